@@ -0,0 +1,49 @@
+#ifndef ESB_BENCH_H_
+#define ESB_BENCH_H_
+
+/*!
+ * \file esb_bench.h
+ * \brief Helpers shared by the host benchmarks
+ * \details Every benchmark is a standalone program on top of the simulated radio (common/host/esb_sim.h). It
+ * prints its measurements and checks the functional results along the way, a failed check makes the program
+ * exit with a non-zero status so the benchmarks double as regression tests (ctest).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/*! \brief Monotonic wall clock time in microseconds */
+static inline uint64_t esb_bench_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (((uint64_t)ts.tv_sec * 1000000u) + ((uint64_t)ts.tv_nsec / 1000u));
+}
+
+/*! \brief Wait until the frames a virtual node queued in the last run are sent or given up
+ *  \details Call before esb_sim_init() for the next run, the simulation keeps the queued frames
+ */
+static inline void esb_bench_settle(void)
+{
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = 200000000};
+    nanosleep(&ts, NULL);
+}
+
+/* number of failed checks, the exit status of the benchmark */
+static int esb_bench_failed = 0;
+
+/*! \brief Check a functional result, reports the failed condition and continues */
+#define ESB_BENCH_CHECK(cond)                                                                        \
+    do {                                                                                             \
+        if (!(cond)) {                                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                 \
+            esb_bench_failed++;                                                                      \
+        }                                                                                            \
+    } while (0)
+
+/*! \brief Exit status of the benchmark */
+#define ESB_BENCH_RESULT() ((esb_bench_failed == 0) ? 0 : 1)
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Radio setup per frame depending on the destinations of the sent messages
+ *
+ * The firmware sends messages to two virtual nodes with esb_protocol_transmit(). The driver only writes the address
+ * registers when the destination changes, and frames queued together share one mode switch. The runs compare a
+ * single destination (sent one by one and queued in bursts) with alternating destinations, which need the address
+ * setup for every change like every frame did before. The register writes and radio inits are counted by the
+ * simulation, the setup time is the mode switch time measured by the driver.
+ *
+ * Usage: esb_bench_addr [messages per run]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+#define BENCH_MSG_CMD 0x91
+
+static const uint8_t g_fw_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+static const uint8_t g_node_addr[2][5] = {{0x55, 0x55, 0x55, 0x55, 0x01}, {0x66, 0x66, 0x66, 0x66, 0x02}};
+
+static volatile uint32_t g_received;
+
+static void esb_bench_node_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    g_received++;
+}
+
+/* sends the messages in bursts, the destination changes every group messages */
+static void esb_bench_run(const char *p_name, uint32_t messages, uint32_t group, uint32_t burst)
+{
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 50, .realtime = 0, .seed = 7};
+    esb_sim_node_t nodes[2];
+    esb_sim_init(&config);
+    esb_sim_node_add(g_node_addr[0], esb_bench_node_rx, &nodes[0]);
+    esb_sim_node_add(g_node_addr[1], esb_bench_node_rx, &nodes[1]);
+    esb_protocol_init(g_fw_addr);
+    g_received = 0;
+
+    esb_sim_stats_t stats_start;
+    esb_sim_get_stats(&stats_start);
+    esb_mode_switch_stats_t switches_start;
+    esb_get_mode_switch_stats(&switches_start);
+
+    for (uint32_t i = 0; i < messages; i += burst) {
+        for (uint32_t k = 0; (k < burst) && ((i + k) < messages); k++) {
+            esb_protocol_message_t message = {.cmd = BENCH_MSG_CMD, .payload_len = 2};
+            message.payload[0] = (uint8_t)(i + k);
+            message.payload[1] = (uint8_t)((i + k) >> 8);
+            memcpy(message.address, g_node_addr[((i + k) / group) & 1], 5);
+            ESB_BENCH_CHECK(esb_protocol_transmit(&message) == ESB_PROT_ERR_OK);
+        }
+        do {
+            esb_protocol_process();
+        } while ((esb_protocol_tx_idle() == 0) || (esb_tx_pending() > 0));
+    }
+
+    esb_sim_stats_t stats;
+    esb_sim_get_stats(&stats);
+    esb_mode_switch_stats_t switches;
+    esb_get_mode_switch_stats(&switches);
+    printf("%-28s %4u/%u received, %.2f mode switches/frame, %.2f address writes/frame, %.2f radio inits/frame, "
+           "setup %.2f us/frame\n",
+           p_name, g_received, messages, (double)(switches.count - switches_start.count) / messages,
+           (double)(stats.addr_writes - stats_start.addr_writes) / messages,
+           (double)(stats.radio_inits - stats_start.radio_inits) / messages,
+           (double)(switches.total_us - switches_start.total_us) / messages);
+    ESB_BENCH_CHECK(g_received == messages);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t messages = (argc > 1) ? (uint32_t)atoi(argv[1]) : 400;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    esb_bench_run("1 destination, one by one", messages, messages, 1);
+    esb_bench_run("1 destination, bursts of 4", messages, messages, 4);
+    esb_bench_run("2 destinations in pairs", messages, 2, 4);
+    esb_bench_run("2 destinations alternating", messages, 1, 4);
+
+    return (ESB_BENCH_RESULT());
+}
@@ -0,0 +1,171 @@
+/*
+ * Main loop iteration time of esb_protocol_process() and esb_protocol_process_budget() under a command flood
+ *
+ * A virtual node floods the firmware with commands, a burst arrives before every main loop iteration, each command
+ * handler busy-waits for a fixed time. Every iteration also queues one notification to a virtual central, e.g. a
+ * sampled value. The iteration time is the wall clock time of the transmit and the process call, the command and
+ * notification rates are per second of that time. The simulation runs in virtual time.
+ *
+ * Usage: esb_bench_budget [iterations] [handler us] [commands per iteration]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/commands/esb_commands.h>
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+#define BENCH_CMD 0x40
+#define BENCH_NOTIFICATION_CMD 0x91
+
+typedef struct {
+    const char *p_name;
+    uint32_t max_items;
+    uint32_t max_us;
+} esb_bench_budget_t;
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_central_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+static const uint8_t g_flood_addr[5] = {0x30, 0x31, 0x32, 0x33, 0x01};
+static const esb_bench_budget_t g_budgets[] = {
+    {"process", 0, 0}, {"budget 2 items", 2, 0}, {"budget 4 items", 4, 0}, {"budget 300 us", 0, 300}};
+
+static esb_sim_node_t g_flood;
+static uint32_t g_handler_us;
+static uint32_t g_handled;
+static uint32_t g_notifications;
+
+static void esb_bench_cmd(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    uint64_t start_us = esb_bench_now_us();
+    while ((esb_bench_now_us() - start_us) < g_handler_us) {
+    }
+    g_handled++;
+    answer->error = ESB_PROT_REPLY_ERR_OK;
+    answer->payload_len = 0;
+}
+
+static esb_cmd_table_item_t g_cmd_table[] = {{BENCH_CMD, 4, esb_bench_cmd}, {0, 0, NULL}};
+
+static void esb_bench_central_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    if (payload[0] == BENCH_NOTIFICATION_CMD) {
+        g_notifications++;
+    }
+}
+
+static int esb_bench_compare(const void *p_a, const void *p_b)
+{
+    uint64_t a = *(const uint64_t *)p_a;
+    uint64_t b = *(const uint64_t *)p_b;
+
+    return ((a < b) ? -1 : (a > b));
+}
+
+static void esb_bench_run(const esb_bench_budget_t *p_budget, uint32_t iterations, uint32_t burst,
+                          uint64_t *p_iteration_us)
+{
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 0, .realtime = 0, .seed = 5};
+    esb_sim_node_t central, fw_rx;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_flood_addr, NULL, &g_flood);
+    esb_sim_node_add(g_central_addr, esb_bench_central_rx, &central);
+    esb_sim_node_add(g_fw_addr, NULL, &fw_rx);
+    esb_protocol_init(g_fw_addr);
+    ESB_BENCH_CHECK(esb_commands_register_app_commands(g_cmd_table, 1) == ESB_PROT_ERR_OK);
+    g_handled = 0;
+    g_notifications = 0;
+
+    uint32_t sent = 0;
+    uint32_t queued = 0;
+    uint32_t pending_max = 0;
+    uint32_t handled_max = 0;
+    uint64_t busy_us = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        /* the burst arrives between two iterations */
+        while (esb_tx_pending() > 0) {
+        }
+        for (uint32_t k = 0; k < burst; k++, sent++) {
+            uint8_t frame[ESB_PROTOCOL_HEADER_SIZE + 4] = {BENCH_CMD, 0};
+            memcpy(&frame[2], g_flood_addr, 5);
+            memcpy(&frame[ESB_PROTOCOL_HEADER_SIZE], &sent, sizeof(sent));
+            esb_sim_tx_result_t result;
+            (void)esb_sim_node_send(g_flood, g_fw_addr, frame, sizeof(frame), &result);
+        }
+
+        uint32_t handled = g_handled;
+        uint64_t start_us = esb_bench_now_us();
+        esb_protocol_message_t message = {.cmd = BENCH_NOTIFICATION_CMD, .payload_len = 4};
+        memcpy(message.address, g_central_addr, 5);
+        memcpy(message.payload, &i, sizeof(i));
+        if (esb_protocol_transmit(&message) == ESB_PROT_ERR_OK) {
+            queued++;
+        }
+        if ((p_budget->max_items > 0) || (p_budget->max_us > 0)) {
+            esb_protocol_pending_t pending;
+            (void)esb_protocol_process_budget(p_budget->max_items, p_budget->max_us, &pending);
+            pending_max = ((pending.rx + pending.tx) > pending_max) ? (pending.rx + pending.tx) : pending_max;
+        } else {
+            (void)esb_protocol_process();
+        }
+        p_iteration_us[i] = esb_bench_now_us() - start_us;
+        busy_us += p_iteration_us[i];
+        handled_max = ((g_handled - handled) > handled_max) ? (g_handled - handled) : handled_max;
+    }
+
+    /* the rest of the queues, not timed */
+    esb_protocol_pending_t pending;
+    do {
+        while (esb_tx_pending() > 0) {
+        }
+        (void)esb_protocol_process_budget(0, 0, &pending);
+    } while ((pending.rx + pending.tx) > 0);
+    while (esb_tx_pending() > 0) {
+    }
+
+    esb_protocol_stats_t stats;
+    esb_protocol_get_stats(&stats);
+    qsort(p_iteration_us, iterations, sizeof(uint64_t), esb_bench_compare);
+    printf("%-15s iteration p50 %5llu p99 %5llu max %6llu us, %5.0f commands/s, %5.0f notifications/s, "
+           "max %u commands/iteration, %4u turned away, %4u busy, max %2u pending\n",
+           p_budget->p_name, (unsigned long long)p_iteration_us[iterations / 2],
+           (unsigned long long)p_iteration_us[(iterations / 100) * 99],
+           (unsigned long long)p_iteration_us[iterations - 1], (busy_us > 0) ? g_handled * 1e6 / busy_us : 0.0,
+           (busy_us > 0) ? queued * 1e6 / busy_us : 0.0, handled_max,
+           stats.counter[ESB_PROT_STAT_RX_DROPPED], stats.counter[ESB_PROT_STAT_RX_BUSY], pending_max);
+
+    /* every command was handled or turned away (with a BUSY reply as long as the BUSY queue had room), every queued
+     * notification was sent */
+    ESB_BENCH_CHECK((g_handled + stats.counter[ESB_PROT_STAT_RX_DROPPED]) == sent);
+    ESB_BENCH_CHECK(g_notifications == queued);
+    if (p_budget->max_items > 0) {
+        ESB_BENCH_CHECK(handled_max <= p_budget->max_items);
+    }
+    if ((p_budget->max_us > 0) && (g_handler_us > 0)) {
+        /* a slice overruns its time by at most one command handler */
+        ESB_BENCH_CHECK(handled_max <= ((p_budget->max_us / g_handler_us) + 1));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = (argc > 1) ? (uint32_t)atoi(argv[1]) : 1000;
+    g_handler_us = (argc > 2) ? (uint32_t)atoi(argv[2]) : 100;
+    uint32_t burst = (argc > 3) ? (uint32_t)atoi(argv[3]) : 4;
+    uint64_t *p_iteration_us = malloc(iterations * sizeof(uint64_t));
+    ESB_BENCH_CHECK(p_iteration_us != NULL);
+    if (p_iteration_us == NULL) {
+        return (ESB_BENCH_RESULT());
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("%u iterations, %u commands per iteration, handler %u us\n", iterations, burst, g_handler_us);
+    for (uint8_t i = 0; i < (sizeof(g_budgets) / sizeof(g_budgets[0])); i++) {
+        esb_bench_run(&g_budgets[i], iterations, burst, p_iteration_us);
+    }
+    free(p_iteration_us);
+
+    return (ESB_BENCH_RESULT());
+}
@@ -0,0 +1,245 @@
+/*
+ * Completion time, timeouts and fairness of two centrals sending to an overloaded peripheral
+ *
+ * The firmware is a peripheral which handles its RX queue once per round of the simulation. A chatty central sends
+ * bursts of 12 requests with a window of 16 outstanding requests, a quiet central sends one request at a time. The
+ * centrals repeat a request at once on a BUSY reply, after a timeout of BENCH_TIMEOUT_ROUNDS rounds without reply
+ * and stop their burst on a back-off hint. The benchmark is built three times:
+ * - esb_bench_busy: BUSY replies, fair admission and back-off hints (default settings of esb_protocol.h)
+ * - esb_bench_busy_unfair: BUSY replies and back-off hints, frames are queued regardless of the sender
+ * - esb_bench_busy_drop: frames which don't fit the RX queue are dropped without reply
+ * The simulation runs in virtual time, the latencies are in rounds.
+ *
+ * Usage: esb_bench_busy [requests of the quiet central]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/commands/esb_commands.h>
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+#define BENCH_CMD_CHATTY 0x40
+#define BENCH_CMD_QUIET 0x41
+#define BENCH_TIMEOUT_ROUNDS 10
+#define BENCH_MAX_ROUNDS 20000
+#define BENCH_SLOTS 64 /* request IDs per central, an ID is reused long after it left the request cache */
+
+typedef enum { BENCH_REQ_IDLE, BENCH_REQ_WAIT, BENCH_REQ_RETRY, BENCH_REQ_DONE } esb_bench_req_state_t;
+
+typedef struct {
+    esb_bench_req_state_t state;
+    uint32_t seq;
+    uint32_t first_round;
+    uint32_t sent_round;
+} esb_bench_req_t;
+
+typedef struct {
+    const char *p_name;
+    const uint8_t *p_addr;
+    uint8_t cmd;
+    uint8_t id_base;
+    uint8_t window;
+    uint8_t burst;
+    uint32_t requests;
+    esb_sim_node_t node;
+    esb_bench_req_t req[BENCH_SLOTS];
+    uint32_t next_seq;
+    uint32_t done;
+    uint32_t done_round;
+    uint64_t latency_sum;
+    uint32_t latency_max;
+    uint32_t sends;
+    uint32_t busy;
+    uint32_t timeouts;
+    uint32_t hints;
+    uint32_t mismatches;
+} esb_bench_central_t;
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_chatty_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+static const uint8_t g_quiet_addr[5] = {0x30, 0x31, 0x32, 0x33, 0x01};
+
+static esb_bench_central_t g_chatty = {.p_name = "chatty",
+                                       .p_addr = g_chatty_addr,
+                                       .cmd = BENCH_CMD_CHATTY,
+                                       .id_base = 1,
+                                       .window = 16,
+                                       .burst = 12};
+static esb_bench_central_t g_quiet = {
+    .p_name = "quiet", .p_addr = g_quiet_addr, .cmd = BENCH_CMD_QUIET, .id_base = 129, .window = 1, .burst = 1};
+static uint32_t g_round;
+static uint32_t g_executions;
+
+static void esb_bench_cmd(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    g_executions++;
+    answer->error = ESB_PROT_REPLY_ERR_OK;
+    memcpy(answer->payload, message->payload, 2);
+    answer->payload_len = 2;
+}
+
+static esb_cmd_table_item_t g_cmd_table[] = {
+    {BENCH_CMD_CHATTY, 2, esb_bench_cmd}, {BENCH_CMD_QUIET, 2, esb_bench_cmd}, {0, 0, NULL}};
+
+static void esb_bench_central_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    esb_bench_central_t *p_central = (payload[0] == BENCH_CMD_CHATTY)  ? &g_chatty
+                                     : (payload[0] == BENCH_CMD_QUIET) ? &g_quiet
+                                                                       : NULL;
+    if ((p_central == NULL) || ((payload[1] & ESB_PROTOCOL_FLAG_REQ_ID) == 0) ||
+        (payload_length < ESB_PROTOCOL_HEADER_SIZE + 1)) {
+        return;
+    }
+
+    uint8_t slot = payload[ESB_PROTOCOL_HEADER_SIZE] - p_central->id_base;
+    esb_bench_req_t *p_req = &p_central->req[slot % BENCH_SLOTS];
+    if (p_req->state != BENCH_REQ_WAIT) {
+        return;
+    }
+    uint8_t error = payload[1] & (uint8_t)~(ESB_PROTOCOL_FLAG_REQ_ID | ESB_PROTOCOL_FLAG_COMPACT);
+    if (error == ESB_PROT_REPLY_ERR_BUSY) {
+        p_req->state = BENCH_REQ_RETRY;
+        p_central->busy++;
+        return;
+    }
+
+    /* the reply echoes the sequence number, a reply of an earlier request with the same ID is a mismatch */
+    if ((payload_length < ESB_PROTOCOL_HEADER_SIZE + 3) ||
+        (payload[ESB_PROTOCOL_HEADER_SIZE + 1] != (uint8_t)p_req->seq) ||
+        (payload[ESB_PROTOCOL_HEADER_SIZE + 2] != (uint8_t)(p_req->seq >> 8))) {
+        p_central->mismatches++;
+    }
+    p_req->state = BENCH_REQ_DONE;
+    p_central->done++;
+    uint32_t latency = g_round - p_req->first_round;
+    p_central->latency_sum += latency;
+    p_central->latency_max = (latency > p_central->latency_max) ? latency : p_central->latency_max;
+    if (p_central->done == p_central->requests) {
+        p_central->done_round = g_round;
+    }
+}
+
+/* sends a request, returns 1 if the peripheral attached a back-off hint to the ACK */
+static uint8_t esb_bench_send(esb_bench_central_t *p_central, uint8_t slot)
+{
+    esb_bench_req_t *p_req = &p_central->req[slot];
+    uint8_t frame[ESB_PROTOCOL_HEADER_SIZE + 3] = {p_central->cmd, ESB_PROTOCOL_FLAG_REQ_ID};
+    memcpy(&frame[2], p_central->p_addr, 5);
+    frame[ESB_PROTOCOL_HEADER_SIZE] = p_central->id_base + slot;
+    frame[ESB_PROTOCOL_HEADER_SIZE + 1] = (uint8_t)p_req->seq;
+    frame[ESB_PROTOCOL_HEADER_SIZE + 2] = (uint8_t)(p_req->seq >> 8);
+
+    esb_sim_tx_result_t result;
+    (void)esb_sim_node_send(p_central->node, g_fw_addr, frame, sizeof(frame), &result);
+    p_central->sends++;
+    p_req->state = BENCH_REQ_WAIT;
+    p_req->sent_round = g_round;
+    if ((result.ack_payload_length > 0) && (result.ack_payload[0] == ESB_PROTOCOL_CMD_BUSY_HINT)) {
+        p_central->hints++;
+        return (1);
+    }
+
+    return (0);
+}
+
+/* one round of a central: repeats the requests answered with BUSY or timed out, then sends new ones */
+static void esb_bench_central_round(esb_bench_central_t *p_central)
+{
+    uint32_t outstanding = 0;
+    uint8_t sent = 0;
+    uint8_t hint = 0;
+
+    for (uint8_t slot = 0; slot < BENCH_SLOTS; slot++) {
+        esb_bench_req_t *p_req = &p_central->req[slot];
+        if ((p_req->state == BENCH_REQ_WAIT) && ((g_round - p_req->sent_round) >= BENCH_TIMEOUT_ROUNDS)) {
+            p_req->state = BENCH_REQ_RETRY;
+            p_central->timeouts++;
+        }
+        outstanding += ((p_req->state == BENCH_REQ_WAIT) || (p_req->state == BENCH_REQ_RETRY)) ? 1 : 0;
+    }
+
+    for (uint8_t slot = 0; (slot < BENCH_SLOTS) && (sent < p_central->burst) && (hint == 0); slot++) {
+        if (p_central->req[slot].state == BENCH_REQ_RETRY) {
+            hint = esb_bench_send(p_central, slot);
+            sent++;
+        }
+    }
+
+    while ((sent < p_central->burst) && (hint == 0) && (outstanding < p_central->window) &&
+           (p_central->next_seq < p_central->requests)) {
+        uint8_t slot = p_central->next_seq % BENCH_SLOTS;
+        esb_bench_req_t *p_req = &p_central->req[slot];
+        if ((p_req->state == BENCH_REQ_WAIT) || (p_req->state == BENCH_REQ_RETRY)) {
+            break;
+        }
+        p_req->state = BENCH_REQ_WAIT;
+        p_req->seq = p_central->next_seq++;
+        p_req->first_round = g_round;
+        outstanding++;
+        hint = esb_bench_send(p_central, slot);
+        sent++;
+    }
+}
+
+static void esb_bench_report(const esb_bench_central_t *p_central)
+{
+    printf("%-6s %4u/%u done after %5u rounds, latency avg %5.1f max %3u rounds, %5u sends, %4u busy, "
+           "%4u timeouts, %3u hints\n",
+           p_central->p_name, p_central->done, p_central->requests, p_central->done_round,
+           (p_central->done > 0) ? (double)p_central->latency_sum / p_central->done : 0.0, p_central->latency_max,
+           p_central->sends, p_central->busy, p_central->timeouts, p_central->hints);
+    ESB_BENCH_CHECK(p_central->done == p_central->requests);
+    ESB_BENCH_CHECK(p_central->mismatches == 0);
+    if (ESB_PROTOCOL_BUSY_REPLY != 0) {
+        /* no frame loss, every request gets a reply or a BUSY reply */
+        ESB_BENCH_CHECK(p_central->timeouts == 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    g_quiet.requests = (argc > 1) ? (uint32_t)atoi(argv[1]) : 200;
+    g_chatty.requests = g_quiet.requests * 20;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("BUSY reply %u, fair admission %u, back-off hint %u, RX queue %u\n", ESB_PROTOCOL_BUSY_REPLY,
+           ESB_PROTOCOL_RX_FAIR, ESB_PROTOCOL_BUSY_HINT, ESB_PROTOCOL_RX_QUEUE_SIZE);
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 50, .realtime = 0, .seed = 3};
+    esb_sim_node_t central_rx;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_chatty_addr, NULL, &g_chatty.node);
+    esb_sim_node_add(g_quiet_addr, NULL, &g_quiet.node);
+    esb_sim_node_add(g_fw_addr, esb_bench_central_rx, &central_rx);
+    esb_protocol_init(g_fw_addr);
+    ESB_BENCH_CHECK(esb_commands_register_app_commands(g_cmd_table, 2) == ESB_PROT_ERR_OK);
+
+    for (g_round = 0; (g_round < BENCH_MAX_ROUNDS) &&
+                      ((g_chatty.done < g_chatty.requests) || (g_quiet.done < g_quiet.requests));
+         g_round++) {
+        esb_bench_central_round(&g_chatty);
+        esb_bench_central_round(&g_quiet);
+        esb_protocol_process();
+        while (esb_tx_pending() > 0) {
+        }
+    }
+
+    esb_sim_stats_t stats;
+    esb_sim_get_stats(&stats);
+    esb_protocol_stats_t protocol_stats;
+    esb_protocol_get_stats(&protocol_stats);
+    esb_bench_report(&g_chatty);
+    esb_bench_report(&g_quiet);
+    printf("peripheral: %u executions, %u busy, %u dropped, %u hints sent, %u frames on air\n", g_executions,
+           protocol_stats.counter[ESB_PROT_STAT_RX_BUSY], protocol_stats.counter[ESB_PROT_STAT_RX_DROPPED],
+           protocol_stats.counter[ESB_PROT_STAT_TX_BUSY_HINTS], stats.frames);
+    if ((ESB_PROTOCOL_BUSY_REPLY != 0) && (ESB_PROTOCOL_RX_FAIR != 0)) {
+        /* the quiet central is never turned away, it finishes at its own pace */
+        ESB_BENCH_CHECK(g_quiet.busy == 0);
+        ESB_BENCH_CHECK(g_quiet.done_round < g_quiet.requests);
+    }
+
+    return (ESB_BENCH_RESULT());
+}
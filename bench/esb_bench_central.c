@@ -0,0 +1,164 @@
+/*
+ * Notification ingest of the central against the number of peripherals
+ *
+ * A virtual node sends the notifications of N peripherals to the firmware (central/central.h), alternating the
+ * single channel (0x91) and the batch format (0x94). The peripherals are told apart by the address in the
+ * notification, so one virtual node stands in for all of them. The simulation runs as fast as possible, the time
+ * of esb_protocol_process() plus central_process() per notification is measured and should not grow with N.
+ * Every run is done with similar addresses (differing in two bytes, as assigned by an installer) and with
+ * scattered addresses.
+ *
+ * Usage: esb_bench_central [peripherals] [rounds]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <central/central.h>
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+/* notifications between two calls of central_process() */
+#define BENCH_PROCESS_INTERVAL 50
+
+static const uint8_t g_central_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+static const uint8_t g_node_addr[5] = {0x09, 0x09, 0x09, 0x09, 0x09};
+
+static uint32_t g_expected[CENTRAL_MAX_DEVICES];
+static uint32_t g_upstream_events;
+
+static void esb_bench_upstream(const central_event_t *p_events, uint16_t num_events)
+{
+    g_upstream_events += num_events;
+}
+
+static void esb_bench_periph_addr(uint16_t idx, uint8_t scattered, uint8_t address[5])
+{
+    if (scattered != 0) {
+        uint32_t x = ((uint32_t)idx * 2654435761u) + 12345u;
+        x ^= x >> 13;
+        x *= 0x5bd1e995u;
+        x ^= x >> 15;
+        address[0] = (uint8_t)x;
+        address[1] = (uint8_t)(x >> 8);
+        address[2] = (uint8_t)(x >> 16);
+        address[3] = (uint8_t)(x >> 24);
+        address[4] = (uint8_t)idx;
+    } else {
+        address[0] = 0x55;
+        address[1] = 0x55;
+        address[2] = (uint8_t)(idx >> 8);
+        address[3] = 0x55;
+        address[4] = (uint8_t)idx;
+    }
+}
+
+static void esb_bench_run(uint16_t peripherals, uint32_t rounds, uint8_t scattered)
+{
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 50, .realtime = 0, .seed = 7};
+    esb_sim_node_t node;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_node_addr, NULL, &node);
+    esb_protocol_init(g_central_addr);
+    ESB_BENCH_CHECK(central_init(esb_bench_upstream, NULL) == ESB_PROT_ERR_OK);
+
+    memset(g_expected, 0, sizeof(g_expected));
+    g_upstream_events = 0;
+    srand(1);
+
+    uint32_t sent = 0;
+    uint64_t process_us = 0;
+    for (uint32_t r = 0; r < rounds; r++) {
+        for (uint16_t i = 0; i < peripherals; i++) {
+            uint8_t address[5];
+            esb_bench_periph_addr(i, scattered, address);
+
+            uint8_t chan = (uint8_t)(rand() % 32);
+            uint8_t value = (uint8_t)(rand() & 1);
+            uint8_t frame[ESB_FRAME_SIZE] = {0};
+            uint8_t length;
+            frame[1] = (uint8_t)r;
+            memcpy(&frame[2], address, 5);
+            if (((r + i) & 1) != 0) {
+                frame[0] = 0x91;
+                memcpy(&frame[7], address, 5);
+                frame[12] = chan;
+                frame[13] = value;
+                length = 14;
+            } else {
+                frame[0] = 0x94;
+                frame[7] = chan & ~0x07u;
+                frame[8] = 1;
+                frame[9] = (uint8_t)(1u << (chan % 8));
+                frame[10] = (uint8_t)(value << (chan % 8));
+                length = 11;
+            }
+
+            esb_sim_tx_result_t result;
+            (void)esb_sim_node_send(node, g_central_addr, frame, length, &result);
+            if (result.acked == 0) {
+                continue;
+            }
+            sent++;
+            if (value != 0) {
+                g_expected[i] |= (1u << chan);
+            } else {
+                g_expected[i] &= ~(1u << chan);
+            }
+
+            uint64_t start = esb_bench_now_us();
+            esb_protocol_process();
+            if ((sent % BENCH_PROCESS_INTERVAL) == 0) {
+                central_process();
+            }
+            process_us += esb_bench_now_us() - start;
+        }
+    }
+    central_process();
+
+    uint32_t mismatches = 0;
+    for (uint16_t i = 0; i < peripherals; i++) {
+        uint8_t address[5];
+        esb_bench_periph_addr(i, scattered, address);
+        const central_device_t *p_device = central_find_device(address);
+        if ((p_device == NULL) || (p_device->chan_values[0] != g_expected[i])) {
+            mismatches++;
+        }
+    }
+
+    central_stats_t stats;
+    central_get_stats(&stats);
+    printf("%3u peripherals, %s addresses: %5u/%u notifications, %u mismatches, %5u events in %4u upstream calls, "
+           "max probe %2u, %.2f us/notification\n",
+           peripherals, (scattered != 0) ? "scattered" : "similar  ", stats.notifications, sent, mismatches,
+           stats.events, stats.upstream_calls, stats.max_probe, (sent > 0) ? (double)process_us / sent : 0.0);
+    ESB_BENCH_CHECK(sent == (rounds * peripherals));
+    ESB_BENCH_CHECK(stats.notifications == sent);
+    ESB_BENCH_CHECK(stats.devices == peripherals);
+    ESB_BENCH_CHECK(stats.table_full == 0);
+    ESB_BENCH_CHECK(mismatches == 0);
+    ESB_BENCH_CHECK(g_upstream_events == stats.events);
+}
+
+int main(int argc, char **argv)
+{
+    static const uint16_t peripherals[] = {16, 150, CENTRAL_MAX_DEVICES};
+    uint32_t rounds = (argc > 2) ? (uint32_t)atoi(argv[2]) : 20;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("table size %u, at most %u peripherals, %u rounds\n", CENTRAL_TABLE_SIZE, CENTRAL_MAX_DEVICES, rounds);
+
+    for (uint8_t scattered = 0; scattered < 2; scattered++) {
+        if (argc > 1) {
+            uint16_t n = (uint16_t)atoi(argv[1]);
+            esb_bench_run((n < CENTRAL_MAX_DEVICES) ? n : CENTRAL_MAX_DEVICES, rounds, scattered);
+        } else {
+            for (uint8_t i = 0; i < (sizeof(peripherals) / sizeof(peripherals[0])); i++) {
+                esb_bench_run(peripherals[i], rounds, scattered);
+            }
+        }
+    }
+
+    return (ESB_BENCH_RESULT());
+}
@@ -0,0 +1,176 @@
+/*
+ * Throughput and recovery time of the channel agility under injected interference
+ *
+ * The firmware is a peripheral (esb_channel_init() with the central address) and sends messages to a virtual
+ * central. The simulation runs in virtual time, the throughput is based on the air time including retransmits.
+ * - clean channel, then interference of 90% on the first hop while the peripheral stays there
+ * - the central announces another hop with ESB_CMD_CHANNEL_MAP and moves there
+ * - the central moves to another hop without announcement, the peripheral has to rediscover it
+ * - the central is gone, the peripheral cycles through its searches with back-off
+ *
+ * Usage: esb_bench_channel [messages per run]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_channel.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+#define BENCH_MSG_CMD 0x30
+#define BENCH_INTERFERENCE_PERMILLE 900
+#define BENCH_ANNOUNCED_HOP 1   /* channel 25 of the default sequence */
+#define BENCH_UNANNOUNCED_HOP 3 /* channel 76 of the default sequence */
+#define BENCH_OFF_CHANNEL 2     /* not in the default sequence */
+#define BENCH_SEARCH_MAX_MSGS 100
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_central_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+static const uint8_t g_sequence[] = ESB_CHANNEL_DEFAULT_SEQUENCE;
+
+static esb_sim_node_t g_central;
+static volatile uint32_t g_received;
+static uint16_t g_seq;
+
+static void esb_bench_central_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    if (payload[0] == BENCH_MSG_CMD) {
+        g_received++;
+    }
+}
+
+static void esb_bench_loop(uint8_t agile)
+{
+    esb_protocol_process();
+    if (agile != 0) {
+        esb_channel_process();
+    }
+}
+
+/* sends the messages and waits for their completion, returns the number received by the central */
+static uint32_t esb_bench_send(uint32_t messages, uint8_t agile, uint64_t *p_duration_us)
+{
+    uint32_t received = g_received;
+    uint64_t start_us = esb_sim_time_us();
+
+    for (uint32_t i = 0; i < messages; i++) {
+        esb_protocol_message_t message = {.cmd = BENCH_MSG_CMD, .payload_len = 16};
+        g_seq++;
+        message.payload[0] = (uint8_t)g_seq;
+        message.payload[1] = (uint8_t)(g_seq >> 8);
+        memcpy(message.address, g_central_addr, 5);
+        while (esb_protocol_transmit(&message) != ESB_PROT_ERR_OK) {
+            esb_bench_loop(agile);
+        }
+        esb_bench_loop(agile);
+    }
+    while (esb_protocol_tx_idle() == 0) {
+        esb_bench_loop(agile);
+    }
+    esb_bench_loop(agile);
+
+    if (p_duration_us != NULL) {
+        *p_duration_us = esb_sim_time_us() - start_us;
+    }
+
+    return (g_received - received);
+}
+
+static void esb_bench_report(const char *p_name, uint32_t received, uint32_t messages, uint64_t duration_us)
+{
+    printf("%-28s channel %2u, %4u/%u received, %5.0f messages/s\n", p_name, esb_get_rf_channel(), received, messages,
+           (duration_us > 0) ? received * 1e6 / duration_us : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t messages = (argc > 1) ? (uint32_t)atoi(argv[1]) : 500;
+    uint64_t duration_us;
+    uint32_t received;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    esb_sim_config_t config = {.loss_permille = 20, .latency_us = 20, .realtime = 0, .seed = 5};
+    esb_sim_init(&config);
+    esb_sim_node_add(g_central_addr, esb_bench_central_rx, &g_central);
+    esb_protocol_init(g_fw_addr);
+    ESB_BENCH_CHECK(esb_channel_init(g_central_addr) == ESB_PROT_ERR_OK);
+
+    received = esb_bench_send(messages, 1, &duration_us);
+    esb_bench_report("clean", received, messages, duration_us);
+    ESB_BENCH_CHECK(received == messages);
+
+    esb_sim_set_interference(g_sequence[0], BENCH_INTERFERENCE_PERMILLE);
+    received = esb_bench_send(messages, 0, &duration_us);
+    esb_bench_report("interference, no agility", received, messages, duration_us);
+
+    /* the central announces the hop until the ESB ACK confirms it, then moves itself */
+    uint8_t map[ESB_PROTOCOL_HEADER_SIZE + ESB_CHANNEL_MAP_LEN(sizeof(g_sequence))] = {ESB_CMD_CHANNEL_MAP, 0};
+    memcpy(&map[2], g_central_addr, 5);
+    map[ESB_PROTOCOL_HEADER_SIZE] = BENCH_ANNOUNCED_HOP;
+    map[ESB_PROTOCOL_HEADER_SIZE + 1] = sizeof(g_sequence);
+    memcpy(&map[ESB_PROTOCOL_HEADER_SIZE + 2], g_sequence, sizeof(g_sequence));
+    uint32_t tries = 0;
+    uint64_t start_us = esb_sim_time_us();
+    esb_sim_tx_result_t result;
+    do {
+        (void)esb_sim_node_send(g_central, g_fw_addr, map, sizeof(map), &result);
+        tries++;
+    } while (result.acked == 0);
+    uint64_t announce_us = esb_sim_time_us() - start_us;
+    esb_sim_node_set_rf_channel(g_central, g_sequence[BENCH_ANNOUNCED_HOP]);
+    start_us = esb_sim_time_us();
+    while (esb_get_rf_channel() != g_sequence[BENCH_ANNOUNCED_HOP]) {
+        esb_bench_loop(1);
+    }
+    uint64_t switch_us = esb_sim_time_us() - start_us;
+    received = esb_bench_send(messages, 1, &duration_us);
+    esb_bench_report("announced hop", received, messages, duration_us);
+    printf("%-28s %u tries in %llu us, moved %llu us after the ACK\n", "  announcement", tries,
+           (unsigned long long)announce_us, (unsigned long long)switch_us);
+    ESB_BENCH_CHECK(received == messages);
+
+    /* the central moves without announcement, the peripheral searches it */
+    esb_sim_node_set_rf_channel(g_central, g_sequence[BENCH_UNANNOUNCED_HOP]);
+    start_us = esb_sim_time_us();
+    uint32_t sent = 0;
+    received = 0;
+    while (((esb_get_rf_channel() != g_sequence[BENCH_UNANNOUNCED_HOP]) ||
+            (esb_channel_get_state() != ESB_CHANNEL_STATE_SYNCED)) &&
+           (sent < BENCH_SEARCH_MAX_MSGS)) {
+        received += esb_bench_send(1, 1, NULL);
+        sent++;
+    }
+    uint64_t recovery_us = esb_sim_time_us() - start_us;
+    esb_channel_stats_t stats;
+    esb_channel_get_stats(&stats);
+    printf("%-28s channel %2u after %llu us, %u messages sent, %u received, %u probes\n", "unannounced move",
+           esb_get_rf_channel(), (unsigned long long)recovery_us, sent, received, stats.probes);
+    ESB_BENCH_CHECK(esb_get_rf_channel() == g_sequence[BENCH_UNANNOUNCED_HOP]);
+    ESB_BENCH_CHECK(esb_channel_get_state() == ESB_CHANNEL_STATE_SYNCED);
+
+    received = esb_bench_send(messages, 1, &duration_us);
+    esb_bench_report("after rediscovery", received, messages, duration_us);
+    ESB_BENCH_CHECK(received == messages);
+
+    uint16_t scores[ESB_CHANNEL_MAX_HOPS];
+    uint8_t hops = esb_channel_get_quality(scores);
+    printf("%-28s", "  scores (16 = no retries)");
+    for (uint8_t i = 0; i < hops; i++) {
+        printf(" %u", scores[i]);
+    }
+    printf(", best hop %u\n", esb_channel_best_hop());
+    ESB_BENCH_CHECK(esb_channel_best_hop() != 0);
+
+    /* the central is gone */
+    esb_sim_node_set_rf_channel(g_central, BENCH_OFF_CHANNEL);
+    received = esb_bench_send(20, 1, &duration_us);
+    esb_channel_get_stats(&stats);
+    printf("%-28s state %u, %u searches, %u probes, %llu us air time for 20 messages\n", "central gone",
+           esb_channel_get_state(), stats.searches, stats.probes, (unsigned long long)duration_us);
+    ESB_BENCH_CHECK(received == 0);
+    ESB_BENCH_CHECK(esb_channel_get_state() != ESB_CHANNEL_STATE_SYNCED);
+
+    return (ESB_BENCH_RESULT());
+}
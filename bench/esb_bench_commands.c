@@ -0,0 +1,165 @@
+/*
+ * Dispatch of all registered commands and lookup time of the command index
+ *
+ * The firmware registers the commands of all modules (common commands, channel agility, PHY selection,
+ * fragmentation, binary sensor, central) and one application command. A virtual node then sends every command
+ * found in the dispatch index with its payload size, each one has to reach its handler (no unknown command and no
+ * size mismatch). Tables with a duplicate ID or with an ID taken by another handler have to be rejected. The
+ * lookup time is the wall clock time of esb_commands_lookup() over all command IDs. The benchmark is built twice,
+ * with the index built at registration (esb_bench_commands) and with the constant index of all modules
+ * (esb_bench_commands_static, ESB_COMMANDS_STATIC_INDEX=1, compiled with -Werror=override-init so two static
+ * entries with the same ID don't build). The simulation runs in virtual time.
+ *
+ * Usage: esb_bench_commands [lookup rounds]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <binary-sensor/binary_sensor.h>
+#include <binary-sensor/binary_sensor_esb_cmd_def.h>
+#include <central/central.h>
+#include <central/central_esb_cmd_def.h>
+#include <common/commands/esb_cmd_def_common.h>
+#include <common/commands/esb_commands.h>
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_channel.h>
+#include <common/protocol/esb_fragment.h>
+#include <common/protocol/esb_phy.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+#define BENCH_CMD 0xA0
+#define BENCH_UNKNOWN_CMD 0xA1
+#define BENCH_CMD_NUM 20 /* common 6, channel 2, PHY 2, fragment 2, binary sensor 4, central 3, bench 1 */
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_node_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+
+static uint32_t g_handled;
+
+static void esb_bench_cmd(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    g_handled++;
+    answer->error = ESB_PROT_REPLY_ERR_OK;
+    answer->payload_len = 0;
+}
+
+static esb_cmd_table_item_t g_cmd_table[] = {{BENCH_CMD, 4, esb_bench_cmd}, {0, 0, NULL}};
+static esb_cmd_table_item_t g_dup_table[] = {
+    {BENCH_CMD, 4, esb_bench_cmd}, {BENCH_CMD, 4, esb_bench_cmd}, {0, 0, NULL}};
+static esb_cmd_table_item_t g_taken_table[] = {{ESB_CMD_VERSION, 0, esb_bench_cmd}, {0, 0, NULL}};
+
+#ifdef ESB_COMMANDS_STATIC_INDEX
+const esb_cmd_table_item_t *const esb_commands_static_index[ESB_COMMANDS_INDEX_SIZE] = {
+    ESB_CMD_TABLE_COMMON_STATIC_ENTRIES,
+    ESB_CHANNEL_STATIC_ENTRIES,
+    ESB_PHY_STATIC_ENTRIES,
+    ESB_FRAGMENT_STATIC_ENTRIES,
+    BINARY_SENSOR_ESB_CMD_STATIC_ENTRIES,
+    CENTRAL_ESB_CMD_STATIC_ENTRIES,
+    ESB_COMMANDS_STATIC_ENTRY(BENCH_CMD, 4, esb_bench_cmd),
+};
+#endif
+
+static void esb_bench_upstream(const central_event_t *p_events, uint16_t num_events)
+{
+}
+
+static void esb_bench_fragment_rx(const uint8_t address[5], uint8_t cmd, const uint8_t *p_data, uint16_t length)
+{
+}
+
+static uint64_t esb_bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = (argc > 1) ? (uint32_t)atoi(argv[1]) : 100000;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 20, .realtime = 0, .seed = 5};
+    esb_sim_node_t node, node_rx;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_node_addr, NULL, &node);
+    esb_sim_node_add(g_fw_addr, NULL, &node_rx);
+    esb_protocol_init(g_fw_addr);
+#ifdef ESB_COMMANDS_STATIC_INDEX
+    printf("static command index\n");
+#else
+    printf("command index built at registration\n");
+#endif
+
+    /* every module finds its table in the index */
+    ESB_BENCH_CHECK(esb_channel_init(g_node_addr) == ESB_PROT_ERR_OK);
+    ESB_BENCH_CHECK(esb_phy_init(g_node_addr) == ESB_PROT_ERR_OK);
+    ESB_BENCH_CHECK(esb_fragment_init(esb_bench_fragment_rx) == ESB_PROT_ERR_OK);
+    ESB_BENCH_CHECK(binary_sensor_init(g_fw_addr) == ESB_PROT_ERR_OK);
+    ESB_BENCH_CHECK(central_init(esb_bench_upstream, NULL) == ESB_PROT_ERR_OK);
+    ESB_BENCH_CHECK(esb_commands_register_app_commands(g_cmd_table, 1) == ESB_PROT_ERR_OK);
+
+    /* duplicate IDs in a table, an ID taken by another handler */
+    ESB_BENCH_CHECK(esb_commands_register_app_commands(g_dup_table, 2) == ESB_PROT_ERR_DUPLICATE);
+#ifdef ESB_COMMANDS_STATIC_INDEX
+    ESB_BENCH_CHECK(esb_commands_register_app_commands(g_taken_table, 1) == ESB_PROT_ERR_VALUE);
+#else
+    ESB_BENCH_CHECK(esb_commands_register_app_commands(g_taken_table, 1) == ESB_PROT_ERR_DUPLICATE);
+#endif
+    ESB_BENCH_CHECK(esb_commands_find(ESB_CMD_VERSION)->cmd_fct_pnt == esb_cmd_fct_get_version);
+
+    /* send every registered command with its payload size */
+    uint32_t registered = 0;
+    for (uint32_t cmd = 0; cmd < ESB_COMMANDS_INDEX_SIZE; cmd++) {
+        const esb_cmd_table_item_t *p_entry = esb_commands_find((uint8_t)cmd);
+        if (p_entry == NULL) {
+            continue;
+        }
+        ESB_BENCH_CHECK(p_entry->cmd_id == cmd);
+        registered++;
+
+        uint8_t payload_len = (p_entry->payload_size == ESB_CMD_PAYLOAD_LEN_DYN) ? 0 : p_entry->payload_size;
+        uint8_t frame[ESB_FRAME_SIZE] = {(uint8_t)cmd, 0};
+        memcpy(&frame[2], g_node_addr, 5);
+        esb_sim_tx_result_t result;
+        (void)esb_sim_node_send(node, g_fw_addr, frame, ESB_PROTOCOL_HEADER_SIZE + payload_len, &result);
+        do {
+            esb_protocol_process();
+        } while (esb_tx_pending() > 0);
+    }
+    uint8_t frame[ESB_PROTOCOL_HEADER_SIZE] = {BENCH_UNKNOWN_CMD, 0};
+    memcpy(&frame[2], g_node_addr, 5);
+    esb_sim_tx_result_t result;
+    (void)esb_sim_node_send(node, g_fw_addr, frame, sizeof(frame), &result);
+    do {
+        esb_protocol_process();
+    } while (esb_tx_pending() > 0);
+
+    esb_protocol_stats_t stats;
+    esb_protocol_get_stats(&stats);
+
+    /* lookup of all IDs, registered or not */
+    uint32_t found = 0;
+    uint64_t start_ns = esb_bench_now_ns();
+    for (uint32_t round = 0; round < rounds; round++) {
+        for (uint32_t cmd = 0; cmd < ESB_COMMANDS_INDEX_SIZE; cmd++) {
+            found += (esb_commands_lookup((uint8_t)cmd, 0) != NULL) ? 1 : 0;
+        }
+    }
+    double lookup_ns = (double)(esb_bench_now_ns() - start_ns) / ((double)rounds * ESB_COMMANDS_INDEX_SIZE);
+
+    printf("%u commands registered, %u frames received, %u unknown, %u size mismatches, lookup %.2f ns (%u hits)\n",
+           registered, stats.counter[ESB_PROT_STAT_RX_FRAMES], stats.counter[ESB_PROT_STAT_CMD_UNKNOWN],
+           stats.counter[ESB_PROT_STAT_CMD_SIZE_MISMATCH], lookup_ns, found);
+    ESB_BENCH_CHECK(registered == BENCH_CMD_NUM);
+    ESB_BENCH_CHECK(stats.counter[ESB_PROT_STAT_RX_FRAMES] == (registered + 1));
+    ESB_BENCH_CHECK(stats.counter[ESB_PROT_STAT_CMD_UNKNOWN] == 1);
+    ESB_BENCH_CHECK(stats.counter[ESB_PROT_STAT_CMD_SIZE_MISMATCH] == 0);
+    ESB_BENCH_CHECK(g_handled == 1);
+
+    return (ESB_BENCH_RESULT());
+}
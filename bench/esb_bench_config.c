@@ -0,0 +1,237 @@
+/*
+ * Power loss recovery and write cost of the configuration store
+ *
+ * The store runs on the RAM storage backend. A sequence of batches is committed to small pages, so the commits
+ * alternate between appending a batch with its commit record and compacting the live items into the next page.
+ * Every commit is repeated from the storage image before it with the power cut after each byte it programs (and
+ * before each page erase), after the restart esb_config_init() has to return the last committed values: the old
+ * ones for a cut commit, the new ones for a complete one. The recovered store has to take the batch again.
+ * The write cost is measured on pages of 4 KiB with the same number of SETs committed one at a time and in
+ * batches: bytes programmed per SET, commits, compactions and erases of each page.
+ *
+ * Usage: esb_bench_config [SETs]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/config/esb_config.h>
+#include <common/config/esb_config_storage_ram.h>
+
+#include "esb_bench.h"
+
+#define BENCH_CUT_PAGE_SIZE 256
+#define BENCH_CUT_BATCHES 12
+#define BENCH_PAGE_SIZE 4096
+#define BENCH_PAGES 4
+#define BENCH_KEYS 8
+#define BENCH_BATCH_SETS BENCH_KEYS /* SETs per commit of the batched run, one per key */
+
+typedef struct {
+    uint8_t set;
+    uint8_t length;
+    uint8_t value[ESB_CONFIG_MAX_VALUE_LEN];
+} esb_bench_item_t;
+
+static uint8_t g_memory[BENCH_PAGE_SIZE * BENCH_PAGES];
+static uint8_t g_image[BENCH_PAGE_SIZE * BENCH_PAGES];
+static esb_config_storage_t g_storage;
+static esb_config_storage_ram_t g_ram;
+static esb_protocol_err_t (*g_ram_erase)(const esb_config_storage_t *p_storage, uint8_t page);
+static uint32_t g_page_erases[BENCH_PAGES];
+
+static esb_protocol_err_t esb_bench_erase(const esb_config_storage_t *p_storage, uint8_t page)
+{
+    esb_protocol_err_t result = g_ram_erase(p_storage, page);
+    if (result == ESB_PROT_ERR_OK) {
+        g_page_erases[page]++;
+    }
+    return (result);
+}
+
+/* RAM storage with erases counted per page */
+static void esb_bench_storage_init(uint32_t page_size)
+{
+    ESB_BENCH_CHECK(esb_config_storage_ram_init(&g_storage, &g_ram, g_memory, page_size, BENCH_PAGES) ==
+                    ESB_PROT_ERR_OK);
+    g_ram_erase = g_storage.erase;
+    g_storage.erase = esb_bench_erase;
+    memset(g_page_erases, 0, sizeof(g_page_erases));
+}
+
+/* the values of batch n: every key in the first one, later about two out of three with changing lengths */
+static void esb_bench_batch(uint32_t batch, esb_bench_item_t *p_items)
+{
+    memset(p_items, 0, sizeof(esb_bench_item_t) * BENCH_KEYS);
+    for (uint8_t key = 0; key < BENCH_KEYS; key++) {
+        if ((batch > 0) && (((key + batch) % 3) == 0)) {
+            continue;
+        }
+        p_items[key].set = 1;
+        p_items[key].length = (uint8_t)(1 + (((key * 7) + (batch * 5)) % ESB_CONFIG_MAX_VALUE_LEN));
+        for (uint8_t i = 0; i < p_items[key].length; i++) {
+            p_items[key].value[i] = (uint8_t)((batch * 31) + (key * 17) + i);
+        }
+    }
+}
+
+static void esb_bench_batch_set(const esb_bench_item_t *p_items)
+{
+    for (uint8_t key = 0; key < BENCH_KEYS; key++) {
+        if (p_items[key].set != 0) {
+            ESB_BENCH_CHECK(esb_config_set(key, p_items[key].value, p_items[key].length) == ESB_PROT_ERR_OK);
+        }
+    }
+}
+
+/* the committed values after the batch */
+static void esb_bench_batch_apply(esb_bench_item_t *p_state, const esb_bench_item_t *p_items)
+{
+    for (uint8_t key = 0; key < BENCH_KEYS; key++) {
+        if (p_items[key].set != 0) {
+            p_state[key] = p_items[key];
+        }
+    }
+}
+
+/* returns 1 if the store holds exactly the values of the state */
+static uint8_t esb_bench_verify(const esb_bench_item_t *p_state)
+{
+    for (uint8_t key = 0; key < BENCH_KEYS; key++) {
+        uint8_t value[ESB_CONFIG_MAX_VALUE_LEN];
+        uint8_t length;
+        esb_protocol_err_t result = esb_config_get(key, value, sizeof(value), &length);
+        if (p_state[key].set == 0) {
+            if (result != ESB_PROT_ERR_VALUE) {
+                return (0);
+            }
+        } else if ((result != ESB_PROT_ERR_OK) || (length != p_state[key].length) ||
+                   (memcmp(value, p_state[key].value, length) != 0)) {
+            return (0);
+        }
+    }
+    return (1);
+}
+
+/* restart from the image, ESB_PROT_ERR_OK if the store comes up */
+static esb_protocol_err_t esb_bench_restart(const uint8_t *p_image)
+{
+    g_ram.fail_after = 0;
+    if (p_image != NULL) {
+        memcpy(g_memory, p_image, sizeof(g_memory));
+    }
+    return (esb_config_init(&g_storage));
+}
+
+/* commits the batches, each one with a power cut at every byte it programs, returns the wrong recoveries */
+static uint32_t esb_bench_power_cuts(uint32_t *p_commit_cuts, uint32_t *p_compaction_cuts)
+{
+    esb_bench_item_t state[BENCH_KEYS] = {0};
+    esb_bench_item_t next[BENCH_KEYS];
+    esb_bench_item_t items[BENCH_KEYS];
+    uint32_t wrong = 0;
+
+    esb_bench_storage_init(BENCH_CUT_PAGE_SIZE);
+    ESB_BENCH_CHECK(esb_config_init(&g_storage) == ESB_PROT_ERR_OK);
+    *p_commit_cuts = 0;
+    *p_compaction_cuts = 0;
+
+    for (uint32_t batch = 0; batch < BENCH_CUT_BATCHES; batch++) {
+        esb_bench_batch(batch, items);
+        memcpy(next, state, sizeof(next));
+        esb_bench_batch_apply(next, items);
+        memcpy(g_image, g_memory, sizeof(g_image));
+
+        /* the complete commit: storage operations and kind */
+        esb_config_stats_t stats;
+        esb_config_get_stats(&stats);
+        uint32_t compactions = stats.compactions;
+        uint32_t programmed = g_ram.programmed_bytes;
+        uint32_t erases = g_ram.erase_count;
+        esb_bench_batch_set(items);
+        ESB_BENCH_CHECK(esb_config_commit() == ESB_PROT_ERR_OK);
+        esb_config_get_stats(&stats);
+        uint32_t steps = (g_ram.programmed_bytes - programmed) + (g_ram.erase_count - erases);
+        uint32_t *p_cuts = (stats.compactions != compactions) ? p_compaction_cuts : p_commit_cuts;
+
+        for (uint32_t cut = 0; cut < steps; cut++) {
+            ESB_BENCH_CHECK(esb_bench_restart(g_image) == ESB_PROT_ERR_OK);
+            esb_bench_batch_set(items);
+            g_ram.fail_after = cut + 1;
+            ESB_BENCH_CHECK(esb_config_commit() != ESB_PROT_ERR_OK);
+
+            /* the old values after the restart, the batch can be committed again */
+            uint8_t ok = (esb_bench_restart(NULL) == ESB_PROT_ERR_OK) && (esb_bench_verify(state) != 0);
+            esb_bench_batch_set(items);
+            ok = ok && (esb_config_commit() == ESB_PROT_ERR_OK);
+            ok = ok && (esb_bench_restart(NULL) == ESB_PROT_ERR_OK) && (esb_bench_verify(next) != 0);
+            wrong += (ok != 0) ? 0 : 1;
+            (*p_cuts)++;
+        }
+
+        /* continue from the complete commit */
+        ESB_BENCH_CHECK(esb_bench_restart(g_image) == ESB_PROT_ERR_OK);
+        esb_bench_batch_set(items);
+        ESB_BENCH_CHECK(esb_config_commit() == ESB_PROT_ERR_OK);
+        ESB_BENCH_CHECK(esb_bench_restart(NULL) == ESB_PROT_ERR_OK);
+        wrong += (esb_bench_verify(next) != 0) ? 0 : 1;
+        memcpy(state, next, sizeof(state));
+    }
+
+    return (wrong);
+}
+
+/* SETs of one changed 4 byte value each, committed every batch_sets SETs */
+static void esb_bench_cost(const char *p_name, uint32_t sets, uint32_t batch_sets, double *p_bytes_per_set)
+{
+    esb_bench_storage_init(BENCH_PAGE_SIZE);
+    ESB_BENCH_CHECK(esb_config_init(&g_storage) == ESB_PROT_ERR_OK);
+
+    for (uint32_t i = 0; i < sets; i++) {
+        ESB_BENCH_CHECK(esb_config_set((uint8_t)(i % BENCH_KEYS), (const uint8_t *)&i, sizeof(i)) == ESB_PROT_ERR_OK);
+        if (((i + 1) % batch_sets) == 0) {
+            ESB_BENCH_CHECK(esb_config_commit() == ESB_PROT_ERR_OK);
+        }
+    }
+    ESB_BENCH_CHECK(esb_config_commit() == ESB_PROT_ERR_OK);
+
+    esb_config_stats_t stats;
+    esb_config_get_stats(&stats);
+    uint32_t min_erases = g_page_erases[0];
+    uint32_t max_erases = g_page_erases[0];
+    printf("%-10s %6u SETs, %7u bytes programmed, %.1f bytes/SET (%.1fx the values), %5u commits, "
+           "%4u compactions, erases per page",
+           p_name, sets, stats.programmed_bytes, (double)stats.programmed_bytes / sets,
+           (double)stats.programmed_bytes / stats.value_bytes, stats.commits, stats.compactions);
+    for (uint8_t page = 0; page < BENCH_PAGES; page++) {
+        printf(" %u", g_page_erases[page]);
+        min_erases = (g_page_erases[page] < min_erases) ? g_page_erases[page] : min_erases;
+        max_erases = (g_page_erases[page] > max_erases) ? g_page_erases[page] : max_erases;
+    }
+    printf("\n");
+    *p_bytes_per_set = (double)stats.programmed_bytes / sets;
+
+    /* the pages are used in turn */
+    ESB_BENCH_CHECK((max_erases - min_erases) <= 1);
+    ESB_BENCH_CHECK(stats.programmed_bytes == g_ram.programmed_bytes);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t sets = (argc > 1) ? (uint32_t)atoi(argv[1]) : 20000;
+    uint32_t commit_cuts, compaction_cuts;
+    double unbatched, batched;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    uint32_t wrong = esb_bench_power_cuts(&commit_cuts, &compaction_cuts);
+    printf("power cuts: %u in commit records, %u in compactions, %u wrong recoveries\n", commit_cuts,
+           compaction_cuts, wrong);
+    ESB_BENCH_CHECK(commit_cuts > 0);
+    ESB_BENCH_CHECK(compaction_cuts > 0);
+    ESB_BENCH_CHECK(wrong == 0);
+
+    esb_bench_cost("unbatched", sets, 1, &unbatched);
+    esb_bench_cost("batched", sets, BENCH_BATCH_SETS, &batched);
+    ESB_BENCH_CHECK(batched < unbatched);
+
+    return (ESB_BENCH_RESULT());
+}
@@ -0,0 +1,223 @@
+/*
+ * Notifications per input edge and tick cost of the debouncing and coalescing of the binary sensor
+ *
+ * The firmware is a binary sensor which sets all its inputs once per tick (1 ms) and publishes to a virtual
+ * central. Every input toggles about every 300 ms and bounces for 3 ms after each edge, one in 8 inputs rattles
+ * with edges about 20 ms apart. The central decodes the notifications into its view of the channel states, which
+ * has to match the inputs once they are stable. Each run uses other settings of binary_sensor_set_debounce(): off,
+ * a stable time, a stable time with a minimum publish interval reporting the final state, and reporting every
+ * transition. The tick cost is the wall clock time of binary_sensor_tick(), with changing inputs and idle. The
+ * benchmark is built twice, with 128 channels and batch notifications (esb_bench_debounce, binary sensor library
+ * with BINARY_SENSOR_CHAN_NUM=128 and BINARY_SENSOR_NOTIFICATION_VERSION=2) and with the default single channel
+ * (esb_bench_debounce_single). The simulation runs in virtual time.
+ *
+ * Usage: esb_bench_debounce [ticks per run]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <binary-sensor/binary_sensor.h>
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+#define BENCH_EDGE_TICKS 300   /* mean ticks between two edges of an input */
+#define BENCH_RATTLE_TICKS 20  /* mean ticks between two edges of a rattling input */
+#define BENCH_BOUNCE_TICKS 3   /* ticks an input bounces after an edge */
+#define BENCH_SETTLE_TICKS 600 /* ticks with stable inputs at the end of a run */
+#define BENCH_IDLE_TICKS 100000
+#define BENCH_WORDS ((BINARY_SENSOR_CHAN_NUM + 31) / 32)
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static uint8_t g_central_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+
+static uint8_t g_central_state[BINARY_SENSOR_CHAN_NUM];
+static uint8_t g_input[BINARY_SENSOR_CHAN_NUM];
+static uint32_t g_edge_tick[BINARY_SENSOR_CHAN_NUM];
+static uint32_t g_frames;
+static uint32_t g_reports;
+static uint32_t g_transitions;
+static uint32_t g_random;
+
+static uint32_t esb_bench_random(void)
+{
+    g_random = (g_random * 1103515245u) + 12345u;
+
+    return (g_random >> 8);
+}
+
+static uint64_t esb_bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec);
+}
+
+static void esb_bench_report_chan(uint8_t chan, uint8_t state)
+{
+    if (chan < BINARY_SENSOR_CHAN_NUM) {
+        g_central_state[chan] = state;
+    }
+    g_reports++;
+}
+
+static void esb_bench_central_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    const uint8_t *p_payload = &payload[ESB_PROTOCOL_HEADER_SIZE];
+    uint8_t length = payload_length - ESB_PROTOCOL_HEADER_SIZE;
+
+    g_frames++;
+    if (payload[0] == BINARY_SENSOR_NOTIFICATION_ESB_CMD_ID) {
+        /* peripheral address, channel, state */
+        esb_bench_report_chan(p_payload[5], p_payload[6]);
+    } else if (payload[0] == BINARY_SENSOR_NOTIFICATION_BATCH_ESB_CMD_ID) {
+        /* first channel, number of bytes, changed mask, states */
+        uint8_t num_bytes = p_payload[1];
+        for (uint8_t i = 0; i < num_bytes; i++) {
+            for (uint8_t bit = 0; bit < 8; bit++) {
+                if ((p_payload[2 + i] & (1u << bit)) != 0) {
+                    esb_bench_report_chan(p_payload[0] + (8 * i) + bit, (p_payload[2 + num_bytes + i] >> bit) & 1u);
+                }
+            }
+        }
+    } else if (payload[0] == BINARY_SENSOR_NOTIFICATION_TRANSITIONS_ESB_CMD_ID) {
+        /* channel, state, count per channel */
+        for (uint8_t i = 0; (i + 3) <= length; i += 3) {
+            esb_bench_report_chan(p_payload[i], p_payload[i + 1]);
+            g_transitions += p_payload[i + 2];
+        }
+    }
+}
+
+static void esb_bench_pump(void)
+{
+    do {
+        esb_protocol_process();
+    } while (esb_tx_pending() > 0);
+    esb_protocol_process();
+}
+
+static void esb_bench_publish(void)
+{
+    while (binary_sensor_publish() != ESB_PROT_ERR_OK) {
+        esb_bench_pump();
+    }
+    esb_bench_pump();
+}
+
+/* sets all inputs, bouncing ones get a random value */
+static void esb_bench_set_inputs(uint32_t tick, uint8_t bounce)
+{
+    for (uint8_t word = 0; word < BENCH_WORDS; word++) {
+        uint32_t values = 0;
+        uint32_t mask = 0;
+        for (uint8_t bit = 0; (bit < 32) && (((word * 32) + bit) < BINARY_SENSOR_CHAN_NUM); bit++) {
+            uint8_t chan = (word * 32) + bit;
+            uint8_t value = g_input[chan];
+            if ((bounce != 0) && ((tick - g_edge_tick[chan]) < BENCH_BOUNCE_TICKS)) {
+                value = esb_bench_random() & 1u;
+            }
+            values |= (uint32_t)value << bit;
+            mask |= 1u << bit;
+        }
+        (void)binary_sensor_set_channels(word * 32, mask, values);
+    }
+}
+
+static void esb_bench_run(const char *p_name, const binary_sensor_debounce_t *p_config, uint32_t ticks,
+                          double *p_reports_per_edge)
+{
+    /* all channels off and reported without debouncing */
+    g_random = 7;
+    memset(g_input, 0, sizeof(g_input));
+    (void)binary_sensor_set_debounce(NULL);
+    esb_bench_set_inputs(0, 0);
+    esb_bench_publish();
+    memset(g_central_state, 0, sizeof(g_central_state));
+    for (uint16_t chan = 0; chan < BINARY_SENSOR_CHAN_NUM; chan++) {
+        g_edge_tick[chan] = 0 - BENCH_EDGE_TICKS;
+    }
+    ESB_BENCH_CHECK(binary_sensor_set_debounce(p_config) == ESB_PROT_ERR_OK);
+
+    uint32_t frames = g_frames;
+    uint32_t reports = g_reports;
+    uint32_t transitions = g_transitions;
+    uint32_t edges = 0;
+    uint64_t tick_ns = 0;
+    for (uint32_t tick = 0; tick < ticks; tick++) {
+        for (uint16_t chan = 0; chan < BINARY_SENSOR_CHAN_NUM; chan++) {
+            uint32_t mean_ticks = ((chan % 8) == 0) ? BENCH_RATTLE_TICKS : BENCH_EDGE_TICKS;
+            if (((esb_bench_random() % mean_ticks) == 0) && ((tick - g_edge_tick[chan]) > BENCH_BOUNCE_TICKS + 2)) {
+                g_input[chan] ^= 1;
+                g_edge_tick[chan] = tick;
+                edges++;
+            }
+        }
+        esb_bench_set_inputs(tick, 1);
+        uint64_t start_ns = esb_bench_now_ns();
+        binary_sensor_tick(tick);
+        tick_ns += esb_bench_now_ns() - start_ns;
+        esb_bench_publish();
+    }
+    for (uint32_t tick = ticks; tick < (ticks + BENCH_SETTLE_TICKS); tick++) {
+        esb_bench_set_inputs(tick, 0);
+        binary_sensor_tick(tick);
+        esb_bench_publish();
+    }
+
+    uint32_t wrong = 0;
+    for (uint16_t chan = 0; chan < BINARY_SENSOR_CHAN_NUM; chan++) {
+        wrong += (g_central_state[chan] != g_input[chan]) ? 1 : 0;
+    }
+    uint64_t start_ns = esb_bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_IDLE_TICKS; i++) {
+        binary_sensor_tick(ticks + BENCH_SETTLE_TICKS + i);
+    }
+    double idle_ns = (double)(esb_bench_now_ns() - start_ns) / BENCH_IDLE_TICKS;
+
+    frames = g_frames - frames;
+    reports = g_reports - reports;
+    transitions = g_transitions - transitions;
+    *p_reports_per_edge = (edges > 0) ? (double)reports / edges : 0.0;
+    printf("%-30s %5u edges, %5u frames, %5u channel reports (%.2f/edge), %5u transitions, %u wrong, "
+           "tick %4.0f ns (%.1f ns/channel), idle tick %.1f ns\n",
+           p_name, edges, frames, reports, *p_reports_per_edge, transitions, wrong, (double)tick_ns / ticks,
+           (double)tick_ns / ticks / BINARY_SENSOR_CHAN_NUM, idle_ns);
+    ESB_BENCH_CHECK(wrong == 0);
+    if ((p_config != NULL) && (p_config->report == BINARY_SENSOR_REPORT_TRANSITIONS)) {
+        ESB_BENCH_CHECK(transitions >= reports);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ticks = (argc > 1) ? (uint32_t)atoi(argv[1]) : 3000;
+    double off, stable, interval, transitions;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 20, .realtime = 0, .seed = 5};
+    esb_sim_node_t central, central_rx;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_central_addr, esb_bench_central_rx, &central);
+    esb_sim_node_add(g_fw_addr, NULL, &central_rx);
+    esb_protocol_init(g_fw_addr);
+    ESB_BENCH_CHECK(binary_sensor_init(g_fw_addr) == ESB_PROT_ERR_OK);
+    binary_sensor_set_central_address(g_central_addr);
+    printf("%u channels, %u ticks per run\n", BINARY_SENSOR_CHAN_NUM, ticks);
+
+    binary_sensor_debounce_t debounce = {
+        .stable_ticks = 5, .min_interval_ticks = 0, .report = BINARY_SENSOR_REPORT_FINAL};
+    esb_bench_run("off", NULL, ticks, &off);
+    esb_bench_run("stable 5", &debounce, ticks, &stable);
+    debounce.min_interval_ticks = 100;
+    esb_bench_run("stable 5, interval 100, final", &debounce, ticks, &interval);
+    debounce.report = BINARY_SENSOR_REPORT_TRANSITIONS;
+    esb_bench_run("stable 5, interval 100, all", &debounce, ticks, &transitions);
+    ESB_BENCH_CHECK(stable < off);
+    ESB_BENCH_CHECK(interval < stable);
+    ESB_BENCH_CHECK(transitions < stable);
+
+    return (ESB_BENCH_RESULT());
+}
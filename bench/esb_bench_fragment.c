@@ -0,0 +1,320 @@
+/*
+ * Goodput of the fragmentation layer against the frame loss rate
+ *
+ * Both directions are measured with a real-time simulation, so the ESB_FRAGMENT_TIMEOUT_MS stalls count:
+ * - firmware sender: esb_fragment_send() to a virtual node, which acknowledges like esb_fragment.c
+ * - firmware receiver: a virtual node sends with the windowed sender of esb_fragment.c to the firmware
+ *
+ * The loss rate applies to every attempt, ESB retransmits hide most of it from the fragmentation layer. With the
+ * default sizes a message fits into one window, build with a smaller ESB_FRAGMENT_WINDOW (e.g. 4) to measure the
+ * window handling.
+ *
+ * Usage: esb_bench_fragment [transfers per loss rate]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_fragment.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+#define BENCH_MSG_CMD 0x55
+#define BENCH_TRANSFER_ID 9
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_node_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+static const uint16_t g_loss_permille[] = {0, 200, 400, 500, 600};
+
+static esb_sim_node_t g_node;
+static uint8_t g_msg[ESB_FRAGMENT_MAX_LEN];
+static const uint8_t g_count = (ESB_FRAGMENT_MAX_LEN + ESB_FRAGMENT_DATA_LEN - 1) / ESB_FRAGMENT_DATA_LEN;
+
+static uint8_t esb_bench_bit(const uint32_t *p_bits, uint8_t idx)
+{
+    return ((p_bits[idx / 32] >> (idx % 32)) & 1u);
+}
+
+/*
+ * Virtual receiver, runs on the radio thread
+ */
+
+static struct {
+    uint8_t transfer_id;
+    uint8_t base;
+    uint8_t acked_base;
+    uint8_t gap;
+    uint8_t complete;
+    uint32_t received[8];
+    uint8_t data[ESB_FRAGMENT_MAX_LEN];
+    uint16_t length;
+} g_rx;
+
+static void esb_bench_rx_ack(uint8_t seq)
+{
+    uint8_t frame[7 + ESB_FRAGMENT_ACK_LEN] = {ESB_CMD_FRAGMENT_ACK, 0};
+    uint32_t window = 0;
+    for (uint8_t i = 0; (i < 32) && ((g_rx.base + i) < g_count); i++) {
+        if (esb_bench_bit(g_rx.received, g_rx.base + i)) {
+            window |= (1u << i);
+        }
+    }
+
+    memcpy(&frame[2], g_node_addr, 5);
+    frame[7] = g_rx.transfer_id;
+    frame[8] = seq;
+    frame[9] = g_rx.base;
+    memcpy(&frame[10], &window, 4);
+    (void)esb_sim_node_send(g_node, g_fw_addr, frame, sizeof(frame), NULL);
+
+    g_rx.acked_base = g_rx.base;
+    g_rx.gap = (g_rx.base <= seq) ? 1 : 0;
+}
+
+static void esb_bench_rx_callback(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    if ((payload_length <= (7 + ESB_FRAGMENT_HEADER_SIZE)) || (payload[0] != ESB_CMD_FRAGMENT)) {
+        return;
+    }
+
+    const uint8_t *p_frag = &payload[7];
+    uint8_t seq = p_frag[1];
+    uint8_t data_len = payload_length - 7 - ESB_FRAGMENT_HEADER_SIZE;
+
+    if (p_frag[0] != g_rx.transfer_id) {
+        memset(&g_rx, 0, sizeof(g_rx));
+        g_rx.transfer_id = p_frag[0];
+    }
+
+    uint8_t duplicate = esb_bench_bit(g_rx.received, seq);
+    if (duplicate == 0) {
+        memcpy(&g_rx.data[seq * ESB_FRAGMENT_DATA_LEN], &p_frag[ESB_FRAGMENT_HEADER_SIZE], data_len);
+        g_rx.received[seq / 32] |= (1u << (seq % 32));
+        if (seq == (g_count - 1)) {
+            g_rx.length = (seq * ESB_FRAGMENT_DATA_LEN) + data_len;
+        }
+        while ((g_rx.base < g_count) && esb_bench_bit(g_rx.received, g_rx.base)) {
+            g_rx.base++;
+        }
+    }
+
+    if (g_rx.base >= g_count) {
+        esb_bench_rx_ack(seq);
+        g_rx.complete = 1;
+    } else if ((duplicate == 1) || (seq == (g_count - 1)) || (seq >= (g_rx.acked_base + ESB_FRAGMENT_WINDOW - 1)) ||
+               ((g_rx.gap == 1) && (g_rx.base > g_rx.acked_base))) {
+        esb_bench_rx_ack(seq);
+    }
+}
+
+static volatile uint8_t g_tx_done;
+static esb_protocol_err_t g_tx_result;
+
+static void esb_bench_tx_callback(esb_protocol_err_t result)
+{
+    g_tx_result = result;
+    g_tx_done = 1;
+}
+
+static void esb_bench_fw_send(uint16_t loss_permille, uint32_t transfers)
+{
+    esb_bench_settle();
+    esb_sim_config_t config = {.loss_permille = loss_permille, .latency_us = 50, .realtime = 1, .seed = 11};
+    esb_sim_init(&config);
+    esb_sim_node_add(g_node_addr, esb_bench_rx_callback, &g_node);
+    esb_protocol_init(g_fw_addr);
+    esb_fragment_init(NULL);
+
+    uint32_t ok = 0;
+    uint64_t start = esb_bench_now_us();
+    for (uint32_t i = 0; i < transfers; i++) {
+        g_tx_done = 0;
+        ESB_BENCH_CHECK(esb_fragment_send(g_node_addr, BENCH_MSG_CMD, g_msg, sizeof(g_msg), esb_bench_tx_callback) ==
+                        ESB_PROT_ERR_OK);
+        while (g_tx_done == 0) {
+            esb_fragment_process();
+            esb_protocol_process();
+        }
+        if (g_tx_result == ESB_PROT_ERR_OK) {
+            ok++;
+            ESB_BENCH_CHECK((g_rx.complete == 1) && (g_rx.length == sizeof(g_msg)) &&
+                            (memcmp(g_rx.data, g_msg, sizeof(g_msg)) == 0));
+        }
+    }
+    uint64_t duration_us = esb_bench_now_us() - start;
+    while (esb_protocol_tx_idle() == 0) {
+        esb_protocol_process();
+    }
+
+    esb_sim_stats_t stats;
+    esb_sim_get_stats(&stats);
+    printf("firmware sender   loss %2u%%: %2u/%u ok, goodput %6.0f bytes/s, %5.1f frames/transfer\n",
+           loss_permille / 10, ok, transfers, (double)ok * sizeof(g_msg) * 1e6 / (double)duration_us,
+           (double)stats.frames / transfers);
+    if (loss_permille <= 200) {
+        ESB_BENCH_CHECK(ok == transfers);
+    }
+}
+
+/*
+ * Virtual sender, runs on the main thread, the acknowledges are passed from the radio thread
+ */
+
+static volatile uint8_t g_ack_ready;
+static uint8_t g_ack[ESB_FRAGMENT_ACK_LEN];
+static volatile uint8_t g_fw_rx_done;
+static uint8_t g_fw_rx_match;
+
+static void esb_bench_ack_callback(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    if ((payload_length == (7 + ESB_FRAGMENT_ACK_LEN)) && (payload[0] == ESB_CMD_FRAGMENT_ACK)) {
+        memcpy(g_ack, &payload[7], ESB_FRAGMENT_ACK_LEN);
+        g_ack_ready = 1;
+    }
+}
+
+static void esb_bench_fw_rx_callback(const uint8_t address[5], uint8_t cmd, const uint8_t *p_data, uint16_t length)
+{
+    g_fw_rx_match = ((cmd == BENCH_MSG_CMD) && (length == sizeof(g_msg)) && (memcmp(p_data, g_msg, length) == 0));
+    g_fw_rx_done = 1;
+}
+
+static void esb_bench_node_send_fragment(uint8_t transfer_id, uint8_t seq)
+{
+    uint8_t frame[ESB_FRAME_SIZE] = {ESB_CMD_FRAGMENT, 0};
+    uint16_t offset = (uint16_t)seq * ESB_FRAGMENT_DATA_LEN;
+    uint8_t data_len = ((sizeof(g_msg) - offset) > ESB_FRAGMENT_DATA_LEN) ? ESB_FRAGMENT_DATA_LEN
+                                                                            : (uint8_t)(sizeof(g_msg) - offset);
+
+    memcpy(&frame[2], g_node_addr, 5);
+    frame[7] = transfer_id;
+    frame[8] = seq;
+    frame[9] = g_count;
+    frame[10] = BENCH_MSG_CMD;
+    memcpy(&frame[11], &g_msg[offset], data_len);
+
+    esb_sim_tx_result_t result;
+    (void)esb_sim_node_send(g_node, g_fw_addr, frame, 11 + data_len, &result);
+
+    /* the main loop of the firmware keeps up with the fragments */
+    esb_protocol_process();
+}
+
+/* one transfer with the sender algorithm of esb_fragment.c, returns the number of timeouts */
+static uint32_t esb_bench_node_transfer(uint8_t transfer_id)
+{
+    uint8_t base = 0;
+    uint8_t next = 0;
+    uint32_t acked = 0;
+    uint32_t resend = 0;
+    uint32_t timeouts = 0;
+    uint64_t last_us = esb_bench_now_us();
+
+    g_fw_rx_done = 0;
+    while (base < g_count) {
+        if (g_ack_ready != 0) {
+            uint8_t ack[ESB_FRAGMENT_ACK_LEN];
+            esb_sim_critical_region_enter();
+            memcpy(ack, g_ack, sizeof(ack));
+            g_ack_ready = 0;
+            esb_sim_critical_region_exit();
+
+            uint8_t seq = ack[1];
+            uint8_t ack_base = ack[2];
+            uint32_t received;
+            memcpy(&received, &ack[3], 4);
+            if ((ack[0] == transfer_id) && (ack_base <= next) && (seq < next) && (ack_base >= base)) {
+                last_us = esb_bench_now_us();
+                uint8_t shift = ack_base - base;
+                resend = (shift >= 32) ? 0 : (resend >> shift);
+                base = ack_base;
+                acked = received;
+                if (seq >= base) {
+                    uint8_t upto = seq - base;
+                    resend |= ((upto >= 31) ? 0xFFFFFFFFu : ((1u << (upto + 1)) - 1)) & ~received;
+                }
+            }
+        }
+
+        while (resend != 0) {
+            uint8_t bit = 0;
+            while ((resend & (1u << bit)) == 0) {
+                bit++;
+            }
+            esb_bench_node_send_fragment(transfer_id, base + bit);
+            resend &= ~(1u << bit);
+        }
+        while ((next < g_count) && ((next - base) < ESB_FRAGMENT_WINDOW)) {
+            esb_bench_node_send_fragment(transfer_id, next);
+            next++;
+        }
+
+        if ((base < g_count) && ((esb_bench_now_us() - last_us) >= (ESB_FRAGMENT_TIMEOUT_MS * 1000u))) {
+            uint8_t sent = next - base;
+            resend = ((sent >= 32) ? 0xFFFFFFFFu : ((1u << sent) - 1)) & ~acked;
+            last_us = esb_bench_now_us();
+            timeouts++;
+        }
+
+        esb_protocol_process();
+    }
+
+    return (timeouts);
+}
+
+static void esb_bench_fw_receive(uint16_t loss_permille, uint32_t transfers)
+{
+    esb_bench_settle();
+    esb_sim_config_t config = {.loss_permille = loss_permille, .latency_us = 50, .realtime = 1, .seed = 5};
+    esb_sim_init(&config);
+    esb_sim_node_add(g_node_addr, esb_bench_ack_callback, &g_node);
+    esb_protocol_init(g_fw_addr);
+    esb_fragment_init(esb_bench_fw_rx_callback);
+
+    uint32_t ok = 0;
+    uint32_t timeouts = 0;
+    uint64_t start = esb_bench_now_us();
+    for (uint32_t i = 0; i < transfers; i++) {
+        g_ack_ready = 0;
+        timeouts += esb_bench_node_transfer((uint8_t)(BENCH_TRANSFER_ID + i));
+        ok += ((g_fw_rx_done == 1) && (g_fw_rx_match == 1)) ? 1 : 0;
+    }
+    uint64_t duration_us = esb_bench_now_us() - start;
+    while (esb_protocol_tx_idle() == 0) {
+        esb_protocol_process();
+    }
+
+    esb_sim_stats_t stats;
+    esb_sim_get_stats(&stats);
+    printf("firmware receiver loss %2u%%: %2u/%u ok, goodput %6.0f bytes/s, %5.1f frames/transfer, %4.2f "
+           "timeouts/transfer\n",
+           loss_permille / 10, ok, transfers, (double)ok * sizeof(g_msg) * 1e6 / (double)duration_us,
+           (double)stats.frames / transfers, (double)timeouts / transfers);
+    ESB_BENCH_CHECK(ok == transfers);
+    if (loss_permille == 0) {
+        ESB_BENCH_CHECK(timeouts == 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t transfers = (argc > 1) ? (uint32_t)atoi(argv[1]) : 5;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    srand(1);
+    for (uint16_t i = 0; i < sizeof(g_msg); i++) {
+        g_msg[i] = (uint8_t)rand();
+    }
+    printf("message %u bytes, %u fragments, window %u, timeout %u ms\n", (unsigned)sizeof(g_msg), g_count,
+           ESB_FRAGMENT_WINDOW, ESB_FRAGMENT_TIMEOUT_MS);
+
+    for (uint8_t i = 0; i < (sizeof(g_loss_permille) / sizeof(g_loss_permille[0])); i++) {
+        esb_bench_fw_send(g_loss_permille[i], transfers);
+    }
+    for (uint8_t i = 0; i < (sizeof(g_loss_permille) / sizeof(g_loss_permille[0])); i++) {
+        esb_bench_fw_receive(g_loss_permille[i], transfers);
+    }
+
+    return (ESB_BENCH_RESULT());
+}
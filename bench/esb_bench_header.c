@@ -0,0 +1,168 @@
+/*
+ * Bytes and air time per notification with the full and the compact header
+ *
+ * The firmware is a binary sensor with 128 channels and batch notifications (built against a copy of the binary
+ * sensor library with BINARY_SENSOR_CHAN_NUM=128 and BINARY_SENSOR_NOTIFICATION_VERSION=2). It publishes single
+ * channel changes and changes of 100 channels to a virtual central, first with the full header, then after the
+ * central assigned a node ID with ESB_CMD_SET_NODE_ID with the compact header. Then the firmware acts as central
+ * and receives compact frames of a virtual peripheral, which are only accepted once its node ID is registered.
+ * The simulation runs in virtual time.
+ *
+ * Usage: esb_bench_header [publishes per run]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <binary-sensor/binary_sensor.h>
+#include <common/commands/esb_cmd_def_common.h>
+#include <common/commands/esb_commands.h>
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+#define BENCH_NODE_ID 3
+#define BENCH_PERIPH_NODE_ID 7
+#define BENCH_CMD 0xA5
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_central_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+/* pipe 0 keeps the address the firmware sent to, as central it listens on another one */
+static const uint8_t g_fw_central_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x02};
+static const uint8_t g_periph_addr[5] = {0x55, 0x55, 0x55, 0x55, BENCH_PERIPH_NODE_ID};
+
+static esb_sim_node_t g_central;
+static uint32_t g_notification_frames;
+static uint32_t g_notification_bytes;
+static uint32_t g_handler_calls;
+static uint8_t g_handler_address[5];
+
+static void esb_bench_central_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    g_notification_frames++;
+    g_notification_bytes += payload_length;
+}
+
+static void esb_bench_pump(void)
+{
+    do {
+        esb_protocol_process();
+    } while (esb_tx_pending() > 0);
+    esb_protocol_process();
+}
+
+/* publishes the changes of the first channels, returns the air time per publish */
+static double esb_bench_publish(const char *p_name, uint8_t channels, uint32_t publishes)
+{
+    static uint8_t value = 0;
+    uint32_t frames = g_notification_frames;
+    uint32_t bytes = g_notification_bytes;
+    esb_sim_stats_t stats_start;
+    esb_sim_get_stats(&stats_start);
+
+    for (uint32_t i = 0; i < publishes; i++) {
+        value ^= 1;
+        for (uint8_t chan = 0; chan < channels; chan++) {
+            (void)binary_sensor_set_channel(chan, (value != 0) ? CHAN_VAL_TRUE : CHAN_VAL_FALSE);
+        }
+        while (binary_sensor_publish() != ESB_PROT_ERR_OK) {
+            esb_bench_pump();
+        }
+        esb_bench_pump();
+    }
+
+    esb_sim_stats_t stats;
+    esb_sim_get_stats(&stats);
+    frames = g_notification_frames - frames;
+    bytes = g_notification_bytes - bytes;
+    printf("%-15s %3u changes x %u: %4u frames, %4.1f bytes/frame, %4.1f frames/publish, air time %6.1f us/publish\n",
+           p_name, channels, publishes, frames, (double)bytes / frames, (double)frames / publishes,
+           (double)(stats.airtime_us - stats_start.airtime_us) / publishes);
+    ESB_BENCH_CHECK(frames >= publishes);
+
+    return ((double)(stats.airtime_us - stats_start.airtime_us) / publishes);
+}
+
+static void esb_bench_handler(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    g_handler_calls++;
+    memcpy(g_handler_address, message->address, 5);
+    answer->error = ESB_PROT_REPLY_NONE;
+}
+
+static esb_cmd_table_item_t g_cmd_table[] = {{BENCH_CMD, ESB_CMD_PAYLOAD_LEN_DYN, esb_bench_handler}, {0, 0, NULL}};
+
+/* the firmware as central, a virtual peripheral sends compact frames with a 29 byte payload */
+static void esb_bench_central_side(const esb_sim_config_t *p_config)
+{
+    esb_sim_init(p_config);
+    esb_protocol_init(g_fw_central_addr);
+    ESB_BENCH_CHECK(esb_commands_register_app_commands(g_cmd_table, 1) == ESB_PROT_ERR_OK);
+    esb_sim_node_t periph;
+    esb_sim_node_add(g_periph_addr, NULL, &periph);
+
+    uint8_t frame[ESB_FRAME_SIZE] = {BENCH_CMD, ESB_PROTOCOL_FLAG_COMPACT, BENCH_PERIPH_NODE_ID};
+    for (uint8_t i = ESB_PROTOCOL_COMPACT_HEADER_SIZE; i < sizeof(frame); i++) {
+        frame[i] = i;
+    }
+    esb_sim_tx_result_t result;
+    (void)esb_sim_node_send(periph, g_fw_central_addr, frame, sizeof(frame), &result);
+    esb_bench_pump();
+    esb_protocol_stats_t stats;
+    esb_protocol_get_stats(&stats);
+    printf("central, unknown node %u:    %u handler calls, %u invalid frames\n", BENCH_PERIPH_NODE_ID, g_handler_calls,
+           stats.counter[ESB_PROT_STAT_RX_INVALID]);
+    ESB_BENCH_CHECK(g_handler_calls == 0);
+
+    ESB_BENCH_CHECK(esb_protocol_register_node(BENCH_PERIPH_NODE_ID, g_periph_addr) == ESB_PROT_ERR_OK);
+    frame[ESB_PROTOCOL_COMPACT_HEADER_SIZE] = 99;
+    (void)esb_sim_node_send(periph, g_fw_central_addr, frame, sizeof(frame), &result);
+    esb_bench_pump();
+    printf("central, registered node %u: %u handler calls, %u byte payload from %02x..%02x\n", BENCH_PERIPH_NODE_ID,
+           g_handler_calls, ESB_PROTOCOL_COMPACT_MAX_PAYLOAD_LEN, g_handler_address[0], g_handler_address[4]);
+    ESB_BENCH_CHECK(g_handler_calls == 1);
+    ESB_BENCH_CHECK(memcmp(g_handler_address, g_periph_addr, 5) == 0);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t publishes = (argc > 1) ? (uint32_t)atoi(argv[1]) : 200;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 20, .realtime = 0, .seed = 5};
+    esb_sim_node_t central_rx;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_central_addr, esb_bench_central_rx, &g_central);
+    esb_sim_node_add(g_fw_addr, NULL, &central_rx);
+    esb_protocol_init(g_fw_addr);
+    ESB_BENCH_CHECK(binary_sensor_init(g_fw_addr) == ESB_PROT_ERR_OK);
+    binary_sensor_set_central_address((uint8_t *)g_central_addr);
+
+    esb_protocol_message_t message = {.cmd = BENCH_CMD, .payload_len = ESB_PROTOCOL_COMPACT_MAX_PAYLOAD_LEN};
+    memcpy(message.address, g_central_addr, 5);
+    printf("full header:    max payload %u bytes\n", esb_protocol_max_payload_len());
+    ESB_BENCH_CHECK(esb_protocol_transmit(&message) != ESB_PROT_ERR_OK);
+    double full_single_us = esb_bench_publish("full header", 1, publishes);
+    double full_batch_us = esb_bench_publish("full header", 100, publishes / 10);
+
+    /* the central assigns the node ID */
+    uint8_t set_node_id[ESB_PROTOCOL_HEADER_SIZE + 1] = {ESB_CMD_SET_NODE_ID, 0};
+    memcpy(&set_node_id[2], g_central_addr, 5);
+    set_node_id[ESB_PROTOCOL_HEADER_SIZE] = BENCH_NODE_ID;
+    esb_sim_tx_result_t result;
+    (void)esb_sim_node_send(g_central, g_fw_addr, set_node_id, sizeof(set_node_id), &result);
+    esb_bench_pump();
+    printf("compact header: node ID %u, max payload %u bytes\n", esb_protocol_get_node_id(),
+           esb_protocol_max_payload_len());
+    ESB_BENCH_CHECK(esb_protocol_get_node_id() == BENCH_NODE_ID);
+    ESB_BENCH_CHECK(esb_protocol_transmit(&message) == ESB_PROT_ERR_OK);
+    esb_bench_pump();
+    double compact_single_us = esb_bench_publish("compact header", 1, publishes);
+    double compact_batch_us = esb_bench_publish("compact header", 100, publishes / 10);
+    ESB_BENCH_CHECK(compact_single_us < full_single_us);
+    ESB_BENCH_CHECK(compact_batch_us < full_batch_us);
+
+    esb_bench_central_side(&config);
+
+    return (ESB_BENCH_RESULT());
+}
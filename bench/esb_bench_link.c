@@ -0,0 +1,142 @@
+/*
+ * Delivery, latency and air time of the retransmit settings on lossy and contended channels
+ *
+ * The firmware sends frames with esb_send_packet() to a virtual node, on a channel with random frame loss, with
+ * hidden contenders (other transmitters the node doesn't hear) and to an absent node. The simulation runs in virtual
+ * time, the latency is the time from the start of a frame to its completion. The benchmark is built twice, with
+ * the adaptive retransmit settings of esb_link.h (esb_bench_link) and with the fixed ones (esb_bench_link_fixed,
+ * ESB_LINK_ADAPTIVE=0). Finally frames to two destinations are queued alternately, a frame for the other
+ * destination has to be rejected as long as frames are in flight, they share the retransmit settings.
+ *
+ * Usage: esb_bench_link [frames per run]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/driver/esb.h>
+#include <common/driver/esb_link.h>
+#include <common/host/esb_sim.h>
+
+#include "esb_bench.h"
+
+static const uint8_t g_node_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_other_addr[5] = {0x66, 0x66, 0x66, 0x66, 0x01};
+
+static volatile uint32_t g_received;
+
+static void esb_bench_node_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    g_received++;
+}
+
+static void esb_bench_tx_done(const esb_tx_result_t *p_result, void *p_context)
+{
+    *(volatile uint8_t *)p_context = 1;
+}
+
+static void esb_bench_mixed(uint32_t frames)
+{
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 20, .realtime = 0, .seed = 11};
+    esb_sim_node_t node, other;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_node_addr, esb_bench_node_rx, &node);
+    esb_sim_node_add(g_other_addr, esb_bench_node_rx, &other);
+    ESB_BENCH_CHECK(esb_init() == ESB_ERR_OK);
+    ESB_BENCH_CHECK(esb_set_pipeline_address(ESB_PIPE_0, g_node_addr) == ESB_ERR_OK);
+    ESB_BENCH_CHECK(esb_set_pipeline_address(ESB_PIPE_1, g_other_addr) == ESB_ERR_OK);
+
+    uint32_t busy = 0;
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < frames; i++) {
+        volatile uint8_t done = 0;
+        uint8_t payload[16] = {(uint8_t)i, (uint8_t)(i >> 8)};
+        while (esb_send_packet_async(ESB_PIPE_0, payload, sizeof(payload), esb_bench_tx_done, (void *)&done) !=
+               ESB_ERR_OK) {
+        }
+        /* accepted only once the frame to the first destination is completed */
+        int8_t result;
+        while ((result = esb_send_packet_async(ESB_PIPE_1, payload, sizeof(payload), NULL, NULL)) == ESB_ERR_BUSY) {
+            busy++;
+        }
+        wrong += ((result != ESB_ERR_OK) || (done == 0)) ? 1 : 0;
+        while (esb_tx_pending() > 0) {
+        }
+    }
+    printf("%-20s %u frames to 2 destinations, %u rejections, %u accepted while in flight\n",
+           "mixed destinations", 2 * frames, busy, wrong);
+    ESB_BENCH_CHECK(wrong == 0);
+}
+
+static void esb_bench_run(const char *p_name, const esb_sim_config_t *p_config, uint8_t present, uint32_t frames)
+{
+    esb_sim_node_t node;
+    esb_sim_init(p_config);
+    if (present != 0) {
+        esb_sim_node_add(g_node_addr, esb_bench_node_rx, &node);
+    }
+    ESB_BENCH_CHECK(esb_init() == ESB_ERR_OK);
+    ESB_BENCH_CHECK(esb_set_pipeline_address(ESB_PIPE_0, g_node_addr) == ESB_ERR_OK);
+    g_received = 0;
+
+    uint32_t delivered = 0;
+    uint64_t latency_sum_us = 0;
+    uint64_t latency_max_us = 0;
+    for (uint32_t i = 0; i < frames; i++) {
+        uint8_t payload[16] = {(uint8_t)i, (uint8_t)(i >> 8)};
+        uint64_t start_us = esb_sim_time_us();
+        if (esb_send_packet(ESB_PIPE_0, payload, sizeof(payload)) == ESB_ERR_OK) {
+            delivered++;
+        }
+        uint64_t latency_us = esb_sim_time_us() - start_us;
+        latency_sum_us += latency_us;
+        latency_max_us = (latency_us > latency_max_us) ? latency_us : latency_max_us;
+    }
+
+    esb_sim_stats_t stats;
+    esb_sim_get_stats(&stats);
+    esb_link_stats_t link = {0};
+    (void)esb_link_get_stats(g_node_addr, &link);
+    printf("%-20s delivered %5.1f%%, latency avg %6.0f max %6llu us, %5.2f attempts/frame, air time %4.0f us/frame, "
+           "%5u collisions",
+           p_name, 100.0 * delivered / frames, (double)latency_sum_us / frames, (unsigned long long)latency_max_us,
+           (double)stats.frames / frames, (double)stats.airtime_us / frames, stats.collisions);
+    if (ESB_LINK_ADAPTIVE != 0) {
+        printf(", retransmit count %2u, backoff %u slots", link.retransmit_count, link.backoff_slots);
+    }
+    printf("\n");
+    /* a frame can arrive although all its ACKs got lost */
+    ESB_BENCH_CHECK(g_received >= delivered);
+    if ((present != 0) && (p_config->loss_permille == 0) && (p_config->contenders == 0)) {
+        ESB_BENCH_CHECK(delivered == frames);
+    }
+    if (present == 0) {
+        ESB_BENCH_CHECK(delivered == 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = (argc > 1) ? (uint32_t)atoi(argv[1]) : 2000;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("%s retransmit settings, %u frames per run\n", (ESB_LINK_ADAPTIVE != 0) ? "adaptive" : "fixed", frames);
+
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 20, .realtime = 0, .seed = 11};
+    esb_bench_run("clean", &config, 1, frames);
+    config.loss_permille = 200;
+    esb_bench_run("loss 20%", &config, 1, frames);
+    config.loss_permille = 400;
+    esb_bench_run("loss 40%", &config, 1, frames);
+    config.loss_permille = 20;
+    config.contenders = 4;
+    config.contender_interval_us = 4000;
+    esb_bench_run("4 contenders", &config, 1, frames);
+    config.contenders = 8;
+    esb_bench_run("8 contenders", &config, 1, frames);
+    config.loss_permille = 0;
+    config.contenders = 0;
+    esb_bench_run("absent destination", &config, 0, frames);
+    esb_bench_mixed(frames);
+
+    return (ESB_BENCH_RESULT());
+}
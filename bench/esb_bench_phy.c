@@ -0,0 +1,202 @@
+/*
+ * Throughput and energy per frame of the bitrate and TX power selection
+ *
+ * The firmware is a peripheral and sends messages to a virtual central at a given path loss (range model of the
+ * simulation). Each path loss is run without the PHY module (1 Mbit/s at the highest TX power) and with it:
+ * - the TX power policy lowers the TX power at 1 Mbit/s
+ * - if 1 Mbit/s has enough margin, the central announces 2 Mbit/s with ESB_CMD_PHY_SET and switches
+ * - the central announces 1 Mbit/s but stays on 2 Mbit/s, the peripheral has to return to 2 Mbit/s
+ * - the central silently returns to 1 Mbit/s, the peripheral has to fall back to the default setting
+ * At the end the estimated frames per second and energy per frame of all settings used are listed. The simulation
+ * runs in virtual time, the throughput is based on the air time including retransmits.
+ *
+ * Usage: esb_bench_phy [messages per run]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_phy.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+#define BENCH_MSG_CMD 0x30
+#define BENCH_FALLBACK_MAX_MSGS 100
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_central_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+static const uint8_t g_path_loss_db[] = {60, 80};
+static const int8_t g_power_levels[] = ESB_PHY_POWER_LEVELS;
+
+static esb_sim_node_t g_central;
+static volatile uint32_t g_received;
+static uint8_t g_use_phy;
+static uint16_t g_seq;
+
+static void esb_bench_central_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    if (payload[0] == BENCH_MSG_CMD) {
+        g_received++;
+    }
+}
+
+static void esb_bench_loop(void)
+{
+    esb_protocol_process();
+    if (g_use_phy != 0) {
+        esb_phy_process();
+    }
+}
+
+/* sends the messages and waits for their completion, returns the number received by the central */
+static uint32_t esb_bench_send(uint32_t messages, uint64_t *p_duration_us)
+{
+    uint32_t received = g_received;
+    uint64_t start_us = esb_sim_time_us();
+
+    for (uint32_t i = 0; i < messages; i++) {
+        esb_protocol_message_t message = {.cmd = BENCH_MSG_CMD, .payload_len = 24};
+        g_seq++;
+        message.payload[0] = (uint8_t)g_seq;
+        message.payload[1] = (uint8_t)(g_seq >> 8);
+        memcpy(message.address, g_central_addr, 5);
+        while (esb_protocol_transmit(&message) != ESB_PROT_ERR_OK) {
+            esb_bench_loop();
+        }
+        esb_bench_loop();
+    }
+    while (esb_protocol_tx_idle() == 0) {
+        esb_bench_loop();
+    }
+    esb_bench_loop();
+
+    if (p_duration_us != NULL) {
+        *p_duration_us = esb_sim_time_us() - start_us;
+    }
+
+    return (g_received - received);
+}
+
+static void esb_bench_report(const char *p_name, uint32_t received, uint32_t messages, uint64_t duration_us)
+{
+    esb_bitrate_t bitrate;
+    int8_t tx_power;
+    esb_get_phy(&bitrate, &tx_power);
+    printf("  %-30s %uM %+3d dBm, %4u/%u received, %5.0f messages/s\n", p_name, bitrate + 1, tx_power, received,
+           messages, (duration_us > 0) ? received * 1e6 / duration_us : 0.0);
+    ESB_BENCH_CHECK(received >= ((messages * 99) / 100));
+}
+
+/* the central sends ESB_CMD_PHY_SET until the ESB ACK confirms it */
+static void esb_bench_announce(esb_bitrate_t bitrate)
+{
+    uint8_t frame[ESB_PROTOCOL_HEADER_SIZE + ESB_PHY_SET_LEN] = {ESB_CMD_PHY_SET, 0};
+    memcpy(&frame[2], g_central_addr, 5);
+    frame[ESB_PROTOCOL_HEADER_SIZE] = bitrate;
+    frame[ESB_PROTOCOL_HEADER_SIZE + 1] = (uint8_t)g_power_levels[0];
+
+    esb_sim_tx_result_t result;
+    do {
+        (void)esb_sim_node_send(g_central, g_fw_addr, frame, sizeof(frame), &result);
+    } while (result.acked == 0);
+}
+
+static void esb_bench_wait_stable(void)
+{
+    while (esb_phy_get_state() != ESB_PHY_STATE_STABLE) {
+        esb_bench_loop();
+    }
+}
+
+static void esb_bench_init(uint8_t path_loss_db, uint8_t use_phy)
+{
+    esb_sim_config_t config = {
+        .loss_permille = 5, .latency_us = 20, .realtime = 0, .seed = 5, .path_loss_db = path_loss_db};
+    esb_sim_init(&config);
+    esb_sim_node_add(g_central_addr, esb_bench_central_rx, &g_central);
+    esb_protocol_init(g_fw_addr);
+    g_use_phy = use_phy;
+    if (use_phy != 0) {
+        ESB_BENCH_CHECK(esb_phy_init(g_central_addr) == ESB_PROT_ERR_OK);
+    }
+}
+
+static void esb_bench_run(uint8_t path_loss_db, uint32_t messages)
+{
+    uint64_t duration_us;
+    uint32_t received;
+
+    printf("path loss %u dB\n", path_loss_db);
+    esb_bench_init(path_loss_db, 0);
+    received = esb_bench_send(messages, &duration_us);
+    esb_bench_report("without PHY module", received, messages, duration_us);
+
+    esb_bench_init(path_loss_db, 1);
+    received = esb_bench_send(messages, &duration_us);
+    esb_bench_report("TX power policy", received, messages, duration_us);
+
+    if (esb_phy_best_bitrate() == ESB_BITRATE_2MBPS) {
+        esb_bench_announce(ESB_BITRATE_2MBPS);
+        esb_sim_node_set_bitrate(g_central, ESB_BITRATE_2MBPS);
+        esb_bench_wait_stable();
+        received = esb_bench_send(messages, &duration_us);
+        esb_bench_report("2 Mbit/s negotiated", received, messages, duration_us);
+
+        esb_phy_counters_t counters_before;
+        esb_phy_get_counters(&counters_before);
+        esb_bench_announce(ESB_BITRATE_1MBPS);
+        esb_bench_loop();
+        esb_bench_wait_stable();
+        esb_phy_counters_t counters;
+        esb_phy_get_counters(&counters);
+        esb_bitrate_t bitrate;
+        int8_t tx_power;
+        esb_get_phy(&bitrate, &tx_power);
+        printf("  %-30s %uM %+3d dBm, %u reverts\n", "central didn't follow", bitrate + 1, tx_power,
+               counters.reverts - counters_before.reverts);
+        ESB_BENCH_CHECK(bitrate == ESB_BITRATE_2MBPS);
+        ESB_BENCH_CHECK(counters.reverts > counters_before.reverts);
+
+        esb_sim_node_set_bitrate(g_central, ESB_BITRATE_1MBPS);
+        uint32_t sent = 0;
+        do {
+            (void)esb_bench_send(1, NULL);
+            sent++;
+            esb_get_phy(&bitrate, &tx_power);
+        } while (((bitrate != ESB_BITRATE_1MBPS) || (esb_phy_get_state() != ESB_PHY_STATE_STABLE)) &&
+                 (sent < BENCH_FALLBACK_MAX_MSGS));
+        esb_phy_get_counters(&counters);
+        printf("  %-30s %uM %+3d dBm after %u messages, %u fallbacks\n", "central silently back to 1M",
+               bitrate + 1, tx_power, sent, counters.fallbacks);
+        ESB_BENCH_CHECK(bitrate == ESB_BITRATE_1MBPS);
+        ESB_BENCH_CHECK(counters.fallbacks > 0);
+
+        received = esb_bench_send(messages, &duration_us);
+        esb_bench_report("after the fallback", received, messages, duration_us);
+    }
+
+    for (uint8_t bitrate = 0; bitrate < ESB_BITRATE_NUM; bitrate++) {
+        for (uint8_t level = 0; level < sizeof(g_power_levels); level++) {
+            esb_phy_stats_t stats;
+            esb_phy_get_stats((esb_bitrate_t)bitrate, level, &stats);
+            if (stats.frames > 0) {
+                printf("    %uM %+3d dBm: %5u frames, %3u failed, success %4u permille, %5u frames/s, %6u nJ/frame\n",
+                       bitrate + 1, g_power_levels[level], stats.frames, stats.failed, stats.success_permille,
+                       stats.frames_per_s, stats.energy_nj);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t messages = (argc > 1) ? (uint32_t)atoi(argv[1]) : 2000;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    for (uint8_t i = 0; i < sizeof(g_path_loss_db); i++) {
+        esb_bench_run(g_path_loss_db[i], messages);
+    }
+
+    return (ESB_BENCH_RESULT());
+}
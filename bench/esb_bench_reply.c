@@ -0,0 +1,107 @@
+/*
+ * Air cost of a request/reply exchange with replies in separate frames and in ACK payloads
+ *
+ * A virtual central sends ESB_CMD_GET_STATS requests to the firmware and counts the replies, once with
+ * ESB_PROT_REPLY_MODE_FRAME, where the firmware switches to PTX mode for every reply, and once with
+ * ESB_PROT_REPLY_MODE_ACK_PAYLOAD, where the reply rides on the ACK of the next request (the last one is picked up
+ * with ESB_CMD_POLL). Reply frames are sent on the pipeline address of the firmware, so the central listens on it with
+ * a second virtual node. The statistics change with every request, identical reply frames would be dropped as
+ * retransmits by the receiver of the virtual node (the PID restarts with every mode switch). The simulation runs in
+ * virtual time, the air time per exchange includes the retransmits.
+ *
+ * Usage: esb_bench_reply [exchanges per run]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/commands/esb_cmd_def_common.h>
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_central_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+static const uint16_t g_loss_permille[] = {0, 100};
+
+static volatile uint32_t g_frame_replies;
+
+static void esb_bench_central_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    if (payload[0] == ESB_CMD_GET_STATS) {
+        g_frame_replies++;
+    }
+}
+
+static void esb_bench_run(uint16_t loss_permille, uint32_t exchanges, esb_protocol_reply_mode_t mode)
+{
+    esb_sim_config_t config = {.loss_permille = loss_permille, .latency_us = 50, .realtime = 0, .seed = 7};
+    esb_sim_node_t central;
+    esb_sim_node_t central_rx;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_central_addr, NULL, &central);
+    esb_sim_node_add(g_fw_addr, esb_bench_central_rx, &central_rx);
+    esb_protocol_init(g_fw_addr);
+    ESB_BENCH_CHECK(esb_protocol_set_reply_mode(mode) == ESB_PROT_ERR_OK);
+
+    g_frame_replies = 0;
+    uint32_t ack_replies = 0;
+    esb_mode_switch_stats_t switches_start;
+    esb_get_mode_switch_stats(&switches_start);
+    uint64_t start_us = esb_sim_time_us();
+
+    uint8_t request[ESB_PROTOCOL_HEADER_SIZE + 1] = {ESB_CMD_GET_STATS, 0};
+    memcpy(&request[2], g_central_addr, 5);
+    request[ESB_PROTOCOL_HEADER_SIZE] = 0; /* first counter */
+    uint8_t length = sizeof(request);
+    for (uint32_t i = 0; i <= exchanges; i++) {
+        if (i == exchanges) {
+            if (mode == ESB_PROT_REPLY_MODE_FRAME) {
+                break;
+            }
+            /* pick up the last reply */
+            request[0] = ESB_CMD_POLL;
+            length = ESB_PROTOCOL_HEADER_SIZE;
+        }
+
+        esb_sim_tx_result_t result;
+        (void)esb_sim_node_send(central, g_fw_addr, request, length, &result);
+        if ((result.ack_payload_length > 0) && (result.ack_payload[0] == ESB_CMD_GET_STATS)) {
+            ack_replies++;
+        }
+        esb_protocol_process();
+        while (esb_protocol_tx_idle() == 0) {
+            esb_protocol_process();
+        }
+    }
+    uint64_t duration_us = esb_sim_time_us() - start_us;
+
+    esb_sim_stats_t stats;
+    esb_sim_get_stats(&stats);
+    esb_mode_switch_stats_t switches;
+    esb_get_mode_switch_stats(&switches);
+    uint32_t replies = g_frame_replies + ack_replies;
+    printf("%s loss %2u%%: %4u/%u replies, %.2f frames/exchange, %5.0f us air time/exchange, %4u mode switches\n",
+           (mode == ESB_PROT_REPLY_MODE_FRAME) ? "frame replies      " : "ACK payload replies", loss_permille / 10,
+           replies, exchanges, (double)stats.frames / exchanges, (double)duration_us / exchanges,
+           switches.count - switches_start.count);
+    if (loss_permille == 0) {
+        ESB_BENCH_CHECK(replies == exchanges);
+    }
+    if (mode == ESB_PROT_REPLY_MODE_ACK_PAYLOAD) {
+        ESB_BENCH_CHECK(g_frame_replies == 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t exchanges = (argc > 1) ? (uint32_t)atoi(argv[1]) : 200;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    for (uint8_t i = 0; i < (sizeof(g_loss_permille) / sizeof(g_loss_permille[0])); i++) {
+        esb_bench_run(g_loss_permille[i], exchanges, ESB_PROT_REPLY_MODE_FRAME);
+        esb_bench_run(g_loss_permille[i], exchanges, ESB_PROT_REPLY_MODE_ACK_PAYLOAD);
+    }
+
+    return (ESB_BENCH_RESULT());
+}
@@ -0,0 +1,156 @@
+/*
+ * Command throughput with pipelined requests and exactly-once execution with request IDs
+ *
+ * A virtual central sends requests of an application command to the firmware, which counts its executions.
+ * - throughput: without request ID one request is outstanding at a time, with request IDs a window of requests
+ *   is sent before the main loop of the firmware runs (every main loop iteration takes a fixed time). The
+ *   simulation runs in real time.
+ * - exactly once: on a link with 70% frame loss the central repeats each request until it gets the reply. Without
+ *   request ID a request whose reply got lost is executed again, with request ID the cached reply is sent.
+ *
+ * Usage: esb_bench_request [requests per run]
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <common/commands/esb_commands.h>
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+#define BENCH_CMD 0xA0
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_central_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+static const uint32_t g_loop_us[] = {1000, 5000};
+
+static esb_sim_node_t g_central;
+static uint32_t g_executions;
+static volatile uint32_t g_replies;
+static uint32_t g_main_loop_us;
+
+static void esb_bench_cmd(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    g_executions++;
+    answer->error = ESB_PROT_REPLY_ERR_OK;
+    answer->payload[0] = message->payload[0];
+    memcpy(&answer->payload[1], &g_executions, sizeof(g_executions));
+    answer->payload_len = 1 + sizeof(g_executions);
+}
+
+static esb_cmd_table_item_t g_cmd_table[] = {{BENCH_CMD, 1, esb_bench_cmd}, {0, 0, NULL}};
+
+static void esb_bench_central_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    if (payload[0] == BENCH_CMD) {
+        g_replies++;
+    }
+}
+
+/* one iteration of the firmware main loop, until the replies are sent */
+static void esb_bench_main_loop(void)
+{
+    if (g_main_loop_us > 0) {
+        usleep(g_main_loop_us);
+    }
+    do {
+        esb_protocol_process();
+    } while (esb_tx_pending() > 0);
+    esb_protocol_process();
+}
+
+static void esb_bench_send_request(uint8_t request_id, uint8_t tag)
+{
+    uint8_t frame[ESB_PROTOCOL_HEADER_SIZE + 2] = {BENCH_CMD, 0};
+    uint8_t length = ESB_PROTOCOL_HEADER_SIZE;
+    memcpy(&frame[2], g_central_addr, 5);
+    if (request_id != 0) {
+        frame[1] = ESB_PROTOCOL_FLAG_REQ_ID;
+        frame[length++] = request_id;
+    }
+    frame[length++] = tag;
+
+    esb_sim_tx_result_t result;
+    (void)esb_sim_node_send(g_central, g_fw_addr, frame, length, &result);
+}
+
+static void esb_bench_throughput(uint32_t requests, uint32_t window)
+{
+    uint32_t replies = g_replies;
+    uint64_t start_us = esb_bench_now_us();
+
+    for (uint32_t i = 0; i < requests; i += window) {
+        for (uint32_t k = 0; (k < window) && ((i + k) < requests); k++) {
+            esb_bench_send_request((window > 1) ? esb_protocol_next_request_id() : 0, (uint8_t)(i + k));
+        }
+        esb_bench_main_loop();
+    }
+
+    replies = g_replies - replies;
+    printf("%s window %u, main loop %4u us: %4u/%u replies, %5.0f requests/s\n",
+           (window > 1) ? "with ID   " : "without ID", window, g_main_loop_us, replies, requests,
+           replies * 1e6 / (esb_bench_now_us() - start_us));
+    ESB_BENCH_CHECK(replies == requests);
+}
+
+static void esb_bench_exactly_once(uint32_t requests, uint8_t with_id)
+{
+    uint32_t executions = g_executions;
+    uint32_t sends = 0;
+
+    esb_protocol_reset_stats();
+    for (uint32_t i = 0; i < requests; i++) {
+        uint8_t request_id = (with_id != 0) ? esb_protocol_next_request_id() : 0;
+        uint32_t replies;
+        do {
+            replies = g_replies;
+            esb_bench_send_request(request_id, (uint8_t)i);
+            sends++;
+            esb_bench_main_loop();
+        } while (g_replies == replies);
+    }
+
+    esb_protocol_stats_t stats;
+    esb_protocol_get_stats(&stats);
+    executions = g_executions - executions;
+    printf("%s loss 70%%: %u requests, %u sends, handler ran %u times, %u replies from the cache\n",
+           (with_id != 0) ? "with ID   " : "without ID", requests, sends, executions,
+           stats.counter[ESB_PROT_STAT_RX_REPEATED]);
+    if (with_id != 0) {
+        ESB_BENCH_CHECK(executions == requests);
+    } else {
+        ESB_BENCH_CHECK(executions >= requests);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t requests = (argc > 1) ? (uint32_t)atoi(argv[1]) : 200;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 20, .realtime = 1, .seed = 3};
+    esb_sim_node_t central_rx;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_central_addr, NULL, &g_central);
+    esb_sim_node_add(g_fw_addr, esb_bench_central_rx, &central_rx);
+    esb_protocol_init(g_fw_addr);
+    ESB_BENCH_CHECK(esb_commands_register_app_commands(g_cmd_table, 1) == ESB_PROT_ERR_OK);
+
+    for (uint8_t i = 0; i < (sizeof(g_loop_us) / sizeof(g_loop_us[0])); i++) {
+        g_main_loop_us = g_loop_us[i];
+        esb_bench_throughput(requests, 1);
+        esb_bench_throughput(requests, 2);
+        esb_bench_throughput(requests, 4);
+    }
+
+    g_main_loop_us = 0;
+    config.loss_permille = 700;
+    config.realtime = 0;
+    esb_sim_set_config(&config);
+    esb_bench_exactly_once(requests * 10, 0);
+    esb_bench_exactly_once(requests * 10, 1);
+
+    return (ESB_BENCH_RESULT());
+}
@@ -0,0 +1,129 @@
+/*
+ * Throughput and producer latency of the lock-free frame ring between the radio interrupt and the main loop
+ *
+ * A producer thread stands in for the radio interrupt: it writes received frames into an esb_ring of
+ * ESB_PROTOCOL_RX_QUEUE_SIZE protocol messages in place, like the RX path of esb_protocol. The main thread
+ * consumes them and checks that every message arrives once, in order and unchanged. A full ring is counted and
+ * retried, only the successful pushes are part of the latency statistics.
+ *
+ * Usage: esb_bench_ring [messages]
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/protocol/esb_protocol.h>
+#include <common/protocol/esb_ring.h>
+
+#include "esb_bench.h"
+
+#define BENCH_PAYLOAD_LEN 25
+
+ESB_RING_DEF(esb_protocol_message_t, g_ring, ESB_PROTOCOL_RX_QUEUE_SIZE);
+
+static uint32_t g_messages;
+static uint32_t *g_latency_ns;
+static uint64_t g_ring_full;
+static volatile uint8_t g_done;
+
+static uint64_t esb_bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec);
+}
+
+static void *esb_bench_producer(void *p_arg)
+{
+    uint8_t frame[ESB_FRAME_SIZE];
+    memset(frame, 0xA5, sizeof(frame));
+
+    for (uint32_t i = 0; i < g_messages;) {
+        memcpy(&frame[ESB_PROTOCOL_HEADER_SIZE], &i, sizeof(i));
+        uint64_t start_ns = esb_bench_now_ns();
+        esb_protocol_message_t *p_message = esb_ring_alloc(&g_ring);
+        if (p_message == NULL) {
+            g_ring_full++;
+            sched_yield();
+            continue;
+        }
+        p_message->cmd = frame[0];
+        memcpy(p_message->address, &frame[2], 5);
+        p_message->payload_len = BENCH_PAYLOAD_LEN;
+        memcpy(p_message->payload, &frame[ESB_PROTOCOL_HEADER_SIZE], BENCH_PAYLOAD_LEN);
+        esb_ring_commit(&g_ring);
+        g_latency_ns[i++] = (uint32_t)(esb_bench_now_ns() - start_ns);
+    }
+    g_done = 1;
+
+    return (NULL);
+}
+
+static int esb_bench_compare(const void *p_a, const void *p_b)
+{
+    uint32_t a = *(const uint32_t *)p_a;
+    uint32_t b = *(const uint32_t *)p_b;
+
+    return ((a < b) ? -1 : (a > b));
+}
+
+int main(int argc, char **argv)
+{
+    g_messages = (argc > 1) ? (uint32_t)atoi(argv[1]) : 2000000;
+    g_latency_ns = malloc(g_messages * sizeof(uint32_t));
+    ESB_BENCH_CHECK(g_latency_ns != NULL);
+    if (g_latency_ns == NULL) {
+        return (ESB_BENCH_RESULT());
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    esb_ring_reset(&g_ring);
+    uint64_t start_ns = esb_bench_now_ns();
+    pthread_t producer;
+    pthread_create(&producer, NULL, esb_bench_producer, NULL);
+
+    uint32_t consumed = 0;
+    uint32_t out_of_order = 0;
+    uint32_t corrupted = 0;
+    for (;;) {
+        const esb_protocol_message_t *p_message = esb_ring_peek(&g_ring);
+        if (p_message != NULL) {
+            uint32_t seq;
+            memcpy(&seq, p_message->payload, sizeof(seq));
+            out_of_order += (seq != consumed) ? 1 : 0;
+            corrupted += ((p_message->cmd != 0xA5) || (p_message->payload_len != BENCH_PAYLOAD_LEN) ||
+                          (p_message->payload[BENCH_PAYLOAD_LEN - 1] != 0xA5))
+                             ? 1
+                             : 0;
+            consumed++;
+            esb_ring_pop(&g_ring);
+        } else if (g_done != 0) {
+            if (esb_ring_count(&g_ring) == 0) {
+                break;
+            }
+        } else {
+            sched_yield();
+        }
+    }
+    uint64_t duration_ns = esb_bench_now_ns() - start_ns;
+    pthread_join(producer, NULL);
+
+    uint64_t latency_sum_ns = 0;
+    for (uint32_t i = 0; i < g_messages; i++) {
+        latency_sum_ns += g_latency_ns[i];
+    }
+    qsort(g_latency_ns, g_messages, sizeof(uint32_t), esb_bench_compare);
+    printf("depth %u: %u messages, %.2f million/s, ring full %llu times\n", ESB_PROTOCOL_RX_QUEUE_SIZE, consumed,
+           consumed * 1000.0 / duration_ns, (unsigned long long)g_ring_full);
+    printf("producer latency avg %.0f ns, p50 %u ns, p99 %u ns, p99.9 %u ns, max %u ns\n",
+           (double)latency_sum_ns / g_messages, g_latency_ns[g_messages / 2], g_latency_ns[(g_messages / 100) * 99],
+           g_latency_ns[(g_messages / 1000) * 999], g_latency_ns[g_messages - 1]);
+    ESB_BENCH_CHECK(consumed == g_messages);
+    ESB_BENCH_CHECK(out_of_order == 0);
+    ESB_BENCH_CHECK(corrupted == 0);
+    free(g_latency_ns);
+
+    return (ESB_BENCH_RESULT());
+}
@@ -0,0 +1,146 @@
+/*
+ * CPU use of the firmware main loop with busy polling and with the event-driven scheduler
+ *
+ * The main loop of the firmware runs in its own thread, once polling esb_protocol_process() and once sleeping in
+ * esb_sched_wait() between the events (common/sched/esb_sched.h). A virtual central sends requests at a fixed rate
+ * and counts the replies. The CPU time of the main loop thread and the sleep statistics of the scheduler are scaled
+ * to one hour. Finally a single long wakeup checks that requested wakeups beyond a few seconds are kept.
+ *
+ * Usage: esb_bench_sched [seconds per run]
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/commands/esb_cmd_def_common.h>
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_protocol.h>
+#include <common/sched/esb_sched.h>
+
+#include "esb_bench.h"
+
+/* longer than the wrap-around of a 32 bit nanosecond counter */
+#define BENCH_LONG_WAKEUP_US 5000000u
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_central_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+static const uint32_t g_rates[] = {10, 100};
+
+static volatile uint32_t g_replies;
+static volatile uint8_t g_stop;
+static uint8_t g_event_loop;
+static uint64_t g_loop_iterations;
+static uint64_t g_cpu_us;
+
+static uint64_t esb_bench_thread_cpu_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    return (((uint64_t)ts.tv_sec * 1000000u) + ((uint64_t)ts.tv_nsec / 1000u));
+}
+
+static void esb_bench_central_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    g_replies++;
+}
+
+static void *esb_bench_main_loop(void *p_arg)
+{
+    uint64_t start = esb_bench_thread_cpu_us();
+
+    while (g_stop == 0) {
+        if (g_event_loop != 0) {
+            (void)esb_sched_take();
+            esb_protocol_process();
+            esb_sched_wait();
+        } else {
+            esb_protocol_process();
+        }
+        g_loop_iterations++;
+    }
+    g_cpu_us = esb_bench_thread_cpu_us() - start;
+
+    return (NULL);
+}
+
+static void esb_bench_run(uint32_t rate, uint32_t seconds, uint8_t event_loop)
+{
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 50, .realtime = 0, .seed = 7};
+    esb_sim_node_t central;
+    esb_sim_node_t central_rx;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_central_addr, NULL, &central);
+    esb_sim_node_add(g_fw_addr, esb_bench_central_rx, &central_rx);
+    esb_protocol_init(g_fw_addr);
+    esb_sched_init();
+
+    g_replies = 0;
+    g_stop = 0;
+    g_event_loop = event_loop;
+    g_loop_iterations = 0;
+    pthread_t thread;
+    pthread_create(&thread, NULL, esb_bench_main_loop, NULL);
+
+    /* VERSION and GET_STATS alternate, identical reply frames would be dropped as retransmits */
+    uint32_t requests = rate * seconds;
+    struct timespec interval = {.tv_sec = 0, .tv_nsec = 1000000000L / rate};
+    for (uint32_t i = 0; i < requests; i++) {
+        uint8_t request[ESB_PROTOCOL_HEADER_SIZE + 1] = {((i & 1) != 0) ? ESB_CMD_GET_STATS : ESB_CMD_VERSION, 0};
+        memcpy(&request[2], g_central_addr, 5);
+        esb_sim_tx_result_t result;
+        (void)esb_sim_node_send(central, g_fw_addr, request,
+                                ((i & 1) != 0) ? sizeof(request) : ESB_PROTOCOL_HEADER_SIZE, &result);
+        nanosleep(&interval, NULL);
+    }
+
+    g_stop = 1;
+    esb_sched_signal(ESB_SCHED_EVT_APP);
+    pthread_join(thread, NULL);
+
+    double per_hour = 3600.0 / seconds;
+    if (event_loop != 0) {
+        esb_sched_stats_t stats;
+        esb_sched_get_stats(&stats);
+        printf("event loop %3u requests/s: %4u/%u replies, %9.0f wakeups/h, active %8.1f ms/h, thread CPU %7.2f s/h\n",
+               rate, g_replies, requests, stats.wakeups * per_hour, stats.active_us * per_hour / 1000.0,
+               g_cpu_us * per_hour / 1e6);
+    } else {
+        printf("busy poll  %3u requests/s: %4u/%u replies, %9.3g loop iterations/h,        thread CPU %7.2f s/h\n",
+               rate, g_replies, requests, g_loop_iterations * per_hour, g_cpu_us * per_hour / 1e6);
+    }
+    ESB_BENCH_CHECK(g_replies == requests);
+}
+
+static void esb_bench_long_wakeup(void)
+{
+    esb_sched_init();
+    (void)esb_sched_take();
+
+    uint64_t start = esb_bench_now_us();
+    esb_sched_request_wakeup(BENCH_LONG_WAKEUP_US);
+    while ((esb_sched_take() & ESB_SCHED_EVT_TIMER) == 0) {
+        esb_sched_wait();
+    }
+    uint64_t slept_us = esb_bench_now_us() - start;
+
+    printf("wakeup requested in %u ms: woke up after %llu ms\n", BENCH_LONG_WAKEUP_US / 1000,
+           (unsigned long long)(slept_us / 1000));
+    ESB_BENCH_CHECK(slept_us >= BENCH_LONG_WAKEUP_US);
+    ESB_BENCH_CHECK(slept_us < (BENCH_LONG_WAKEUP_US + (BENCH_LONG_WAKEUP_US / 10)));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seconds = (argc > 1) ? (uint32_t)atoi(argv[1]) : 1;
+    seconds = (seconds > 0) ? seconds : 1;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    for (uint8_t i = 0; i < (sizeof(g_rates) / sizeof(g_rates[0])); i++) {
+        esb_bench_run(g_rates[i], seconds, 0);
+        esb_bench_run(g_rates[i], seconds, 1);
+    }
+    esb_bench_long_wakeup();
+
+    return (ESB_BENCH_RESULT());
+}
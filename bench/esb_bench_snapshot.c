@@ -0,0 +1,210 @@
+/*
+ * Exchanges and air time of a central resync with single channel and with snapshot commands
+ *
+ * The firmware is a binary sensor with random channel values, a virtual central reads all channels once with
+ * ESB_CMD_BINARY_SENSOR_GET_CHANNEL per channel and once with ESB_CMD_BINARY_SENSOR_GET_ALL_CHANNELS (in parts of
+ * as many channels as fit into one reply, all parts with the same generation). Then it inverts all channels once
+ * with ESB_CMD_BINARY_SENSOR_SET_CHANNEL per channel and sets them back with
+ * ESB_CMD_BINARY_SENSOR_SET_CHANNELS_MASKED. Finally the error replies of invalid snapshot commands are checked.
+ * The benchmark is built twice, with 128 channels (esb_bench_snapshot, binary sensor library with
+ * BINARY_SENSOR_CHAN_NUM=128 and BINARY_SENSOR_NOTIFICATION_VERSION=2) and with 32 channels
+ * (esb_bench_snapshot_32). The simulation runs in virtual time.
+ *
+ * Usage: esb_bench_snapshot
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <binary-sensor/binary_sensor.h>
+#include <binary-sensor/binary_sensor_esb_cmd_def.h>
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_protocol.h>
+
+#include "esb_bench.h"
+
+#define BENCH_MASKED_MAX_BYTES 11 /* mask and value bytes per ESB_CMD_BINARY_SENSOR_SET_CHANNELS_MASKED */
+#define BENCH_SNAPSHOT_MAX_BYTES (ESB_PROTOCOL_REQ_MAX_PAYLOAD_LEN - 4) /* state bytes per snapshot reply */
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static uint8_t g_central_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+
+static esb_sim_node_t g_central;
+static uint8_t g_reply[ESB_FRAME_SIZE];
+static uint8_t g_reply_length;
+static uint32_t g_replies;
+static uint8_t g_request_id;
+
+static void esb_bench_central_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    if ((payload[1] & ESB_PROTOCOL_FLAG_REQ_ID) != 0) {
+        memcpy(g_reply, payload, payload_length);
+        g_reply_length = payload_length;
+        g_replies++;
+    }
+}
+
+static void esb_bench_pump(void)
+{
+    do {
+        esb_protocol_process();
+    } while (esb_tx_pending() > 0);
+    esb_protocol_process();
+}
+
+/* one request/reply exchange, returns the reply error, the reply payload follows the request ID */
+static uint8_t esb_bench_exchange(uint8_t cmd, const uint8_t *p_payload, uint8_t payload_len)
+{
+    uint8_t frame[ESB_FRAME_SIZE] = {cmd, ESB_PROTOCOL_FLAG_REQ_ID};
+    memcpy(&frame[2], g_central_addr, 5);
+    g_request_id = (g_request_id == UINT8_MAX) ? 1 : (g_request_id + 1);
+    frame[ESB_PROTOCOL_HEADER_SIZE] = g_request_id;
+    memcpy(&frame[ESB_PROTOCOL_HEADER_SIZE + 1], p_payload, payload_len);
+
+    uint32_t replies = g_replies;
+    esb_sim_tx_result_t result;
+    (void)esb_sim_node_send(g_central, g_fw_addr, frame, ESB_PROTOCOL_HEADER_SIZE + 1 + payload_len, &result);
+    esb_bench_pump();
+    ESB_BENCH_CHECK(g_replies == (replies + 1));
+    ESB_BENCH_CHECK(g_reply[ESB_PROTOCOL_HEADER_SIZE] == g_request_id);
+
+    return (g_reply[1] & (uint8_t)~(ESB_PROTOCOL_FLAG_REQ_ID | ESB_PROTOCOL_FLAG_COMPACT));
+}
+
+static void esb_bench_report(const char *p_name, uint32_t exchanges, const esb_sim_stats_t *p_start, uint32_t wrong)
+{
+    esb_sim_stats_t stats;
+    esb_sim_get_stats(&stats);
+    printf("%-30s %3u exchanges, %3u frames, air time %6llu us, %u wrong channels\n", p_name, exchanges,
+           stats.frames - p_start->frames, (unsigned long long)(stats.airtime_us - p_start->airtime_us), wrong);
+    ESB_BENCH_CHECK(wrong == 0);
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t expected[BINARY_SENSOR_CHAN_NUM];
+    uint8_t states[BINARY_SENSOR_CHAN_NUM];
+    const uint8_t *p_reply = &g_reply[ESB_PROTOCOL_HEADER_SIZE + 1];
+    esb_sim_stats_t start;
+    uint32_t exchanges;
+    uint32_t wrong;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 20, .realtime = 0, .seed = 5};
+    esb_sim_node_t central_rx;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_central_addr, NULL, &g_central);
+    esb_sim_node_add(g_fw_addr, esb_bench_central_rx, &central_rx);
+    esb_protocol_init(g_fw_addr);
+    ESB_BENCH_CHECK(binary_sensor_init(g_fw_addr) == ESB_PROT_ERR_OK);
+    binary_sensor_set_central_address(g_central_addr);
+    printf("%u channels\n", BINARY_SENSOR_CHAN_NUM);
+
+    srand(3);
+    for (uint16_t chan = 0; chan < BINARY_SENSOR_CHAN_NUM; chan++) {
+        expected[chan] = rand() & 1;
+        (void)binary_sensor_set_channel(chan, (channel_value_t)expected[chan]);
+    }
+    while (binary_sensor_publish() != ESB_PROT_ERR_OK) {
+        esb_bench_pump();
+    }
+    esb_bench_pump();
+
+    /* resync channel by channel */
+    esb_sim_get_stats(&start);
+    wrong = 0;
+    for (uint16_t chan = 0; chan < BINARY_SENSOR_CHAN_NUM; chan++) {
+        uint8_t request = chan;
+        ESB_BENCH_CHECK(esb_bench_exchange(ESB_CMD_BINARY_SENSOR_GET_CHANNEL, &request, 1) == ESB_PROT_REPLY_ERR_OK);
+        wrong += (p_reply[0] != expected[chan]) ? 1 : 0;
+    }
+    esb_bench_report("GET_CHANNEL per channel", BINARY_SENSOR_CHAN_NUM, &start, wrong);
+
+    /* resync with snapshots: generation, first channel, total state bytes, states */
+    esb_sim_get_stats(&start);
+    exchanges = 0;
+    memset(states, 0xFF, sizeof(states));
+    uint16_t generation = 0;
+    uint8_t total_bytes = 1;
+    for (uint16_t first = 0; (first / 8) < total_bytes;) {
+        uint8_t request = first;
+        ESB_BENCH_CHECK(esb_bench_exchange(ESB_CMD_BINARY_SENSOR_GET_ALL_CHANNELS, &request, 1) ==
+                        ESB_PROT_REPLY_ERR_OK);
+        exchanges++;
+        uint16_t part_generation = p_reply[0] | (p_reply[1] << 8);
+        ESB_BENCH_CHECK((first == 0) || (part_generation == generation));
+        generation = part_generation;
+        total_bytes = p_reply[3];
+        uint8_t num_bytes = g_reply_length - (ESB_PROTOCOL_HEADER_SIZE + 1) - 4;
+        for (uint16_t i = 0; (i < (8 * num_bytes)) && ((first + i) < BINARY_SENSOR_CHAN_NUM); i++) {
+            states[first + i] = (p_reply[4 + (i / 8)] >> (i % 8)) & 1u;
+        }
+        first += 8 * num_bytes;
+    }
+    wrong = 0;
+    for (uint16_t chan = 0; chan < BINARY_SENSOR_CHAN_NUM; chan++) {
+        wrong += (states[chan] != expected[chan]) ? 1 : 0;
+    }
+    esb_bench_report("GET_ALL_CHANNELS", exchanges, &start, wrong);
+    uint32_t state_bytes = (BINARY_SENSOR_CHAN_NUM + 7) / 8;
+    ESB_BENCH_CHECK(exchanges == ((state_bytes + BENCH_SNAPSHOT_MAX_BYTES - 1) / BENCH_SNAPSHOT_MAX_BYTES));
+
+    /* invert all channels channel by channel, then set them back with masked updates */
+    esb_sim_get_stats(&start);
+    for (uint16_t chan = 0; chan < BINARY_SENSOR_CHAN_NUM; chan++) {
+        uint8_t request[2] = {chan, expected[chan] ^ 1u};
+        ESB_BENCH_CHECK(esb_bench_exchange(ESB_CMD_BINARY_SENSOR_SET_CHANNEL, request, 2) == ESB_PROT_REPLY_ERR_OK);
+    }
+    esb_bench_report("SET_CHANNEL per channel", BINARY_SENSOR_CHAN_NUM, &start, 0);
+    while (binary_sensor_publish() != ESB_PROT_ERR_OK) {
+        esb_bench_pump();
+    }
+    esb_bench_pump();
+
+    esb_sim_get_stats(&start);
+    exchanges = 0;
+    for (uint16_t first = 0; first < BINARY_SENSOR_CHAN_NUM; first += 8 * BENCH_MASKED_MAX_BYTES) {
+        uint8_t request[2 + (2 * BENCH_MASKED_MAX_BYTES)] = {0};
+        uint8_t num_bytes = (BINARY_SENSOR_CHAN_NUM - first + 7) / 8;
+        num_bytes = (num_bytes > BENCH_MASKED_MAX_BYTES) ? BENCH_MASKED_MAX_BYTES : num_bytes;
+        request[0] = first;
+        request[1] = num_bytes;
+        for (uint16_t i = 0; (i < (8 * num_bytes)) && ((first + i) < BINARY_SENSOR_CHAN_NUM); i++) {
+            request[2 + (i / 8)] |= 1u << (i % 8);
+            request[2 + num_bytes + (i / 8)] |= expected[first + i] << (i % 8);
+        }
+        ESB_BENCH_CHECK(esb_bench_exchange(ESB_CMD_BINARY_SENSOR_SET_CHANNELS_MASKED, request, 2 + (2 * num_bytes)) ==
+                        ESB_PROT_REPLY_ERR_OK);
+        exchanges++;
+    }
+    wrong = 0;
+    for (uint16_t chan = 0; chan < BINARY_SENSOR_CHAN_NUM; chan++) {
+        channel_value_t value;
+        (void)binary_sensor_get_channel(chan, &value);
+        wrong += (value != expected[chan]) ? 1 : 0;
+    }
+    esb_bench_report("SET_CHANNELS_MASKED", exchanges, &start, wrong);
+
+    /* invalid requests change nothing */
+    uint8_t num_bytes = 1;
+    uint16_t generation_before;
+    uint16_t generation_after;
+    (void)binary_sensor_get_snapshot(0, states, &num_bytes, &generation_before);
+    uint8_t beyond[4] = {248, 1, 0xFF, 0xFF};
+    uint8_t length_mismatch[3] = {0, 2, 0x01};
+    uint8_t unaligned = 3;
+    uint8_t beyond_error = esb_bench_exchange(ESB_CMD_BINARY_SENSOR_SET_CHANNELS_MASKED, beyond, sizeof(beyond));
+    uint8_t length_error =
+        esb_bench_exchange(ESB_CMD_BINARY_SENSOR_SET_CHANNELS_MASKED, length_mismatch, sizeof(length_mismatch));
+    uint8_t unaligned_error = esb_bench_exchange(ESB_CMD_BINARY_SENSOR_GET_ALL_CHANNELS, &unaligned, 1);
+    num_bytes = 1;
+    (void)binary_sensor_get_snapshot(0, states, &num_bytes, &generation_after);
+    printf("invalid requests: mask beyond the last channel error %u, length mismatch error %u, unaligned first "
+           "channel error %u, generation %u -> %u\n",
+           beyond_error, length_error, unaligned_error, generation_before, generation_after);
+    ESB_BENCH_CHECK(beyond_error == ESB_PROT_REPLY_ERR_PARAM);
+    ESB_BENCH_CHECK(length_error == ESB_PROT_REPLY_ERR_SIZE);
+    ESB_BENCH_CHECK(unaligned_error == ESB_PROT_REPLY_ERR_PARAM);
+    ESB_BENCH_CHECK(generation_after == generation_before);
+
+    return (ESB_BENCH_RESULT());
+}
@@ -0,0 +1,90 @@
+/*
+ * Per-stage latencies of the ESB stack from the trace ring
+ *
+ * The stack is built with the trace (esb-home-fw-trace, ESB_TRACE_ENABLED=1 like the CMake option ESB_TRACE=ON).
+ * A virtual node sends commands to the firmware one at a time, every command is handled and answered with a reply
+ * frame. The ring is then dumped with esb_trace_read() and decoded into the histograms of esb_trace_decode.h, every
+ * command has to show up once in each stage: isr, queue, lookup, handler, reply and radio. The simulation runs in
+ * virtual time, the cycle counter of the host backend counts microseconds.
+ *
+ * Usage: esb_bench_trace [commands]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/commands/esb_commands.h>
+#include <common/host/esb_sim.h>
+#include <common/protocol/esb_protocol.h>
+#include <common/trace/esb_trace_decode.h>
+
+#include "esb_bench.h"
+
+#define BENCH_CMD 0x40
+#define BENCH_EVENTS_PER_CMD 8 /* radio IRQ, queued, lookup, handler enter and exit, TX start, radio IRQ, TX done */
+
+static const uint8_t g_fw_addr[5] = {0x55, 0x55, 0x55, 0x55, 0x01};
+static const uint8_t g_node_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+
+static esb_trace_record_t g_dump[ESB_TRACE_BUFFER_SIZE];
+static volatile uint32_t g_replies;
+
+static void esb_bench_cmd(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    answer->error = ESB_PROT_REPLY_ERR_OK;
+    answer->payload_len = message->payload_len;
+    memcpy(answer->payload, message->payload, message->payload_len);
+}
+
+static esb_cmd_table_item_t g_cmd_table[] = {{BENCH_CMD, 4, esb_bench_cmd}, {0, 0, NULL}};
+
+static void esb_bench_node_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    if (payload[0] == BENCH_CMD) {
+        g_replies++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t commands = (argc > 1) ? (uint32_t)atoi(argv[1]) : 400;
+    if (commands > (ESB_TRACE_BUFFER_SIZE / BENCH_EVENTS_PER_CMD)) {
+        /* the dump holds the events of all commands */
+        commands = ESB_TRACE_BUFFER_SIZE / BENCH_EVENTS_PER_CMD;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    esb_sim_config_t config = {.loss_permille = 0, .latency_us = 20, .realtime = 0, .seed = 5};
+    esb_sim_node_t node, node_rx;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_node_addr, NULL, &node);
+    esb_sim_node_add(g_fw_addr, esb_bench_node_rx, &node_rx);
+    esb_protocol_init(g_fw_addr);
+    ESB_BENCH_CHECK(esb_commands_register_app_commands(g_cmd_table, 1) == ESB_PROT_ERR_OK);
+    printf("%u commands, trace ring of %u events\n", commands, ESB_TRACE_BUFFER_SIZE);
+
+    esb_trace_reset();
+    for (uint32_t i = 0; i < commands; i++) {
+        uint8_t frame[ESB_PROTOCOL_HEADER_SIZE + 4] = {BENCH_CMD, 0};
+        memcpy(&frame[2], g_node_addr, 5);
+        memcpy(&frame[ESB_PROTOCOL_HEADER_SIZE], &i, sizeof(i));
+        esb_sim_tx_result_t result;
+        (void)esb_sim_node_send(node, g_fw_addr, frame, sizeof(frame), &result);
+        do {
+            esb_protocol_process();
+        } while (esb_tx_pending() > 0);
+    }
+
+    uint32_t records = esb_trace_read(g_dump, ESB_TRACE_BUFFER_SIZE);
+    esb_trace_report_t report;
+    ESB_BENCH_CHECK(esb_trace_decode(g_dump, records, 1, &report) == 0);
+    esb_trace_print_report(&report, stdout);
+
+    ESB_BENCH_CHECK(g_replies == commands);
+    ESB_BENCH_CHECK(records == (commands * BENCH_EVENTS_PER_CMD));
+    ESB_BENCH_CHECK(report.skipped == 0);
+    for (uint8_t stage = 0; stage < ESB_TRACE_STAGE_NUM; stage++) {
+        ESB_BENCH_CHECK(report.stage[stage].count == commands);
+    }
+
+    return (ESB_BENCH_RESULT());
+}
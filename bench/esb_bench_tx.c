@@ -0,0 +1,227 @@
+/*
+ * Frame rate and main loop stall of the old blocking, the blocking and the asynchronous transmit path of the driver
+ *
+ * The firmware sends a number of frames to a virtual node, once on the old path, once with esb_send_packet(),
+ * which waits for every frame, and once with esb_send_packet_async(), which queues up to ESB_TX_INFLIGHT_MAX frames
+ * and returns. The old path is the esb_send_packet() the driver had before the asynchronous path, reproduced on
+ * top of nrf_esb: it spins until the radio is idle, initializes the radio in PTX mode for every frame, spins until
+ * the frame is completed and initializes the radio in PRX mode again. The main loop stall is the longest time a
+ * single send call kept the main loop from running. The simulation runs in real time, so the air time and the
+ * retransmits count.
+ *
+ * Usage: esb_bench_tx [frames per run]
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/driver/esb.h>
+#include <common/host/esb_sim.h>
+#include <nrf_esb.h>
+
+#include "esb_bench.h"
+
+#define BENCH_MAX_FRAMES 4096
+/* work of the application per main loop iteration, keeps the loop from hammering the radio lock of the simulation */
+#define BENCH_APP_WORK_US 20
+
+static const uint8_t g_node_addr[5] = {0x20, 0x21, 0x22, 0x23, 0x01};
+static const uint8_t g_listen_addr[5] = {0xE7, 0xE7, 0xE7, 0xE7, 0xE7}; /* pipeline 1 of the old path */
+static const uint16_t g_loss_permille[] = {0, 100, 300};
+static const char *g_path_names[] = {"old     ", "blocking", "async   "};
+
+typedef enum {
+    BENCH_PATH_OLD = 0,
+    BENCH_PATH_BLOCKING,
+    BENCH_PATH_ASYNC,
+} esb_bench_path_t;
+
+static uint8_t g_received[BENCH_MAX_FRAMES / 8];
+static volatile uint32_t g_completed;
+static volatile uint32_t g_failed;
+
+/* the old path, see the top of the file */
+static nrf_esb_config_t g_old_config = NRF_ESB_DEFAULT_CONFIG;
+static volatile uint8_t g_old_tx_busy;
+
+static void esb_bench_old_reinit(nrf_esb_mode_t esb_mode);
+
+static void esb_bench_old_event_handler(nrf_esb_evt_t const *p_event)
+{
+    if (p_event->evt_id == NRF_ESB_EVENT_TX_SUCCESS) {
+        g_old_tx_busy = 0;
+        (void)nrf_esb_flush_tx();
+        esb_bench_old_reinit(NRF_ESB_MODE_PRX);
+    } else if (p_event->evt_id == NRF_ESB_EVENT_TX_FAILED) {
+        g_failed++;
+        g_old_tx_busy = 0;
+        (void)nrf_esb_flush_tx();
+        (void)nrf_esb_start_tx();
+    }
+}
+
+static void esb_bench_old_reinit(nrf_esb_mode_t esb_mode)
+{
+    uint8_t addr_prefix[2] = {g_node_addr[4], g_listen_addr[4]};
+    (void)nrf_esb_stop_rx();
+    (void)nrf_esb_disable();
+    g_old_config.mode = esb_mode;
+    (void)nrf_esb_init(&g_old_config);
+    (void)nrf_esb_set_address_length(5);
+    (void)nrf_esb_set_base_address_0(g_node_addr);
+    (void)nrf_esb_set_base_address_1(g_listen_addr);
+    (void)nrf_esb_set_prefixes(addr_prefix, 2);
+    if (esb_mode == NRF_ESB_MODE_PTX) {
+        (void)nrf_esb_start_tx();
+    } else {
+        (void)nrf_esb_start_rx();
+    }
+}
+
+static void esb_bench_old_init(void)
+{
+    g_old_config.protocol = NRF_ESB_PROTOCOL_ESB_DPL;
+    g_old_config.event_handler = esb_bench_old_event_handler;
+    g_old_config.bitrate = NRF_ESB_BITRATE_1MBPS;
+    g_old_config.crc = NRF_ESB_CRC_16BIT;
+    g_old_config.tx_output_power = NRF_ESB_TX_POWER_4DBM;
+    g_old_config.retransmit_delay = 600;
+    g_old_config.retransmit_count = 10;
+    g_old_config.tx_mode = NRF_ESB_TXMODE_AUTO;
+    g_old_config.selective_auto_ack = false;
+    g_old_tx_busy = 0;
+    esb_bench_old_reinit(NRF_ESB_MODE_PRX);
+}
+
+static int8_t esb_bench_old_send(const uint8_t *payload, uint8_t payload_length)
+{
+    nrf_esb_payload_t tx_payload = {.length = payload_length, .pipe = ESB_PIPE_0};
+    memcpy(tx_payload.data, payload, payload_length);
+
+    while (g_old_tx_busy == 1) {
+    }
+    esb_bench_old_reinit(NRF_ESB_MODE_PTX);
+    if (nrf_esb_write_payload(&tx_payload) != NRF_SUCCESS) {
+        return (ESB_ERR_HAL);
+    }
+    g_old_tx_busy = 1;
+    while (g_old_tx_busy == 1) {
+    }
+
+    return (ESB_ERR_OK);
+}
+
+static void esb_bench_node_rx(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    uint16_t seq;
+    memcpy(&seq, payload, sizeof(seq));
+    if (seq < BENCH_MAX_FRAMES) {
+        g_received[seq / 8] |= (uint8_t)(1u << (seq % 8));
+    }
+}
+
+static void esb_bench_tx_done(const esb_tx_result_t *p_result, void *p_context)
+{
+    g_completed++;
+    if (p_result->status != ESB_TX_SUCCESS) {
+        g_failed++;
+    }
+}
+
+static uint64_t esb_bench_run(uint16_t loss_permille, uint32_t frames, esb_bench_path_t path)
+{
+    esb_bench_settle();
+    esb_sim_config_t config = {.loss_permille = loss_permille, .latency_us = 50, .realtime = 1, .seed = 3};
+    esb_sim_node_t node;
+    esb_sim_init(&config);
+    esb_sim_node_add(g_node_addr, esb_bench_node_rx, &node);
+    ESB_BENCH_CHECK(esb_init() == ESB_ERR_OK);
+    ESB_BENCH_CHECK(esb_set_pipeline_address(ESB_PIPE_0, g_node_addr) == ESB_ERR_OK);
+    if (path == BENCH_PATH_OLD) {
+        /* the old path takes the radio over from the driver */
+        esb_bench_old_init();
+    }
+
+    memset(g_received, 0, sizeof(g_received));
+    g_completed = 0;
+    g_failed = 0;
+
+    uint8_t payload[ESB_SIM_MAX_PAYLOAD_LEN] = {0};
+    uint32_t sent = 0;
+    uint32_t timeouts = 0;
+    uint64_t max_stall_us = 0;
+    uint64_t loop_iterations = 0;
+    uint64_t start = esb_bench_now_us();
+    while ((sent < frames) || (g_completed < sent)) {
+        /* one iteration of the main loop, which sends at most one frame */
+        loop_iterations++;
+        uint64_t work_end = esb_bench_now_us() + BENCH_APP_WORK_US;
+        while (esb_bench_now_us() < work_end) {
+        }
+        if (sent == frames) {
+            continue;
+        }
+
+        uint16_t seq = (uint16_t)sent;
+        memcpy(payload, &seq, sizeof(seq));
+        uint64_t call_start = esb_bench_now_us();
+        int8_t result;
+        if (path == BENCH_PATH_ASYNC) {
+            result = esb_send_packet_async(ESB_PIPE_0, payload, sizeof(payload), esb_bench_tx_done, NULL);
+        } else if (path == BENCH_PATH_OLD) {
+            /* failed frames are only counted by the event handler */
+            result = esb_bench_old_send(payload, sizeof(payload));
+            g_completed++;
+        } else {
+            result = esb_send_packet(ESB_PIPE_0, payload, sizeof(payload));
+            if (result == ESB_ERR_TIMEOUT) {
+                timeouts++;
+                result = ESB_ERR_OK;
+            }
+            g_completed++;
+        }
+        uint64_t stall_us = esb_bench_now_us() - call_start;
+        max_stall_us = (stall_us > max_stall_us) ? stall_us : max_stall_us;
+
+        if (result == ESB_ERR_OK) {
+            sent++;
+        } else {
+            ESB_BENCH_CHECK(result == ESB_ERR_BUSY);
+        }
+    }
+    uint64_t duration_us = esb_bench_now_us() - start;
+
+    uint32_t received = 0;
+    for (uint32_t i = 0; i < frames; i++) {
+        received += (g_received[i / 8] >> (i % 8)) & 1u;
+    }
+    printf("%s loss %2u%%: %4u/%u frames received, %6.0f frames/s, max main loop stall %6llu us, %8.0f loop "
+           "iterations/s\n",
+           g_path_names[path], loss_permille / 10, received, frames,
+           (double)frames * 1e6 / (double)duration_us, (unsigned long long)max_stall_us,
+           (double)loop_iterations * 1e6 / (double)duration_us);
+    /* a frame may arrive although all its ACKs got lost */
+    ESB_BENCH_CHECK((received + timeouts + g_failed) >= frames);
+    if (loss_permille == 0) {
+        ESB_BENCH_CHECK(received == frames);
+    }
+
+    return (max_stall_us);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = (argc > 1) ? (uint32_t)atoi(argv[1]) : 500;
+    frames = (frames < BENCH_MAX_FRAMES) ? frames : BENCH_MAX_FRAMES;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("%u frames of %u bytes, %u frames in flight\n", frames, ESB_SIM_MAX_PAYLOAD_LEN, ESB_TX_INFLIGHT_MAX);
+
+    for (uint8_t i = 0; i < (sizeof(g_loss_permille) / sizeof(g_loss_permille[0])); i++) {
+        uint64_t old_stall_us = esb_bench_run(g_loss_permille[i], frames, BENCH_PATH_OLD);
+        (void)esb_bench_run(g_loss_permille[i], frames, BENCH_PATH_BLOCKING);
+        uint64_t async_stall_us = esb_bench_run(g_loss_permille[i], frames, BENCH_PATH_ASYNC);
+        ESB_BENCH_CHECK(async_stall_us < old_stall_us);
+    }
+
+    return (ESB_BENCH_RESULT());
+}
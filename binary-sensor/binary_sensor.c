@@ -3,22 +3,63 @@
 #include <stddef.h>
 #include <string.h>
 
-#ifndef BINARY_SENSOR_CHAN_NUM
-#define BINARY_SENSOR_CHAN_NUM 1
+#define BINARY_SENSOR_NOTIFICATION_ESB_PL_LEN 7
+
+/* payload layout of the batch notification */
+#define BINARY_SENSOR_BATCH_IDX_FIRST_CHAN 0
+#define BINARY_SENSOR_BATCH_IDX_NUM_BYTES 1
+#define BINARY_SENSOR_BATCH_IDX_MASK 2
+#define BINARY_SENSOR_BATCH_MAX_BYTES ((ESB_PROTOCOL_COMPACT_MAX_PAYLOAD_LEN - BINARY_SENSOR_BATCH_IDX_MASK) / 2)
+
+#if (BINARY_SENSOR_CHAN_NUM > 256)
+#error "BINARY_SENSOR_CHAN_NUM must not exceed 256 (8 bit channel IDs)"
 #endif
 
-#define BINARY_SENSOR_NOTIFICATION_ESB_PL_LEN 7
+#define BINARY_SENSOR_WORD_BITS 32
+#define BINARY_SENSOR_WORD_NUM ((BINARY_SENSOR_CHAN_NUM + BINARY_SENSOR_WORD_BITS - 1) / BINARY_SENSOR_WORD_BITS)
+#define BINARY_SENSOR_SUMMARY_BITS 32 /* width of g_chan_dirty_words, one bit per word */
+
+#if BINARY_SENSOR_WORD_NUM > BINARY_SENSOR_SUMMARY_BITS
+#error "BINARY_SENSOR_CHAN_NUM needs more words than g_chan_dirty_words has bits"
+#endif
 
-typedef struct {
-    channel_value_t value; /*!< Binary value of this channel */
-    uint8_t value_changed; /*!< Indicator if this value has changed since last publishing */
-} channel_t;
+#ifndef BINARY_SENSOR_CTZ
+#define BINARY_SENSOR_CTZ(x) ((uint32_t)__builtin_ctz(x)) /* x != 0, maps to RBIT + CLZ on Cortex-M4 */
+#endif
+
+#define BINARY_SENSOR_TRANSITIONS_PL_LEN 3
+#define BINARY_SENSOR_TRANSITIONS_MAX 255
+
+#if (BINARY_SENSOR_DEBOUNCE_BITS < 1) || (BINARY_SENSOR_DEBOUNCE_BITS > 16)
+#error "BINARY_SENSOR_DEBOUNCE_BITS must be 1 to 16"
+#endif
+
+/* channel i is bit (i % 32) of word (i / 32), bits beyond BINARY_SENSOR_CHAN_NUM are always 0 */
+static uint32_t g_chan_values[BINARY_SENSOR_WORD_NUM]; /*!< Binary values of all channels */
+static uint32_t g_chan_dirty[BINARY_SENSOR_WORD_NUM];  /*!< Channels changed since last publishing */
+static uint32_t g_chan_dirty_words = 0;                /*!< Bit w is set if g_chan_dirty[w] != 0 */
+static uint16_t g_chan_generation = 0;                 /*!< Incremented with every update that changes values */
 
-static channel_t g_channels[BINARY_SENSOR_CHAN_NUM];
+/* Debounce engine, see binary_sensor_set_debounce(). The tick counters are vertical counters: bit j of the
+ * counter of channel i is bit (i % 32) of plane j, so one pass of bitwise operations advances the counters of
+ * 32 channels at once. */
+static uint8_t g_debounce_enabled = 0;
+static binary_sensor_debounce_t g_debounce;
+static uint8_t g_debounce_ticking = 0; /*!< g_debounce_last_tick is valid */
+static uint32_t g_debounce_last_tick = 0;
+static uint32_t g_chan_raw[BINARY_SENSOR_WORD_NUM];                                /*!< Last input values */
+static uint32_t g_chan_stable_cnt[BINARY_SENSOR_DEBOUNCE_BITS][BINARY_SENSOR_WORD_NUM]; /*!< Ticks raw != value */
+static uint32_t g_chan_hold[BINARY_SENSOR_WORD_NUM]; /*!< Channels within the min interval after publishing */
+static uint32_t g_chan_hold_cnt[BINARY_SENSOR_DEBOUNCE_BITS][BINARY_SENSOR_WORD_NUM]; /*!< Ticks since publishing */
+static uint32_t g_chan_pending[BINARY_SENSOR_WORD_NUM];   /*!< Changes of held channels, published on release */
+static uint32_t g_chan_published[BINARY_SENSOR_WORD_NUM]; /*!< Values of the last notification */
+static uint32_t g_debounce_words = 0;                     /*!< Bit w is set if word w has counters running */
+static uint8_t g_chan_transitions[BINARY_SENSOR_CHAN_NUM]; /*!< Transitions since publishing (report transitions) */
 
 static uint8_t g_module_initialized = 0;
 static uint8_t g_peripheral_address[5] = {0}; /*!< ESB pipeline address of this binary sensor device */
 static uint8_t g_central_address[5] = {0};    /*!< the central device which shall receive notifications */
+static const uint8_t g_unset_address[5] = {0};
 
 esb_protocol_err_t binary_sensor_init(const uint8_t peripheral_address[5])
 {
@@ -50,9 +91,33 @@ esb_protocol_err_t binary_sensor_set_central_address(uint8_t central_address[5])
     return (ESB_PROT_ERR_OK);
 }
 
+/* update the channels selected by mask in word w and mark the changed ones
+ * returns the changed channels */
+static uint32_t binary_sensor_update_word(uint32_t w, uint32_t mask, uint32_t values)
+{
+    if (g_debounce_enabled != 0) {
+        /* the input is taken over by binary_sensor_tick() once it is stable */
+        g_chan_raw[w] = (g_chan_raw[w] & ~mask) | (values & mask);
+        if ((g_chan_raw[w] ^ g_chan_values[w]) != 0) {
+            g_debounce_words |= (1u << w);
+        }
+        return (0);
+    }
+
+    uint32_t changed = (g_chan_values[w] ^ values) & mask;
+
+    if (changed != 0) {
+        g_chan_values[w] ^= changed;
+        g_chan_dirty[w] |= changed;
+        g_chan_dirty_words |= (1u << w);
+    }
+
+    return (changed);
+}
+
 esb_protocol_err_t binary_sensor_set_channel(uint8_t chan_id, channel_value_t value)
 {
-    if (chan_id > BINARY_SENSOR_CHAN_NUM) {
+    if (chan_id >= BINARY_SENSOR_CHAN_NUM) {
         return (ESB_PROT_ERR_PARAM);
     }
 
@@ -60,16 +125,80 @@ esb_protocol_err_t binary_sensor_set_channel(uint8_t chan_id, channel_value_t va
         return (ESB_PROT_ERR_VALUE);
     }
 
-    if (g_channels[chan_id].value != value) {
-        g_channels[chan_id].value = value;
-        g_channels[chan_id].value_changed = 1;
+    uint32_t bit = 1u << (chan_id % BINARY_SENSOR_WORD_BITS);
+    if (binary_sensor_update_word(chan_id / BINARY_SENSOR_WORD_BITS, bit, (value == CHAN_VAL_TRUE) ? bit : 0) != 0) {
+        g_chan_generation++;
+    }
+
+    return (ESB_PROT_ERR_OK);
+}
+
+esb_protocol_err_t binary_sensor_set_channels(uint8_t first_chan, uint32_t mask, uint32_t values)
+{
+    if (first_chan >= BINARY_SENSOR_CHAN_NUM) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    /* all selected channels must exist */
+    uint32_t num_chan = BINARY_SENSOR_CHAN_NUM - first_chan;
+    if ((num_chan < BINARY_SENSOR_WORD_BITS) && ((mask >> num_chan) != 0)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    uint32_t w = first_chan / BINARY_SENSOR_WORD_BITS;
+    uint32_t shift = first_chan % BINARY_SENSOR_WORD_BITS;
+
+    uint32_t changed = binary_sensor_update_word(w, mask << shift, values << shift);
+    if (shift != 0) {
+        /* the upper part of the port spans into the next word */
+        uint32_t upper_mask = mask >> (BINARY_SENSOR_WORD_BITS - shift);
+        if (upper_mask != 0) {
+            changed |= binary_sensor_update_word(w + 1, upper_mask, values >> (BINARY_SENSOR_WORD_BITS - shift));
+        }
+    }
+    if (changed != 0) {
+        g_chan_generation++;
     }
+
+    return (ESB_PROT_ERR_OK);
+}
+
+esb_protocol_err_t binary_sensor_set_channels_masked(uint8_t first_chan, const uint8_t *p_mask,
+                                                     const uint8_t *p_values, uint8_t num_bytes)
+{
+    if ((p_mask == NULL) || (p_values == NULL) || ((first_chan % 8) != 0)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    /* check all bytes first, so either all channels are updated or none */
+    for (uint8_t i = 0; i < num_bytes; i++) {
+        uint32_t chan = (uint32_t)first_chan + (8u * i);
+        if ((p_mask[i] != 0) && ((chan >= BINARY_SENSOR_CHAN_NUM) ||
+                                 (((BINARY_SENSOR_CHAN_NUM - chan) < 8) &&
+                                  ((p_mask[i] >> (BINARY_SENSOR_CHAN_NUM - chan)) != 0)))) {
+            return (ESB_PROT_ERR_PARAM);
+        }
+    }
+
+    uint32_t changed = 0;
+    for (uint8_t i = 0; i < num_bytes; i++) {
+        uint32_t chan = (uint32_t)first_chan + (8u * i);
+        if (p_mask[i] != 0) {
+            uint32_t shift = chan % BINARY_SENSOR_WORD_BITS;
+            changed |= binary_sensor_update_word(chan / BINARY_SENSOR_WORD_BITS, (uint32_t)p_mask[i] << shift,
+                                                 (uint32_t)p_values[i] << shift);
+        }
+    }
+    if (changed != 0) {
+        g_chan_generation++;
+    }
+
     return (ESB_PROT_ERR_OK);
 }
 
 esb_protocol_err_t binary_sensor_get_channel(uint8_t chan_id, channel_value_t *p_value)
 {
-    if (chan_id > BINARY_SENSOR_CHAN_NUM) {
+    if (chan_id >= BINARY_SENSOR_CHAN_NUM) {
         return (ESB_PROT_ERR_PARAM);
     }
 
@@ -77,7 +206,361 @@ esb_protocol_err_t binary_sensor_get_channel(uint8_t chan_id, channel_value_t *p
         return (ESB_PROT_ERR_PARAM);
     }
 
-    *p_value = g_channels[chan_id].value;
+    uint32_t word = g_chan_values[chan_id / BINARY_SENSOR_WORD_BITS];
+    *p_value = ((word >> (chan_id % BINARY_SENSOR_WORD_BITS)) & 1u) ? CHAN_VAL_TRUE : CHAN_VAL_FALSE;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+esb_protocol_err_t binary_sensor_get_snapshot(uint8_t first_chan, uint8_t *p_states, uint8_t *p_num_bytes,
+                                              uint16_t *p_generation)
+{
+    if ((p_states == NULL) || (p_num_bytes == NULL) || (p_generation == NULL)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    if ((first_chan >= BINARY_SENSOR_CHAN_NUM) || ((first_chan % 8) != 0)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    uint8_t num_bytes = 0;
+    for (uint32_t chan = first_chan; (chan < BINARY_SENSOR_CHAN_NUM) && (num_bytes < *p_num_bytes); chan += 8) {
+        p_states[num_bytes++] = (uint8_t)(g_chan_values[chan / BINARY_SENSOR_WORD_BITS] >>
+                                          (chan % BINARY_SENSOR_WORD_BITS));
+    }
+    *p_num_bytes = num_bytes;
+    *p_generation = g_chan_generation;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+/* clear the dirty bits of the channels selected by mask in word w, their notification is queued */
+static void binary_sensor_clear_dirty(uint32_t w, uint32_t mask)
+{
+    g_chan_dirty[w] &= ~mask;
+    if (g_chan_dirty[w] == 0) {
+        g_chan_dirty_words &= ~(1u << w);
+    }
+
+    if (g_debounce_enabled != 0) {
+        g_chan_published[w] = (g_chan_published[w] & ~mask) | (g_chan_values[w] & mask);
+        if (g_debounce.min_interval_ticks > 0) {
+            /* further changes are held back for the min interval */
+            g_chan_hold[w] |= mask;
+            g_debounce_words |= (1u << w);
+        }
+    }
+}
+
+/* set the changed channels of word w */
+static void binary_sensor_set_dirty(uint32_t w, uint32_t dirty)
+{
+    g_chan_dirty[w] = dirty;
+    if (dirty != 0) {
+        g_chan_dirty_words |= (1u << w);
+    } else {
+        g_chan_dirty_words &= ~(1u << w);
+    }
+}
+
+/* mark channels of word w as changed */
+static void binary_sensor_mark_dirty(uint32_t w, uint32_t mask)
+{
+    binary_sensor_set_dirty(w, g_chan_dirty[w] | mask);
+}
+
+/* advance the vertical counters of the channels in mask by one tick, the counters of the other channels are
+ * cleared. Returns the channels of mask whose counter reached target, their counters are cleared. */
+static uint32_t binary_sensor_count_ticks(uint32_t cnt[][BINARY_SENSOR_WORD_NUM], uint32_t w, uint32_t mask,
+                                          uint32_t target)
+{
+    uint32_t carry = mask;
+    uint32_t reached = mask;
+
+    for (uint32_t j = 0; j < BINARY_SENSOR_DEBOUNCE_BITS; j++) {
+        uint32_t plane = cnt[j][w] & mask;
+        cnt[j][w] = plane ^ carry;
+        carry &= plane;
+        reached &= ((target >> j) & 1u) ? cnt[j][w] : ~cnt[j][w];
+    }
+
+    for (uint32_t j = 0; j < BINARY_SENSOR_DEBOUNCE_BITS; j++) {
+        cnt[j][w] &= ~reached;
+    }
+
+    return (reached);
+}
+
+/* count the transitions of the channels in mask of word w */
+static void binary_sensor_count_transitions(uint32_t w, uint32_t mask)
+{
+    while (mask != 0) {
+        uint32_t chan = (w * BINARY_SENSOR_WORD_BITS) + BINARY_SENSOR_CTZ(mask);
+        if (g_chan_transitions[chan] < BINARY_SENSOR_TRANSITIONS_MAX) {
+            g_chan_transitions[chan]++;
+        }
+        mask &= mask - 1;
+    }
+}
+
+/* one tick of the debounce engine for the 32 channels of word w
+ * returns the channels whose new input was taken over */
+static uint32_t binary_sensor_debounce_word(uint32_t w)
+{
+    /* take over inputs which differ from the value for stable_ticks ticks */
+    uint32_t delta = g_chan_raw[w] ^ g_chan_values[w];
+    uint32_t accepted = delta;
+    if (g_debounce.stable_ticks > 0) {
+        accepted = binary_sensor_count_ticks(g_chan_stable_cnt, w, delta, g_debounce.stable_ticks);
+    }
+    g_chan_values[w] ^= accepted;
+    if (g_debounce.report == BINARY_SENSOR_REPORT_TRANSITIONS) {
+        binary_sensor_count_transitions(w, accepted);
+    }
+
+    /* release the channels whose min interval passed, changes of held channels wait for the release */
+    uint32_t released = 0;
+    if (g_chan_hold[w] != 0) {
+        released = binary_sensor_count_ticks(g_chan_hold_cnt, w, g_chan_hold[w], g_debounce.min_interval_ticks);
+        g_chan_hold[w] &= ~released;
+    }
+    g_chan_pending[w] |= accepted & g_chan_hold[w];
+    uint32_t ready = (accepted & ~g_chan_hold[w]) | (g_chan_pending[w] & released);
+    g_chan_pending[w] &= ~released;
+
+    if (g_debounce.report == BINARY_SENSOR_REPORT_FINAL) {
+        /* only channels whose value differs from the last notification, a change back cancels the notification */
+        binary_sensor_set_dirty(w, (g_chan_dirty[w] | ready) & (g_chan_values[w] ^ g_chan_published[w]));
+    } else {
+        binary_sensor_mark_dirty(w, ready);
+    }
+
+    if (((g_chan_raw[w] ^ g_chan_values[w]) == 0) && (g_chan_hold[w] == 0)) {
+        /* all counters of the word are cleared */
+        g_debounce_words &= ~(1u << w);
+    }
+
+    return (accepted);
+}
+
+esb_protocol_err_t binary_sensor_set_debounce(const binary_sensor_debounce_t *p_config)
+{
+    if ((p_config != NULL) && ((p_config->stable_ticks > BINARY_SENSOR_DEBOUNCE_MAX_TICKS) ||
+                               (p_config->min_interval_ticks > BINARY_SENSOR_DEBOUNCE_MAX_TICKS) ||
+                               (p_config->report > BINARY_SENSOR_REPORT_TRANSITIONS))) {
+        return (ESB_PROT_ERR_VALUE);
+    }
+
+    /* restart all timers, held changes are published right away */
+    for (uint32_t w = 0; w < BINARY_SENSOR_WORD_NUM; w++) {
+        if (g_debounce_enabled != 0) {
+            binary_sensor_mark_dirty(w, g_chan_pending[w]);
+        } else {
+            g_chan_raw[w] = g_chan_values[w];
+        }
+        g_chan_published[w] = g_chan_values[w] ^ g_chan_dirty[w];
+        g_chan_hold[w] = 0;
+        g_chan_pending[w] = 0;
+        for (uint32_t j = 0; j < BINARY_SENSOR_DEBOUNCE_BITS; j++) {
+            g_chan_stable_cnt[j][w] = 0;
+            g_chan_hold_cnt[j][w] = 0;
+        }
+    }
+    memset(g_chan_transitions, 0, sizeof(g_chan_transitions));
+    g_debounce_words = 0;
+    g_debounce_ticking = 0;
+
+    if (p_config == NULL) {
+        /* take over the last inputs */
+        g_debounce_enabled = 0;
+        uint32_t changed = 0;
+        for (uint32_t w = 0; w < BINARY_SENSOR_WORD_NUM; w++) {
+            changed |= binary_sensor_update_word(w, ~0u, g_chan_raw[w]);
+        }
+        if (changed != 0) {
+            g_chan_generation++;
+        }
+        return (ESB_PROT_ERR_OK);
+    }
+
+    g_debounce = *p_config;
+    g_debounce_enabled = 1;
+    for (uint32_t w = 0; w < BINARY_SENSOR_WORD_NUM; w++) {
+        if ((g_chan_raw[w] ^ g_chan_values[w]) != 0) {
+            g_debounce_words |= (1u << w);
+        }
+    }
+
+    return (ESB_PROT_ERR_OK);
+}
+
+void binary_sensor_tick(uint32_t now_ticks)
+{
+    if (g_debounce_enabled == 0) {
+        return;
+    }
+
+    uint32_t elapsed = now_ticks - g_debounce_last_tick;
+    g_debounce_last_tick = now_ticks;
+    if (g_debounce_ticking == 0) {
+        g_debounce_ticking = 1;
+        elapsed = 1;
+    }
+
+    /* all timers expire within the longer setting, ticks beyond change nothing */
+    uint32_t max_ticks = ((g_debounce.stable_ticks > g_debounce.min_interval_ticks) ? g_debounce.stable_ticks
+                                                                                    : g_debounce.min_interval_ticks) +
+                         1;
+    if (elapsed > max_ticks) {
+        elapsed = max_ticks;
+    }
+
+    for (; (elapsed > 0) && (g_debounce_words != 0); elapsed--) {
+        uint32_t accepted = 0;
+        for (uint32_t words = g_debounce_words; words != 0; words &= words - 1) {
+            accepted |= binary_sensor_debounce_word(BINARY_SENSOR_CTZ(words));
+        }
+        if (accepted != 0) {
+            g_chan_generation++;
+        }
+    }
+}
+
+/* ID of the first changed channel >= chan, BINARY_SENSOR_CHAN_NUM if there is none */
+static uint32_t binary_sensor_next_dirty(uint32_t chan)
+{
+    uint32_t w = chan / BINARY_SENSOR_WORD_BITS;
+
+    if (w >= BINARY_SENSOR_WORD_NUM) {
+        return (BINARY_SENSOR_CHAN_NUM);
+    }
+
+    /* changed channels in the first word, then whole words from the summary */
+    uint32_t dirty = g_chan_dirty[w] & (~0u << (chan % BINARY_SENSOR_WORD_BITS));
+    if (dirty != 0) {
+        return ((w * BINARY_SENSOR_WORD_BITS) + BINARY_SENSOR_CTZ(dirty));
+    }
+
+    uint32_t words = ((w + 1) < BINARY_SENSOR_SUMMARY_BITS) ? (g_chan_dirty_words & (~0u << (w + 1))) : 0;
+    if (words == 0) {
+        return (BINARY_SENSOR_CHAN_NUM);
+    }
+    w = BINARY_SENSOR_CTZ(words);
+
+    return ((w * BINARY_SENSOR_WORD_BITS) + BINARY_SENSOR_CTZ(g_chan_dirty[w]));
+}
+
+/* byte of a channel bitset starting at chan (multiple of 8), bytes never span two words */
+static uint8_t binary_sensor_bitset_byte(const uint32_t *p_bitset, uint32_t chan)
+{
+    return ((uint8_t)(p_bitset[chan / BINARY_SENSOR_WORD_BITS] >> (chan % BINARY_SENSOR_WORD_BITS)));
+}
+
+/* queue batch notifications for all changed channels, see binary_sensor.h for the format */
+static esb_protocol_err_t binary_sensor_publish_batch(esb_protocol_message_t *p_message)
+{
+    /* more channels per notification with the compact header */
+    uint8_t max_bytes = (esb_protocol_max_payload_len() - BINARY_SENSOR_BATCH_IDX_MASK) / 2;
+
+    p_message->cmd = BINARY_SENSOR_NOTIFICATION_BATCH_ESB_CMD_ID;
+
+    for (uint32_t chan = binary_sensor_next_dirty(0); chan < BINARY_SENSOR_CHAN_NUM;
+         chan = binary_sensor_next_dirty(chan)) {
+        /* the notification starts at the byte containing the changed channel */
+        uint32_t first_chan = chan & ~0x07u;
+        uint8_t *p_mask = &(p_message->payload[BINARY_SENSOR_BATCH_IDX_MASK]);
+        uint8_t states[BINARY_SENSOR_BATCH_MAX_BYTES];
+        uint8_t num_bytes = 0;
+
+        for (uint8_t i = 0; (i < max_bytes) && ((first_chan + (8u * i)) < BINARY_SENSOR_CHAN_NUM); i++) {
+            p_mask[i] = binary_sensor_bitset_byte(g_chan_dirty, first_chan + (8u * i));
+            states[i] = binary_sensor_bitset_byte(g_chan_values, first_chan + (8u * i));
+            if (p_mask[i] != 0) {
+                num_bytes = i + 1;
+            }
+        }
+
+        p_message->payload[BINARY_SENSOR_BATCH_IDX_FIRST_CHAN] = (uint8_t)first_chan;
+        p_message->payload[BINARY_SENSOR_BATCH_IDX_NUM_BYTES] = num_bytes;
+        memcpy(&(p_message->payload[BINARY_SENSOR_BATCH_IDX_MASK + num_bytes]), states, num_bytes);
+        p_message->payload_len = BINARY_SENSOR_BATCH_IDX_MASK + (2 * num_bytes);
+
+        if (esb_protocol_transmit(p_message) != ESB_PROT_ERR_OK) {
+            /* the channels stay marked as changed */
+            return (ESB_PROT_ERR_QUEUE_FULL);
+        }
+
+        for (uint8_t i = 0; i < num_bytes; i++) {
+            uint32_t byte_chan = first_chan + (8u * i);
+            binary_sensor_clear_dirty(byte_chan / BINARY_SENSOR_WORD_BITS,
+                                      (uint32_t)p_mask[i] << (byte_chan % BINARY_SENSOR_WORD_BITS));
+        }
+        chan = first_chan + (8u * num_bytes);
+    }
+
+    return (ESB_PROT_ERR_OK);
+}
+
+/* queue one notification per changed channel */
+static esb_protocol_err_t binary_sensor_publish_single(esb_protocol_message_t *p_message)
+{
+    p_message->cmd = BINARY_SENSOR_NOTIFICATION_ESB_CMD_ID;
+    p_message->payload_len = BINARY_SENSOR_NOTIFICATION_ESB_PL_LEN;
+    memcpy(p_message->payload, g_peripheral_address, sizeof(g_peripheral_address));
+
+    for (uint32_t chan = binary_sensor_next_dirty(0); chan < BINARY_SENSOR_CHAN_NUM;
+         chan = binary_sensor_next_dirty(chan + 1)) {
+        uint32_t w = chan / BINARY_SENSOR_WORD_BITS;
+        uint32_t bit = 1u << (chan % BINARY_SENSOR_WORD_BITS);
+
+        p_message->payload[5] = (uint8_t)chan;
+        p_message->payload[6] = (g_chan_values[w] & bit) ? CHAN_VAL_TRUE : CHAN_VAL_FALSE;
+
+        if (esb_protocol_transmit(p_message) != ESB_PROT_ERR_OK) {
+            /* the channel stays marked as changed */
+            return (ESB_PROT_ERR_QUEUE_FULL);
+        }
+        binary_sensor_clear_dirty(w, bit);
+    }
+
+    return (ESB_PROT_ERR_OK);
+}
+
+/* queue transition notifications for all changed channels, see binary_sensor.h for the format */
+static esb_protocol_err_t binary_sensor_publish_transitions(esb_protocol_message_t *p_message)
+{
+    uint8_t max_chan = esb_protocol_max_payload_len() / BINARY_SENSOR_TRANSITIONS_PL_LEN;
+
+    p_message->cmd = BINARY_SENSOR_NOTIFICATION_TRANSITIONS_ESB_CMD_ID;
+
+    uint32_t chan = binary_sensor_next_dirty(0);
+    while (chan < BINARY_SENSOR_CHAN_NUM) {
+        uint8_t num_chan = 0;
+
+        for (; (chan < BINARY_SENSOR_CHAN_NUM) && (num_chan < max_chan); chan = binary_sensor_next_dirty(chan + 1)) {
+            uint8_t *p_item = &(p_message->payload[num_chan * BINARY_SENSOR_TRANSITIONS_PL_LEN]);
+            uint32_t word = g_chan_values[chan / BINARY_SENSOR_WORD_BITS];
+
+            p_item[0] = (uint8_t)chan;
+            p_item[1] = ((word >> (chan % BINARY_SENSOR_WORD_BITS)) & 1u) ? CHAN_VAL_TRUE : CHAN_VAL_FALSE;
+            /* channels marked before debouncing was enabled have no transitions counted */
+            p_item[2] = (g_chan_transitions[chan] > 0) ? g_chan_transitions[chan] : 1;
+            num_chan++;
+        }
+        p_message->payload_len = num_chan * BINARY_SENSOR_TRANSITIONS_PL_LEN;
+
+        if (esb_protocol_transmit(p_message) != ESB_PROT_ERR_OK) {
+            /* the channels stay marked as changed */
+            return (ESB_PROT_ERR_QUEUE_FULL);
+        }
+
+        for (uint8_t i = 0; i < num_chan; i++) {
+            uint8_t item_chan = p_message->payload[i * BINARY_SENSOR_TRANSITIONS_PL_LEN];
+            binary_sensor_clear_dirty(item_chan / BINARY_SENSOR_WORD_BITS,
+                                      1u << (item_chan % BINARY_SENSOR_WORD_BITS));
+            g_chan_transitions[item_chan] = 0;
+        }
+    }
 
     return (ESB_PROT_ERR_OK);
 }
@@ -85,26 +568,27 @@ esb_protocol_err_t binary_sensor_get_channel(uint8_t chan_id, channel_value_t *p
 esb_protocol_err_t binary_sensor_publish(void)
 {
     /* check that adresses are set */
-    if ((memcmp(g_central_address, 0, sizeof(g_central_address)) == 0) ||
-        (memcmp(g_peripheral_address, 0, sizeof(g_peripheral_address)) == 0)) {
+    if ((memcmp(g_central_address, g_unset_address, sizeof(g_central_address)) == 0) ||
+        (memcmp(g_peripheral_address, g_unset_address, sizeof(g_peripheral_address)) == 0)) {
         return (ESB_PROT_ERR_INIT);
     }
 
+    if (g_chan_dirty_words == 0) {
+        return (ESB_PROT_ERR_OK);
+    }
+
     esb_protocol_message_t esb_message = {
-        .cmd = BINARY_SENSOR_NOTIFICATION_ESB_CMD_ID,
         .error = 0,
-        .payload_len = BINARY_SENSOR_NOTIFICATION_ESB_PL_LEN,
     };
     memcpy(esb_message.address, g_central_address, sizeof(g_central_address));
-    memcpy(esb_message.payload, g_peripheral_address, sizeof(g_peripheral_address));
-    for (uint8_t i = 0; i < BINARY_SENSOR_CHAN_NUM; i++) {
-        if (g_channels[i].value_changed == 1) {
-            g_channels[i].value_changed = 0;
-            esb_message.payload[5] = i;
-            esb_message.payload[6] = g_channels[i].value;
 
-            esb_protocol_transmit(&esb_message);
-        }
+    if ((g_debounce_enabled != 0) && (g_debounce.report == BINARY_SENSOR_REPORT_TRANSITIONS)) {
+        return (binary_sensor_publish_transitions(&esb_message));
     }
-    return (ESB_PROT_ERR_OK);
+
+    /* a central which assigned a node ID knows the batch notification, the address is in the header */
+    if ((BINARY_SENSOR_NOTIFICATION_VERSION == 2) || (esb_protocol_get_node_id() != ESB_PROT_NODE_ID_NONE)) {
+        return (binary_sensor_publish_batch(&esb_message));
+    }
+    return (binary_sensor_publish_single(&esb_message));
 }
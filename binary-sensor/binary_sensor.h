@@ -7,7 +7,9 @@
  * \details The "Binary Sensor" application notifies a central device when a channel
  * has changed it's state. In addition, it offers commands for manually querying or
  * altering the channel's state (see ::binary_sensor_cmd_def.c). The number of
- * available channels is defined by a compiler switch, see ::BINARY_SENSOR_CHAN_NUM
+ * available channels is defined by a compiler switch, see ::BINARY_SENSOR_CHAN_NUM (at most 256).
+ * The channel states are stored as bitsets, so large channel numbers need only 2 bits of RAM per
+ * channel and publishing without changed channels takes constant time.
  *
  * The ESB protocol message of the state notification has the following format:
             |----HEADER----|------- PAYLOAD----------------|
@@ -17,26 +19,92 @@
  * - CMD:         Command ID for the notification (always 0x91)
  * - ERROR:       Error byte, not used for notifications (always 0x00)
  * - PERIPH_ADDR: ESB pipeline address of this binary sensor device
- * - CHAN_ID:     ID of the channel,  0 < CHAN_ID < BINARY_SENSOR_CHAN_NUM
+ * - CHAN_ID:     ID of the channel,  0 <= CHAN_ID < BINARY_SENSOR_CHAN_NUM
  * - STATE:       the binary state of the channel (0 = off, 1 = on)
+ *
+ * With BINARY_SENSOR_NOTIFICATION_VERSION 2 all changed channels are packed into batch notifications
+ * instead, which use a different command ID so a central can tell the formats apart. The peripheral
+ * address is taken from the PIPE field of the frame header and not repeated in the payload:
+            |----HEADER-----------------|------- PAYLOAD--------------------------------------|
+ * Bytes:   |  0   |   1   |    2:6     |     7      |    8     |  9 : 9+N-1   | 9+N : 9+2N-1 |
+ * Value:   | CMD  | ERROR |    PIPE    | FIRST_CHAN | NUM_BYTES | CHANGED_MASK |    STATES    |
+ *
+ * - CMD:          Command ID for the batch notification (always 0x94)
+ * - FIRST_CHAN:   ID of the channel described by bit 0 of the first mask byte (multiple of 8)
+ * - NUM_BYTES:    Number of bytes N of the mask and of the state bitmap (1 to 11, 1 to 13 with the compact header)
+ * - CHANGED_MASK: Bit (i % 8) of byte (i / 8) is set if channel FIRST_CHAN + i has changed
+ * - STATES:       Bit (i % 8) of byte (i / 8) is the state of channel FIRST_CHAN + i
+ *
+ * One batch notification covers up to 88 consecutive channels, so a change of 16 channels is
+ * published with a single frame instead of 16.
+ *
+ * Once the central assigned a node ID (compact header, see esb_protocol.h) batch notifications are sent with
+ * both versions: the central knows the format, and a single channel change takes 7 bytes on air instead of 14.
+ *
+ * Inputs from mechanical contacts bounce. With ::binary_sensor_set_debounce the inputs set with
+ * ::binary_sensor_set_channel / ::binary_sensor_set_channels are only taken over once they were stable for a number
+ * of ticks of ::binary_sensor_tick, and a channel is published at most once per minimum interval. The changes
+ * within the interval are coalesced: either only the final state is reported (a channel which is back at the
+ * reported state isn't published at all), or every transition is counted and reported with the transition
+ * notification, which carries up to 8 channels (9 with the compact header) and takes the address from the PIPE
+ * field like the batch notification:
+            |----HEADER-----------------|------- PAYLOAD (per channel)---|
+ * Bytes:   |  0   |   1   |    2:6     |    7    |   8   |    9     |
+ * Value:   | CMD  | ERROR |    PIPE    | CHAN_ID | STATE |  COUNT   |
+ *
+ * - CMD:          Command ID for the transition notification (always 0x95)
+ * - STATE:        the binary state of the channel after the last transition
+ * - COUNT:        Number of transitions since the last notification of the channel (1 to 255, saturating), an
+ *                 even count means the channel went back to the previously reported state
+ *
+ * All channels are evaluated together with bitwise operations on 32 channels at a time, ticks without running
+ * debounce or interval timers return after a single check. The timers are vertical counters of
+ * ::BINARY_SENSOR_DEBOUNCE_BITS bit planes each, debouncing takes another 2 * BINARY_SENSOR_DEBOUNCE_BITS + 4 bits and
+ * a transition counter byte of RAM per channel.
  * */
 
 #include <common/protocol/esb_protocol.h>
 #include <stdint.h>
 
 #define BINARY_SENSOR_NOTIFICATION_ESB_CMD_ID 0x91
+#define BINARY_SENSOR_NOTIFICATION_BATCH_ESB_CMD_ID 0x94
+#define BINARY_SENSOR_NOTIFICATION_TRANSITIONS_ESB_CMD_ID 0x95
+
+#ifndef BINARY_SENSOR_CHAN_NUM
+#define BINARY_SENSOR_CHAN_NUM 1 /*!< Number of channels (1 to 256) */
+#endif
+
+#ifndef BINARY_SENSOR_NOTIFICATION_VERSION
+#define BINARY_SENSOR_NOTIFICATION_VERSION 1 /*!< 1: one notification per channel, 2: batch notifications */
+#endif
+
+#ifndef BINARY_SENSOR_DEBOUNCE_BITS
+#define BINARY_SENSOR_DEBOUNCE_BITS 8 /*!< Bits of the debounce and interval tick counters (1 to 16) */
+#endif
+#define BINARY_SENSOR_DEBOUNCE_MAX_TICKS ((1u << BINARY_SENSOR_DEBOUNCE_BITS) - 1)
 
 typedef enum {
     CHAN_VAL_FALSE = 0x00, /*!< value for binary OFF */
     CHAN_VAL_TRUE = 0x01   /*!< value for binary ON */
 } channel_value_t;
 
+typedef enum {
+    BINARY_SENSOR_REPORT_FINAL = 0x00,      /*!< report the state once it differs from the last reported one */
+    BINARY_SENSOR_REPORT_TRANSITIONS = 0x01 /*!< report every transition, with the transition notification */
+} binary_sensor_report_t;
+
+typedef struct {
+    uint16_t stable_ticks;         /*!< ticks an input must differ from the channel value before it is taken over */
+    uint16_t min_interval_ticks;   /*!< ticks after the notification of a channel before it is published again */
+    binary_sensor_report_t report; /*!< how the changes within the min interval are reported */
+} binary_sensor_debounce_t;
+
 /*!
  * \brief Initialize the "Binary Sensor" application layer
  * \param[in] peripheral_address    ESB pipeline address of this binary sensor device
  * \retval ESB_PROT_ERR_OK          No Error
  * \retval ESB_PROT_ERR_PARAM       illegal parameter (NULL-pointer)
- * \retval ESB_PROT_ERR_MEM         No space to register ESB command table, check ::ESB_COMMANDS_NUM_APP_TABLES
+ * \retval ESB_PROT_ERR_MEM         Registration of the ESB command table failed (command ID already registered)
  */
 esb_protocol_err_t binary_sensor_init(const uint8_t peripheral_address[5]);
 /*!
@@ -50,7 +118,7 @@ esb_protocol_err_t binary_sensor_set_central_address(uint8_t central_address[5])
 
 /*!
  * \brief Set the value of a channel
- * \param[in] chan_id           ID of the channel (0 < chan_id < BINARY_SENSOR_CHAN_NUM)
+ * \param[in] chan_id           ID of the channel (0 <= chan_id < BINARY_SENSOR_CHAN_NUM)
  * \param[in] value             New value of the channel (CHAN_VAL_FALSE(0) | CHAN_VAL_TRUE(1))
  * \retval ESB_PROT_ERR_OK      No Error
  * \retval ESB_PROT_ERR_PARAM   Invalid channel ID
@@ -58,20 +126,83 @@ esb_protocol_err_t binary_sensor_set_central_address(uint8_t central_address[5])
  */
 esb_protocol_err_t binary_sensor_set_channel(uint8_t chan_id, channel_value_t value);
 
+/*!
+ * \brief Set the values of up to 32 consecutive channels, e.g. from a GPIO port register
+ * \details Bit i of mask and values refers to channel first_chan + i. Only channels whose mask bit is
+ * set are updated, channels with a new value are marked as changed.
+ * \param[in] first_chan        ID of the channel of bit 0 (0 <= first_chan < BINARY_SENSOR_CHAN_NUM)
+ * \param[in] mask              Channels to update
+ * \param[in] values            New values of the channels (bit set = CHAN_VAL_TRUE)
+ * \retval ESB_PROT_ERR_OK      No Error
+ * \retval ESB_PROT_ERR_PARAM   Invalid channel ID, or mask selects a channel >= BINARY_SENSOR_CHAN_NUM
+ */
+esb_protocol_err_t binary_sensor_set_channels(uint8_t first_chan, uint32_t mask, uint32_t values);
+
+/*!
+ * \brief Set the values of channels given as bitmaps, all at once
+ * \details Bit (i % 8) of byte (i / 8) refers to channel first_chan + i, the layout of the batch notification.
+ * The request is checked before any channel is updated, so either all selected channels are set or none.
+ * \param[in] first_chan        ID of the channel of bit 0 of the first byte (multiple of 8)
+ * \param[in] p_mask            Channels to update, num_bytes bytes
+ * \param[in] p_values          New values of the channels, num_bytes bytes
+ * \param[in] num_bytes         Number of bytes of mask and values
+ * \retval ESB_PROT_ERR_OK      No Error
+ * \retval ESB_PROT_ERR_PARAM   NULL pointer, first_chan not a multiple of 8, or mask selects a channel >=
+ * BINARY_SENSOR_CHAN_NUM
+ */
+esb_protocol_err_t binary_sensor_set_channels_masked(uint8_t first_chan, const uint8_t *p_mask,
+                                                     const uint8_t *p_values, uint8_t num_bytes);
+
 /*!
  * \brief Get the value of a channel
- * \param[in] chan_id           ID of the channel (0 < chan_id < BINARY_SENSOR_CHAN_NUM)
+ * \param[in] chan_id           ID of the channel (0 <= chan_id < BINARY_SENSOR_CHAN_NUM)
  * \param[out] p_value          Pointer to buffer to store the current value of the channel (CHAN_VAL_FALSE (0) |
  * CHAN_VAL_TRUE(1)) \retval ESB_PROT_ERR_OK      No error \retval ESB_PROT_ERR_PARAM   Invalid channel ID or NULL
  * pointer
  */
 esb_protocol_err_t binary_sensor_get_channel(uint8_t chan_id, channel_value_t *p_value);
 
+/*!
+ * \brief Get the values of consecutive channels as bitmap, e.g. for a central to resync after a restart
+ * \details Bit (i % 8) of byte (i / 8) is the value of channel first_chan + i. The generation counter is
+ * incremented with every update that changes channel values, a snapshot read in several parts is consistent if
+ * all parts have the same generation.
+ * \param[in] first_chan            ID of the channel of bit 0 of the first byte (multiple of 8)
+ * \param[out] p_states             Buffer for the bitmap
+ * \param[in,out] p_num_bytes       Size of the buffer, returns the number of bytes written (up to the last channel)
+ * \param[out] p_generation         Generation counter of the channel values
+ * \retval ESB_PROT_ERR_OK          No error
+ * \retval ESB_PROT_ERR_PARAM       NULL pointer, invalid channel ID or first_chan not a multiple of 8
+ */
+esb_protocol_err_t binary_sensor_get_snapshot(uint8_t first_chan, uint8_t *p_states, uint8_t *p_num_bytes,
+                                              uint16_t *p_generation);
+
+/*!
+ * \brief Enable or disable debouncing and coalescing of the channel inputs
+ * \details While enabled, new inputs are taken over by ::binary_sensor_tick. All settings 0 with
+ * BINARY_SENSOR_REPORT_FINAL only suppresses changes which are reverted before they are published.
+ * \param[in] p_config          Debounce settings, NULL disables debouncing (inputs are taken over right away)
+ * \retval ESB_PROT_ERR_OK      No Error
+ * \retval ESB_PROT_ERR_VALUE   Tick count above BINARY_SENSOR_DEBOUNCE_MAX_TICKS or invalid report mode
+ */
+esb_protocol_err_t binary_sensor_set_debounce(const binary_sensor_debounce_t *p_config);
+
+/*!
+ * \brief Advance the debounce and interval timers of all channels
+ * \details Call periodically from the main loop, e.g. every millisecond, and before ::binary_sensor_publish. Ticks
+ * missed since the last call are caught up. Does nothing while debouncing is disabled.
+ * \param[in] now_ticks     Monotonic tick counter (wraps around)
+ */
+void binary_sensor_tick(uint32_t now_ticks);
+
 /*!
  * \brief Send notifications for all changed channels
- * \retval ESB_PROT_ERR_OK      OK
- * \retval ESB_PROT_ERR_INIT    Module is not initialized, call ::binary_sensor_init and
+ * \details Channels whose notification could not be queued stay marked as changed and are published
+ * with the next call
+ * \retval ESB_PROT_ERR_OK          OK
+ * \retval ESB_PROT_ERR_INIT        Module is not initialized, call ::binary_sensor_init and
  * ::binary_sensor_set_central_address first
+ * \retval ESB_PROT_ERR_QUEUE_FULL  Not all notifications could be queued
  */
 esb_protocol_err_t binary_sensor_publish(void);
 
@@ -3,6 +3,8 @@
 #include "binary_sensor.h"
 #include "binary_sensor_esb_cmd_def.h"
 
+#define BINARY_SENSOR_GET_ALL_IDX_STATES 4 /* generation, first channel, number of state bytes */
+
 /* Get channel value
  * payload length: 1
  * payload: 0: (uint8_t) channel ID
@@ -44,7 +46,75 @@ void binary_sensor_esb_cmd_fct_set_channel(const esb_protocol_message_t *message
     return;
 }
 
-#define BINARY_SENSOR_ESB_CMD_NUM 2
+/* Get the values of all channels, with a generation counter to detect changes between the parts
+ * payload length: 0 or 1
+ * payload: 0: (uint8_t) ID of the first channel (multiple of 8), 0 if omitted
+ * answer payload: 0..1: (uint16_t, little endian) generation counter of the channel values
+ *                 2: (uint8_t) ID of the first channel
+ *                 3: (uint8_t) total number of state bytes ((BINARY_SENSOR_CHAN_NUM + 7) / 8)
+ *                 4..: (uint8_t) state bitmap from the first channel on, as many bytes as fit into one message
+ *                      (bit (i % 8) of byte (i / 8) is the value of channel first + i)
+ * answer error: ESB_PROT_REPLY_ERR_OK if OK, ESB_PROT_REPLY_ERR_PARAM for an invalid channel ID,
+ *               ESB_PROT_REPLY_ERR_SIZE for a payload longer than 1 byte
+ */
+void binary_sensor_esb_cmd_fct_get_all_channels(const esb_protocol_message_t *message,
+                                                esb_protocol_message_t *answer)
+{
+    if (message->payload_len > 1) {
+        answer->error = ESB_PROT_REPLY_ERR_SIZE;
+        return;
+    }
+
+    uint8_t first_chan = (message->payload_len == 1) ? message->payload[0] : 0;
+    /* leave room for the request ID */
+    uint8_t num_bytes = esb_protocol_max_payload_len() - BINARY_SENSOR_GET_ALL_IDX_STATES - 1;
+    uint16_t generation = 0;
+    esb_protocol_err_t result = binary_sensor_get_snapshot(
+        first_chan, &answer->payload[BINARY_SENSOR_GET_ALL_IDX_STATES], &num_bytes, &generation);
+
+    if (result != ESB_PROT_ERR_OK) {
+        answer->error = ESB_PROT_REPLY_ERR_PARAM;
+        return;
+    }
+
+    answer->error = ESB_PROT_REPLY_ERR_OK;
+    answer->payload[0] = (uint8_t)generation;
+    answer->payload[1] = (uint8_t)(generation >> 8);
+    answer->payload[2] = first_chan;
+    answer->payload[3] = (uint8_t)((BINARY_SENSOR_CHAN_NUM + 7) / 8);
+    answer->payload_len = BINARY_SENSOR_GET_ALL_IDX_STATES + num_bytes;
+
+    return;
+}
+
+/* Set the values of several channels at once, either all selected channels are set or none
+ * payload length: 4 to 24
+ * payload: 0: (uint8_t) ID of the first channel (multiple of 8)
+ *          1: (uint8_t) number of bytes N of mask and values
+ *          2..: mask (N bytes), values (N bytes), bit (i % 8) of byte (i / 8) refers to channel first + i
+ * answer payload: None
+ * answer error: ESB_PROT_REPLY_ERR_OK if OK, ESB_PROT_REPLY_ERR_PARAM for an invalid channel ID or a mask
+ *               selecting channels that don't exist, ESB_PROT_REPLY_ERR_SIZE if N doesn't match the payload length
+ */
+void binary_sensor_esb_cmd_fct_set_channels_masked(const esb_protocol_message_t *message,
+                                                   esb_protocol_message_t *answer)
+{
+    if ((message->payload_len < 2) || (message->payload[1] == 0) ||
+        (message->payload_len != (2 + (2 * message->payload[1])))) {
+        answer->error = ESB_PROT_REPLY_ERR_SIZE;
+        return;
+    }
+
+    uint8_t num_bytes = message->payload[1];
+    esb_protocol_err_t result = binary_sensor_set_channels_masked(message->payload[0], &message->payload[2],
+                                                                  &message->payload[2 + num_bytes], num_bytes);
+
+    answer->error = (result == ESB_PROT_ERR_OK) ? ESB_PROT_REPLY_ERR_OK : ESB_PROT_REPLY_ERR_PARAM;
+
+    return;
+}
+
+#define BINARY_SENSOR_ESB_CMD_NUM 4
 /*!
  * \brief Command table
  */
@@ -52,6 +122,8 @@ esb_cmd_table_item_t binary_sensor_esb_cmd_table[BINARY_SENSOR_ESB_CMD_NUM + 1]
     /* COMMAND_ID                            PAYLOAD_SIZE   FUNCTION_POINTER*/
     {ESB_CMD_BINARY_SENSOR_GET_CHANNEL, 1, binary_sensor_esb_cmd_fct_get_channel},
     {ESB_CMD_BINARY_SENSOR_SET_CHANNEL, 2, binary_sensor_esb_cmd_fct_set_channel},
+    {ESB_CMD_BINARY_SENSOR_GET_ALL_CHANNELS, ESB_CMD_PAYLOAD_LEN_DYN, binary_sensor_esb_cmd_fct_get_all_channels},
+    {ESB_CMD_BINARY_SENSOR_SET_CHANNELS_MASKED, ESB_CMD_PAYLOAD_LEN_DYN, binary_sensor_esb_cmd_fct_set_channels_masked},
 
     /* last entry must be NULL-terminator */
     {0, 0, NULL}};
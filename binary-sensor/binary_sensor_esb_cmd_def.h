@@ -4,10 +4,12 @@
 
 #include <common/commands/esb_commands.h>
 
-enum {
+enum esb_cmd_id_binary_sensor {
     ESB_CMD_BINARY_SENSOR_GET_CHANNEL = 0x92, /* Get channel value */
     ESB_CMD_BINARY_SENSOR_SET_CHANNEL = 0x93, /* Set channel value */
-} esb_cmd_id_binary_sensor;
+    ESB_CMD_BINARY_SENSOR_GET_ALL_CHANNELS = 0x96,    /* Get the values of all channels as bitmap */
+    ESB_CMD_BINARY_SENSOR_SET_CHANNELS_MASKED = 0x97, /* Set the values of several channels at once */
+};
 
 /*!
  * \brief get pointer to binary sensor command table
@@ -15,4 +17,21 @@ enum {
  */
 esb_cmd_table_item_t *binary_sensor_get_esb_cmd_table(uint8_t *num_entries);
 
+/* command functions of the binary sensor command table */
+void binary_sensor_esb_cmd_fct_get_channel(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void binary_sensor_esb_cmd_fct_set_channel(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void binary_sensor_esb_cmd_fct_get_all_channels(const esb_protocol_message_t *message,
+                                                esb_protocol_message_t *answer);
+void binary_sensor_esb_cmd_fct_set_channels_masked(const esb_protocol_message_t *message,
+                                                   esb_protocol_message_t *answer);
+
+/*! \brief Entries of the binary sensor command table for a static dispatch index (see ESB_COMMANDS_STATIC_INDEX) */
+#define BINARY_SENSOR_ESB_CMD_STATIC_ENTRIES                                                                           \
+    ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_BINARY_SENSOR_GET_CHANNEL, 1, binary_sensor_esb_cmd_fct_get_channel),            \
+        ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_BINARY_SENSOR_SET_CHANNEL, 2, binary_sensor_esb_cmd_fct_set_channel),        \
+        ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_BINARY_SENSOR_GET_ALL_CHANNELS, ESB_CMD_PAYLOAD_LEN_DYN,                     \
+                                  binary_sensor_esb_cmd_fct_get_all_channels),                                         \
+        ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_BINARY_SENSOR_SET_CHANNELS_MASKED, ESB_CMD_PAYLOAD_LEN_DYN,                  \
+                                  binary_sensor_esb_cmd_fct_set_channels_masked)
+
 #endif /* BINARY_SENSOR_ESB_CMD_DEF_H_ */
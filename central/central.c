@@ -0,0 +1,231 @@
+#include "central.h"
+#include "central_esb_cmd_def.h"
+#include <common/driver/esb_time.h>
+#include <common/sched/esb_sched.h>
+#include <stddef.h>
+#include <string.h>
+
+#if ((CENTRAL_TABLE_SIZE & (CENTRAL_TABLE_SIZE - 1)) != 0)
+#error "CENTRAL_TABLE_SIZE must be a power of 2"
+#endif
+
+#if (CENTRAL_CHAN_NUM > 256)
+#error "CENTRAL_CHAN_NUM must not exceed 256 (8 bit channel IDs)"
+#endif
+
+static central_device_t g_devices[CENTRAL_TABLE_SIZE]; /*!< Peripheral table, open addressing with linear probing */
+
+static central_event_t g_events[CENTRAL_EVENT_QUEUE_SIZE]; /*!< Events not yet passed upstream (ring) */
+static uint16_t g_events_head = 0;
+static uint16_t g_events_count = 0;
+
+static uint8_t g_module_initialized = 0;
+static central_upstream_callback_t g_upstream_callback = NULL;
+static central_time_callback_t g_time_callback = NULL;
+static central_stats_t g_stats = {0};
+
+/* default time source, accumulated from the cycle counter */
+static uint32_t g_time_cycles = 0;
+static uint32_t g_time_us = 0;
+static uint32_t g_time_ms = 0;
+
+static uint32_t central_time_ms(void)
+{
+    if (g_time_callback != NULL) {
+        return (g_time_callback());
+    }
+
+    uint32_t now = esb_time_cycles();
+    g_time_us += esb_time_cycles_to_us(now - g_time_cycles);
+    g_time_cycles = now;
+    g_time_ms += g_time_us / 1000;
+    g_time_us %= 1000;
+
+    return (g_time_ms);
+}
+
+/* FNV-1a of the pipeline address */
+static uint32_t central_hash(const uint8_t address[5])
+{
+    uint32_t hash = 2166136261u;
+
+    for (uint8_t i = 0; i < ESB_PIPE_ADDR_LENGTH; i++) {
+        hash = (hash ^ address[i]) * 16777619u;
+    }
+    return (hash);
+}
+
+/* slot of the peripheral, or the empty slot where it would be inserted */
+static central_device_t *central_probe(const uint8_t address[5])
+{
+    uint32_t idx = central_hash(address) & (CENTRAL_TABLE_SIZE - 1);
+    uint32_t probe = 1;
+
+    /* terminates, the table always has empty slots */
+    while ((g_devices[idx].used != 0) && (memcmp(g_devices[idx].address, address, ESB_PIPE_ADDR_LENGTH) != 0)) {
+        idx = (idx + 1) & (CENTRAL_TABLE_SIZE - 1);
+        probe++;
+    }
+
+    if (probe > g_stats.max_probe) {
+        g_stats.max_probe = probe;
+    }
+    return (&g_devices[idx]);
+}
+
+/* pass all queued events upstream, the ring is delivered in at most two contiguous batches */
+static void central_flush_events(void)
+{
+    while (g_events_count > 0) {
+        uint16_t num = CENTRAL_EVENT_QUEUE_SIZE - g_events_head;
+        if (num > g_events_count) {
+            num = g_events_count;
+        }
+
+        if (g_upstream_callback != NULL) {
+            g_upstream_callback(&g_events[g_events_head], num);
+            g_stats.upstream_calls++;
+        }
+        g_events_head = (g_events_head + num) % CENTRAL_EVENT_QUEUE_SIZE;
+        g_events_count -= num;
+    }
+}
+
+static void central_queue_event(const central_device_t *p_device, uint32_t w, uint32_t changed, uint32_t time_ms)
+{
+    if (g_events_count == CENTRAL_EVENT_QUEUE_SIZE) {
+        central_flush_events();
+    }
+
+    central_event_t *p_event = &g_events[(g_events_head + g_events_count) % CENTRAL_EVENT_QUEUE_SIZE];
+    memcpy(p_event->address, p_device->address, ESB_PIPE_ADDR_LENGTH);
+    p_event->first_chan = (uint8_t)(w * CENTRAL_WORD_BITS);
+    p_event->changed = changed;
+    p_event->values = p_device->chan_values[w];
+    p_event->seq = p_device->seq;
+    p_event->time_ms = time_ms;
+
+    g_events_count++;
+    g_stats.events++;
+}
+
+esb_protocol_err_t central_init(central_upstream_callback_t upstream_callback, central_time_callback_t time_callback)
+{
+    if (upstream_callback == NULL) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    memset(g_devices, 0, sizeof(g_devices));
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_events_head = 0;
+    g_events_count = 0;
+    g_upstream_callback = upstream_callback;
+    g_time_callback = time_callback;
+    g_time_cycles = esb_time_cycles();
+
+    /* register notification commands in ESB command table */
+    uint8_t num_entries = 0;
+    esb_cmd_table_item_t *p_cmd_table = central_get_esb_cmd_table(&num_entries);
+    esb_protocol_err_t esb_result = esb_commands_register_app_commands(p_cmd_table, num_entries);
+
+    if (esb_result != ESB_PROT_ERR_OK) {
+        return (ESB_PROT_ERR_MEM);
+    }
+    g_module_initialized = 1;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+void central_process(void)
+{
+    central_flush_events();
+
+    if ((g_module_initialized != 0) && (g_time_callback == NULL)) {
+        /* the cycle counter wraps, account for the time since the last update before it does */
+        (void)central_time_ms();
+        esb_sched_request_wakeup(CENTRAL_TIME_UPDATE_MS * 1000u);
+    }
+}
+
+const central_device_t *central_find_device(const uint8_t address[5])
+{
+    if (address == NULL) {
+        return (NULL);
+    }
+
+    const central_device_t *p_device = central_probe(address);
+
+    return ((p_device->used != 0) ? p_device : NULL);
+}
+
+void central_get_stats(central_stats_t *p_stats)
+{
+    if (p_stats != NULL) {
+        *p_stats = g_stats;
+    }
+}
+
+esb_protocol_err_t central_ingest(const uint8_t address[5], uint8_t first_chan, const uint8_t *p_mask,
+                                  const uint8_t *p_values, uint8_t num_bytes)
+{
+    if (g_module_initialized == 0) {
+        return (ESB_PROT_ERR_INIT);
+    }
+
+    central_device_t *p_device = central_probe(address);
+    if (p_device->used == 0) {
+        if (g_stats.devices >= CENTRAL_MAX_DEVICES) {
+            g_stats.table_full++;
+            return (ESB_PROT_ERR_MEM);
+        }
+        memcpy(p_device->address, address, ESB_PIPE_ADDR_LENGTH);
+        p_device->used = 1;
+        g_stats.devices++;
+    }
+
+    uint32_t time_ms = central_time_ms();
+    p_device->seq++;
+    p_device->last_seen_ms = time_ms;
+    p_device->link.notifications++;
+    g_stats.notifications++;
+
+    /* collect the changes per word, a notification covers up to 88 channels */
+    uint32_t changed[CENTRAL_WORD_NUM] = {0};
+    esb_protocol_err_t result = ESB_PROT_ERR_OK;
+
+    for (uint8_t i = 0; i < num_bytes; i++) {
+        uint32_t chan = (uint32_t)first_chan + (8u * i);
+        uint32_t mask = p_mask[i];
+
+        if (chan >= CENTRAL_CHAN_NUM) {
+            result = ESB_PROT_ERR_PARAM;
+            break;
+        }
+        if ((CENTRAL_CHAN_NUM - chan) < 8) {
+            /* last byte only partially covered */
+            if ((mask >> (CENTRAL_CHAN_NUM - chan)) != 0) {
+                result = ESB_PROT_ERR_PARAM;
+            }
+            mask &= (1u << (CENTRAL_CHAN_NUM - chan)) - 1;
+        }
+
+        uint32_t w = chan / CENTRAL_WORD_BITS;
+        uint32_t shift = chan % CENTRAL_WORD_BITS;
+        mask <<= shift;
+        p_device->chan_values[w] = (p_device->chan_values[w] & ~mask) | (((uint32_t)p_values[i] << shift) & mask);
+        changed[w] |= mask;
+        p_device->link.changes += (uint32_t)__builtin_popcount(mask);
+    }
+
+    if (result != ESB_PROT_ERR_OK) {
+        p_device->link.invalid++;
+    }
+
+    for (uint32_t w = 0; w < CENTRAL_WORD_NUM; w++) {
+        if (changed[w] != 0) {
+            central_queue_event(p_device, w, changed[w], time_ms);
+        }
+    }
+
+    return (result);
+}
@@ -0,0 +1,145 @@
+#ifndef _CENTRAL_H
+#define _CENTRAL_H
+
+/*!
+ * \file central.h
+ * \brief Application layer for the central device, receives the notifications of binary sensor peripherals
+ * \details The central listens on its own pipeline address (the central address configured in the peripherals)
+ * and decodes the notification formats of the binary sensor (0x91, the batch notification 0x94 and the
+ * transition notification 0x95, see binary_sensor.h). The peripherals are kept in an open-addressed hash table
+ * (linear probing) keyed by the 5 byte pipeline address, so a notification is ingested in constant time
+ * independent of the number of peripherals.
+ * Each peripheral entry holds the last channel values, a notification sequence number, the time it was last
+ * seen and link statistics.
+ *
+ * Every notification produces one event per 32 channel word it changes. The events are collected in a queue and
+ * passed to the upstream callback in batches by central_process(), e.g. to forward them to a host over UART.
+ * A full queue is flushed right away, so no event is lost.
+ *
+ * All functions must be called from the main loop (same context as esb_protocol_process()).
+ * */
+
+#include <common/protocol/esb_protocol.h>
+#include <stdint.h>
+
+#ifndef CENTRAL_TABLE_SIZE
+#define CENTRAL_TABLE_SIZE 512 /*!< Slots of the peripheral table, power of 2 */
+#endif
+
+#define CENTRAL_MAX_DEVICES ((CENTRAL_TABLE_SIZE * 3) / 4) /*!< Peripherals, the table is kept at most 3/4 full */
+
+#ifndef CENTRAL_CHAN_NUM
+#define CENTRAL_CHAN_NUM 32 /*!< Channels stored per peripheral, notifications of higher channels are ignored */
+#endif
+
+#ifndef CENTRAL_EVENT_QUEUE_SIZE
+#define CENTRAL_EVENT_QUEUE_SIZE 64 /*!< Events collected before they are passed upstream */
+#endif
+
+#ifndef CENTRAL_TIME_UPDATE_MS
+#define CENTRAL_TIME_UPDATE_MS 30000 /*!< Period of the default time source, below the cycle counter wrap (67s) */
+#endif
+
+#define CENTRAL_WORD_BITS 32
+#define CENTRAL_WORD_NUM ((CENTRAL_CHAN_NUM + CENTRAL_WORD_BITS - 1) / CENTRAL_WORD_BITS)
+
+/*! \brief Link statistics of a peripheral */
+typedef struct {
+    uint32_t notifications; /*!< Notifications received */
+    uint32_t changes;       /*!< Channel changes received */
+    uint32_t invalid;       /*!< Notifications with invalid content, e.g. channel out of range */
+} central_link_stats_t;
+
+/*! \brief State of a peripheral */
+typedef struct {
+    uint8_t address[ESB_PIPE_ADDR_LENGTH]; /*!< Pipeline address of the peripheral */
+    uint8_t used;                          /*!< Slot is in use */
+    uint32_t chan_values[CENTRAL_WORD_NUM]; /*!< Last value of all channels, channel i is bit (i % 32) of word i / 32 */
+    uint32_t seq;                           /*!< Sequence number of the last notification (counted by the central) */
+    uint32_t last_seen_ms;                  /*!< Time of the last notification */
+    central_link_stats_t link;              /*!< Link statistics */
+} central_device_t;
+
+/*! \brief Channel change event, passed upstream */
+typedef struct {
+    uint8_t address[ESB_PIPE_ADDR_LENGTH]; /*!< Pipeline address of the peripheral */
+    uint8_t first_chan;                    /*!< Channel of bit 0, multiple of 32 */
+    uint32_t changed;                      /*!< Bit i is set if channel first_chan + i has changed */
+    uint32_t values;                       /*!< Values of the channels first_chan to first_chan + 31 */
+    uint32_t seq;                          /*!< Sequence number of the notification */
+    uint32_t time_ms;                      /*!< Time the notification was received */
+} central_event_t;
+
+/*! \brief Statistics of the central */
+typedef struct {
+    uint32_t devices;         /*!< Peripherals in the table */
+    uint32_t table_full;      /*!< Notifications dropped because the table was full */
+    uint32_t notifications;   /*!< Notifications received */
+    uint32_t events;          /*!< Events queued */
+    uint32_t upstream_calls;  /*!< Calls of the upstream callback */
+    uint32_t max_probe;       /*!< Longest probe sequence of a table lookup */
+} central_stats_t;
+
+/*!
+ * \brief Called with a batch of events
+ * \param[in] p_events      Events, valid until the callback returns
+ * \param[in] num_events    Number of events
+ */
+typedef void (*central_upstream_callback_t)(const central_event_t *p_events, uint16_t num_events);
+
+/*!
+ * \brief Get the current time in milliseconds, used for last_seen_ms and the event times
+ * \details Without a time callback the time is accumulated from the cycle counter (esb_time.h), which wraps after
+ * 67s on target. The default time source is updated by every notification and by central_process(), which requests
+ * a wakeup of the event-driven main loop (esb_sched.h) every CENTRAL_TIME_UPDATE_MS for it. If central_process()
+ * isn't called at least once per wrap (e.g. a main loop without esb_sched_wait() that sleeps longer), whole wrap
+ * periods are lost and a time callback with a clock that keeps running, e.g. an RTC, has to be passed.
+ */
+typedef uint32_t (*central_time_callback_t)(void);
+
+/*!
+ * \brief Initialize the "Central" application layer
+ * \details Registers the notification commands, esb_protocol_init() must be called with the central address
+ * \param[in] upstream_callback    Called with batches of events
+ * \param[in] time_callback        Time source, NULL to derive the time from the cycle counter (esb_time.h, see
+ *                                 central_time_callback_t for its limits)
+ * \retval ESB_PROT_ERR_OK          No Error
+ * \retval ESB_PROT_ERR_PARAM       illegal parameter (NULL-pointer)
+ * \retval ESB_PROT_ERR_MEM         Registration of the ESB command table failed (command ID already registered)
+ */
+esb_protocol_err_t central_init(central_upstream_callback_t upstream_callback, central_time_callback_t time_callback);
+
+/*!
+ * \brief Pass the queued events upstream and update the default time source
+ */
+void central_process(void);
+
+/*!
+ * \brief Look up a peripheral
+ * \param[in] address       Pipeline address of the peripheral
+ * \returns pointer to the state of the peripheral, NULL if it never sent a notification
+ */
+const central_device_t *central_find_device(const uint8_t address[5]);
+
+/*!
+ * \brief Get the statistics of the central
+ * \param[out] p_stats      Buffer for the statistics
+ */
+void central_get_stats(central_stats_t *p_stats);
+
+/*!
+ * \brief Ingest a notification, called by the command functions (see central_esb_cmd_def.c)
+ * \param[in] address       Pipeline address of the peripheral
+ * \param[in] first_chan    Channel of bit 0 of the first byte of mask and values
+ * \param[in] p_mask        Changed channels, bit (i % 8) of byte (i / 8) is channel first_chan + i
+ * \param[in] p_values      Channel values, same layout as p_mask
+ * \param[in] num_bytes     Number of bytes of p_mask and p_values
+ * \retval ESB_PROT_ERR_OK      No Error
+ * \retval ESB_PROT_ERR_INIT    Module is not initialized
+ * \retval ESB_PROT_ERR_MEM     Peripheral table is full
+ * \retval ESB_PROT_ERR_PARAM   Channels out of range (the valid part is ingested)
+ */
+esb_protocol_err_t central_ingest(const uint8_t address[5], uint8_t first_chan, const uint8_t *p_mask,
+                                  const uint8_t *p_values, uint8_t num_bytes);
+
+#endif
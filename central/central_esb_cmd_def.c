@@ -0,0 +1,131 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "central.h"
+#include "central_esb_cmd_def.h"
+
+/* Channel state notification of a binary sensor (see binary_sensor.h)
+ * payload length: 7
+ * payload: 0..4: peripheral address
+ *          5: (uint8_t) channel ID
+ *          6: (uint8_t) channel value (0 or 1)
+ * answer: None
+ */
+void central_esb_cmd_fct_notification(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    answer->error = ESB_PROT_REPLY_NONE;
+
+    uint8_t chan = message->payload[5];
+    uint8_t value = message->payload[6];
+    if (value > CHAN_VAL_TRUE) {
+        return;
+    }
+
+    uint8_t mask = (uint8_t)(1u << (chan % 8));
+    uint8_t values = (uint8_t)(value << (chan % 8));
+    (void)central_ingest(&message->payload[0], chan & ~0x07u, &mask, &values, 1);
+
+    return;
+}
+
+/* Batch notification of a binary sensor (see binary_sensor.h)
+ * payload length: 4 to 24
+ * payload: 0: (uint8_t) first channel (multiple of 8)
+ *          1: (uint8_t) number of bytes N of mask and states
+ *          2..: changed mask (N bytes), states (N bytes)
+ * answer: None
+ */
+void central_esb_cmd_fct_notification_batch(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    answer->error = ESB_PROT_REPLY_NONE;
+
+    if (message->payload_len < 2) {
+        return;
+    }
+
+    uint8_t first_chan = message->payload[0];
+    uint8_t num_bytes = message->payload[1];
+    if ((num_bytes == 0) || (message->payload_len != (2 + (2 * num_bytes))) || ((first_chan % 8) != 0)) {
+        return;
+    }
+
+    (void)central_ingest(message->address, first_chan, &message->payload[2], &message->payload[2 + num_bytes],
+                         num_bytes);
+
+    return;
+}
+
+/* Transition notification of a debounced binary sensor (see binary_sensor.h)
+ * payload length: 3 to 27 (multiple of 3)
+ * payload: per channel 0: (uint8_t) channel ID
+ *                      1: (uint8_t) channel value after the last transition (0 or 1)
+ *                      2: (uint8_t) number of transitions since the last notification
+ * answer: None
+ */
+void central_esb_cmd_fct_notification_transitions(const esb_protocol_message_t *message,
+                                                  esb_protocol_message_t *answer)
+{
+    answer->error = ESB_PROT_REPLY_NONE;
+
+    if ((message->payload_len == 0) || ((message->payload_len % 3) != 0)) {
+        return;
+    }
+
+    /* the channels are in ascending order, close channels are ingested together like a batch notification. The
+     * central keeps the state only, the transition count isn't stored. */
+    uint8_t mask[CENTRAL_TRANSITIONS_SPAN_BYTES];
+    uint8_t values[CENTRAL_TRANSITIONS_SPAN_BYTES];
+    uint8_t first_chan = 0;
+    uint8_t num_bytes = 0;
+
+    for (uint8_t i = 0; i < message->payload_len; i += 3) {
+        uint8_t chan = message->payload[i];
+        uint8_t value = message->payload[i + 1];
+        if (value > CHAN_VAL_TRUE) {
+            continue;
+        }
+
+        if ((num_bytes != 0) &&
+            ((chan < first_chan) || ((chan - first_chan) >= (8 * CENTRAL_TRANSITIONS_SPAN_BYTES)))) {
+            (void)central_ingest(message->address, first_chan, mask, values, num_bytes);
+            num_bytes = 0;
+        }
+        if (num_bytes == 0) {
+            first_chan = chan & ~0x07u;
+            memset(mask, 0, sizeof(mask));
+            memset(values, 0, sizeof(values));
+        }
+
+        uint8_t byte = (chan - first_chan) / 8;
+        mask[byte] |= (uint8_t)(1u << (chan % 8));
+        values[byte] |= (uint8_t)(value << (chan % 8));
+        if (byte >= num_bytes) {
+            num_bytes = byte + 1;
+        }
+    }
+
+    if (num_bytes != 0) {
+        (void)central_ingest(message->address, first_chan, mask, values, num_bytes);
+    }
+
+    return;
+}
+
+#define CENTRAL_ESB_CMD_NUM 3
+/*!
+ * \brief Command table
+ */
+esb_cmd_table_item_t central_esb_cmd_table[CENTRAL_ESB_CMD_NUM + 1] = {
+    /* COMMAND_ID                                         PAYLOAD_SIZE                  FUNCTION_POINTER*/
+    {BINARY_SENSOR_NOTIFICATION_ESB_CMD_ID,               CENTRAL_NOTIFICATION_PL_LEN,  central_esb_cmd_fct_notification},
+    {BINARY_SENSOR_NOTIFICATION_BATCH_ESB_CMD_ID,         ESB_CMD_PAYLOAD_LEN_DYN,      central_esb_cmd_fct_notification_batch},
+    {BINARY_SENSOR_NOTIFICATION_TRANSITIONS_ESB_CMD_ID,   ESB_CMD_PAYLOAD_LEN_DYN,      central_esb_cmd_fct_notification_transitions},
+
+    /* last entry must be NULL-terminator */
+    {0, 0, NULL}};
+
+esb_cmd_table_item_t *central_get_esb_cmd_table(uint8_t *num_entries)
+{
+    *num_entries = (uint8_t)CENTRAL_ESB_CMD_NUM;
+    return (central_esb_cmd_table);
+}
@@ -0,0 +1,32 @@
+
+#ifndef CENTRAL_ESB_CMD_DEF_H_
+#define CENTRAL_ESB_CMD_DEF_H_
+
+#include <binary-sensor/binary_sensor.h>
+#include <common/commands/esb_commands.h>
+
+#define CENTRAL_NOTIFICATION_PL_LEN 7 /* PERIPH_ADDR, CHAN_ID, STATE */
+#define CENTRAL_TRANSITIONS_SPAN_BYTES 11 /* channel bytes ingested at once from a transition notification */
+
+/*!
+ * \brief get pointer to central command table
+ * \param[out] num_entries  Number of entries in the command table
+ */
+esb_cmd_table_item_t *central_get_esb_cmd_table(uint8_t *num_entries);
+
+/* command functions of the central command table */
+void central_esb_cmd_fct_notification(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void central_esb_cmd_fct_notification_batch(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void central_esb_cmd_fct_notification_transitions(const esb_protocol_message_t *message,
+                                                  esb_protocol_message_t *answer);
+
+/*! \brief Entries of the central command table for a static dispatch index (see ESB_COMMANDS_STATIC_INDEX) */
+#define CENTRAL_ESB_CMD_STATIC_ENTRIES                                                                                 \
+    ESB_COMMANDS_STATIC_ENTRY(BINARY_SENSOR_NOTIFICATION_ESB_CMD_ID, CENTRAL_NOTIFICATION_PL_LEN,                      \
+                              central_esb_cmd_fct_notification),                                                       \
+        ESB_COMMANDS_STATIC_ENTRY(BINARY_SENSOR_NOTIFICATION_BATCH_ESB_CMD_ID, ESB_CMD_PAYLOAD_LEN_DYN,                \
+                                  central_esb_cmd_fct_notification_batch),                                      \
+        ESB_COMMANDS_STATIC_ENTRY(BINARY_SENSOR_NOTIFICATION_TRANSITIONS_ESB_CMD_ID, ESB_CMD_PAYLOAD_LEN_DYN,          \
+                                  central_esb_cmd_fct_notification_transitions)
+
+#endif /* CENTRAL_ESB_CMD_DEF_H_ */
@@ -1,6 +1,7 @@
 #include <stddef.h>
 
 #include <common/commands/esb_cmd_def_common.h>
+#include <common/config/esb_config.h>
 
 #ifndef VERSION_MAJOR
 #define VERSION_MAJOR 0
@@ -29,18 +30,128 @@ void esb_cmd_fct_get_version(const esb_protocol_message_t *message, esb_protocol
     return;
 }
 
+/* Poll
+ * payload length must be 0
+ * answer: None, the ACK of the poll frame carries the next pending ACK payload
+ */
+void esb_cmd_fct_poll(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    answer->error = ESB_PROT_REPLY_NONE;
+
+    return;
+}
+
+/* Get protocol statistics
+ * payload length: 1
+ * payload: 0: (uint8_t) ID of the first counter (see esb_protocol_stat_id_t)
+ * answer payload: 0: (uint8_t) ID of the first counter
+ *                 1: (uint8_t) total number of counters
+ *                 2..: (uint32_t, little endian) consecutive counters, as many as fit into one message
+ * answer error: ESB_PROT_REPLY_ERR_OK if OK, ESB_PROT_REPLY_ERR_PARAM for an invalid counter ID
+ */
+void esb_cmd_fct_get_stats(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    uint8_t first = message->payload[0];
+
+    if (first >= ESB_PROT_STAT_NUM) {
+        answer->error = ESB_PROT_REPLY_ERR_PARAM;
+        return;
+    }
+
+    esb_protocol_stats_t stats;
+    esb_protocol_get_stats(&stats);
+
+    answer->error = ESB_PROT_REPLY_ERR_OK;
+    answer->payload[0] = first;
+    answer->payload[1] = ESB_PROT_STAT_NUM;
+    answer->payload_len = 2;
+
+    for (uint8_t id = first; (id < ESB_PROT_STAT_NUM) && ((answer->payload_len + 4) <= ESB_PROTOCOL_MAX_PAYLOAD_LEN);
+         id++) {
+        uint32_t value = stats.counter[id];
+        answer->payload[answer->payload_len++] = (uint8_t)value;
+        answer->payload[answer->payload_len++] = (uint8_t)(value >> 8);
+        answer->payload[answer->payload_len++] = (uint8_t)(value >> 16);
+        answer->payload[answer->payload_len++] = (uint8_t)(value >> 24);
+    }
+
+    return;
+}
+
+/* Set the node ID, this node sends its frames with the compact header (see esb_protocol.h)
+ * payload length: 1
+ * payload: 0: (uint8_t) node ID, ESB_PROT_NODE_ID_NONE for the full header
+ * answer payload: 0: (uint8_t) node ID, the reply is already sent with the new header
+ * answer error: ESB_PROT_REPLY_ERR_OK if OK, ESB_PROT_REPLY_ERR_API if the protocol is not initialized
+ */
+void esb_cmd_fct_set_node_id(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    if (esb_protocol_set_node_id(message->payload[0]) != ESB_PROT_ERR_OK) {
+        answer->error = ESB_PROT_REPLY_ERR_API;
+        return;
+    }
+
+    answer->error = ESB_PROT_REPLY_ERR_OK;
+    answer->payload[0] = message->payload[0];
+    answer->payload_len = 1;
+
+    return;
+}
+
+/* Set a configuration item (see esb_config.h)
+ * payload length: 1 to 25
+ * payload: 0: (uint8_t) key
+ *          1..: value
+ * answer payload: 0: (uint8_t) key
+ * answer error: ESB_PROT_REPLY_ERR_OK if OK, ESB_PROT_REPLY_ERR_PARAM for an invalid key,
+ *               ESB_PROT_REPLY_ERR_API if the store is not initialized or the storage failed
+ */
 void esb_cmd_fct_cfg_set_item(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
 {
-    /* NOT USED FOR NOW, maybe remove later */
-    answer->error = ESB_PROT_REPLY_ERR_CMD;
+    if (message->payload_len < 1) {
+        answer->error = ESB_PROT_REPLY_ERR_SIZE;
+        return;
+    }
+
+    esb_protocol_err_t result = esb_config_set(message->payload[0], &message->payload[1], message->payload_len - 1);
+    if (result == ESB_PROT_ERR_OK) {
+        answer->error = ESB_PROT_REPLY_ERR_OK;
+    } else if (result == ESB_PROT_ERR_PARAM) {
+        answer->error = ESB_PROT_REPLY_ERR_PARAM;
+    } else {
+        answer->error = ESB_PROT_REPLY_ERR_API;
+    }
+    answer->payload[0] = message->payload[0];
+    answer->payload_len = 1;
 
     return;
 }
 
+/* Get a configuration item (see esb_config.h)
+ * payload length: 1
+ * payload: 0: (uint8_t) key
+ * answer payload: 0: (uint8_t) key
+ *                 1..: value
+ * answer error: ESB_PROT_REPLY_ERR_OK if OK, ESB_PROT_REPLY_ERR_PARAM for an invalid or unset key,
+ *               ESB_PROT_REPLY_ERR_API if the store is not initialized or the storage failed
+ */
 void esb_cmd_fct_cfg_get_item(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
 {
-    /* NOT USED FOR NOW, maybe remove later */
-    answer->error = ESB_PROT_REPLY_ERR_CMD;
+    uint8_t length = 0;
+
+    answer->payload[0] = message->payload[0];
+    answer->payload_len = 1;
+
+    esb_protocol_err_t result = esb_config_get(message->payload[0], &answer->payload[1],
+                                               ESB_PROTOCOL_MAX_PAYLOAD_LEN - 1, &length);
+    if (result == ESB_PROT_ERR_OK) {
+        answer->error = ESB_PROT_REPLY_ERR_OK;
+        answer->payload_len += length;
+    } else if ((result == ESB_PROT_ERR_PARAM) || (result == ESB_PROT_ERR_VALUE)) {
+        answer->error = ESB_PROT_REPLY_ERR_PARAM;
+    } else {
+        answer->error = ESB_PROT_REPLY_ERR_API;
+    }
 
     return;
 }
@@ -51,6 +162,9 @@ void esb_cmd_fct_cfg_get_item(const esb_protocol_message_t *message, esb_protoco
 esb_cmd_table_item_t esb_cmd_table_common[] = {
     /* COMMAND_ID           PAYLOAD_SIZE                FUNCTION_POINTER*/
     {ESB_CMD_VERSION,       0,                          esb_cmd_fct_get_version},
+    {ESB_CMD_POLL,          0,                          esb_cmd_fct_poll},
+    {ESB_CMD_GET_STATS,     1,                          esb_cmd_fct_get_stats},
+    {ESB_CMD_SET_NODE_ID,   1,                          esb_cmd_fct_set_node_id},
     {ESB_CFG_SET_ITEM,      ESB_CMD_PAYLOAD_LEN_DYN,    esb_cmd_fct_cfg_set_item},
     {ESB_CFG_GET_ITEM,      1,                          esb_cmd_fct_cfg_get_item},
 
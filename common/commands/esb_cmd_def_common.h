@@ -5,12 +5,33 @@
 #include <common/commands/esb_commands.h>
 
 enum esb_cmd_id_common {
-    ESB_CMD_VERSION = 0x10,  /* Get firmware version */
-    ESB_CFG_SET_ITEM = 0x21, /* Set a configuration item */
-    ESB_CFG_GET_ITEM = 0x22, /* Get a configuration item */
+    ESB_CMD_VERSION = 0x10,     /* Get firmware version */
+    ESB_CMD_POLL = 0x11,        /* No operation, picks up pending ACK payloads (see esb_protocol_set_reply_mode) */
+    ESB_CMD_GET_STATS = 0x12,   /* Get protocol statistics */
+    ESB_CMD_SET_NODE_ID = 0x19, /* Assign a node ID for the compact header */
+    ESB_CMD_BUSY_HINT = 0x1A,   /* Back-off hint in an ACK payload, not a command (ESB_PROTOCOL_CMD_BUSY_HINT) */
+    ESB_CFG_SET_ITEM = 0x21,    /* Set a configuration item */
+    ESB_CFG_GET_ITEM = 0x22,    /* Get a configuration item */
 };
 
 /*! \brief Get pointer to common command table */
 esb_cmd_table_item_t *get_esb_cmd_table_common(void);
 
+/* command functions of the common command table */
+void esb_cmd_fct_get_version(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void esb_cmd_fct_poll(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void esb_cmd_fct_get_stats(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void esb_cmd_fct_set_node_id(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void esb_cmd_fct_cfg_set_item(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void esb_cmd_fct_cfg_get_item(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+
+/*! \brief Entries of the common command table for a static dispatch index (see ESB_COMMANDS_STATIC_INDEX) */
+#define ESB_CMD_TABLE_COMMON_STATIC_ENTRIES                                                                            \
+    ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_VERSION, 0, esb_cmd_fct_get_version),                                            \
+        ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_POLL, 0, esb_cmd_fct_poll),                                                  \
+        ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_GET_STATS, 1, esb_cmd_fct_get_stats),                                        \
+        ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_SET_NODE_ID, 1, esb_cmd_fct_set_node_id),                                    \
+        ESB_COMMANDS_STATIC_ENTRY(ESB_CFG_SET_ITEM, ESB_CMD_PAYLOAD_LEN_DYN, esb_cmd_fct_cfg_set_item),                 \
+        ESB_COMMANDS_STATIC_ENTRY(ESB_CFG_GET_ITEM, 1, esb_cmd_fct_cfg_get_item)
+
 #endif /* ESB_CMD_DEF_COMMON_H_ */
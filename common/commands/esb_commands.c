@@ -4,19 +4,20 @@
 #include <common/commands/esb_cmd_def_common.h>
 #include <common/commands/esb_commands.h>
 
-#ifndef ESB_COMMANDS_NUM_APP_TABLES
-#define ESB_COMMANDS_NUM_APP_TABLES 3 /* max number of additional app specific command tables (default 3)*/
+#ifdef ESB_COMMANDS_STATIC_INDEX
+/* index defined by the application with ESB_COMMANDS_STATIC_ENTRY(), see esb_commands.h */
+extern const esb_cmd_table_item_t *const esb_commands_static_index[ESB_COMMANDS_INDEX_SIZE];
+#define g_cmd_index esb_commands_static_index
+#else
+/* dispatch index, one entry per command ID, built on registration of the command tables */
+static const esb_cmd_table_item_t *g_cmd_index[ESB_COMMANDS_INDEX_SIZE];
 #endif
 
-esb_cmd_table_item_t *g_cmd_tables[ESB_COMMANDS_NUM_APP_TABLES + 1];
-static uint32_t g_num_app_tables = 0;
+#ifdef ESB_COMMANDS_STATIC_INDEX
 
 void esb_commands_init(void)
 {
-    memset(g_cmd_tables, 0, sizeof(g_cmd_tables));
-
-    /* the first command table is always the common commands */
-    g_cmd_tables[0] = get_esb_cmd_table_common();
+    /* the static index already contains the common commands */
 }
 
 esb_protocol_err_t esb_commands_register_app_commands(esb_cmd_table_item_t *app_cmd_table, uint32_t num_entries)
@@ -25,41 +26,91 @@ esb_protocol_err_t esb_commands_register_app_commands(esb_cmd_table_item_t *app_
         return (ESB_PROT_ERR_PARAM);
     }
 
-    if (g_num_app_tables >= ESB_COMMANDS_NUM_APP_TABLES) {
-        /* maximum number of tables reached */
-        return (ESB_PROT_ERR_MEM);
-    }
-
     if ((num_entries == 0) || (app_cmd_table[num_entries].cmd_fct_pnt != NULL)) {
         return (ESB_PROT_ERR_VALUE);
     }
 
-    g_num_app_tables++;
-    g_cmd_tables[g_num_app_tables] = app_cmd_table;
+    /* nothing to register, only check that the table has no duplicate IDs and the static index matches it */
+    for (uint32_t index = 0; index < num_entries; index++) {
+        for (uint32_t prev = 0; prev < index; prev++) {
+            if (app_cmd_table[prev].cmd_id == app_cmd_table[index].cmd_id) {
+                return (ESB_PROT_ERR_DUPLICATE);
+            }
+        }
+        const esb_cmd_table_item_t *p_entry = g_cmd_index[app_cmd_table[index].cmd_id];
+        if ((p_entry == NULL) || (p_entry->cmd_fct_pnt != app_cmd_table[index].cmd_fct_pnt) ||
+            (p_entry->payload_size != app_cmd_table[index].payload_size)) {
+            return (ESB_PROT_ERR_VALUE);
+        }
+    }
 
     return (ESB_PROT_ERR_OK);
 }
 
-esb_cmd_table_item_t *esb_commands_lookup(uint8_t cmd_id, uint8_t payload_len)
-{
+#else
 
-    /* iterate through command tables */
-    for (uint32_t table_idx = 0; table_idx < ESB_COMMANDS_NUM_APP_TABLES + 1; table_idx++) {
-
-        for (uint32_t index = 0; g_cmd_tables[table_idx][index].cmd_fct_pnt != NULL; index++) {
-            if (cmd_id == g_cmd_tables[table_idx][index].cmd_id) {
-                /* check if payload size matches */
-                if ((g_cmd_tables[table_idx][index].payload_size == payload_len) ||
-                    (g_cmd_tables[table_idx][index].payload_size == ESB_CMD_PAYLOAD_LEN_DYN)) {
-                    /* return pointer to entry */
-                    return &(g_cmd_tables[table_idx][index]);
-                } else {
-                    /* payload size does not match */
-                    return (NULL);
-                }
+/* add all entries of a NULL-terminated table to the index, the whole table is rejected on duplicate IDs */
+static esb_protocol_err_t esb_commands_index_add(const esb_cmd_table_item_t *cmd_table)
+{
+    for (uint32_t index = 0; cmd_table[index].cmd_fct_pnt != NULL; index++) {
+        if (g_cmd_index[cmd_table[index].cmd_id] != NULL) {
+            return (ESB_PROT_ERR_DUPLICATE);
+        }
+        /* duplicates within the table itself */
+        for (uint32_t prev = 0; prev < index; prev++) {
+            if (cmd_table[prev].cmd_id == cmd_table[index].cmd_id) {
+                return (ESB_PROT_ERR_DUPLICATE);
             }
         }
     }
 
-    return (NULL);
+    for (uint32_t index = 0; cmd_table[index].cmd_fct_pnt != NULL; index++) {
+        g_cmd_index[cmd_table[index].cmd_id] = &(cmd_table[index]);
+    }
+
+    return (ESB_PROT_ERR_OK);
+}
+
+void esb_commands_init(void)
+{
+    memset(g_cmd_index, 0, sizeof(g_cmd_index));
+
+    /* the common commands are always registered */
+    (void)esb_commands_index_add(get_esb_cmd_table_common());
+}
+
+esb_protocol_err_t esb_commands_register_app_commands(esb_cmd_table_item_t *app_cmd_table, uint32_t num_entries)
+{
+    if (app_cmd_table == NULL) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    if ((num_entries == 0) || (app_cmd_table[num_entries].cmd_fct_pnt != NULL)) {
+        return (ESB_PROT_ERR_VALUE);
+    }
+
+    return (esb_commands_index_add(app_cmd_table));
+}
+
+#endif /* ESB_COMMANDS_STATIC_INDEX */
+
+const esb_cmd_table_item_t *esb_commands_lookup(uint8_t cmd_id, uint8_t payload_len)
+{
+    const esb_cmd_table_item_t *p_entry = g_cmd_index[cmd_id];
+
+    if (p_entry == NULL) {
+        return (NULL);
+    }
+
+    /* check if payload size matches */
+    if ((p_entry->payload_size != payload_len) && (p_entry->payload_size != ESB_CMD_PAYLOAD_LEN_DYN)) {
+        return (NULL);
+    }
+
+    return (p_entry);
+}
+
+const esb_cmd_table_item_t *esb_commands_find(uint8_t cmd_id)
+{
+    return (g_cmd_index[cmd_id]);
 }
@@ -6,6 +6,8 @@
 
 #define ESB_CMD_PAYLOAD_LEN_DYN 255 /* All payloads are allowed */
 
+#define ESB_COMMANDS_INDEX_SIZE 256 /* one dispatch index entry per command ID */
+
 typedef uint8_t esb_cmd_t;
 
 typedef struct {
@@ -23,22 +25,45 @@ void esb_commands_init(void);
 /*! \brief Register an application specific commands
  *  \details The command table consists of table items (see ::esb_cmd_table_item_t) and must be
  *           terminated with an NULL entry (see example of common command table ::esb_cmd_table
- *           in esb_protocol.c). The application specific command tables will be looked up in order
- *           of registration, but after the common commands. Duplicate command IDs will be ignored,
- *           first come first served
+ *           in esb_protocol.c). The entries are added to a dispatch index with one slot per command ID,
+ *           the table must stay valid after registration. A table containing a command ID which is already
+ *           registered (or twice in the table itself) is rejected as a whole.
+ *           With ESB_COMMANDS_STATIC_INDEX the index is constant, the function only checks that the table
+ *           has no duplicate IDs and is part of it. Two static entries with the same ID are caught at compile
+ *           time with -Werror=override-init.
  *  \param app_cmd_table[in]            - table with application specific command definitions
- *  \param num_entries[in]              - number of entries (excluding NULL-terminator)  // TODO: not needed?
+ *  \param num_entries[in]              - number of entries (excluding NULL-terminator)
  *  \retval ESB_PROT_ERR_OK         - OK
  *  \retval ESB_PROT_ERR_PARAM      - Parameter Error (NULL Pointer)
- *  \retval ESB_PROT_ERR_MEM        - Maximum number of custom command tables reached (see ESB_COMMANDS_MAX_APP_TABLES)
- *  \retval ESB_PROT_ERR_VALUE      - passed command table is missing the NULL terminator as the last entry
+ *  \retval ESB_PROT_ERR_VALUE      - passed command table is missing the NULL terminator as the last entry, or
+ *                                    (ESB_COMMANDS_STATIC_INDEX only) it does not match the static index
+ *  \retval ESB_PROT_ERR_DUPLICATE  - a command ID of the table is already registered
  */
 esb_protocol_err_t esb_commands_register_app_commands(esb_cmd_table_item_t *app_cmd_table, uint32_t num_entries);
 
 /*!
- * \brief lookup command ID in table(s)
- * \returns pointer to command entry, NULL if none is found for this command ID
+ * \brief lookup command ID in the dispatch index, constant time
+ * \returns pointer to command entry, NULL if none is found for this command ID or the payload size does not match
+ */
+const esb_cmd_table_item_t *esb_commands_lookup(uint8_t cmd_id, uint8_t payload_len);
+
+/*!
+ * \brief lookup command ID in the dispatch index without checking the payload size
+ * \returns pointer to command entry, NULL if none is registered for this command ID
+ */
+const esb_cmd_table_item_t *esb_commands_find(uint8_t cmd_id);
+
+/*
+ * Static dispatch index
+ * For nodes with a fixed command set, define ESB_COMMANDS_STATIC_INDEX and provide the index as constant
+ * table (no RAM needed), e.g.:
+ *
+ *   const esb_cmd_table_item_t *const esb_commands_static_index[ESB_COMMANDS_INDEX_SIZE] = {
+ *       ESB_CMD_TABLE_COMMON_STATIC_ENTRIES,
+ *       BINARY_SENSOR_ESB_CMD_STATIC_ENTRIES,
+ *       ESB_COMMANDS_STATIC_ENTRY(0xA0, 1, my_app_cmd_fct),
+ *   };
  */
-esb_cmd_table_item_t *esb_commands_lookup(uint8_t cmd_id, uint8_t payload_len);
+#define ESB_COMMANDS_STATIC_ENTRY(id, size, fct) [(id)] = &(const esb_cmd_table_item_t){(id), (size), (fct)}
 
 #endif /* ESB_COMMANDS_H_ */
@@ -0,0 +1,451 @@
+#include <stddef.h>
+#include <string.h>
+
+#include <common/config/esb_config.h>
+#include <common/driver/esb_time.h>
+#include <common/sched/esb_sched.h>
+
+#define ESB_CONFIG_PAGE_MAGIC 0x43425345u /* "ESBC" */
+#define ESB_CONFIG_PAGE_HEADER_SIZE 8
+#define ESB_CONFIG_RECORD_HEADER_SIZE 4
+#define ESB_CONFIG_COMMIT_SIZE (ESB_CONFIG_RECORD_HEADER_SIZE + 4)
+#define ESB_CONFIG_RECORD_CHECK 0xA5
+#define ESB_CONFIG_NO_OFFSET 0 /* offsets of values are always behind a header */
+
+#define ESB_CONFIG_ALIGN(len) (((len) + 3u) & ~3u)
+#define ESB_CONFIG_RECORD_SIZE(len) (ESB_CONFIG_RECORD_HEADER_SIZE + ESB_CONFIG_ALIGN(len))
+
+#if ESB_CONFIG_MAX_KEYS > ESB_CONFIG_KEY_COMMIT
+#error "ESB_CONFIG_MAX_KEYS must not include ESB_CONFIG_KEY_COMMIT"
+#endif
+
+#if ESB_CONFIG_BATCH_SIZE < (ESB_CONFIG_RECORD_SIZE(ESB_CONFIG_MAX_VALUE_LEN) + ESB_CONFIG_COMMIT_SIZE)
+#error "ESB_CONFIG_BATCH_SIZE too small for one item"
+#endif
+
+/* location of the latest value of each key, offsets are relative to the page or the batch */
+typedef struct {
+    uint16_t offset[ESB_CONFIG_MAX_KEYS];
+    uint8_t length[ESB_CONFIG_MAX_KEYS];
+} esb_config_index_t;
+
+static const esb_config_storage_t *gp_storage = NULL;
+static uint8_t g_active_page = 0;
+static uint32_t g_page_seq = 0;
+static uint32_t g_write_offset = 0; /* offset of the next record in the active page */
+static uint8_t g_page_torn = 0;     /* active page contains records without valid commit, compact on next commit */
+static esb_config_index_t g_index;  /* committed items in the active page */
+
+static uint8_t g_batch[ESB_CONFIG_BATCH_SIZE] __attribute__((aligned(4)));
+static uint32_t g_batch_len = 0;
+static uint32_t g_batch_cycles = 0; /* time of the first item in the batch */
+static esb_config_index_t g_batch_index;
+
+static esb_config_stats_t g_stats = {0};
+
+static uint32_t esb_config_crc32(uint32_t crc, const uint8_t *p_data, uint32_t length)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= p_data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return (~crc);
+}
+
+static uint32_t esb_config_page_address(uint8_t page)
+{
+    return ((uint32_t)page * gp_storage->page_size);
+}
+
+static void esb_config_record_header(uint8_t *p_header, uint8_t key, uint8_t length)
+{
+    p_header[0] = key;
+    p_header[1] = length;
+    p_header[2] = 0x00;
+    p_header[3] = key ^ length ^ ESB_CONFIG_RECORD_CHECK;
+}
+
+static uint8_t esb_config_record_header_valid(const uint8_t *p_header)
+{
+    if ((p_header[2] != 0x00) || (p_header[3] != (p_header[0] ^ p_header[1] ^ ESB_CONFIG_RECORD_CHECK))) {
+        return (0);
+    }
+    if (p_header[0] == ESB_CONFIG_KEY_COMMIT) {
+        return (p_header[1] == 4);
+    }
+    return ((p_header[0] < ESB_CONFIG_MAX_KEYS) && (p_header[1] <= ESB_CONFIG_MAX_VALUE_LEN));
+}
+
+/* build a record in p_buffer, returns its size */
+static uint32_t esb_config_record_build(uint8_t *p_buffer, uint8_t key, const uint8_t *p_value, uint8_t length)
+{
+    uint32_t size = ESB_CONFIG_RECORD_SIZE(length);
+
+    esb_config_record_header(p_buffer, key, length);
+    memset(&p_buffer[ESB_CONFIG_RECORD_HEADER_SIZE], 0xFF, size - ESB_CONFIG_RECORD_HEADER_SIZE);
+    memcpy(&p_buffer[ESB_CONFIG_RECORD_HEADER_SIZE], p_value, length);
+
+    return (size);
+}
+
+static esb_protocol_err_t esb_config_write(uint8_t page, uint32_t offset, const uint8_t *p_data, uint32_t length)
+{
+    esb_protocol_err_t result = gp_storage->write(gp_storage, esb_config_page_address(page) + offset, p_data, length);
+    if (result == ESB_PROT_ERR_OK) {
+        g_stats.programmed_bytes += length;
+    }
+    return ((result == ESB_PROT_ERR_OK) ? ESB_PROT_ERR_OK : ESB_PROT_ERR_HAL);
+}
+
+/* value of a key including uncommitted items, returns 0 if the key is not set */
+static uint8_t esb_config_lookup(uint8_t key, const uint8_t **pp_batch_value, uint32_t *p_page_offset,
+                                 uint8_t *p_length)
+{
+    if (g_batch_index.offset[key] != ESB_CONFIG_NO_OFFSET) {
+        *pp_batch_value = &g_batch[g_batch_index.offset[key]];
+        *p_length = g_batch_index.length[key];
+        return (1);
+    }
+    if (g_index.offset[key] != ESB_CONFIG_NO_OFFSET) {
+        *pp_batch_value = NULL;
+        *p_page_offset = g_index.offset[key];
+        *p_length = g_index.length[key];
+        return (1);
+    }
+    return (0);
+}
+
+static void esb_config_batch_clear(void)
+{
+    g_batch_len = 0;
+    memset(&g_batch_index, 0, sizeof(g_batch_index));
+}
+
+/* copy the live items (committed and batch) to the next page, the header is written last */
+static esb_protocol_err_t esb_config_compact(void)
+{
+    uint8_t page = (uint8_t)((g_active_page + 1) % gp_storage->page_count);
+    uint32_t live_size = ESB_CONFIG_PAGE_HEADER_SIZE + ESB_CONFIG_COMMIT_SIZE;
+    const uint8_t *p_batch_value;
+    uint32_t page_offset;
+    uint8_t length;
+
+    for (uint8_t key = 0; key < ESB_CONFIG_MAX_KEYS; key++) {
+        if (esb_config_lookup(key, &p_batch_value, &page_offset, &length) != 0) {
+            live_size += ESB_CONFIG_RECORD_SIZE(length);
+        }
+    }
+    if (live_size > gp_storage->page_size) {
+        return (ESB_PROT_ERR_MEM);
+    }
+
+    if (gp_storage->erase(gp_storage, page) != ESB_PROT_ERR_OK) {
+        return (ESB_PROT_ERR_HAL);
+    }
+    g_stats.erases++;
+
+    esb_config_index_t index = {0};
+    uint8_t record[ESB_CONFIG_RECORD_SIZE(ESB_CONFIG_MAX_VALUE_LEN)] __attribute__((aligned(4)));
+    uint32_t offset = ESB_CONFIG_PAGE_HEADER_SIZE;
+    uint32_t crc = 0;
+
+    for (uint8_t key = 0; key < ESB_CONFIG_MAX_KEYS; key++) {
+        if (esb_config_lookup(key, &p_batch_value, &page_offset, &length) == 0) {
+            continue;
+        }
+
+        uint8_t value[ESB_CONFIG_MAX_VALUE_LEN];
+        if (p_batch_value == NULL) {
+            if (gp_storage->read(gp_storage, esb_config_page_address(g_active_page) + page_offset, value, length) !=
+                ESB_PROT_ERR_OK) {
+                return (ESB_PROT_ERR_HAL);
+            }
+            p_batch_value = value;
+        }
+
+        uint32_t size = esb_config_record_build(record, key, p_batch_value, length);
+        if (esb_config_write(page, offset, record, size) != ESB_PROT_ERR_OK) {
+            return (ESB_PROT_ERR_HAL);
+        }
+        crc = esb_config_crc32(crc, record, size);
+        index.offset[key] = (uint16_t)(offset + ESB_CONFIG_RECORD_HEADER_SIZE);
+        index.length[key] = length;
+        offset += size;
+    }
+
+    uint32_t size = esb_config_record_build(record, ESB_CONFIG_KEY_COMMIT, (const uint8_t *)&crc, sizeof(crc));
+    if (esb_config_write(page, offset, record, size) != ESB_PROT_ERR_OK) {
+        return (ESB_PROT_ERR_HAL);
+    }
+    offset += size;
+
+    uint32_t header[2] = {ESB_CONFIG_PAGE_MAGIC, g_page_seq + 1};
+    if (esb_config_write(page, 0, (const uint8_t *)header, sizeof(header)) != ESB_PROT_ERR_OK) {
+        return (ESB_PROT_ERR_HAL);
+    }
+
+    g_active_page = page;
+    g_page_seq++;
+    g_write_offset = offset;
+    g_page_torn = 0;
+    memcpy(&g_index, &index, sizeof(g_index));
+    g_stats.compactions++;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+/* apply the records of a committed batch (offset to end) to the index */
+static esb_protocol_err_t esb_config_scan_apply(uint32_t offset, uint32_t end)
+{
+    uint8_t header[ESB_CONFIG_RECORD_HEADER_SIZE];
+
+    while (offset < end) {
+        if (gp_storage->read(gp_storage, esb_config_page_address(g_active_page) + offset, header, sizeof(header)) !=
+            ESB_PROT_ERR_OK) {
+            return (ESB_PROT_ERR_HAL);
+        }
+        g_index.offset[header[0]] = (uint16_t)(offset + ESB_CONFIG_RECORD_HEADER_SIZE);
+        g_index.length[header[0]] = header[1];
+        offset += ESB_CONFIG_RECORD_SIZE(header[1]);
+    }
+    return (ESB_PROT_ERR_OK);
+}
+
+/* rebuild the index from the active page, stops at the first erased word or invalid record */
+static esb_protocol_err_t esb_config_scan(void)
+{
+    uint32_t base = esb_config_page_address(g_active_page);
+    uint32_t offset = ESB_CONFIG_PAGE_HEADER_SIZE;
+    uint32_t batch_offset = offset;
+    uint32_t crc = 0;
+
+    memset(&g_index, 0, sizeof(g_index));
+    g_page_torn = 0;
+
+    while ((offset + ESB_CONFIG_RECORD_HEADER_SIZE) <= gp_storage->page_size) {
+        uint8_t record[ESB_CONFIG_RECORD_SIZE(ESB_CONFIG_MAX_VALUE_LEN)] __attribute__((aligned(4)));
+        if (gp_storage->read(gp_storage, base + offset, record, ESB_CONFIG_RECORD_HEADER_SIZE) != ESB_PROT_ERR_OK) {
+            return (ESB_PROT_ERR_HAL);
+        }
+
+        uint32_t word;
+        memcpy(&word, record, sizeof(word));
+        if (word == ESB_CONFIG_STORAGE_ERASED_WORD) {
+            break;
+        }
+
+        uint32_t size = ESB_CONFIG_RECORD_SIZE(record[1]);
+        if ((esb_config_record_header_valid(record) == 0) || ((offset + size) > gp_storage->page_size)) {
+            g_page_torn = 1;
+            break;
+        }
+        if (gp_storage->read(gp_storage, base + offset + ESB_CONFIG_RECORD_HEADER_SIZE,
+                             &record[ESB_CONFIG_RECORD_HEADER_SIZE],
+                             size - ESB_CONFIG_RECORD_HEADER_SIZE) != ESB_PROT_ERR_OK) {
+            return (ESB_PROT_ERR_HAL);
+        }
+
+        if (record[0] == ESB_CONFIG_KEY_COMMIT) {
+            uint32_t stored_crc;
+            memcpy(&stored_crc, &record[ESB_CONFIG_RECORD_HEADER_SIZE], sizeof(stored_crc));
+            if (stored_crc != crc) {
+                g_page_torn = 1;
+                break;
+            }
+            if (esb_config_scan_apply(batch_offset, offset) != ESB_PROT_ERR_OK) {
+                return (ESB_PROT_ERR_HAL);
+            }
+            crc = 0;
+            batch_offset = offset + size;
+        } else {
+            crc = esb_config_crc32(crc, record, size);
+        }
+        offset += size;
+    }
+
+    if (batch_offset != offset) {
+        /* records without commit, the space behind the last commit may be partially programmed */
+        g_page_torn = 1;
+    }
+    g_write_offset = offset;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+esb_protocol_err_t esb_config_init(const esb_config_storage_t *p_storage)
+{
+    if ((p_storage == NULL) || (p_storage->read == NULL) || (p_storage->write == NULL) ||
+        (p_storage->erase == NULL) || (p_storage->page_count < 2) || ((p_storage->page_size % 4) != 0) ||
+        (p_storage->page_size > UINT16_MAX) ||
+        (p_storage->page_size <
+         (ESB_CONFIG_PAGE_HEADER_SIZE + ESB_CONFIG_RECORD_SIZE(ESB_CONFIG_MAX_VALUE_LEN) + ESB_CONFIG_COMMIT_SIZE))) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    gp_storage = p_storage;
+    memset(&g_stats, 0, sizeof(g_stats));
+    memset(&g_index, 0, sizeof(g_index));
+    esb_config_batch_clear();
+
+    uint8_t found = 0;
+    for (uint8_t page = 0; page < p_storage->page_count; page++) {
+        uint32_t header[2];
+        if (p_storage->read(p_storage, esb_config_page_address(page), header, sizeof(header)) != ESB_PROT_ERR_OK) {
+            gp_storage = NULL;
+            return (ESB_PROT_ERR_HAL);
+        }
+        if ((header[0] == ESB_CONFIG_PAGE_MAGIC) && ((found == 0) || ((int32_t)(header[1] - g_page_seq) > 0))) {
+            found = 1;
+            g_active_page = page;
+            g_page_seq = header[1];
+        }
+    }
+
+    esb_protocol_err_t result;
+    if (found == 0) {
+        /* empty storage: compaction of nothing formats the first page */
+        g_active_page = (uint8_t)(p_storage->page_count - 1);
+        g_page_seq = 0;
+        result = esb_config_compact();
+    } else {
+        result = esb_config_scan();
+        if ((result == ESB_PROT_ERR_OK) && (g_page_torn != 0)) {
+            result = esb_config_compact();
+        }
+    }
+
+    if (result != ESB_PROT_ERR_OK) {
+        gp_storage = NULL;
+    }
+    return (result);
+}
+
+esb_protocol_err_t esb_config_set(uint8_t key, const uint8_t *p_value, uint8_t length)
+{
+    if (gp_storage == NULL) {
+        return (ESB_PROT_ERR_INIT);
+    }
+    if ((key >= ESB_CONFIG_MAX_KEYS) || (length > ESB_CONFIG_MAX_VALUE_LEN) || ((p_value == NULL) && (length > 0))) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    uint8_t current[ESB_CONFIG_MAX_VALUE_LEN];
+    uint8_t current_len;
+    if ((esb_config_get(key, current, sizeof(current), &current_len) == ESB_PROT_ERR_OK) && (current_len == length) &&
+        ((length == 0) || (memcmp(current, p_value, length) == 0))) {
+        return (ESB_PROT_ERR_OK);
+    }
+
+    uint32_t size = ESB_CONFIG_RECORD_SIZE(length);
+    if ((g_batch_len + size + ESB_CONFIG_COMMIT_SIZE) > ESB_CONFIG_BATCH_SIZE) {
+        esb_protocol_err_t result = esb_config_commit();
+        if (result != ESB_PROT_ERR_OK) {
+            return (result);
+        }
+    }
+
+    if (g_batch_len == 0) {
+        g_batch_cycles = esb_time_cycles();
+    }
+    esb_config_record_build(&g_batch[g_batch_len], key, p_value, length);
+    g_batch_index.offset[key] = (uint16_t)(g_batch_len + ESB_CONFIG_RECORD_HEADER_SIZE);
+    g_batch_index.length[key] = length;
+    g_batch_len += size;
+    g_stats.value_bytes += length;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+esb_protocol_err_t esb_config_get(uint8_t key, uint8_t *p_value, uint8_t size, uint8_t *p_length)
+{
+    if (gp_storage == NULL) {
+        return (ESB_PROT_ERR_INIT);
+    }
+    if ((key >= ESB_CONFIG_MAX_KEYS) || (p_length == NULL) || ((p_value == NULL) && (size > 0))) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    const uint8_t *p_batch_value;
+    uint32_t page_offset;
+    uint8_t length;
+    if (esb_config_lookup(key, &p_batch_value, &page_offset, &length) == 0) {
+        return (ESB_PROT_ERR_VALUE);
+    }
+    if (length > size) {
+        return (ESB_PROT_ERR_MEM);
+    }
+
+    if (p_batch_value != NULL) {
+        memcpy(p_value, p_batch_value, length);
+    } else if ((length > 0) &&
+               (gp_storage->read(gp_storage, esb_config_page_address(g_active_page) + page_offset, p_value, length) !=
+                ESB_PROT_ERR_OK)) {
+        return (ESB_PROT_ERR_HAL);
+    }
+    *p_length = length;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+esb_protocol_err_t esb_config_commit(void)
+{
+    if (gp_storage == NULL) {
+        return (ESB_PROT_ERR_INIT);
+    }
+    if (g_batch_len == 0) {
+        return (ESB_PROT_ERR_OK);
+    }
+
+    esb_protocol_err_t result;
+    uint32_t size = g_batch_len + ESB_CONFIG_COMMIT_SIZE;
+
+    if ((g_page_torn != 0) || ((g_write_offset + size) > gp_storage->page_size)) {
+        result = esb_config_compact();
+    } else {
+        uint32_t crc = esb_config_crc32(0, g_batch, g_batch_len);
+        esb_config_record_build(&g_batch[g_batch_len], ESB_CONFIG_KEY_COMMIT, (const uint8_t *)&crc, sizeof(crc));
+
+        result = esb_config_write(g_active_page, g_write_offset, g_batch, size);
+        if (result == ESB_PROT_ERR_OK) {
+            for (uint8_t key = 0; key < ESB_CONFIG_MAX_KEYS; key++) {
+                if (g_batch_index.offset[key] != ESB_CONFIG_NO_OFFSET) {
+                    g_index.offset[key] = (uint16_t)(g_write_offset + g_batch_index.offset[key]);
+                    g_index.length[key] = g_batch_index.length[key];
+                }
+            }
+            g_write_offset += size;
+        } else {
+            /* the batch may be partially programmed, the next commit goes to a fresh page */
+            g_page_torn = 1;
+        }
+    }
+
+    if (result == ESB_PROT_ERR_OK) {
+        esb_config_batch_clear();
+        g_stats.commits++;
+    }
+    return (result);
+}
+
+esb_protocol_err_t esb_config_process(void)
+{
+    if ((gp_storage == NULL) || (g_batch_len == 0)) {
+        return (ESB_PROT_ERR_OK);
+    }
+    uint32_t elapsed_ms = esb_time_cycles_to_us(esb_time_cycles() - g_batch_cycles) / 1000;
+    if (elapsed_ms < ESB_CONFIG_COMMIT_DELAY_MS) {
+        esb_sched_request_wakeup((ESB_CONFIG_COMMIT_DELAY_MS - elapsed_ms) * 1000);
+        return (ESB_PROT_ERR_OK);
+    }
+    return (esb_config_commit());
+}
+
+void esb_config_get_stats(esb_config_stats_t *p_stats)
+{
+    if (p_stats != NULL) {
+        memcpy(p_stats, &g_stats, sizeof(*p_stats));
+    }
+}
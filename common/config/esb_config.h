@@ -0,0 +1,125 @@
+#ifndef ESB_CONFIG_H_
+#define ESB_CONFIG_H_
+
+/*!
+ * \file esb_config.h
+ * \brief Persistent key/value store for configuration items, behind ESB_CFG_SET_ITEM and ESB_CFG_GET_ITEM
+ * \details The store is log structured: items are appended to the active page of the storage (see
+ * esb_config_storage.h), a RAM index points to the latest record of each key, so reading an item is a single
+ * storage read. Items set with esb_config_set() are collected in a RAM batch and programmed together with one
+ * write by esb_config_commit(), so several ESB_CFG_SET_ITEM cost one flash program.
+ *
+ * A batch is only valid with its commit record, which holds a CRC of the batch. On esb_config_init() records
+ * after the last valid commit record (e.g. from a power loss while programming) are discarded. When the active
+ * page is full, the live items are copied to the next page (compaction). The page header with a sequence number
+ * is written last, so the old page stays valid until the copy is complete. The pages are used in turn, which
+ * spreads the erase cycles over the whole storage.
+ *
+ * Page layout:
+ * Bytes:   |   0:3    |  4:7  |   8 ...                                         |
+ * Value:   |  MAGIC   |  SEQ  | RECORD | RECORD | ... | COMMIT | RECORD | ...   |
+ *
+ * Record layout (padded with 0xFF to a multiple of 4 bytes):
+ * Bytes:   |  0  |  1  |  2   |   3   |  4 : 4+LEN-1 |
+ * Value:   | KEY | LEN | 0x00 | CHECK |    VALUE     |
+ *
+ * - KEY:   Key of the item, ESB_CONFIG_KEY_COMMIT for the commit record
+ * - CHECK: KEY ^ LEN ^ 0xA5
+ * - VALUE: Value of the item, CRC-32 of all records of the batch for the commit record
+ *
+ * All functions must be called from the main loop (same context as esb_protocol_process()).
+ */
+
+#include <common/config/esb_config_storage.h>
+#include <common/protocol/esb_protocol.h>
+#include <stdint.h>
+
+#ifndef ESB_CONFIG_MAX_KEYS
+#define ESB_CONFIG_MAX_KEYS 32 /* keys 0 to ESB_CONFIG_MAX_KEYS - 1 are valid */
+#endif
+
+#ifndef ESB_CONFIG_MAX_VALUE_LEN
+#define ESB_CONFIG_MAX_VALUE_LEN 24 /* max size of a value in bytes, ESB_CFG_SET_ITEM carries up to 24 bytes */
+#endif
+
+#ifndef ESB_CONFIG_BATCH_SIZE
+#define ESB_CONFIG_BATCH_SIZE 256 /* RAM for items not yet committed, in bytes */
+#endif
+
+#ifndef ESB_CONFIG_COMMIT_DELAY_MS
+#define ESB_CONFIG_COMMIT_DELAY_MS 100 /* esb_config_process() commits items set at least this long ago */
+#endif
+
+#define ESB_CONFIG_KEY_COMMIT 0xFF
+
+/*! \brief Counters of the configuration store, e.g. write amplification = programmed_bytes / value_bytes */
+typedef struct {
+    uint32_t value_bytes;      /* Bytes of values passed to esb_config_set() and not skipped as unchanged */
+    uint32_t programmed_bytes; /* Bytes written to the storage */
+    uint32_t commits;          /* Batches committed */
+    uint32_t compactions;      /* Live items copied to the next page */
+    uint32_t erases;           /* Pages erased */
+} esb_config_stats_t;
+
+/*! \brief Initialize the configuration store
+ *  \details Selects the page with the latest complete header, rebuilds the RAM index from the committed records
+ *           and compacts the page if it contains a torn batch. An empty storage is formatted.
+ *  \param p_storage[in]            Storage backend, must stay valid
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_PARAM      - NULL Pointer or unsupported page size/count
+ *  \retval ESB_PROT_ERR_HAL        - Storage error
+ *  \retval ESB_PROT_ERR_MEM        - Items of a torn page don't fit into a new page
+ */
+esb_protocol_err_t esb_config_init(const esb_config_storage_t *p_storage);
+
+/*! \brief Set a configuration item
+ *  \details The item is added to the batch of uncommitted items, it is returned by esb_config_get() right away and
+ *           programmed with the next esb_config_commit(). A full batch is committed first. Setting the current
+ *           value again doesn't write anything.
+ *  \param key[in]                  Key of the item (0 <= key < ESB_CONFIG_MAX_KEYS)
+ *  \param p_value[in]              Value
+ *  \param length[in]               Value length (0 to ESB_CONFIG_MAX_VALUE_LEN)
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_INIT       - Module not initialized
+ *  \retval ESB_PROT_ERR_PARAM      - Invalid key, length or NULL pointer
+ *  \retval ESB_PROT_ERR_HAL        - Storage error while committing a full batch
+ *  \retval ESB_PROT_ERR_MEM        - Items don't fit into one page
+ */
+esb_protocol_err_t esb_config_set(uint8_t key, const uint8_t *p_value, uint8_t length);
+
+/*! \brief Get a configuration item
+ *  \param key[in]                  Key of the item (0 <= key < ESB_CONFIG_MAX_KEYS)
+ *  \param p_value[out]             Buffer for the value
+ *  \param size[in]                 Size of the buffer
+ *  \param p_length[out]            Value length
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_INIT       - Module not initialized
+ *  \retval ESB_PROT_ERR_PARAM      - Invalid key or NULL pointer
+ *  \retval ESB_PROT_ERR_VALUE      - Item is not set
+ *  \retval ESB_PROT_ERR_MEM        - Buffer too small
+ *  \retval ESB_PROT_ERR_HAL        - Storage error
+ */
+esb_protocol_err_t esb_config_get(uint8_t key, uint8_t *p_value, uint8_t size, uint8_t *p_length);
+
+/*! \brief Program all items set since the last commit
+ *  \details The batch is written with one storage write, or copied to the next page together with the live
+ *           items if the active page is full
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_INIT       - Module not initialized
+ *  \retval ESB_PROT_ERR_HAL        - Storage error, the items stay in the batch
+ *  \retval ESB_PROT_ERR_MEM        - Items don't fit into one page
+ */
+esb_protocol_err_t esb_config_commit(void);
+
+/*! \brief Commit the batch when its oldest item is ESB_CONFIG_COMMIT_DELAY_MS old, call from the main loop
+ *  \details Requests a wakeup for the commit of a younger batch (see esb_sched.h)
+ *  \retval see esb_config_commit()
+ */
+esb_protocol_err_t esb_config_process(void);
+
+/*! \brief Get the counters of the configuration store since esb_config_init()
+ *  \param p_stats[out]     Buffer for the counters
+ */
+void esb_config_get_stats(esb_config_stats_t *p_stats);
+
+#endif /* ESB_CONFIG_H_ */
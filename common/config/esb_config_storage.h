@@ -0,0 +1,37 @@
+#ifndef ESB_CONFIG_STORAGE_H_
+#define ESB_CONFIG_STORAGE_H_
+
+/*!
+ * \file esb_config_storage.h
+ * \brief Storage backend interface of the configuration store (see esb_config.h)
+ * \details The storage is a range of page_count pages of page_size bytes with flash semantics: erasing a page
+ * sets all bytes to 0xFF, writing can only clear bits. Writes are word aligned (address and length are
+ * multiples of 4). Available backends:
+ * - esb_config_storage_ram.h: RAM buffer, for the host backend and tests
+ * - esb_config_storage_nvmc.h: internal flash of the nRF52 (target only)
+ */
+
+#include <common/protocol/esb_protocol.h>
+#include <stdint.h>
+
+#define ESB_CONFIG_STORAGE_ERASED_WORD 0xFFFFFFFFu
+
+typedef struct esb_config_storage_s esb_config_storage_t;
+
+struct esb_config_storage_s {
+    uint32_t page_size; /* Bytes per page, multiple of 4 */
+    uint8_t page_count; /* Number of pages, at least 2 */
+
+    /* Read length bytes at address (offset from the start of the storage) */
+    esb_protocol_err_t (*read)(const esb_config_storage_t *p_storage, uint32_t address, void *p_data,
+                               uint32_t length);
+    /* Program length bytes at address, both word aligned, returns when the data is programmed */
+    esb_protocol_err_t (*write)(const esb_config_storage_t *p_storage, uint32_t address, const void *p_data,
+                                uint32_t length);
+    /* Erase a page */
+    esb_protocol_err_t (*erase)(const esb_config_storage_t *p_storage, uint8_t page);
+
+    void *p_context; /* Backend specific data */
+};
+
+#endif /* ESB_CONFIG_STORAGE_H_ */
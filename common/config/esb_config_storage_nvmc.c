@@ -0,0 +1,61 @@
+#include <stddef.h>
+#include <string.h>
+
+#include <common/config/esb_config_storage_nvmc.h>
+
+#include "nrf_nvmc.h"
+
+static esb_protocol_err_t esb_config_storage_nvmc_read(const esb_config_storage_t *p_storage, uint32_t address,
+                                                       void *p_data, uint32_t length)
+{
+    uint32_t base_address = (uint32_t)p_storage->p_context;
+
+    /* flash is memory mapped */
+    memcpy(p_data, (const void *)(base_address + address), length);
+
+    return (ESB_PROT_ERR_OK);
+}
+
+static esb_protocol_err_t esb_config_storage_nvmc_write(const esb_config_storage_t *p_storage, uint32_t address,
+                                                        const void *p_data, uint32_t length)
+{
+    uint32_t base_address = (uint32_t)p_storage->p_context;
+
+    if (((address % 4) != 0) || ((length % 4) != 0) || (((uint32_t)p_data % 4) != 0)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    nrf_nvmc_write_words(base_address + address, (const uint32_t *)p_data, length / 4);
+
+    return (ESB_PROT_ERR_OK);
+}
+
+static esb_protocol_err_t esb_config_storage_nvmc_erase(const esb_config_storage_t *p_storage, uint8_t page)
+{
+    uint32_t base_address = (uint32_t)p_storage->p_context;
+
+    if (page >= p_storage->page_count) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    nrf_nvmc_page_erase(base_address + (page * p_storage->page_size));
+
+    return (ESB_PROT_ERR_OK);
+}
+
+esb_protocol_err_t esb_config_storage_nvmc_init(esb_config_storage_t *p_storage, uint32_t base_address,
+                                                uint8_t page_count)
+{
+    if ((p_storage == NULL) || ((base_address % ESB_CONFIG_STORAGE_NVMC_PAGE_SIZE) != 0) || (page_count < 2)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    p_storage->page_size = ESB_CONFIG_STORAGE_NVMC_PAGE_SIZE;
+    p_storage->page_count = page_count;
+    p_storage->read = esb_config_storage_nvmc_read;
+    p_storage->write = esb_config_storage_nvmc_write;
+    p_storage->erase = esb_config_storage_nvmc_erase;
+    p_storage->p_context = (void *)base_address;
+
+    return (ESB_PROT_ERR_OK);
+}
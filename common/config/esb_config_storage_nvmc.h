@@ -0,0 +1,26 @@
+#ifndef ESB_CONFIG_STORAGE_NVMC_H_
+#define ESB_CONFIG_STORAGE_NVMC_H_
+
+/*!
+ * \file esb_config_storage_nvmc.h
+ * \brief Internal flash of the nRF52 as storage for the configuration store (target only)
+ * \details Pages are programmed and erased with the NVMC (nrf_nvmc.c of the SDK must be part of the
+ * application). The CPU is halted while the flash is busy, up to 85ms for a page erase, so frames received in
+ * the meantime are lost. The pages must be reserved for the store, e.g. in the linker script.
+ */
+
+#include <common/config/esb_config_storage.h>
+
+#define ESB_CONFIG_STORAGE_NVMC_PAGE_SIZE 4096
+
+/*! \brief Set up the flash storage
+ *  \param p_storage[out]       Storage handle for esb_config_init()
+ *  \param base_address[in]     Address of the first page, page aligned
+ *  \param page_count[in]       Number of pages, at least 2
+ *  \retval ESB_PROT_ERR_OK     - OK
+ *  \retval ESB_PROT_ERR_PARAM  - NULL Pointer, unaligned address or invalid page count
+ */
+esb_protocol_err_t esb_config_storage_nvmc_init(esb_config_storage_t *p_storage, uint32_t base_address,
+                                                uint8_t page_count);
+
+#endif /* ESB_CONFIG_STORAGE_NVMC_H_ */
@@ -0,0 +1,115 @@
+#include <stddef.h>
+#include <string.h>
+
+#include <common/config/esb_config_storage_ram.h>
+
+static esb_protocol_err_t esb_config_storage_ram_check(const esb_config_storage_t *p_storage, uint32_t address,
+                                                       uint32_t length)
+{
+    uint32_t size = p_storage->page_size * p_storage->page_count;
+
+    if ((address > size) || (length > (size - address))) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+    return (ESB_PROT_ERR_OK);
+}
+
+/* limit an operation to the bytes left before the simulated power loss, returns the bytes to execute */
+static uint32_t esb_config_storage_ram_budget(esb_config_storage_ram_t *p_ram, uint32_t length)
+{
+    if (p_ram->fail_after == 0) {
+        return (length);
+    }
+    if (p_ram->fail_after == 1) {
+        /* power is already lost */
+        return (0);
+    }
+
+    uint32_t budget = p_ram->fail_after - 1;
+    if (length >= budget) {
+        p_ram->fail_after = 1;
+        return (budget);
+    }
+    p_ram->fail_after -= length;
+
+    return (length);
+}
+
+static esb_protocol_err_t esb_config_storage_ram_read(const esb_config_storage_t *p_storage, uint32_t address,
+                                                      void *p_data, uint32_t length)
+{
+    esb_config_storage_ram_t *p_ram = (esb_config_storage_ram_t *)p_storage->p_context;
+
+    if (esb_config_storage_ram_check(p_storage, address, length) != ESB_PROT_ERR_OK) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+    memcpy(p_data, &(p_ram->p_memory[address]), length);
+
+    return (ESB_PROT_ERR_OK);
+}
+
+static esb_protocol_err_t esb_config_storage_ram_write(const esb_config_storage_t *p_storage, uint32_t address,
+                                                       const void *p_data, uint32_t length)
+{
+    esb_config_storage_ram_t *p_ram = (esb_config_storage_ram_t *)p_storage->p_context;
+    const uint8_t *p_bytes = (const uint8_t *)p_data;
+
+    if ((esb_config_storage_ram_check(p_storage, address, length) != ESB_PROT_ERR_OK) || ((address % 4) != 0) ||
+        ((length % 4) != 0)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+        if ((p_bytes[i] & ~p_ram->p_memory[address + i]) != 0) {
+            /* flash can only clear bits */
+            return (ESB_PROT_ERR_VALUE);
+        }
+    }
+
+    uint32_t budget = esb_config_storage_ram_budget(p_ram, length);
+    for (uint32_t i = 0; i < budget; i++) {
+        p_ram->p_memory[address + i] = p_bytes[i];
+    }
+    p_ram->programmed_bytes += budget;
+
+    return ((budget == length) ? ESB_PROT_ERR_OK : ESB_PROT_ERR_HAL);
+}
+
+static esb_protocol_err_t esb_config_storage_ram_erase(const esb_config_storage_t *p_storage, uint8_t page)
+{
+    esb_config_storage_ram_t *p_ram = (esb_config_storage_ram_t *)p_storage->p_context;
+
+    if (page >= p_storage->page_count) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+    if (esb_config_storage_ram_budget(p_ram, 1) == 0) {
+        return (ESB_PROT_ERR_HAL);
+    }
+
+    memset(&(p_ram->p_memory[page * p_storage->page_size]), 0xFF, p_storage->page_size);
+    p_ram->erase_count++;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+esb_protocol_err_t esb_config_storage_ram_init(esb_config_storage_t *p_storage, esb_config_storage_ram_t *p_ram,
+                                               uint8_t *p_memory, uint32_t page_size, uint8_t page_count)
+{
+    if ((p_storage == NULL) || (p_ram == NULL) || (p_memory == NULL) || (page_size == 0) || ((page_size % 4) != 0) ||
+        (page_count < 2)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    memset(p_ram, 0, sizeof(*p_ram));
+    p_ram->p_memory = p_memory;
+    memset(p_memory, 0xFF, page_size * page_count);
+
+    p_storage->page_size = page_size;
+    p_storage->page_count = page_count;
+    p_storage->read = esb_config_storage_ram_read;
+    p_storage->write = esb_config_storage_ram_write;
+    p_storage->erase = esb_config_storage_ram_erase;
+    p_storage->p_context = p_ram;
+
+    return (ESB_PROT_ERR_OK);
+}
@@ -0,0 +1,36 @@
+#ifndef ESB_CONFIG_STORAGE_RAM_H_
+#define ESB_CONFIG_STORAGE_RAM_H_
+
+/*!
+ * \file esb_config_storage_ram.h
+ * \brief RAM backed storage for the configuration store, stand-in for the flash on the host
+ * \details The backend enforces flash semantics (writes can only clear bits) and counts the programmed
+ * bytes and erased pages, e.g. to measure the write amplification. A power loss can be simulated by
+ * limiting the number of bytes that are still programmed (fail_after).
+ */
+
+#include <common/config/esb_config_storage.h>
+
+/*! \brief State of a RAM storage */
+typedef struct {
+    uint8_t *p_memory;         /* page_size * page_count bytes */
+    uint32_t programmed_bytes; /* Number of bytes written */
+    uint32_t erase_count;      /* Number of erased pages */
+    uint32_t fail_after;       /* 0: disabled, otherwise only this many more bytes are programmed, then all
+                                  writes and erases fail (simulated power loss) */
+} esb_config_storage_ram_t;
+
+/*! \brief Set up a RAM storage
+ *  \details The memory is erased (set to 0xFF)
+ *  \param p_storage[out]       Storage handle for esb_config_init()
+ *  \param p_ram[in]            State of the storage, must stay valid
+ *  \param p_memory[in]         Memory of page_size * page_count bytes, must stay valid
+ *  \param page_size[in]        Bytes per page, multiple of 4
+ *  \param page_count[in]       Number of pages, at least 2
+ *  \retval ESB_PROT_ERR_OK     - OK
+ *  \retval ESB_PROT_ERR_PARAM  - NULL Pointer or invalid size
+ */
+esb_protocol_err_t esb_config_storage_ram_init(esb_config_storage_t *p_storage, esb_config_storage_ram_t *p_ram,
+                                               uint8_t *p_memory, uint32_t page_size, uint8_t page_count);
+
+#endif /* ESB_CONFIG_STORAGE_RAM_H_ */
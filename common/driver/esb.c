@@ -1,14 +1,17 @@
 #include <string.h>
+#include "app_util_platform.h"
 #include "nrf_esb.h"
 #include "nrf_error.h"
 
 #include <common/driver/esb.h>
+#include <common/driver/esb_link.h>
+#include <common/driver/esb_time.h>
+#include <common/sched/esb_sched.h>
+#include <common/trace/esb_trace.h>
 
 #define ESB_CHECK_PIPE_PARAM(pipe)    do{if(pipe>=ESB_PIPE_NUM){return(ESB_ERR_PARAM);}}while(0)
 #define ESB_CHECK_NULL_PARAM(param)   do{if(param==NULL){return(ESB_ERR_PARAM);}}while(0)
 
-#define ESB_DEFAULT_CHANNEL 40
-
 static nrf_esb_payload_t        rx_payload;
 static nrf_esb_payload_t        tx_payload;
 
@@ -17,76 +20,226 @@ static volatile uint8_t rx_payload_available = 0;
 static nrf_esb_config_t g_nrf_esb_config = NRF_ESB_DEFAULT_CONFIG;
 
 static volatile uint8_t g_initialized = 0;
-static volatile uint8_t g_tx_busy = 0;
+
+/* completion info of the frames in flight, in the same order as in the radio TX FIFO */
+typedef struct {
+    esb_tx_callback_t callback;
+    void *p_context;
+    uint8_t link; /* destination, see esb_link.h */
+} esb_tx_slot_t;
+
+static esb_tx_slot_t g_tx_slots[ESB_TX_INFLIGHT_MAX];
+static volatile uint8_t g_tx_head = 0;
+static volatile uint8_t g_tx_count = 0;
+
+/* pipelines whose address changed since it was last programmed to the radio */
+static volatile uint8_t g_pipe_addr_changed = 0;
+
+/* radio mode state machine
+ * g_nrf_esb_config.mode holds the mode the radio is initialized in, g_radio_started tells if it is
+ * receiving (PRX) or ready to send (PTX). g_radio_addr caches the programmed pipeline addresses, which
+ * are only valid until the next nrf_esb_init() */
+static volatile uint8_t g_radio_started = 0;
+static uint8_t g_radio_addr_valid = 0;
+static uint8_t g_radio_addr[ESB_PIPE_NUM][5];
+
+/* set while a TX burst is open, the radio stays in PTX mode between the frames of the burst */
+static volatile uint8_t g_tx_burst = 0;
+
+static uint8_t g_rf_channel = ESB_DEFAULT_CHANNEL;
+static esb_bitrate_t g_bitrate = ESB_BITRATE_1MBPS;
+static int8_t g_tx_power = ESB_DEFAULT_TX_POWER;
+
+static esb_mode_switch_stats_t g_switch_stats = {0};
 
 static esb_listener_callback_t g_listener_callbacks[ESB_PIPE_NUM] = {NULL, NULL};
+static esb_listener_callback_t g_ack_payload_callback = NULL;
 
 static uint8_t g_pipe_addr[ESB_PIPE_NUM][5] = {
                         {0xC2, 0xC2, 0xC2, 0xC2, 0x01}, 
                         {0xE7, 0xE7, 0xE7, 0xE7, 0xE7}};
 
-static int8_t esb_reinit(nrf_esb_mode_t esb_mode);
+static int8_t esb_radio_switch(nrf_esb_mode_t esb_mode);
+
+/* apply the retransmit settings for the next frame to a destination, the radio must be idle
+ * the settings are kept in g_nrf_esb_config, so they survive the nrf_esb_init() of a mode switch */
+static int8_t esb_radio_apply_link(uint8_t link)
+{
+    uint16_t delay_us;
+    uint16_t count;
+
+    esb_link_get_params(link, &delay_us, &count);
+    if(delay_us != g_nrf_esb_config.retransmit_delay){
+        if(nrf_esb_set_retransmit_delay(delay_us) != NRF_SUCCESS){
+            return (ESB_ERR_HAL);
+        }
+        g_nrf_esb_config.retransmit_delay = delay_us;
+    }
+    if(count != g_nrf_esb_config.retransmit_count){
+        if(nrf_esb_set_retransmit_count(count) != NRF_SUCCESS){
+            return (ESB_ERR_HAL);
+        }
+        g_nrf_esb_config.retransmit_count = count;
+    }
+
+    return (ESB_ERR_OK);
+}
+
+/* called from the radio interrupt for every completed frame */
+static void esb_tx_complete(esb_tx_status_t status, uint32_t attempts)
+{
+    ESB_TRACE(ESB_TRACE_EVT_TX_DONE, status);
+
+    if(g_tx_count == 0){
+        return;
+    }
+
+    esb_tx_slot_t slot = g_tx_slots[g_tx_head];
+    g_tx_head = (g_tx_head + 1) % ESB_TX_INFLIGHT_MAX;
+    g_tx_count--;
+    esb_link_update(slot.link, (status == ESB_TX_SUCCESS) ? 1 : 0, attempts);
+
+    if((g_tx_count == 0) && (g_tx_burst == 0)){
+        /* last frame in flight, go back to listening */
+        esb_radio_switch(NRF_ESB_MODE_PRX);
+    }
+
+    if(slot.callback != NULL){
+        esb_tx_result_t result = {.status = status, .attempts = attempts};
+        slot.callback(&result, slot.p_context);
+    }
+}
+
+/* called from the radio interrupt, hands the received payloads to their callbacks
+ * In PTX mode the payloads are ACK payloads of the frames sent, they go to the ACK payload callback. */
+static void esb_rx_drain(void)
+{
+    while (nrf_esb_read_rx_payload(&rx_payload) == NRF_SUCCESS){
+        if (rx_payload.length > 0){
+            if(g_nrf_esb_config.mode == NRF_ESB_MODE_PTX){
+                if(g_ack_payload_callback != NULL){
+                    g_ack_payload_callback(rx_payload.data, rx_payload.length);
+                }
+            }else if(rx_payload.pipe < ESB_PIPE_NUM){
+                if(g_listener_callbacks[rx_payload.pipe] != NULL){
+                    g_listener_callbacks[rx_payload.pipe](rx_payload.data, rx_payload.length);
+                }
+            }
+        }
+    }
+    nrf_esb_flush_rx();
+}
 
 static void nrf_esb_event_handler(nrf_esb_evt_t const * p_event)
 {
+    ESB_TRACE(ESB_TRACE_EVT_RADIO_IRQ, p_event->evt_id);
+
     switch (p_event->evt_id){
         case NRF_ESB_EVENT_TX_SUCCESS:
-            g_tx_busy = 0;
-            nrf_esb_flush_tx();
-            esb_reinit(NRF_ESB_MODE_PRX);
+            if(g_nrf_esb_config.mode == NRF_ESB_MODE_PTX){
+                /* an ACK payload arrives with the TX success, read it before the switch back to PRX resets the FIFOs */
+                esb_rx_drain();
+            }
+            esb_tx_complete(ESB_TX_SUCCESS, p_event->tx_attempts);
+            esb_sched_signal(ESB_SCHED_EVT_TX_DONE);
             break;
         case NRF_ESB_EVENT_TX_FAILED:
-            g_tx_busy = 0;
-            (void) nrf_esb_flush_tx();
-            (void) nrf_esb_start_tx();
+            /* the failed frame is still in the FIFO, drop it and continue with the next one */
+            (void) nrf_esb_pop_tx();
+            if(g_tx_count > 1){
+                /* the radio is idle, the next frame gets the settings (and a new backoff) of its destination */
+                (void) esb_radio_apply_link(g_tx_slots[(g_tx_head + 1) % ESB_TX_INFLIGHT_MAX].link);
+                (void) nrf_esb_start_tx();
+            }
+            esb_tx_complete(ESB_TX_FAILED, p_event->tx_attempts);
+            esb_sched_signal(ESB_SCHED_EVT_TX_DONE);
             break;
         case NRF_ESB_EVENT_RX_RECEIVED:
-            memset(&rx_payload, 0, sizeof(nrf_esb_payload_t));
-            while (nrf_esb_read_rx_payload(&rx_payload) == NRF_SUCCESS){
-                if (rx_payload.length > 0){
-                    if(rx_payload.pipe < ESB_PIPE_NUM){
-                        if(g_listener_callbacks[rx_payload.pipe] != NULL){
-                            g_listener_callbacks[rx_payload.pipe](rx_payload.data, rx_payload.length);
-                        }
-                        
-                    }
-                }
-            }
-            nrf_esb_flush_rx();
+            esb_rx_drain();
+            esb_sched_signal(ESB_SCHED_EVT_RX);
             break;
     }
 }
 
-static int8_t esb_reinit(nrf_esb_mode_t esb_mode)
+/* program the pipeline addresses which differ from the ones in the radio */
+static int8_t esb_radio_program_addresses(void)
 {
-    nrf_esb_stop_rx();
-    nrf_esb_disable();
-    g_nrf_esb_config.mode = esb_mode;
-    nrf_esb_init(&g_nrf_esb_config);
+    if(((g_radio_addr_valid & (1 << ESB_PIPE_0)) == 0) || (memcmp(g_radio_addr[ESB_PIPE_0], g_pipe_addr[ESB_PIPE_0], 4) != 0)){
+        if(nrf_esb_set_base_address_0(g_pipe_addr[ESB_PIPE_0]) != NRF_SUCCESS){
+            return (ESB_ERR_HAL);
+        }
+    }
 
-    /* set pipeline addresses again because they are reset in nrf_esb_init() */
-    uint8_t addr_prefix[2] = {g_pipe_addr[ESB_PIPE_0][4], g_pipe_addr[ESB_PIPE_1][4]};
-    if(nrf_esb_set_address_length(5) != NRF_SUCCESS){
-        return (ESB_ERR_HAL);
+    if(((g_radio_addr_valid & (1 << ESB_PIPE_1)) == 0) || (memcmp(g_radio_addr[ESB_PIPE_1], g_pipe_addr[ESB_PIPE_1], 4) != 0)){
+        if(nrf_esb_set_base_address_1(g_pipe_addr[ESB_PIPE_1]) != NRF_SUCCESS){
+            return (ESB_ERR_HAL);
+        }
     }
 
-    if(nrf_esb_set_base_address_0(g_pipe_addr[ESB_PIPE_0]) != NRF_SUCCESS){
-        return (ESB_ERR_HAL);
+    if((g_radio_addr_valid != ((1 << ESB_PIPE_0) | (1 << ESB_PIPE_1))) ||
+       (g_radio_addr[ESB_PIPE_0][4] != g_pipe_addr[ESB_PIPE_0][4]) ||
+       (g_radio_addr[ESB_PIPE_1][4] != g_pipe_addr[ESB_PIPE_1][4])){
+        uint8_t addr_prefix[2] = {g_pipe_addr[ESB_PIPE_0][4], g_pipe_addr[ESB_PIPE_1][4]};
+        if(nrf_esb_set_prefixes(addr_prefix, 2) != NRF_SUCCESS){
+            return (ESB_ERR_HAL);
+        }
     }
 
-    if(nrf_esb_set_base_address_1(g_pipe_addr[ESB_PIPE_1]) != NRF_SUCCESS){
-        return (ESB_ERR_HAL);
+    memcpy(g_radio_addr, g_pipe_addr, sizeof(g_radio_addr));
+    g_radio_addr_valid = (1 << ESB_PIPE_0) | (1 << ESB_PIPE_1);
+    g_pipe_addr_changed = 0;
+
+    return (ESB_ERR_OK);
+}
+
+/* switch the radio to PTX or PRX mode
+ * Does nothing if the radio already runs in this mode with the current addresses. Changing the mode
+ * requires nrf_esb_init(), which resets the address registers, the address length and the RF channel
+ * are kept. In the same mode only the changed addresses are reprogrammed. */
+static int8_t esb_radio_switch(nrf_esb_mode_t esb_mode)
+{
+    if((g_nrf_esb_config.mode == esb_mode) && (g_radio_started == 1) && (g_pipe_addr_changed == 0)){
+        g_switch_stats.skipped++;
+        return (ESB_ERR_OK);
     }
 
-    if(nrf_esb_set_prefixes(addr_prefix, 2) != NRF_SUCCESS){
-        return (ESB_ERR_HAL);
+    uint32_t start = esb_time_cycles();
+
+    if(g_nrf_esb_config.mode != esb_mode){
+        /* nrf_esb_init() disables the radio itself */
+        g_nrf_esb_config.mode = esb_mode;
+        g_radio_started = 0;
+        if(nrf_esb_init(&g_nrf_esb_config) != NRF_SUCCESS){
+            return (ESB_ERR_HAL);
+        }
+        g_radio_addr_valid = 0;
+    }else if((g_radio_started == 1) && (esb_mode == NRF_ESB_MODE_PRX)){
+        /* addresses can only be changed while the radio is idle */
+        nrf_esb_stop_rx();
+        g_radio_started = 0;
+    }
+
+    int8_t result = esb_radio_program_addresses();
+    if(result != ESB_ERR_OK){
+        return (result);
     }
 
-    if(esb_mode == NRF_ESB_MODE_PTX){
-        nrf_esb_start_tx();
-    }else if (esb_mode == NRF_ESB_MODE_PRX){
-        nrf_esb_start_rx();
+    if(esb_mode == NRF_ESB_MODE_PRX){
+        if(nrf_esb_start_rx() != NRF_SUCCESS){
+            return (ESB_ERR_HAL);
+        }
+    }
+    /* in PTX mode the transmission starts automatically with nrf_esb_write_payload() */
+    g_radio_started = 1;
+
+    uint32_t duration_us = esb_time_cycles_to_us(esb_time_cycles() - start);
+    g_switch_stats.count++;
+    g_switch_stats.last_us = duration_us;
+    g_switch_stats.total_us += duration_us;
+    if(duration_us > g_switch_stats.max_us){
+        g_switch_stats.max_us = duration_us;
     }
+
     return (ESB_ERR_OK);
 }
     
@@ -97,9 +250,9 @@ int8_t esb_init(void)
     g_nrf_esb_config.event_handler            = nrf_esb_event_handler;
     g_nrf_esb_config.bitrate                  = NRF_ESB_BITRATE_1MBPS;
     g_nrf_esb_config.crc                      = NRF_ESB_CRC_16BIT;
-    g_nrf_esb_config.tx_output_power          = NRF_ESB_TX_POWER_4DBM;
-    g_nrf_esb_config.retransmit_delay         = 600;
-    g_nrf_esb_config.retransmit_count         = 10;
+    g_nrf_esb_config.tx_output_power          = (nrf_esb_tx_power_t)ESB_DEFAULT_TX_POWER;
+    g_nrf_esb_config.retransmit_delay         = ESB_LINK_DELAY_MIN_US;
+    g_nrf_esb_config.retransmit_count         = ESB_LINK_COUNT_DEFAULT;
     g_nrf_esb_config.tx_mode                  = NRF_ESB_TXMODE_AUTO;
     g_nrf_esb_config.selective_auto_ack       = false;
 
@@ -110,7 +263,23 @@ int8_t esb_init(void)
     if(nrf_esb_set_rf_channel(ESB_DEFAULT_CHANNEL) != NRF_SUCCESS){
         return (ESB_ERR_HAL);
     }
+    g_rf_channel = ESB_DEFAULT_CHANNEL;
+    g_bitrate = ESB_BITRATE_1MBPS;
+    g_tx_power = ESB_DEFAULT_TX_POWER;
+
+    /* the address length is kept by nrf_esb_init(), it is only set once */
+    if(nrf_esb_set_address_length(5) != NRF_SUCCESS){
+        return (ESB_ERR_HAL);
+    }
 
+    esb_time_init();
+    esb_link_init();
+    g_radio_started = 0;
+    g_radio_addr_valid = 0;
+    /* nrf_esb_init() emptied the TX FIFO, frames still in flight from before are gone without completion */
+    g_tx_head = 0;
+    g_tx_count = 0;
+    g_tx_burst = 0;
     g_initialized = 1;
     return (ESB_ERR_OK);
 }
@@ -120,7 +289,12 @@ int8_t esb_set_pipeline_address(const esb_pipeline_t pipeline, const uint8_t add
     ESB_CHECK_PIPE_PARAM(pipeline);
     ESB_CHECK_NULL_PARAM(addr);
 
-    memcpy(g_pipe_addr[pipeline], addr, 5);
+    if(memcmp(g_pipe_addr[pipeline], addr, 5) != 0){
+        CRITICAL_REGION_ENTER();
+        memcpy(g_pipe_addr[pipeline], addr, 5);
+        g_pipe_addr_changed |= (1 << pipeline);
+        CRITICAL_REGION_EXIT();
+    }
 
     return (ESB_ERR_OK);
 }
@@ -132,7 +306,15 @@ int8_t esb_start_listening(const esb_pipeline_t pipeline, esb_listener_callback_
     
     g_listener_callbacks[pipeline] = listener_callback;
 
-    return (esb_reinit(NRF_ESB_MODE_PRX));
+    int8_t result = ESB_ERR_OK;
+    CRITICAL_REGION_ENTER();
+    if(g_tx_count == 0){
+        /* otherwise the radio switches to PRX when the last frame in flight is completed */
+        result = esb_radio_switch(NRF_ESB_MODE_PRX);
+    }
+    CRITICAL_REGION_EXIT();
+
+    return (result);
 
 }
 
@@ -146,6 +328,7 @@ int8_t esb_stop_listening(const esb_pipeline_t pipeline)
         if(nrf_esb_stop_rx() != NRF_SUCCESS){
             return (ESB_ERR_HAL);
         }
+        g_radio_started = 0;
     }
 
     return (ESB_ERR_OK);   
@@ -153,35 +336,300 @@ int8_t esb_stop_listening(const esb_pipeline_t pipeline)
 
 int8_t esb_set_rf_channel(const uint8_t channel)
 {
-    if(nrf_esb_set_rf_channel(channel) != NRF_SUCCESS){
-        return (ESB_ERR_HAL);
+    int8_t result = ESB_ERR_OK;
+
+    CRITICAL_REGION_ENTER();
+    if(g_tx_count > 0){
+        /* the frames in flight are sent on the current channel */
+        result = ESB_ERR_BUSY;
+    }else{
+        /* the channel can only be changed while the radio is idle */
+        uint8_t restart_rx = (g_radio_started == 1) && (g_nrf_esb_config.mode == NRF_ESB_MODE_PRX);
+        if(restart_rx == 1){
+            nrf_esb_stop_rx();
+            g_radio_started = 0;
+        }
+
+        if(nrf_esb_set_rf_channel(channel) != NRF_SUCCESS){
+            result = ESB_ERR_HAL;
+        }else{
+            g_rf_channel = channel;
+        }
+
+        if(restart_rx == 1){
+            if(nrf_esb_start_rx() != NRF_SUCCESS){
+                result = ESB_ERR_HAL;
+            }else{
+                g_radio_started = 1;
+            }
+        }
     }
+    CRITICAL_REGION_EXIT();
 
-    return (ESB_ERR_OK);
+    return (result);
 }
 
+uint8_t esb_get_rf_channel(void)
+{
+    return (g_rf_channel);
+}
 
-int8_t esb_send_packet(const esb_pipeline_t pipeline, const uint8_t *payload, uint8_t payload_length)
+int8_t esb_set_phy(const esb_bitrate_t bitrate, const int8_t tx_power)
+{
+    int8_t result = ESB_ERR_OK;
+
+    switch(tx_power){
+        case 4: case 0: case -4: case -8: case -12: case -16: case -20: case -40:
+            break;
+        default:
+            return (ESB_ERR_PARAM);
+    }
+    if(bitrate >= ESB_BITRATE_NUM){
+        return (ESB_ERR_PARAM);
+    }
+
+    nrf_esb_bitrate_t nrf_bitrate = (bitrate == ESB_BITRATE_2MBPS) ? NRF_ESB_BITRATE_2MBPS : NRF_ESB_BITRATE_1MBPS;
+
+    CRITICAL_REGION_ENTER();
+    if(g_tx_count > 0){
+        /* the frames in flight are sent with the current settings */
+        result = ESB_ERR_BUSY;
+    }else{
+        /* like the channel, bitrate and TX power can only be changed while the radio is idle */
+        uint8_t restart_rx = (g_radio_started == 1) && (g_nrf_esb_config.mode == NRF_ESB_MODE_PRX);
+        if(restart_rx == 1){
+            nrf_esb_stop_rx();
+            g_radio_started = 0;
+        }
+
+        if((nrf_esb_set_bitrate(nrf_bitrate) != NRF_SUCCESS) ||
+           (nrf_esb_set_tx_power((nrf_esb_tx_power_t)tx_power) != NRF_SUCCESS)){
+            result = ESB_ERR_HAL;
+        }else{
+            /* kept for the nrf_esb_init() of the next mode switch */
+            g_nrf_esb_config.bitrate = nrf_bitrate;
+            g_nrf_esb_config.tx_output_power = (nrf_esb_tx_power_t)tx_power;
+            g_bitrate = bitrate;
+            g_tx_power = tx_power;
+        }
+
+        if(restart_rx == 1){
+            if(nrf_esb_start_rx() != NRF_SUCCESS){
+                result = ESB_ERR_HAL;
+            }else{
+                g_radio_started = 1;
+            }
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    return (result);
+}
+
+void esb_get_phy(esb_bitrate_t *p_bitrate, int8_t *p_tx_power)
+{
+    if(p_bitrate != NULL){
+        *p_bitrate = g_bitrate;
+    }
+    if(p_tx_power != NULL){
+        *p_tx_power = g_tx_power;
+    }
+}
+
+
+int8_t esb_send_packet_async(const esb_pipeline_t pipeline, const uint8_t *payload, uint8_t payload_length,
+                             esb_tx_callback_t callback, void *p_context)
 {
     ESB_CHECK_PIPE_PARAM(pipeline);
     ESB_CHECK_NULL_PARAM(payload);
-    
+
     if(g_initialized != 1){
         return (ESB_ERR_INIT);
     }
-    
-    while(g_tx_busy==1); /* wait until radio is ready */
-    esb_reinit(NRF_ESB_MODE_PTX);
-    memcpy(tx_payload.data, payload, payload_length);
-    tx_payload.length = payload_length;
-    tx_payload.pipe = pipeline;
-    if(nrf_esb_write_payload(&tx_payload) == NRF_SUCCESS){
-        g_tx_busy = 1;  
+
+    if((payload_length == 0) || (payload_length > NRF_ESB_MAX_PAYLOAD_LENGTH)){
+        return (ESB_ERR_SIZE);
+    }
+
+    int8_t result = ESB_ERR_OK;
+
+    CRITICAL_REGION_ENTER();
+    if(g_tx_count >= ESB_TX_INFLIGHT_MAX){
+        result = ESB_ERR_BUSY;
+    }else if((g_tx_count > 0) && (g_pipe_addr_changed & (1 << pipeline))){
+        /* the new address can only be programmed when the radio is idle */
+        result = ESB_ERR_BUSY;
     }else{
-        return (ESB_ERR_HAL);
+        uint8_t link = esb_link_lookup(g_pipe_addr[pipeline]);
+
+        if(g_tx_count == 0){
+            result = esb_radio_switch(NRF_ESB_MODE_PTX);
+            if(result == ESB_ERR_OK){
+                result = esb_radio_apply_link(link);
+            }
+        }else if(link != g_tx_slots[g_tx_head].link){
+            /* the retransmit settings can only be changed while the radio is idle, all frames in flight go to
+             * the same destination */
+            result = ESB_ERR_BUSY;
+        }
+
+        if(result == ESB_ERR_OK){
+            /* register the completion before writing, the TX event may fire before nrf_esb_write_payload() returns */
+            uint8_t slot_idx = (g_tx_head + g_tx_count) % ESB_TX_INFLIGHT_MAX;
+            g_tx_slots[slot_idx].callback = callback;
+            g_tx_slots[slot_idx].p_context = p_context;
+            g_tx_slots[slot_idx].link = link;
+            g_tx_count++;
+
+            memcpy(tx_payload.data, payload, payload_length);
+            tx_payload.length = payload_length;
+            tx_payload.pipe = pipeline;
+            if(nrf_esb_write_payload(&tx_payload) != NRF_SUCCESS){
+                g_tx_count--;
+                if(g_tx_count == 0){
+                    esb_radio_switch(NRF_ESB_MODE_PRX);
+                }
+                result = ESB_ERR_HAL;
+            }else{
+                /* only frames in the FIFO are traced, every TX start gets its TX done. Still in the critical
+                 * region, so the TX done of this frame can't be recorded first */
+                ESB_TRACE(ESB_TRACE_EVT_TX_START, pipeline);
+            }
+        }
     }
-    
-    while(g_tx_busy==1); /* wait until radio is ready */
-    
-    return (ESB_ERR_OK);
+    CRITICAL_REGION_EXIT();
+
+    return (result);
+}
+
+int8_t esb_write_ack_payload(const esb_pipeline_t pipeline, const uint8_t *payload, uint8_t payload_length)
+{
+    ESB_CHECK_PIPE_PARAM(pipeline);
+    ESB_CHECK_NULL_PARAM(payload);
+
+    if(g_initialized != 1){
+        return (ESB_ERR_INIT);
+    }
+
+    if((payload_length == 0) || (payload_length > NRF_ESB_MAX_PAYLOAD_LENGTH)){
+        return (ESB_ERR_SIZE);
+    }
+
+    int8_t result = ESB_ERR_OK;
+
+    CRITICAL_REGION_ENTER();
+    if(g_tx_count > 0){
+        /* in PTX mode the payload would be sent as a frame, wait for the switch back to PRX */
+        result = ESB_ERR_BUSY;
+    }else if((g_nrf_esb_config.mode != NRF_ESB_MODE_PRX) || (g_radio_started == 0)){
+        result = ESB_ERR_INIT;
+    }else{
+        memcpy(tx_payload.data, payload, payload_length);
+        tx_payload.length = payload_length;
+        tx_payload.pipe = pipeline;
+        uint32_t err_code = nrf_esb_write_payload(&tx_payload);
+        if(err_code == NRF_ERROR_NO_MEM){
+            result = ESB_ERR_BUSY;
+        }else if(err_code != NRF_SUCCESS){
+            result = ESB_ERR_HAL;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    return (result);
+}
+
+int8_t esb_flush_ack_payloads(void)
+{
+    if(g_initialized != 1){
+        return (ESB_ERR_INIT);
+    }
+
+    int8_t result = ESB_ERR_OK;
+
+    CRITICAL_REGION_ENTER();
+    /* with frames in flight the FIFO holds frames, the ACK payloads were already discarded by the switch to PTX */
+    if((g_tx_count == 0) && (g_nrf_esb_config.mode == NRF_ESB_MODE_PRX)){
+        if(nrf_esb_flush_tx() != NRF_SUCCESS){
+            result = ESB_ERR_HAL;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    return (result);
+}
+
+void esb_set_ack_payload_callback(esb_listener_callback_t ack_payload_callback)
+{
+    g_ack_payload_callback = ack_payload_callback;
+}
+
+uint8_t esb_tx_pending(void)
+{
+    return (g_tx_count);
+}
+
+void esb_tx_burst_begin(void)
+{
+    g_tx_burst = 1;
+}
+
+int8_t esb_tx_burst_end(void)
+{
+    int8_t result = ESB_ERR_OK;
+
+    CRITICAL_REGION_ENTER();
+    g_tx_burst = 0;
+    if((g_tx_count == 0) && (g_nrf_esb_config.mode == NRF_ESB_MODE_PTX)){
+        /* otherwise the radio switches to PRX when the last frame in flight is completed */
+        result = esb_radio_switch(NRF_ESB_MODE_PRX);
+    }
+    CRITICAL_REGION_EXIT();
+
+    return (result);
+}
+
+typedef struct {
+    volatile uint8_t done;
+    volatile esb_tx_status_t status;
+} esb_send_packet_ctx_t;
+
+static void esb_send_packet_complete(const esb_tx_result_t *p_result, void *p_context)
+{
+    esb_send_packet_ctx_t *p_ctx = (esb_send_packet_ctx_t *)p_context;
+    p_ctx->status = p_result->status;
+    p_ctx->done = 1;
+}
+
+int8_t esb_send_packet(const esb_pipeline_t pipeline, const uint8_t *payload, uint8_t payload_length)
+{
+    esb_send_packet_ctx_t ctx = {.done = 0, .status = ESB_TX_FAILED};
+    int8_t result;
+
+    /* sleep until the radio interrupt instead of polling */
+    while((result = esb_send_packet_async(pipeline, payload, payload_length,
+                                          esb_send_packet_complete, &ctx)) == ESB_ERR_BUSY){
+        esb_sched_port_wait(ESB_SCHED_WAIT_FOREVER);
+    }
+
+    if(result != ESB_ERR_OK){
+        return (result);
+    }
+
+    while(ctx.done == 0){ /* wait until radio is ready */
+        esb_sched_port_wait(ESB_SCHED_WAIT_FOREVER);
+    }
+
+    return ((ctx.status == ESB_TX_SUCCESS) ? ESB_ERR_OK : ESB_ERR_TIMEOUT);
+}
+
+void esb_get_mode_switch_stats(esb_mode_switch_stats_t *p_stats)
+{
+    if(p_stats == NULL){
+        return;
+    }
+
+    CRITICAL_REGION_ENTER();
+    *p_stats = g_switch_stats;
+    CRITICAL_REGION_EXIT();
 }
@@ -9,9 +9,53 @@
 #define ESB_ERR_SIZE -3    /* Invalid payload length */
 #define ESB_ERR_PARAM -4   /* Function parameter error */
 #define ESB_ERR_TIMEOUT -5 /* Timeout waiting for an answer */
+#define ESB_ERR_BUSY -6    /* Transmission can not be queued right now, try again later */
+
+#ifndef ESB_TX_INFLIGHT_MAX
+#define ESB_TX_INFLIGHT_MAX 4 /* max number of frames in the radio TX FIFO (at most NRF_ESB_TX_FIFO_SIZE) */
+#endif
+
+#ifndef ESB_DEFAULT_CHANNEL
+#define ESB_DEFAULT_CHANNEL 40 /* RF channel after esb_init() */
+#endif
+
+#ifndef ESB_DEFAULT_TX_POWER
+#define ESB_DEFAULT_TX_POWER 4 /* TX power in dBm after esb_init() */
+#endif
+
+/*! \brief Bitrate of the radio */
+typedef enum {
+    ESB_BITRATE_1MBPS = 0x00, /* Default after esb_init() */
+    ESB_BITRATE_2MBPS = 0x01, /* Half the air time, about 4 dB less sensitivity */
+    ESB_BITRATE_NUM
+} esb_bitrate_t;
 
 typedef void (*esb_listener_callback_t)(uint8_t *payload, uint8_t payload_length);
 
+/*! \brief Result of an asynchronous transmission */
+typedef enum {
+    ESB_TX_SUCCESS = 0x00, /* Frame was acknowledged by the receiver */
+    ESB_TX_FAILED = 0x01,  /* No ACK after all retransmits */
+} esb_tx_status_t;
+
+typedef struct {
+    esb_tx_status_t status; /* Transmission result */
+    uint32_t attempts;      /* Number of attempts used (1 = no retransmit) */
+} esb_tx_result_t;
+
+/*! \brief Statistics of the PTX/PRX mode switches
+ *  \details While a switch is in progress the node can't receive, the switch time is the deaf window */
+typedef struct {
+    uint32_t count;    /* Number of mode switches (or address reprogramming) done */
+    uint32_t skipped;  /* Number of requested switches skipped because the radio already was in that mode */
+    uint32_t last_us;  /* Duration of the last switch in microseconds */
+    uint32_t max_us;   /* Maximum duration of a switch in microseconds */
+    uint32_t total_us; /* Accumulated duration of all switches in microseconds */
+} esb_mode_switch_stats_t;
+
+/* Completion callback of an asynchronous transmission, called from the radio interrupt */
+typedef void (*esb_tx_callback_t)(const esb_tx_result_t *p_result, void *p_context);
+
 typedef enum {
     ESB_PIPE_0 = 0x00,
     ESB_PIPE_1 = 0x01,
@@ -46,13 +90,82 @@ int8_t esb_start_listening(const esb_pipeline_t pipeline, esb_listener_callback_
 int8_t esb_stop_listening(const esb_pipeline_t pipeline);
 
 /* \brief Set RF Channel
- * \param pipeline[in]  Pipeline number to listen on
+ * \details A running receiver is stopped for the change and restarted on the new channel
+ * \param channel[in]   RF channel (0 to 100, frequency 2400 + channel MHz)
  * \retval ESB_ERR_OK         - OK
- * \retval ESB_ERR_HAL        - Error setting channel
+ * \retval ESB_ERR_HAL        - Error setting channel (e.g. invalid channel)
+ * \retval ESB_ERR_BUSY       - Frames in flight, try again when they are completed
  */
 int8_t esb_set_rf_channel(const uint8_t channel);
 
+/* \brief Get the RF Channel
+ */
+uint8_t esb_get_rf_channel(void);
+
+/* \brief Set bitrate and TX power
+ * \details Like the RF channel, the settings are kept across mode switches. Both ends of a link must use the same
+ *          bitrate, see esb_phy.h for the negotiation.
+ * \param bitrate[in]       Bitrate
+ * \param tx_power[in]      TX power in dBm (4, 0, -4, -8, -12, -16, -20 or -40)
+ * \retval ESB_ERR_OK       - OK
+ * \retval ESB_ERR_PARAM    - Invalid bitrate or TX power
+ * \retval ESB_ERR_HAL      - Error setting bitrate or TX power
+ * \retval ESB_ERR_BUSY     - Frames in flight, try again when they are completed
+ */
+int8_t esb_set_phy(const esb_bitrate_t bitrate, const int8_t tx_power);
+
+/* \brief Get bitrate and TX power
+ * \param p_bitrate[out]    Bitrate, may be NULL
+ * \param p_tx_power[out]   TX power in dBm, may be NULL
+ */
+void esb_get_phy(esb_bitrate_t *p_bitrate, int8_t *p_tx_power);
+
+/* \brief Send data asynchronously
+ * \details The frame is written to the radio TX FIFO and the function returns right away. Up to
+ *          ESB_TX_INFLIGHT_MAX frames can be in flight, they are sent in order. The radio switches back
+ *          to receive mode after the last frame in flight is completed.
+ *          A changed pipeline address (see esb_set_pipeline_address) is applied once all frames in
+ *          flight are completed, until then frames for this pipeline are rejected with ESB_ERR_BUSY.
+ *          The retransmit settings are chosen by the link quality of the destination (see esb_link.h), they
+ *          can only be applied while the radio is idle. So all frames in flight go to the same destination,
+ *          a frame for another destination is rejected with ESB_ERR_BUSY until they are completed.
+ * \param pipeline          Target Pipeline address
+ * \param payload           Pointer to buffer for payload data (copied, may be reused right away)
+ * \param payload_length    Length of payload buffer
+ * \param callback          Called from the radio interrupt when the frame is completed, may be NULL
+ * \param p_context         User context passed to the callback
+ * \retval ESB_ERR_OK       OK, frame is queued
+ * \retval ESB_ERR_INIT     Module not initialized
+ * \retval ESB_ERR_HAL      ESB HAL Error
+ * \retval ESB_ERR_SIZE     Invalid Payload length
+ * \retval ESB_ERR_PARAM    Parameter Error (NULL Pointer)
+ * \retval ESB_ERR_BUSY     TX FIFO full, pipeline address change pending or frames in flight to another
+ *                          destination, try again later
+ */
+int8_t esb_send_packet_async(const esb_pipeline_t pipeline, const uint8_t *payload, uint8_t payload_length,
+                             esb_tx_callback_t callback, void *p_context);
+
+/* \brief Get the number of frames in flight
+ */
+uint8_t esb_tx_pending(void);
+
+/* \brief Start a TX burst
+ * \details Until esb_tx_burst_end() the radio stays in transmit mode when the last frame in flight is
+ *          completed, so the frames of the burst share one mode switch. A changed pipeline address is
+ *          reprogrammed without reinitializing the radio, only the changed address registers are written.
+ *          The radio doesn't receive during the burst, keep it short.
+ */
+void esb_tx_burst_begin(void);
+
+/* \brief End a TX burst
+ * \details Switches back to receive mode, right away if no frame is in flight
+ * \retval ESB_ERR_OK       OK
+ * \retval ESB_ERR_HAL      ESB HAL Error
+ */
+int8_t esb_tx_burst_end(void);
+
 /* \brief Send data
+ * \details Blocks until the frame is completed
  * \param pipeline          Target Pipeline address
  * \param payload           Pointer to buffer for payload data
  * \param payload_length    Length of payload buffer
@@ -61,8 +174,44 @@ int8_t esb_set_rf_channel(const uint8_t channel);
  * \retval ESB_ERR_HAL      ESB HAL Error
  * \retval ESB_ERR_SIZE     Invalid Payload length
  * \retval ESB_ERR_PARAM    Parameter Error (NULL Pointer)
- * \retval ESB_ERR_TIMEOUT  ESB Timeout waiting for TX success
+ * \retval ESB_ERR_TIMEOUT  No ACK received after all retransmits
  */
 int8_t esb_send_packet(const esb_pipeline_t pipeline, const uint8_t *payload, uint8_t payload_length);
 
+/* \brief Queue an ACK payload
+ * \details The payload is attached to the ACK of the next frame received on the pipeline, which saves the
+ *          PTX round trip of a separate reply frame. ACK payloads are sent in the order they are queued.
+ *          They can only be queued in receive mode (see esb_start_listening) without frames in flight,
+ *          queued ACK payloads are discarded when the radio switches to transmit mode (esb_send_packet_async).
+ * \param pipeline          Pipeline the ACK payload is sent on
+ * \param payload           Pointer to buffer for payload data (copied, may be reused right away)
+ * \param payload_length    Length of payload buffer
+ * \retval ESB_ERR_OK       OK, ACK payload is queued
+ * \retval ESB_ERR_INIT     Module not initialized or not listening
+ * \retval ESB_ERR_HAL      ESB HAL Error
+ * \retval ESB_ERR_SIZE     Invalid Payload length
+ * \retval ESB_ERR_PARAM    Parameter Error (NULL Pointer)
+ * \retval ESB_ERR_BUSY     TX FIFO full or frames in flight, try again later
+ */
+int8_t esb_write_ack_payload(const esb_pipeline_t pipeline, const uint8_t *payload, uint8_t payload_length);
+
+/* \brief Discard the queued ACK payloads
+ * \retval ESB_ERR_OK       OK
+ * \retval ESB_ERR_INIT     Module not initialized
+ * \retval ESB_ERR_HAL      ESB HAL Error
+ */
+int8_t esb_flush_ack_payloads(void);
+
+/* \brief Set the callback for received ACK payloads
+ * \details A receiver can attach a payload to the ACK of a frame (see esb_write_ack_payload). The callback is
+ *          called from the radio interrupt with the payload, before the completion callback of the frame.
+ * \param ack_payload_callback  Callback, NULL to discard ACK payloads
+ */
+void esb_set_ack_payload_callback(esb_listener_callback_t ack_payload_callback);
+
+/* \brief Get the statistics of the PTX/PRX mode switches
+ * \param p_stats[out]      Buffer for the statistics
+ */
+void esb_get_mode_switch_stats(esb_mode_switch_stats_t *p_stats);
+
 #endif
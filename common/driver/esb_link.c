@@ -0,0 +1,198 @@
+#include <string.h>
+#include "app_util_platform.h"
+
+#include <common/driver/esb.h>
+#include <common/driver/esb_link.h>
+#include <common/driver/esb_time.h>
+
+#define ESB_LINK_ONE_Q16 65536u /* 1.0 */
+#define ESB_LINK_EWMA_SHIFT 4   /* weight of a new frame in the moving averages: 1/16 */
+
+typedef struct {
+    uint8_t addr[5];
+    uint8_t used;
+    uint8_t failed_in_row;   /* consecutive failed frames */
+    uint16_t count;          /* retransmit count for the next frame */
+    uint32_t acked_q16;      /* average acknowledged frames per frame */
+    uint32_t attempts_q16;   /* average attempts per frame */
+    uint32_t last_use;
+    uint32_t frames;
+    uint32_t failed;
+    uint32_t attempts;
+} esb_link_t;
+
+static esb_link_t g_links[ESB_LINK_TABLE_SIZE];
+static uint32_t g_link_use = 0;
+static uint32_t g_link_rand = 1;
+
+#if (ESB_LINK_ADAPTIVE == 1)
+/* xorshift32, only used for the backoff */
+static uint32_t esb_link_rand(void)
+{
+    g_link_rand ^= g_link_rand << 13;
+    g_link_rand ^= g_link_rand >> 17;
+    g_link_rand ^= g_link_rand << 5;
+    return (g_link_rand);
+}
+#endif
+
+static uint32_t esb_link_ewma(uint32_t average, uint32_t sample)
+{
+    return ((uint32_t)((int32_t)average + (((int32_t)sample - (int32_t)average) >> ESB_LINK_EWMA_SHIFT)));
+}
+
+/* probability that an attempt is acknowledged, the ratio of the averages also accounts for frames that failed
+ * after all retransmits */
+static uint32_t esb_link_ack_q16(const esb_link_t *p_link)
+{
+    if(p_link->attempts_q16 == 0){
+        return (0);
+    }
+
+    uint32_t ack = (uint32_t)(((uint64_t)p_link->acked_q16 * ESB_LINK_ONE_Q16) / p_link->attempts_q16);
+    return ((ack > ESB_LINK_ONE_Q16) ? ESB_LINK_ONE_Q16 : ack);
+}
+
+/* lowest retransmit count which keeps the probability that all attempts fail below the target */
+static uint16_t esb_link_count(const esb_link_t *p_link)
+{
+    if(p_link->failed_in_row >= ESB_LINK_DEAD_FRAMES){
+        return (ESB_LINK_COUNT_MIN);
+    }
+
+    uint32_t miss = ESB_LINK_ONE_Q16 - esb_link_ack_q16(p_link);
+    uint32_t fail = miss;
+    uint32_t target = (ESB_LINK_FAIL_TARGET_PERMILLE * ESB_LINK_ONE_Q16) / 1000;
+    uint16_t count = 0;
+
+    while((fail > target) && (count < ESB_LINK_COUNT_MAX)){
+        fail = (uint32_t)(((uint64_t)fail * miss) >> 16);
+        count++;
+    }
+
+    return ((count < ESB_LINK_COUNT_MIN) ? ESB_LINK_COUNT_MIN : count);
+}
+
+/* one backoff slot per retransmit of the average frame, none on a clean link */
+static uint32_t esb_link_backoff_slots(const esb_link_t *p_link)
+{
+    uint32_t retransmits_q16 = (p_link->attempts_q16 > ESB_LINK_ONE_Q16) ? (p_link->attempts_q16 - ESB_LINK_ONE_Q16) : 0;
+    uint32_t slots = (retransmits_q16 + ESB_LINK_ONE_Q16 - 1) / ESB_LINK_ONE_Q16;
+
+    return ((slots > ESB_LINK_BACKOFF_MAX_SLOTS) ? ESB_LINK_BACKOFF_MAX_SLOTS : slots);
+}
+
+static int8_t esb_link_find(const uint8_t addr[5])
+{
+    for(uint8_t i = 0; i < ESB_LINK_TABLE_SIZE; i++){
+        if((g_links[i].used == 1) && (memcmp(g_links[i].addr, addr, 5) == 0)){
+            return ((int8_t)i);
+        }
+    }
+    return (-1);
+}
+
+void esb_link_init(void)
+{
+    memset(g_links, 0, sizeof(g_links));
+    g_link_use = 0;
+    g_link_rand = esb_time_cycles() | 1;
+}
+
+uint8_t esb_link_lookup(const uint8_t addr[5])
+{
+    int8_t found = esb_link_find(addr);
+    uint8_t link;
+
+    if(found >= 0){
+        link = (uint8_t)found;
+    }else{
+        /* replace a free or the least recently used entry */
+        link = 0;
+        for(uint8_t i = 1; (i < ESB_LINK_TABLE_SIZE) && (g_links[link].used == 1); i++){
+            if((g_links[i].used == 0) || (g_links[i].last_use < g_links[link].last_use)){
+                link = i;
+            }
+        }
+        memset(&g_links[link], 0, sizeof(esb_link_t));
+        memcpy(g_links[link].addr, addr, 5);
+        g_links[link].count = ESB_LINK_COUNT_DEFAULT;
+        g_links[link].used = 1;
+    }
+
+    g_links[link].last_use = ++g_link_use;
+    return (link);
+}
+
+void esb_link_get_params(uint8_t link, uint16_t *p_delay_us, uint16_t *p_count)
+{
+#if (ESB_LINK_ADAPTIVE == 1)
+    const esb_link_t *p_link = &g_links[link];
+    uint32_t slots = esb_link_backoff_slots(p_link);
+
+    *p_delay_us = (uint16_t)(ESB_LINK_DELAY_MIN_US + (ESB_LINK_BACKOFF_SLOT_US * (esb_link_rand() % (slots + 1))));
+    *p_count = p_link->count;
+#else
+    (void)link;
+    *p_delay_us = ESB_LINK_DELAY_MIN_US;
+    *p_count = ESB_LINK_COUNT_DEFAULT;
+#endif
+}
+
+void esb_link_update(uint8_t link, uint8_t acked, uint32_t attempts)
+{
+    if((link >= ESB_LINK_TABLE_SIZE) || (attempts == 0)){
+        return;
+    }
+
+    esb_link_t *p_link = &g_links[link];
+    uint32_t acked_q16 = (acked == 1) ? ESB_LINK_ONE_Q16 : 0;
+    uint32_t attempts_q16 = attempts * ESB_LINK_ONE_Q16;
+
+    if(p_link->frames == 0){
+        /* no history yet, start the averages with the first frame */
+        p_link->acked_q16 = acked_q16;
+        p_link->attempts_q16 = attempts_q16;
+    }else{
+        p_link->acked_q16 = esb_link_ewma(p_link->acked_q16, acked_q16);
+        p_link->attempts_q16 = esb_link_ewma(p_link->attempts_q16, attempts_q16);
+    }
+
+    p_link->frames++;
+    p_link->attempts += attempts;
+    if(acked == 1){
+        p_link->failed_in_row = 0;
+    }else{
+        p_link->failed++;
+        if(p_link->failed_in_row < 0xFF){
+            p_link->failed_in_row++;
+        }
+    }
+    p_link->count = esb_link_count(p_link);
+}
+
+int8_t esb_link_get_stats(const uint8_t addr[5], esb_link_stats_t *p_stats)
+{
+    if((addr == NULL) || (p_stats == NULL)){
+        return (ESB_ERR_PARAM);
+    }
+
+    int8_t result = ESB_ERR_PARAM;
+
+    /* the links are updated from the radio interrupt */
+    CRITICAL_REGION_ENTER();
+    int8_t link = esb_link_find(addr);
+    if((link >= 0) && (g_links[link].frames > 0)){
+        const esb_link_t *p_link = &g_links[link];
+        p_stats->frames = p_link->frames;
+        p_stats->failed = p_link->failed;
+        p_stats->attempts = p_link->attempts;
+        p_stats->ack_permille = (uint16_t)((esb_link_ack_q16(p_link) * 1000) / ESB_LINK_ONE_Q16);
+        p_stats->retransmit_count = p_link->count;
+        p_stats->backoff_slots = (uint16_t)esb_link_backoff_slots(p_link);
+        result = ESB_ERR_OK;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return (result);
+}
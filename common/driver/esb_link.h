@@ -0,0 +1,104 @@
+#ifndef ESB_LINK_H_
+#define ESB_LINK_H_
+
+#include <stdint.h>
+
+/*
+ * Link quality of the destinations the radio sends to, used to tune the retransmit settings per frame.
+ * For every destination (pipeline address) the driver keeps moving averages of the acknowledged frames and
+ * of the attempts per frame, their ratio is the probability that a single attempt is acknowledged:
+ * - The retransmit count is the lowest count which delivers a frame with a probability of at least
+ *   1 - ESB_LINK_FAIL_TARGET_PERMILLE / 1000. A destination that didn't acknowledge the last
+ *   ESB_LINK_DEAD_FRAMES frames gets ESB_LINK_COUNT_MIN retransmits, which saves airtime for absent nodes.
+ * - The retransmit delay is ESB_LINK_DELAY_MIN_US plus a random backoff of up to one slot per retransmit
+ *   of the average frame. Nodes that collided once don't collide again in every retransmit, because ESB
+ *   retransmits with a fixed delay.
+ * The settings are applied when the radio starts sending (esb_send_packet_async() with no frame in flight,
+ * or the next frame after a failed one), frames queued behind use the settings of the first one.
+ */
+
+#ifndef ESB_LINK_ADAPTIVE
+#define ESB_LINK_ADAPTIVE 1 /* 0: fixed retransmit settings (ESB_LINK_DELAY_MIN_US, ESB_LINK_COUNT_DEFAULT) */
+#endif
+
+#ifndef ESB_LINK_TABLE_SIZE
+#define ESB_LINK_TABLE_SIZE 8 /* destinations tracked, the least recently used one is replaced */
+#endif
+
+#ifndef ESB_LINK_DELAY_MIN_US
+#define ESB_LINK_DELAY_MIN_US 600 /* shortest retransmit delay, time for a frame and an ACK with payload at 1MBit/s */
+#endif
+
+#ifndef ESB_LINK_BACKOFF_SLOT_US
+#define ESB_LINK_BACKOFF_SLOT_US 250 /* unit of the random backoff added to the retransmit delay */
+#endif
+
+#ifndef ESB_LINK_BACKOFF_MAX_SLOTS
+#define ESB_LINK_BACKOFF_MAX_SLOTS 4 /* max random backoff in slots */
+#endif
+
+#ifndef ESB_LINK_COUNT_DEFAULT
+#define ESB_LINK_COUNT_DEFAULT 10 /* retransmit count of a destination without history */
+#endif
+
+#ifndef ESB_LINK_COUNT_MIN
+#define ESB_LINK_COUNT_MIN 2
+#endif
+
+#ifndef ESB_LINK_COUNT_MAX
+#define ESB_LINK_COUNT_MAX 15
+#endif
+
+#ifndef ESB_LINK_FAIL_TARGET_PERMILLE
+#define ESB_LINK_FAIL_TARGET_PERMILLE 1 /* accepted probability that a frame fails after all retransmits */
+#endif
+
+#ifndef ESB_LINK_DEAD_FRAMES
+#define ESB_LINK_DEAD_FRAMES 3 /* consecutive failed frames after which a destination is considered absent */
+#endif
+
+#define ESB_LINK_INVALID 0xFF
+
+/*! \brief Link statistics of a destination */
+typedef struct {
+    uint32_t frames;              /* Frames completed */
+    uint32_t failed;              /* Frames not acknowledged after all retransmits */
+    uint32_t attempts;            /* Attempts of all frames (1 per frame without retransmits) */
+    uint16_t ack_permille;        /* Average probability that an attempt is acknowledged */
+    uint16_t retransmit_count;    /* Current retransmit count */
+    uint16_t backoff_slots;       /* Current max random backoff in ESB_LINK_BACKOFF_SLOT_US */
+} esb_link_stats_t;
+
+/* \brief Forget all destinations, called by esb_init()
+ */
+void esb_link_init(void);
+
+/* \brief Get the link of a destination, a new link is created for an unknown destination
+ * \param addr[in]          Pipeline address of the destination
+ * \returns index of the link
+ */
+uint8_t esb_link_lookup(const uint8_t addr[5]);
+
+/* \brief Get the retransmit settings for the next frame to a destination
+ * \param link              Index of the link (esb_link_lookup())
+ * \param p_delay_us[out]   Retransmit delay including the random backoff
+ * \param p_count[out]      Retransmit count
+ */
+void esb_link_get_params(uint8_t link, uint16_t *p_delay_us, uint16_t *p_count);
+
+/* \brief Update the link quality with a completed frame, called from the radio interrupt
+ * \param link              Index of the link, ESB_LINK_INVALID is ignored
+ * \param acked             1 if the frame was acknowledged
+ * \param attempts          Attempts used
+ */
+void esb_link_update(uint8_t link, uint8_t acked, uint32_t attempts);
+
+/* \brief Get the link statistics of a destination
+ * \param addr[in]          Pipeline address of the destination
+ * \param p_stats[out]      Buffer for the statistics
+ * \retval ESB_ERR_OK       OK
+ * \retval ESB_ERR_PARAM    NULL Pointer or no frame was sent to the destination
+ */
+int8_t esb_link_get_stats(const uint8_t addr[5], esb_link_stats_t *p_stats);
+
+#endif /* ESB_LINK_H_ */
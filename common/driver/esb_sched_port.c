@@ -0,0 +1,15 @@
+#include "nrf.h"
+
+#include <common/sched/esb_sched.h>
+
+void esb_sched_port_wait(uint32_t timeout_us)
+{
+    /* wakes up on any interrupt, the timeout needs a timer interrupt of the application */
+    __WFE();
+}
+
+void esb_sched_port_wake(void)
+{
+    /* also covers an interrupt between the check of the events and WFE */
+    __SEV();
+}
@@ -0,0 +1,19 @@
+#include "nrf.h"
+
+#include <common/driver/esb_time.h>
+
+void esb_time_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t esb_time_cycles(void)
+{
+    return (DWT->CYCCNT);
+}
+
+uint32_t esb_time_cycles_to_us(uint32_t cycles)
+{
+    return (cycles / (SystemCoreClock / 1000000));
+}
@@ -0,0 +1,25 @@
+#ifndef ESB_TIME_H_
+#define ESB_TIME_H_
+
+#include <stdint.h>
+
+/*
+ * Cycle counter used for timing measurements of the ESB stack.
+ * On target the DWT cycle counter (CYCCNT) is used, on the host backend a monotonic clock with
+ * microsecond resolution. Differences of two readings are valid as long as they are shorter than
+ * the wrap-around time of the 32 bit counter (67s at 64MHz, 71min on host).
+ */
+
+/* \brief Start the cycle counter
+ */
+void esb_time_init(void);
+
+/* \brief Get the current value of the cycle counter
+ */
+uint32_t esb_time_cycles(void);
+
+/* \brief Convert a number of cycles to microseconds
+ */
+uint32_t esb_time_cycles_to_us(uint32_t cycles);
+
+#endif /* ESB_TIME_H_ */
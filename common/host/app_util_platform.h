@@ -0,0 +1,19 @@
+#ifndef APP_UTIL_PLATFORM_H_
+#define APP_UTIL_PLATFORM_H_
+
+/*
+ * Host stand-in for the NRF5 SDK critical region macros. Entering a critical region blocks the
+ * simulated radio thread, which takes the role of the radio interrupt (see esb_sim.h).
+ */
+
+#include <common/host/esb_sim.h>
+
+#define CRITICAL_REGION_ENTER()                                                                                        \
+    {                                                                                                                  \
+        esb_sim_critical_region_enter();
+
+#define CRITICAL_REGION_EXIT()                                                                                         \
+    esb_sim_critical_region_exit();                                                                                    \
+    }
+
+#endif /* APP_UTIL_PLATFORM_H_ */
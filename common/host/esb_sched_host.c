@@ -0,0 +1,54 @@
+#include <pthread.h>
+#include <time.h>
+
+#include <common/sched/esb_sched.h>
+
+/* the simulated radio thread plays the interrupt, the main loop blocks on a condition variable */
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond;
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static uint8_t g_woken = 0;
+
+static void esb_sched_host_init(void)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+void esb_sched_port_wait(uint32_t timeout_us)
+{
+    pthread_once(&g_once, esb_sched_host_init);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_us / 1000000u;
+    deadline.tv_nsec += (long)(timeout_us % 1000000u) * 1000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&g_mutex);
+    while (g_woken == 0) {
+        if (timeout_us == ESB_SCHED_WAIT_FOREVER) {
+            pthread_cond_wait(&g_cond, &g_mutex);
+        } else if (pthread_cond_timedwait(&g_cond, &g_mutex, &deadline) != 0) {
+            break;
+        }
+    }
+    g_woken = 0;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+void esb_sched_port_wake(void)
+{
+    pthread_once(&g_once, esb_sched_host_init);
+
+    pthread_mutex_lock(&g_mutex);
+    g_woken = 1;
+    pthread_cond_signal(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
+}
@@ -0,0 +1,1162 @@
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "esb_sim.h"
+#include "nrf_esb.h"
+
+#define ESB_SIM_AIR_QUEUE_SIZE 16  /* frames of virtual nodes waiting for the air */
+#define ESB_SIM_RAMP_UP_US 130     /* radio ramp up time, once for the frame and once for the ACK */
+#define ESB_SIM_RETRANSMIT_DELAY 600
+#define ESB_SIM_RETRANSMIT_COUNT 10
+#define ESB_SIM_SENSITIVITY_1MBPS (-93) /* dBm, nRF52 ESB at 1 Mbit/s */
+#define ESB_SIM_SENSITIVITY_2MBPS (-89) /* dBm, nRF52 ESB at 2 Mbit/s */
+#define ESB_SIM_FADE_MARGIN_DB 6        /* below this margin over the sensitivity frames start to get lost */
+
+#define ESB_SIM_INT_TX_SUCCESS 0x01
+#define ESB_SIM_INT_TX_FAILED 0x02
+#define ESB_SIM_INT_RX_RECEIVED 0x04
+
+#define ESB_SIM_CHECK_NODE_PARAM(node)                                                                                 \
+    do {                                                                                                               \
+        if ((node < 0) || (node >= ESB_SIM_MAX_NODES) || (g_sim.nodes[node].used == 0)) {                              \
+            pthread_mutex_unlock(&g_sim.lock);                                                                         \
+            return (ESB_ERR_PARAM);                                                                                    \
+        }                                                                                                              \
+    } while (0)
+
+/* FIFO of the local radio, entries are removed by moving the remaining ones (max. 8 entries) */
+typedef struct {
+    nrf_esb_payload_t items[NRF_ESB_TX_FIFO_SIZE];
+    uint8_t count;
+} sim_fifo_t;
+
+/* duplicate detection of the receiver, like the PID/CRC check of ESB */
+typedef struct {
+    uint8_t valid;
+    uint8_t pid;
+    uint32_t checksum;
+} sim_rx_info_t;
+
+typedef struct {
+    uint8_t used;
+    uint8_t addr[5];
+    uint8_t rf_channel;
+    esb_bitrate_t bitrate;
+    esb_sim_rx_callback_t rx_callback;
+    uint8_t ack_payload[ESB_SIM_MAX_PAYLOAD_LEN];
+    uint8_t ack_payload_length;
+    uint8_t tx_pid;
+    sim_rx_info_t rx_info;
+} sim_node_t;
+
+/* hidden transmitter, its frames have the same air time as the colliding frame of the local radio */
+typedef struct {
+    uint64_t next_us; /* start of the next attempt */
+    uint8_t attempts; /* attempts of the current frame */
+} sim_contender_t;
+
+typedef struct {
+    esb_sim_node_t node;
+    uint8_t dest[5];
+    uint8_t data[ESB_SIM_MAX_PAYLOAD_LEN];
+    uint8_t length;
+    uint8_t pid;
+    esb_sim_tx_result_t *p_result;
+    volatile uint8_t *p_done;
+} sim_air_frame_t;
+
+static struct {
+    pthread_mutex_t lock; /* recursive, the event handler calls back into the nrf_esb API */
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    pthread_t thread;
+    esb_sim_config_t config;
+    uint64_t time_us;
+    uint32_t rand_state;
+    esb_sim_stats_t stats;
+    sim_node_t nodes[ESB_SIM_MAX_NODES];
+    sim_contender_t contenders[ESB_SIM_MAX_CONTENDERS];
+    uint16_t interference[ESB_SIM_CHANNEL_NUM]; /* additional loss per RF channel in 1/1000 */
+    sim_air_frame_t air[ESB_SIM_AIR_QUEUE_SIZE];
+    uint8_t air_head;
+    uint8_t air_count;
+} g_sim;
+
+/* state of the local (simulated nRF) radio */
+static struct {
+    uint8_t initialized;
+    uint32_t generation; /* incremented on init/disable/suspend to abort a running transaction */
+    nrf_esb_config_t config;
+    uint8_t tx_active;
+    uint8_t rx_active;
+    uint8_t in_transaction;
+    uint32_t rf_channel;
+    uint8_t addr_length;
+    uint8_t base_addr_0[4];
+    uint8_t base_addr_1[4];
+    uint8_t prefixes[NRF_ESB_PIPE_COUNT];
+    uint8_t pipes_enabled;
+    sim_fifo_t tx_fifo;
+    sim_fifo_t rx_fifo;
+    uint8_t pids[NRF_ESB_PIPE_COUNT];
+    sim_rx_info_t rx_info[NRF_ESB_PIPE_COUNT];
+    uint32_t int_flags;
+    uint32_t tx_attempts;
+} g_radio = {.rf_channel = 2, .addr_length = 5, .pipes_enabled = 0xFF};
+
+static const esb_sim_config_t g_default_config = {.loss_permille = 0, .latency_us = 0, .realtime = 0, .seed = 1};
+
+static const uint8_t g_default_base_addr_0[4] = {0xE7, 0xE7, 0xE7, 0xE7};
+static const uint8_t g_default_base_addr_1[4] = {0xC2, 0xC2, 0xC2, 0xC2};
+static const uint8_t g_default_prefixes[NRF_ESB_PIPE_COUNT] = {0xE7, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8};
+
+static pthread_once_t g_sim_once = PTHREAD_ONCE_INIT;
+
+static void *sim_radio_thread(void *arg);
+
+static void sim_setup(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&g_sim.lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    pthread_cond_init(&g_sim.work_cond, NULL);
+    pthread_cond_init(&g_sim.done_cond, NULL);
+
+    g_sim.config = g_default_config;
+    g_sim.rand_state = g_default_config.seed;
+
+    pthread_create(&g_sim.thread, NULL, sim_radio_thread, NULL);
+}
+
+static void sim_lock(void)
+{
+    pthread_once(&g_sim_once, sim_setup);
+    pthread_mutex_lock(&g_sim.lock);
+}
+
+static void sim_unlock(void)
+{
+    pthread_mutex_unlock(&g_sim.lock);
+}
+
+static void sim_signal_work(void)
+{
+    pthread_cond_broadcast(&g_sim.work_cond);
+}
+
+/* xorshift32, reproducible with a given seed */
+static uint32_t sim_rand(void)
+{
+    uint32_t x = g_sim.rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_sim.rand_state = x;
+    return (x);
+}
+
+static esb_bitrate_t sim_radio_bitrate(void)
+{
+    if ((g_radio.config.bitrate == NRF_ESB_BITRATE_2MBPS) || (g_radio.config.bitrate == NRF_ESB_BITRATE_2MBPS_BLE)) {
+        return (ESB_BITRATE_2MBPS);
+    }
+    return (ESB_BITRATE_1MBPS);
+}
+
+/* loss from the link budget: TX power of the local radio minus the path loss, compared to the sensitivity of the
+ * bitrate. The link is symmetric, the ACKs of the nodes are received with the same margin. */
+static uint32_t sim_range_loss(void)
+{
+    if (g_sim.config.path_loss_db == 0) {
+        return (0);
+    }
+
+    int32_t sensitivity = (sim_radio_bitrate() == ESB_BITRATE_2MBPS) ? ESB_SIM_SENSITIVITY_2MBPS
+                                                                      : ESB_SIM_SENSITIVITY_1MBPS;
+    int32_t margin = (int32_t)g_radio.config.tx_output_power - (int32_t)g_sim.config.path_loss_db - sensitivity;
+
+    if (margin >= ESB_SIM_FADE_MARGIN_DB) {
+        return (0);
+    } else if (margin <= 0) {
+        return (1000);
+    }
+    return (((uint32_t)(ESB_SIM_FADE_MARGIN_DB - margin) * 1000) / ESB_SIM_FADE_MARGIN_DB);
+}
+
+static uint8_t sim_lost(uint8_t rf_channel)
+{
+    uint32_t loss = g_sim.config.loss_permille + sim_range_loss();
+
+    if (rf_channel < ESB_SIM_CHANNEL_NUM) {
+        loss += g_sim.interference[rf_channel];
+    }
+    return ((sim_rand() % 1000) < loss);
+}
+
+/* random gap between two frames of a contender, uniform with the configured mean */
+static uint64_t sim_contender_gap(void)
+{
+    return ((g_sim.config.contender_interval_us > 0) ? (sim_rand() % (2 * g_sim.config.contender_interval_us)) : 0);
+}
+
+static void sim_contenders_reset(void)
+{
+    for (uint8_t i = 0; i < ESB_SIM_MAX_CONTENDERS; i++) {
+        g_sim.contenders[i].next_us = g_sim.time_us + sim_contender_gap();
+        g_sim.contenders[i].attempts = 0;
+    }
+}
+
+/* returns 1 if an attempt of the local radio from start_us to start_us + duration_us collides with a contender
+ * the contenders are advanced to start_us, attempts without overlap are successful */
+static uint8_t sim_collision(uint64_t start_us, uint32_t duration_us)
+{
+    uint8_t collision = 0;
+    uint8_t num = (g_sim.config.contenders < ESB_SIM_MAX_CONTENDERS) ? g_sim.config.contenders : ESB_SIM_MAX_CONTENDERS;
+
+    for (uint8_t i = 0; i < num; i++) {
+        sim_contender_t *p_contender = &g_sim.contenders[i];
+
+        while ((p_contender->next_us + duration_us) <= start_us) {
+            p_contender->attempts = 0;
+            p_contender->next_us += duration_us + sim_contender_gap();
+        }
+        if (p_contender->next_us < (start_us + duration_us)) {
+            collision = 1;
+            p_contender->attempts++;
+            if (p_contender->attempts > ESB_SIM_RETRANSMIT_COUNT) {
+                p_contender->attempts = 0;
+                p_contender->next_us += duration_us + sim_contender_gap();
+            } else {
+                p_contender->next_us += ESB_SIM_RETRANSMIT_DELAY;
+            }
+        }
+    }
+    return (collision);
+}
+
+static uint32_t sim_checksum(const uint8_t *data, uint8_t length)
+{
+    uint32_t sum = 2166136261u;
+    for (uint8_t i = 0; i < length; i++) {
+        sum = (sum ^ data[i]) * 16777619u;
+    }
+    return (sum);
+}
+
+/* returns 1 if the frame is new, 0 for a retransmit of an already received frame */
+static uint8_t sim_rx_info_update(sim_rx_info_t *p_info, uint8_t pid, const uint8_t *data, uint8_t length)
+{
+    uint32_t checksum = sim_checksum(data, length);
+
+    if ((p_info->valid == 1) && (p_info->pid == pid) && (p_info->checksum == checksum)) {
+        return (0);
+    }
+    p_info->valid = 1;
+    p_info->pid = pid;
+    p_info->checksum = checksum;
+
+    return (1);
+}
+
+/* on-air duration of one frame in microseconds */
+static uint32_t sim_frame_airtime_us(uint8_t length)
+{
+    uint32_t bits_per_us = 1;
+    uint32_t preamble = 1;
+    uint32_t crc = (g_radio.config.crc == NRF_ESB_CRC_16BIT) ? 2 : ((g_radio.config.crc == NRF_ESB_CRC_8BIT) ? 1 : 0);
+
+    if ((g_radio.config.bitrate == NRF_ESB_BITRATE_2MBPS) || (g_radio.config.bitrate == NRF_ESB_BITRATE_2MBPS_BLE)) {
+        bits_per_us = 2;
+        preamble = 2;
+    }
+    /* 9 bit packet control field */
+    return ((8 * (preamble + g_radio.addr_length + length + crc) + 9) / bits_per_us);
+}
+
+/* let the simulated time pass, in realtime mode the radio thread sleeps without holding the lock */
+static void sim_wait(uint32_t duration_us)
+{
+    g_sim.time_us += duration_us;
+
+    if ((g_sim.config.realtime == 1) && (duration_us > 0)) {
+        struct timespec ts = {.tv_sec = duration_us / 1000000, .tv_nsec = (duration_us % 1000000) * 1000};
+        sim_unlock();
+        nanosleep(&ts, NULL);
+        sim_lock();
+    }
+}
+
+static void sim_fifo_push(sim_fifo_t *p_fifo, const nrf_esb_payload_t *p_payload)
+{
+    p_fifo->items[p_fifo->count] = *p_payload;
+    p_fifo->count++;
+}
+
+static void sim_fifo_remove(sim_fifo_t *p_fifo, uint8_t index)
+{
+    memmove(&p_fifo->items[index], &p_fifo->items[index + 1], (p_fifo->count - index - 1) * sizeof(nrf_esb_payload_t));
+    p_fifo->count--;
+}
+
+static void sim_radio_pipe_address(uint8_t pipe, uint8_t addr[5])
+{
+    memcpy(addr, (pipe == 0) ? g_radio.base_addr_0 : g_radio.base_addr_1, 4);
+    addr[4] = g_radio.prefixes[pipe];
+}
+
+static uint8_t sim_radio_is_idle(void)
+{
+    return ((g_radio.tx_active == 0) && (g_radio.rx_active == 0) && (g_radio.in_transaction == 0));
+}
+
+/* returns the pipe of the local radio that receives a frame to addr, -1 if the radio is not listening */
+static int8_t sim_radio_rx_pipe(const uint8_t addr[5], uint8_t rf_channel)
+{
+    if ((g_radio.initialized == 0) || (g_radio.rx_active == 0) || (g_radio.config.mode != NRF_ESB_MODE_PRX) ||
+        (g_radio.rf_channel != rf_channel)) {
+        return (-1);
+    }
+
+    for (uint8_t pipe = 0; pipe < NRF_ESB_PIPE_COUNT; pipe++) {
+        uint8_t pipe_addr[5];
+        sim_radio_pipe_address(pipe, pipe_addr);
+        if (((g_radio.pipes_enabled & (1 << pipe)) != 0) && (memcmp(pipe_addr, addr, 5) == 0)) {
+            return ((int8_t)pipe);
+        }
+    }
+    return (-1);
+}
+
+static sim_node_t *sim_node_find(const uint8_t addr[5], uint8_t rf_channel)
+{
+    for (uint8_t i = 0; i < ESB_SIM_MAX_NODES; i++) {
+        if ((g_sim.nodes[i].used == 1) && (g_sim.nodes[i].rf_channel == rf_channel) &&
+            (memcmp(g_sim.nodes[i].addr, addr, 5) == 0)) {
+            return (&g_sim.nodes[i]);
+        }
+    }
+    return (NULL);
+}
+
+static void sim_dispatch_events(void)
+{
+    uint32_t flags = g_radio.int_flags;
+    nrf_esb_event_handler_t handler = g_radio.config.event_handler;
+    nrf_esb_evt_t event = {.tx_attempts = g_radio.tx_attempts};
+
+    g_radio.int_flags = 0;
+    if (handler == NULL) {
+        return;
+    }
+
+    if (flags & ESB_SIM_INT_TX_SUCCESS) {
+        event.evt_id = NRF_ESB_EVENT_TX_SUCCESS;
+        handler(&event);
+    }
+    if (flags & ESB_SIM_INT_TX_FAILED) {
+        event.evt_id = NRF_ESB_EVENT_TX_FAILED;
+        handler(&event);
+    }
+    if (flags & ESB_SIM_INT_RX_RECEIVED) {
+        event.evt_id = NRF_ESB_EVENT_RX_RECEIVED;
+        handler(&event);
+    }
+}
+
+/* transmit the first frame of the local TX FIFO to a virtual node */
+static void sim_radio_ptx_transaction(void)
+{
+    nrf_esb_payload_t frame = g_radio.tx_fifo.items[0];
+    uint32_t generation = g_radio.generation;
+    uint32_t max_attempts = g_radio.config.retransmit_count + 1;
+    uint32_t attempts = 0;
+    uint8_t acked = 0;
+    uint8_t ack_payload_length = 0;
+    uint8_t ack_payload[ESB_SIM_MAX_PAYLOAD_LEN];
+    uint8_t dest[5];
+
+    sim_radio_pipe_address(frame.pipe, dest);
+    frame.pid = g_radio.pids[frame.pipe];
+    g_radio.in_transaction = 1;
+
+    while ((acked == 0) && (attempts < max_attempts)) {
+        uint32_t duration = ESB_SIM_RAMP_UP_US + sim_frame_airtime_us(frame.length) + g_sim.config.latency_us;
+        sim_node_t *p_node = sim_node_find(dest, (uint8_t)g_radio.rf_channel);
+        if ((p_node != NULL) && (p_node->bitrate != sim_radio_bitrate())) {
+            /* the node can't demodulate the frame */
+            p_node = NULL;
+        }
+
+        attempts++;
+        g_sim.stats.frames++;
+        g_sim.stats.airtime_us += sim_frame_airtime_us(frame.length);
+
+        if (sim_collision(g_sim.time_us, duration) == 1) {
+            g_sim.stats.collisions++;
+        } else if ((p_node != NULL) && (sim_lost((uint8_t)g_radio.rf_channel) == 0)) {
+            if (sim_rx_info_update(&p_node->rx_info, frame.pid, frame.data, frame.length) == 1) {
+                if (p_node->rx_callback != NULL) {
+                    p_node->rx_callback((esb_sim_node_t)(p_node - g_sim.nodes), frame.data, frame.length);
+                }
+            }
+            duration += ESB_SIM_RAMP_UP_US + sim_frame_airtime_us(p_node->ack_payload_length);
+            g_sim.stats.airtime_us += sim_frame_airtime_us(p_node->ack_payload_length);
+
+            if (sim_lost((uint8_t)g_radio.rf_channel) == 0) {
+                acked = 1;
+                ack_payload_length = p_node->ack_payload_length;
+                memcpy(ack_payload, p_node->ack_payload, ack_payload_length);
+                p_node->ack_payload_length = 0;
+            } else {
+                g_sim.stats.acks_lost++;
+            }
+        } else if (p_node != NULL) {
+            g_sim.stats.frames_lost++;
+        }
+
+        if ((acked == 0) && (duration < g_radio.config.retransmit_delay)) {
+            duration = g_radio.config.retransmit_delay;
+        }
+        sim_wait(duration);
+
+        if (g_radio.generation != generation) {
+            /* radio was disabled or re-initialized during the transaction */
+            g_radio.in_transaction = 0;
+            return;
+        }
+    }
+
+    g_radio.in_transaction = 0;
+    g_radio.tx_attempts = attempts;
+
+    if (acked == 1) {
+        if (g_radio.tx_fifo.count > 0) {
+            sim_fifo_remove(&g_radio.tx_fifo, 0);
+        }
+        g_radio.pids[frame.pipe] = (frame.pid + 1) & 0x03;
+        g_radio.int_flags |= ESB_SIM_INT_TX_SUCCESS;
+
+        if ((ack_payload_length > 0) && (g_radio.rx_fifo.count < NRF_ESB_RX_FIFO_SIZE)) {
+            nrf_esb_payload_t rx = {.length = ack_payload_length, .pipe = frame.pipe};
+            memcpy(rx.data, ack_payload, ack_payload_length);
+            sim_fifo_push(&g_radio.rx_fifo, &rx);
+            g_radio.int_flags |= ESB_SIM_INT_RX_RECEIVED;
+        }
+
+        if ((g_radio.tx_fifo.count == 0) || (g_radio.config.tx_mode == NRF_ESB_TXMODE_MANUAL)) {
+            g_radio.tx_active = 0;
+        }
+    } else {
+        /* like the SDK, the failed frame stays in the TX FIFO */
+        g_radio.tx_active = 0;
+        g_radio.int_flags |= ESB_SIM_INT_TX_FAILED;
+    }
+}
+
+/* transmit the oldest frame of a virtual node to the local radio */
+static void sim_air_transaction(void)
+{
+    sim_air_frame_t *p_frame = &g_sim.air[g_sim.air_head];
+    uint8_t attempts = 0;
+    uint8_t acked = 0;
+    esb_sim_tx_result_t result = {0};
+
+    while ((acked == 0) && (attempts < (ESB_SIM_RETRANSMIT_COUNT + 1))) {
+        uint32_t duration = ESB_SIM_RAMP_UP_US + sim_frame_airtime_us(p_frame->length) + g_sim.config.latency_us;
+        sim_node_t *p_node = &g_sim.nodes[p_frame->node];
+        int8_t pipe = sim_radio_rx_pipe(p_frame->dest, p_node->rf_channel);
+        if (p_node->bitrate != sim_radio_bitrate()) {
+            pipe = -1;
+        }
+
+        attempts++;
+        g_sim.stats.frames++;
+        g_sim.stats.airtime_us += sim_frame_airtime_us(p_frame->length);
+
+        if ((pipe >= 0) && (sim_lost(p_node->rf_channel) == 1)) {
+            g_sim.stats.frames_lost++;
+        } else if ((pipe >= 0) && (g_radio.rx_fifo.count < NRF_ESB_RX_FIFO_SIZE)) {
+            if (sim_rx_info_update(&g_radio.rx_info[pipe], p_frame->pid, p_frame->data, p_frame->length) == 1) {
+                nrf_esb_payload_t rx = {.length = p_frame->length, .pipe = (uint8_t)pipe, .pid = p_frame->pid};
+                memcpy(rx.data, p_frame->data, p_frame->length);
+                sim_fifo_push(&g_radio.rx_fifo, &rx);
+                g_radio.int_flags |= ESB_SIM_INT_RX_RECEIVED;
+            }
+
+            /* in PRX mode the TX FIFO holds the ACK payloads */
+            int8_t ack_idx = -1;
+            for (uint8_t i = 0; i < g_radio.tx_fifo.count; i++) {
+                if (g_radio.tx_fifo.items[i].pipe == (uint8_t)pipe) {
+                    ack_idx = (int8_t)i;
+                    break;
+                }
+            }
+            uint8_t ack_length = (ack_idx >= 0) ? g_radio.tx_fifo.items[ack_idx].length : 0;
+            duration += ESB_SIM_RAMP_UP_US + sim_frame_airtime_us(ack_length);
+            g_sim.stats.airtime_us += sim_frame_airtime_us(ack_length);
+
+            if (sim_lost(p_node->rf_channel) == 0) {
+                acked = 1;
+                if (ack_idx >= 0) {
+                    result.ack_payload_length = ack_length;
+                    memcpy(result.ack_payload, g_radio.tx_fifo.items[ack_idx].data, ack_length);
+                    sim_fifo_remove(&g_radio.tx_fifo, (uint8_t)ack_idx);
+                }
+            } else {
+                g_sim.stats.acks_lost++;
+            }
+        }
+
+        /* deliver RX events as soon as possible, like the radio interrupt */
+        sim_dispatch_events();
+
+        if ((acked == 0) && (duration < ESB_SIM_RETRANSMIT_DELAY)) {
+            duration = ESB_SIM_RETRANSMIT_DELAY;
+        }
+        sim_wait(duration);
+    }
+
+    result.acked = acked;
+    result.attempts = attempts;
+
+    if (p_frame->p_result != NULL) {
+        *p_frame->p_result = result;
+        *p_frame->p_done = 1;
+        pthread_cond_broadcast(&g_sim.done_cond);
+    }
+    g_sim.air_head = (g_sim.air_head + 1) % ESB_SIM_AIR_QUEUE_SIZE;
+    g_sim.air_count--;
+    pthread_cond_broadcast(&g_sim.done_cond);
+}
+
+static uint8_t sim_radio_tx_pending(void)
+{
+    return ((g_radio.initialized == 1) && (g_radio.config.mode == NRF_ESB_MODE_PTX) && (g_radio.tx_active == 1) &&
+            (g_radio.tx_fifo.count > 0));
+}
+
+static void *sim_radio_thread(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&g_sim.lock);
+    for (;;) {
+        if (sim_radio_tx_pending()) {
+            sim_radio_ptx_transaction();
+        } else if (g_sim.air_count > 0) {
+            sim_air_transaction();
+        } else {
+            pthread_cond_wait(&g_sim.work_cond, &g_sim.lock);
+        }
+        sim_dispatch_events();
+    }
+    return (NULL);
+}
+
+/*
+ * Simulation control
+ */
+
+int8_t esb_sim_init(const esb_sim_config_t *config)
+{
+    sim_lock();
+    g_sim.config = (config != NULL) ? *config : g_default_config;
+    g_sim.rand_state = (g_sim.config.seed != 0) ? g_sim.config.seed : 1;
+    g_sim.time_us = 0;
+    memset(&g_sim.stats, 0, sizeof(g_sim.stats));
+    memset(g_sim.nodes, 0, sizeof(g_sim.nodes));
+    memset(g_sim.interference, 0, sizeof(g_sim.interference));
+    sim_contenders_reset();
+    sim_unlock();
+
+    return (ESB_ERR_OK);
+}
+
+int8_t esb_sim_set_config(const esb_sim_config_t *config)
+{
+    if (config == NULL) {
+        return (ESB_ERR_PARAM);
+    }
+    sim_lock();
+    g_sim.config = *config;
+    sim_contenders_reset();
+    sim_unlock();
+
+    return (ESB_ERR_OK);
+}
+
+int8_t esb_sim_set_interference(uint8_t channel, uint16_t loss_permille)
+{
+    if (channel >= ESB_SIM_CHANNEL_NUM) {
+        return (ESB_ERR_PARAM);
+    }
+    sim_lock();
+    g_sim.interference[channel] = (loss_permille > 1000) ? 1000 : loss_permille;
+    sim_unlock();
+
+    return (ESB_ERR_OK);
+}
+
+int8_t esb_sim_node_add(const uint8_t addr[5], esb_sim_rx_callback_t rx_callback, esb_sim_node_t *p_node)
+{
+    if ((addr == NULL) || (p_node == NULL)) {
+        return (ESB_ERR_PARAM);
+    }
+
+    sim_lock();
+    for (esb_sim_node_t i = 0; i < ESB_SIM_MAX_NODES; i++) {
+        if (g_sim.nodes[i].used == 0) {
+            memset(&g_sim.nodes[i], 0, sizeof(sim_node_t));
+            g_sim.nodes[i].used = 1;
+            g_sim.nodes[i].rf_channel = ESB_SIM_DEFAULT_CHANNEL;
+            g_sim.nodes[i].bitrate = ESB_BITRATE_1MBPS;
+            g_sim.nodes[i].rx_callback = rx_callback;
+            memcpy(g_sim.nodes[i].addr, addr, 5);
+            *p_node = i;
+            sim_unlock();
+            return (ESB_ERR_OK);
+        }
+    }
+    sim_unlock();
+
+    return (ESB_ERR_PARAM);
+}
+
+int8_t esb_sim_node_remove(esb_sim_node_t node)
+{
+    sim_lock();
+    ESB_SIM_CHECK_NODE_PARAM(node);
+    g_sim.nodes[node].used = 0;
+    sim_unlock();
+
+    return (ESB_ERR_OK);
+}
+
+int8_t esb_sim_node_set_rf_channel(esb_sim_node_t node, uint8_t channel)
+{
+    sim_lock();
+    ESB_SIM_CHECK_NODE_PARAM(node);
+    g_sim.nodes[node].rf_channel = channel;
+    sim_unlock();
+
+    return (ESB_ERR_OK);
+}
+
+int8_t esb_sim_node_set_bitrate(esb_sim_node_t node, esb_bitrate_t bitrate)
+{
+    if (bitrate >= ESB_BITRATE_NUM) {
+        return (ESB_ERR_PARAM);
+    }
+    sim_lock();
+    ESB_SIM_CHECK_NODE_PARAM(node);
+    g_sim.nodes[node].bitrate = bitrate;
+    sim_unlock();
+
+    return (ESB_ERR_OK);
+}
+
+int8_t esb_sim_node_set_ack_payload(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length)
+{
+    if (payload_length > ESB_SIM_MAX_PAYLOAD_LEN) {
+        return (ESB_ERR_SIZE);
+    }
+
+    sim_lock();
+    ESB_SIM_CHECK_NODE_PARAM(node);
+    if ((payload == NULL) && (payload_length > 0)) {
+        sim_unlock();
+        return (ESB_ERR_PARAM);
+    }
+    memcpy(g_sim.nodes[node].ack_payload, payload, payload_length);
+    g_sim.nodes[node].ack_payload_length = payload_length;
+    sim_unlock();
+
+    return (ESB_ERR_OK);
+}
+
+int8_t esb_sim_node_send(esb_sim_node_t node, const uint8_t dest[5], const uint8_t *payload, uint8_t payload_length,
+                         esb_sim_tx_result_t *p_result)
+{
+    volatile uint8_t done = 0;
+
+    if ((dest == NULL) || (payload == NULL)) {
+        return (ESB_ERR_PARAM);
+    }
+    if ((payload_length == 0) || (payload_length > ESB_SIM_MAX_PAYLOAD_LEN)) {
+        return (ESB_ERR_SIZE);
+    }
+
+    sim_lock();
+    ESB_SIM_CHECK_NODE_PARAM(node);
+
+    uint8_t radio_thread = pthread_equal(pthread_self(), g_sim.thread);
+    if ((radio_thread != 0) && (p_result != NULL)) {
+        sim_unlock();
+        return (ESB_ERR_PARAM);
+    }
+
+    while (g_sim.air_count >= ESB_SIM_AIR_QUEUE_SIZE) {
+        if (radio_thread != 0) {
+            sim_unlock();
+            return (ESB_ERR_HAL);
+        }
+        pthread_cond_wait(&g_sim.done_cond, &g_sim.lock);
+    }
+
+    sim_air_frame_t *p_frame = &g_sim.air[(g_sim.air_head + g_sim.air_count) % ESB_SIM_AIR_QUEUE_SIZE];
+    p_frame->node = node;
+    memcpy(p_frame->dest, dest, 5);
+    memcpy(p_frame->data, payload, payload_length);
+    p_frame->length = payload_length;
+    p_frame->pid = g_sim.nodes[node].tx_pid;
+    p_frame->p_result = p_result;
+    p_frame->p_done = &done;
+    g_sim.nodes[node].tx_pid = (g_sim.nodes[node].tx_pid + 1) & 0x03;
+    g_sim.air_count++;
+    sim_signal_work();
+
+    if (p_result != NULL) {
+        while (done == 0) {
+            pthread_cond_wait(&g_sim.done_cond, &g_sim.lock);
+        }
+    }
+    sim_unlock();
+
+    return (ESB_ERR_OK);
+}
+
+uint64_t esb_sim_time_us(void)
+{
+    sim_lock();
+    uint64_t time_us = g_sim.time_us;
+    sim_unlock();
+
+    return (time_us);
+}
+
+void esb_sim_get_stats(esb_sim_stats_t *p_stats)
+{
+    if (p_stats == NULL) {
+        return;
+    }
+    sim_lock();
+    *p_stats = g_sim.stats;
+    sim_unlock();
+}
+
+void esb_sim_critical_region_enter(void)
+{
+    sim_lock();
+}
+
+void esb_sim_critical_region_exit(void)
+{
+    sim_unlock();
+}
+
+/*
+ * nrf_esb API of the local radio
+ */
+
+uint32_t nrf_esb_init(nrf_esb_config_t const *p_config)
+{
+    if (p_config == NULL) {
+        return (NRF_ERROR_NULL);
+    }
+
+    sim_lock();
+    g_sim.stats.radio_inits++;
+    g_radio.config = *p_config;
+    g_radio.generation++;
+    g_radio.tx_active = 0;
+    g_radio.rx_active = 0;
+    g_radio.int_flags = 0;
+    memset(&g_radio.tx_fifo, 0, sizeof(g_radio.tx_fifo));
+    memset(&g_radio.rx_fifo, 0, sizeof(g_radio.rx_fifo));
+    memset(g_radio.pids, 0, sizeof(g_radio.pids));
+    memset(g_radio.rx_info, 0, sizeof(g_radio.rx_info));
+
+    /* the address registers are reset to the ESB default values */
+    memcpy(g_radio.base_addr_0, g_default_base_addr_0, sizeof(g_radio.base_addr_0));
+    memcpy(g_radio.base_addr_1, g_default_base_addr_1, sizeof(g_radio.base_addr_1));
+    memcpy(g_radio.prefixes, g_default_prefixes, sizeof(g_radio.prefixes));
+
+    g_radio.initialized = 1;
+    sim_unlock();
+
+    return (NRF_SUCCESS);
+}
+
+uint32_t nrf_esb_suspend(void)
+{
+    sim_lock();
+    g_radio.generation++;
+    g_radio.tx_active = 0;
+    g_radio.rx_active = 0;
+    sim_unlock();
+
+    return (NRF_SUCCESS);
+}
+
+uint32_t nrf_esb_disable(void)
+{
+    sim_lock();
+    g_radio.generation++;
+    g_radio.tx_active = 0;
+    g_radio.rx_active = 0;
+    g_radio.initialized = 0;
+    sim_unlock();
+
+    return (NRF_SUCCESS);
+}
+
+bool nrf_esb_is_idle(void)
+{
+    sim_lock();
+    bool idle = (sim_radio_is_idle() == 1);
+    sim_unlock();
+
+    return (idle);
+}
+
+uint32_t nrf_esb_write_payload(nrf_esb_payload_t const *p_payload)
+{
+    uint32_t result = NRF_SUCCESS;
+
+    if (p_payload == NULL) {
+        return (NRF_ERROR_NULL);
+    }
+
+    sim_lock();
+    if (g_radio.initialized == 0) {
+        result = NRF_ERROR_INVALID_STATE;
+    } else if ((p_payload->length == 0) || (p_payload->length > NRF_ESB_MAX_PAYLOAD_LENGTH)) {
+        result = NRF_ERROR_INVALID_LENGTH;
+    } else if (p_payload->pipe >= NRF_ESB_PIPE_COUNT) {
+        result = NRF_ERROR_INVALID_PARAM;
+    } else if (g_radio.tx_fifo.count >= NRF_ESB_TX_FIFO_SIZE) {
+        result = NRF_ERROR_NO_MEM;
+    } else {
+        sim_fifo_push(&g_radio.tx_fifo, p_payload);
+        if ((g_radio.config.mode == NRF_ESB_MODE_PTX) && (g_radio.config.tx_mode == NRF_ESB_TXMODE_AUTO) &&
+            (g_radio.rx_active == 0)) {
+            g_radio.tx_active = 1;
+            sim_signal_work();
+        }
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_read_rx_payload(nrf_esb_payload_t *p_payload)
+{
+    uint32_t result = NRF_SUCCESS;
+
+    if (p_payload == NULL) {
+        return (NRF_ERROR_NULL);
+    }
+
+    sim_lock();
+    if (g_radio.initialized == 0) {
+        result = NRF_ERROR_INVALID_STATE;
+    } else if (g_radio.rx_fifo.count == 0) {
+        result = NRF_ERROR_NOT_FOUND;
+    } else {
+        *p_payload = g_radio.rx_fifo.items[0];
+        sim_fifo_remove(&g_radio.rx_fifo, 0);
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_start_tx(void)
+{
+    uint32_t result = NRF_SUCCESS;
+
+    sim_lock();
+    if (g_radio.initialized == 0) {
+        result = NRF_ERROR_INVALID_STATE;
+    } else if (sim_radio_is_idle() == 0) {
+        result = NRF_ERROR_BUSY;
+    } else if (g_radio.tx_fifo.count == 0) {
+        result = NRF_ERROR_BUFFER_EMPTY;
+    } else {
+        g_radio.tx_active = 1;
+        sim_signal_work();
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_start_rx(void)
+{
+    uint32_t result = NRF_SUCCESS;
+
+    sim_lock();
+    if (g_radio.initialized == 0) {
+        result = NRF_ERROR_INVALID_STATE;
+    } else if (sim_radio_is_idle() == 0) {
+        result = NRF_ERROR_BUSY;
+    } else {
+        g_radio.rx_active = 1;
+        sim_signal_work();
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_stop_rx(void)
+{
+    uint32_t result = NRF_SUCCESS;
+
+    sim_lock();
+    if (g_radio.rx_active == 0) {
+        result = NRF_ERROR_INVALID_STATE;
+    } else {
+        g_radio.rx_active = 0;
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_flush_tx(void)
+{
+    sim_lock();
+    if (g_radio.initialized == 0) {
+        sim_unlock();
+        return (NRF_ERROR_INVALID_STATE);
+    }
+    g_radio.tx_fifo.count = 0;
+    sim_unlock();
+
+    return (NRF_SUCCESS);
+}
+
+uint32_t nrf_esb_pop_tx(void)
+{
+    uint32_t result = NRF_SUCCESS;
+
+    sim_lock();
+    if (g_radio.initialized == 0) {
+        result = NRF_ERROR_INVALID_STATE;
+    } else if (g_radio.tx_fifo.count == 0) {
+        result = NRF_ERROR_BUFFER_EMPTY;
+    } else {
+        sim_fifo_remove(&g_radio.tx_fifo, 0);
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_flush_rx(void)
+{
+    sim_lock();
+    if (g_radio.initialized == 0) {
+        sim_unlock();
+        return (NRF_ERROR_INVALID_STATE);
+    }
+    g_radio.rx_fifo.count = 0;
+    sim_unlock();
+
+    return (NRF_SUCCESS);
+}
+
+/* common checks of the setters which require an idle radio */
+static uint32_t sim_radio_check_idle(void)
+{
+    if (g_radio.initialized == 0) {
+        return (NRF_ERROR_INVALID_STATE);
+    }
+    if (sim_radio_is_idle() == 0) {
+        return (NRF_ERROR_BUSY);
+    }
+    return (NRF_SUCCESS);
+}
+
+uint32_t nrf_esb_set_address_length(uint8_t length)
+{
+    if ((length < 3) || (length > 5)) {
+        return (NRF_ERROR_INVALID_PARAM);
+    }
+
+    sim_lock();
+    uint32_t result = sim_radio_check_idle();
+    if (result == NRF_SUCCESS) {
+        g_radio.addr_length = length;
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_set_base_address_0(uint8_t const *p_addr)
+{
+    if (p_addr == NULL) {
+        return (NRF_ERROR_NULL);
+    }
+
+    sim_lock();
+    uint32_t result = sim_radio_check_idle();
+    if (result == NRF_SUCCESS) {
+        memcpy(g_radio.base_addr_0, p_addr, sizeof(g_radio.base_addr_0));
+        g_sim.stats.addr_writes++;
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_set_base_address_1(uint8_t const *p_addr)
+{
+    if (p_addr == NULL) {
+        return (NRF_ERROR_NULL);
+    }
+
+    sim_lock();
+    uint32_t result = sim_radio_check_idle();
+    if (result == NRF_SUCCESS) {
+        memcpy(g_radio.base_addr_1, p_addr, sizeof(g_radio.base_addr_1));
+        g_sim.stats.addr_writes++;
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_set_prefixes(uint8_t const *p_prefixes, uint8_t num_pipes)
+{
+    if (p_prefixes == NULL) {
+        return (NRF_ERROR_NULL);
+    }
+    if (num_pipes > NRF_ESB_PIPE_COUNT) {
+        return (NRF_ERROR_INVALID_PARAM);
+    }
+
+    sim_lock();
+    uint32_t result = sim_radio_check_idle();
+    if (result == NRF_SUCCESS) {
+        memcpy(g_radio.prefixes, p_prefixes, num_pipes);
+        g_sim.stats.addr_writes++;
+        g_radio.pipes_enabled = (uint8_t)((1u << num_pipes) - 1);
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_update_prefix(uint8_t pipe, uint8_t prefix)
+{
+    if (pipe >= NRF_ESB_PIPE_COUNT) {
+        return (NRF_ERROR_INVALID_PARAM);
+    }
+
+    sim_lock();
+    uint32_t result = sim_radio_check_idle();
+    if (result == NRF_SUCCESS) {
+        g_radio.prefixes[pipe] = prefix;
+        g_sim.stats.addr_writes++;
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_enable_pipes(uint8_t enable_mask)
+{
+    sim_lock();
+    uint32_t result = sim_radio_check_idle();
+    if (result == NRF_SUCCESS) {
+        g_radio.pipes_enabled = enable_mask;
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_set_rf_channel(uint32_t channel)
+{
+    if (channel > 100) {
+        return (NRF_ERROR_INVALID_PARAM);
+    }
+
+    sim_lock();
+    uint32_t result = sim_radio_check_idle();
+    if (result == NRF_SUCCESS) {
+        g_radio.rf_channel = channel;
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_get_rf_channel(uint32_t *p_channel)
+{
+    if (p_channel == NULL) {
+        return (NRF_ERROR_NULL);
+    }
+
+    sim_lock();
+    *p_channel = g_radio.rf_channel;
+    sim_unlock();
+
+    return (NRF_SUCCESS);
+}
+
+uint32_t nrf_esb_set_tx_power(nrf_esb_tx_power_t tx_output_power)
+{
+    sim_lock();
+    uint32_t result = sim_radio_check_idle();
+    if (result == NRF_SUCCESS) {
+        g_radio.config.tx_output_power = tx_output_power;
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_set_retransmit_delay(uint16_t delay)
+{
+    sim_lock();
+    uint32_t result = sim_radio_check_idle();
+    if (result == NRF_SUCCESS) {
+        g_radio.config.retransmit_delay = delay;
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_set_retransmit_count(uint16_t count)
+{
+    sim_lock();
+    uint32_t result = sim_radio_check_idle();
+    if (result == NRF_SUCCESS) {
+        g_radio.config.retransmit_count = count;
+    }
+    sim_unlock();
+
+    return (result);
+}
+
+uint32_t nrf_esb_set_bitrate(nrf_esb_bitrate_t bitrate)
+{
+    sim_lock();
+    uint32_t result = sim_radio_check_idle();
+    if (result == NRF_SUCCESS) {
+        g_radio.config.bitrate = bitrate;
+    }
+    sim_unlock();
+
+    return (result);
+}
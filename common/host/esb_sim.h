@@ -0,0 +1,167 @@
+#ifndef ESB_SIM_H_
+#define ESB_SIM_H_
+
+/*!
+ * \file esb_sim.h
+ * \brief Simulated radio backend for host builds (ESB_HOST_BACKEND)
+ * \details The simulation replaces the nRF radio with a "virtual air" inside the host process. The
+ * local radio is driven through the regular nrf_esb API (see host/nrf_esb.h), so common/driver/esb.c
+ * and everything on top of it runs unmodified. Additional virtual nodes (e.g. a central or other
+ * peripherals) are created with ::esb_sim_node_add and can exchange frames with the local radio.
+ *
+ * All radio activity is executed by a dedicated thread, which takes the role of the radio interrupt:
+ * the nrf_esb event handler and the node RX callbacks are called from this thread.
+ *
+ * Contenders model other transmitters on the same channel which can't be heard by the virtual nodes. They
+ * send frames at random times and retransmit with the fixed ESB delay, an attempt of the local radio
+ * overlapping with one of them is lost for both.
+ *
+ * With a path loss configured, frames and ACKs are additionally lost when the TX power of the local radio minus
+ * the path loss gets close to the receiver sensitivity of the bitrate (-93 dBm at 1 Mbit/s, -89 dBm at 2 Mbit/s).
+ *
+ * Every air transaction advances a virtual clock by the estimated air time plus the configured latency.
+ * In realtime mode the radio thread additionally sleeps for that time, which makes timing measurements
+ * of the firmware main loop meaningful.
+ */
+
+#include <stdint.h>
+
+#include <common/driver/esb.h>
+
+#ifndef ESB_SIM_MAX_NODES
+#define ESB_SIM_MAX_NODES 16 /* max number of virtual nodes besides the local radio */
+#endif
+
+#ifndef ESB_SIM_MAX_CONTENDERS
+#define ESB_SIM_MAX_CONTENDERS 8 /* max number of contending transmitters (see esb_sim_config_t) */
+#endif
+
+#define ESB_SIM_MAX_PAYLOAD_LEN 32
+#define ESB_SIM_DEFAULT_CHANNEL 40
+#define ESB_SIM_CHANNEL_NUM 101 /* RF channels 0 to 100 */
+
+/*! \brief Parameters of the virtual air */
+typedef struct {
+    uint16_t loss_permille; /* Probability that a single frame or ACK gets lost on air, in 1/1000 */
+    uint32_t latency_us;    /* Additional latency per air transaction in microseconds */
+    uint8_t realtime;       /* 1: radio thread sleeps for the simulated air time, 0: only virtual time advances */
+    uint32_t seed;          /* Seed of the random generator used for frame loss */
+    uint8_t contenders;     /* Hidden transmitters sharing the channel with the local radio, 0 to disable */
+    uint32_t contender_interval_us; /* Mean time between two new frames of a contender */
+    uint8_t path_loss_db;   /* Path loss between the nodes and the local radio in dB, 0 to disable the range model */
+} esb_sim_config_t;
+
+/*! \brief Air statistics and register writes of the local radio */
+typedef struct {
+    uint32_t frames;      /* Number of frames sent on air (including retransmits) */
+    uint32_t frames_lost; /* Number of frames lost on air */
+    uint32_t acks_lost;   /* Number of ACKs lost on air */
+    uint32_t collisions;  /* Number of frames of the local radio lost in a collision with a contender */
+    uint64_t airtime_us;  /* Accumulated air time of all frames and ACKs */
+    uint32_t radio_inits; /* Number of nrf_esb_init() calls of the local radio */
+    uint32_t addr_writes; /* Number of writes to the base address and prefix registers of the local radio */
+} esb_sim_stats_t;
+
+/*! \brief Result of a transmission of a virtual node */
+typedef struct {
+    uint8_t acked;                                    /* 1 if the frame was acknowledged */
+    uint8_t attempts;                                 /* Number of attempts used */
+    uint8_t ack_payload[ESB_SIM_MAX_PAYLOAD_LEN];     /* ACK payload, if the receiver sent one */
+    uint8_t ack_payload_length;                       /* Length of the ACK payload, 0 if none */
+} esb_sim_tx_result_t;
+
+typedef int8_t esb_sim_node_t;
+
+/*! \brief Callback for frames received by a virtual node, called from the radio thread */
+typedef void (*esb_sim_rx_callback_t)(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length);
+
+/*! \brief Initialize (or reset) the virtual air
+ *  \details Removes all virtual nodes and resets the statistics and the virtual clock. The simulation
+ *           starts implicitly with a lossless default configuration on the first use of the nrf_esb API,
+ *           so calling this function is only required to change the parameters.
+ *  \param config[in]           Parameters of the virtual air, NULL for the default configuration
+ *  \retval ESB_ERR_OK          - OK
+ */
+int8_t esb_sim_init(const esb_sim_config_t *config);
+
+/*! \brief Change the parameters of the virtual air without resetting nodes and statistics
+ *  \retval ESB_ERR_OK          - OK
+ *  \retval ESB_ERR_PARAM       - NULL Pointer
+ */
+int8_t esb_sim_set_config(const esb_sim_config_t *config);
+
+/*! \brief Inject interference on an RF channel, e.g. a Wi-Fi network or a microwave oven
+ *  \details Frames and ACKs on the channel are additionally lost with the given probability. Cleared by
+ *           esb_sim_init().
+ *  \param channel[in]          RF channel
+ *  \param loss_permille[in]    Additional loss probability in 1/1000, 0 to remove the interference
+ *  \retval ESB_ERR_OK          - OK
+ *  \retval ESB_ERR_PARAM       - Invalid channel
+ */
+int8_t esb_sim_set_interference(uint8_t channel, uint16_t loss_permille);
+
+/*! \brief Add a virtual node
+ *  \param addr[in]             Pipeline address the node listens on
+ *  \param rx_callback[in]      Called for every frame the node receives, may be NULL
+ *  \param p_node[out]          Handle of the new node
+ *  \retval ESB_ERR_OK          - OK
+ *  \retval ESB_ERR_PARAM       - NULL Pointer or no free node slot (see ::ESB_SIM_MAX_NODES)
+ */
+int8_t esb_sim_node_add(const uint8_t addr[5], esb_sim_rx_callback_t rx_callback, esb_sim_node_t *p_node);
+
+/*! \brief Remove a virtual node
+ *  \retval ESB_ERR_OK          - OK
+ *  \retval ESB_ERR_PARAM       - Invalid node handle
+ */
+int8_t esb_sim_node_remove(esb_sim_node_t node);
+
+/*! \brief Set the RF channel of a virtual node (default ::ESB_SIM_DEFAULT_CHANNEL)
+ *  \retval ESB_ERR_OK          - OK
+ *  \retval ESB_ERR_PARAM       - Invalid node handle
+ */
+int8_t esb_sim_node_set_rf_channel(esb_sim_node_t node, uint8_t channel);
+
+/*! \brief Set the bitrate of a virtual node (default ESB_BITRATE_1MBPS)
+ *  \details Frames between the local radio and a node with a different bitrate are not received
+ *  \retval ESB_ERR_OK          - OK
+ *  \retval ESB_ERR_PARAM       - Invalid node handle or bitrate
+ */
+int8_t esb_sim_node_set_bitrate(esb_sim_node_t node, esb_bitrate_t bitrate);
+
+/*! \brief Set the payload the node attaches to the ACK of the next received frame
+ *  \retval ESB_ERR_OK          - OK
+ *  \retval ESB_ERR_PARAM       - Invalid node handle or NULL Pointer
+ *  \retval ESB_ERR_SIZE        - Invalid payload length
+ */
+int8_t esb_sim_node_set_ack_payload(esb_sim_node_t node, const uint8_t *payload, uint8_t payload_length);
+
+/*! \brief Send a frame from a virtual node
+ *  \details The frame is sent with the retransmit settings of the firmware (10 retransmits, 600us delay).
+ *           If p_result is not NULL, the call blocks until the transmission is finished. Frames sent from
+ *           an RX callback (radio thread) must be sent asynchronously (p_result = NULL).
+ *  \param node[in]             Sending node
+ *  \param dest[in]             Destination pipeline address
+ *  \param payload[in]          Frame data
+ *  \param payload_length[in]   Frame length
+ *  \param p_result[out]        Transmission result, NULL for asynchronous transmission
+ *  \retval ESB_ERR_OK          - OK
+ *  \retval ESB_ERR_PARAM       - Invalid node handle, NULL Pointer or blocking call from the radio thread
+ *  \retval ESB_ERR_SIZE        - Invalid payload length
+ *  \retval ESB_ERR_HAL         - Air queue full (asynchronous call from the radio thread)
+ */
+int8_t esb_sim_node_send(esb_sim_node_t node, const uint8_t dest[5], const uint8_t *payload, uint8_t payload_length,
+                         esb_sim_tx_result_t *p_result);
+
+/*! \brief Get the virtual time in microseconds */
+uint64_t esb_sim_time_us(void);
+
+/*! \brief Get the air statistics, reset by esb_sim_init() */
+void esb_sim_get_stats(esb_sim_stats_t *p_stats);
+
+/*! \brief Block the radio thread (used by CRITICAL_REGION_ENTER, may be nested) */
+void esb_sim_critical_region_enter(void);
+
+/*! \brief Release the radio thread (used by CRITICAL_REGION_EXIT) */
+void esb_sim_critical_region_exit(void);
+
+#endif /* ESB_SIM_H_ */
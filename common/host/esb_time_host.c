@@ -0,0 +1,22 @@
+#include <time.h>
+
+#include <common/driver/esb_time.h>
+
+/* one "cycle" is one microsecond on the host, the 32 bit counter wraps after 71 minutes */
+
+void esb_time_init(void)
+{
+}
+
+uint32_t esb_time_cycles(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint32_t)((uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u));
+}
+
+uint32_t esb_time_cycles_to_us(uint32_t cycles)
+{
+    return (cycles);
+}
@@ -0,0 +1,22 @@
+#ifndef NRF_ERROR_H_
+#define NRF_ERROR_H_
+
+/*
+ * Host stand-in for the NRF5 SDK error codes. Only the codes used by the esb-home modules and the
+ * simulated radio backend are defined, with the same values as in the SDK.
+ */
+
+#define NRF_ERROR_BASE_NUM (0x0)
+
+#define NRF_SUCCESS (NRF_ERROR_BASE_NUM + 0)          /* Successful command */
+#define NRF_ERROR_INTERNAL (NRF_ERROR_BASE_NUM + 3)   /* Internal Error */
+#define NRF_ERROR_NO_MEM (NRF_ERROR_BASE_NUM + 4)     /* No Memory for operation */
+#define NRF_ERROR_NOT_FOUND (NRF_ERROR_BASE_NUM + 5)  /* Not found */
+#define NRF_ERROR_INVALID_PARAM (NRF_ERROR_BASE_NUM + 7)  /* Invalid Parameter */
+#define NRF_ERROR_INVALID_STATE (NRF_ERROR_BASE_NUM + 8)  /* Invalid state, operation disallowed in this state */
+#define NRF_ERROR_INVALID_LENGTH (NRF_ERROR_BASE_NUM + 9) /* Invalid Length */
+#define NRF_ERROR_TIMEOUT (NRF_ERROR_BASE_NUM + 13)       /* Operation timed out */
+#define NRF_ERROR_NULL (NRF_ERROR_BASE_NUM + 14)          /* Null Pointer */
+#define NRF_ERROR_BUSY (NRF_ERROR_BASE_NUM + 17)          /* Busy */
+
+#endif /* NRF_ERROR_H_ */
@@ -0,0 +1,138 @@
+#ifndef NRF_ESB_H_
+#define NRF_ESB_H_
+
+/*
+ * Host stand-in for the NRF5 SDK Enhanced ShockBurst library (nrf_esb). The API and the types match
+ * the SDK, the radio is replaced by the simulated air of esb_sim.c. Events are delivered from the
+ * simulated radio thread, which takes the role of the radio interrupt.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nrf_error.h"
+
+#define NRF_ERROR_BUFFER_EMPTY (0x0100) /* Same value as in nrf_esb_error_codes.h */
+
+#define NRF_ESB_MAX_PAYLOAD_LENGTH 32 /* The maximum size of the payload */
+#define NRF_ESB_TX_FIFO_SIZE 8        /* The size of the transmission first-in, first-out buffer */
+#define NRF_ESB_RX_FIFO_SIZE 8        /* The size of the reception first-in, first-out buffer */
+#define NRF_ESB_PIPE_COUNT 8          /* The maximum number of pipes allowed in the API */
+
+/*! \brief Default radio parameters (same values as in the SDK) */
+#define NRF_ESB_DEFAULT_CONFIG                                                                                         \
+    {                                                                                                                  \
+        .protocol = NRF_ESB_PROTOCOL_ESB_DPL, .mode = NRF_ESB_MODE_PTX, .event_handler = 0,                            \
+        .bitrate = NRF_ESB_BITRATE_2MBPS, .crc = NRF_ESB_CRC_16BIT, .tx_output_power = NRF_ESB_TX_POWER_0DBM,          \
+        .retransmit_delay = 250, .retransmit_count = 3, .tx_mode = NRF_ESB_TXMODE_AUTO, .radio_irq_priority = 1,       \
+        .event_irq_priority = 2, .payload_length = 32, .selective_auto_ack = false                                     \
+    }
+
+typedef enum {
+    NRF_ESB_PROTOCOL_ESB,    /* Enhanced ShockBurst with fixed payload length */
+    NRF_ESB_PROTOCOL_ESB_DPL /* Enhanced ShockBurst with dynamic payload length */
+} nrf_esb_protocol_t;
+
+typedef enum {
+    NRF_ESB_MODE_PTX, /* Primary transmitter mode */
+    NRF_ESB_MODE_PRX  /* Primary receiver mode */
+} nrf_esb_mode_t;
+
+typedef enum {
+    NRF_ESB_BITRATE_2MBPS,     /* 2 Mb radio mode */
+    NRF_ESB_BITRATE_1MBPS,     /* 1 Mb radio mode */
+    NRF_ESB_BITRATE_1MBPS_BLE, /* 1 Mb radio mode using BLE */
+    NRF_ESB_BITRATE_2MBPS_BLE  /* 2 Mb radio mode using BLE */
+} nrf_esb_bitrate_t;
+
+typedef enum {
+    NRF_ESB_CRC_16BIT, /* Use two-byte CRC */
+    NRF_ESB_CRC_8BIT,  /* Use one-byte CRC */
+    NRF_ESB_CRC_OFF    /* Disable CRC */
+} nrf_esb_crc_t;
+
+typedef enum {
+    NRF_ESB_TX_POWER_8DBM = 8,
+    NRF_ESB_TX_POWER_4DBM = 4,
+    NRF_ESB_TX_POWER_0DBM = 0,
+    NRF_ESB_TX_POWER_NEG4DBM = -4,
+    NRF_ESB_TX_POWER_NEG8DBM = -8,
+    NRF_ESB_TX_POWER_NEG12DBM = -12,
+    NRF_ESB_TX_POWER_NEG16DBM = -16,
+    NRF_ESB_TX_POWER_NEG20DBM = -20,
+    NRF_ESB_TX_POWER_NEG30DBM = -30,
+    NRF_ESB_TX_POWER_NEG40DBM = -40
+} nrf_esb_tx_power_t;
+
+typedef enum {
+    NRF_ESB_TXMODE_AUTO,        /* Automatic TX mode: When the TX FIFO contains packets and the radio is idle,
+                                   packets are sent automatically */
+    NRF_ESB_TXMODE_MANUAL,      /* Manual TX mode: Packets are not sent until nrf_esb_start_tx() is called */
+    NRF_ESB_TXMODE_MANUAL_START /* Manual start TX mode: Packets are not sent until nrf_esb_start_tx() is called,
+                                   then transmission continues automatically until the FIFO is empty */
+} nrf_esb_tx_mode_t;
+
+typedef enum {
+    NRF_ESB_EVENT_TX_SUCCESS, /* Event triggered on TX success */
+    NRF_ESB_EVENT_TX_FAILED,  /* Event triggered on TX failure */
+    NRF_ESB_EVENT_RX_RECEIVED /* Event triggered on RX received */
+} nrf_esb_evt_id_t;
+
+typedef struct {
+    uint8_t length;                              /* Length of the packet */
+    uint8_t pipe;                                /* Pipe used for this payload */
+    int8_t rssi;                                 /* RSSI for the received packet */
+    uint8_t noack;                               /* Flag indicating that this packet will not be acknowledged */
+    uint8_t pid;                                 /* PID assigned during communication */
+    uint8_t data[NRF_ESB_MAX_PAYLOAD_LENGTH];    /* The payload data */
+} nrf_esb_payload_t;
+
+typedef struct {
+    nrf_esb_evt_id_t evt_id; /* Enhanced ShockBurst event ID */
+    uint32_t tx_attempts;    /* Number of TX retransmission attempts */
+} nrf_esb_evt_t;
+
+typedef void (*nrf_esb_event_handler_t)(nrf_esb_evt_t const *p_event);
+
+typedef struct {
+    nrf_esb_protocol_t protocol;           /* Enhanced ShockBurst protocol */
+    nrf_esb_mode_t mode;                   /* Enhanced ShockBurst mode */
+    nrf_esb_event_handler_t event_handler; /* Enhanced ShockBurst event handler */
+    nrf_esb_bitrate_t bitrate;             /* Enhanced ShockBurst bitrate mode */
+    nrf_esb_crc_t crc;                     /* Enhanced ShockBurst CRC mode */
+    nrf_esb_tx_power_t tx_output_power;    /* Enhanced ShockBurst radio transmission power mode */
+    uint16_t retransmit_delay;             /* The delay between each retransmission of unacknowledged packets */
+    uint16_t retransmit_count;             /* The number of retransmission attempts before transmission fail */
+    nrf_esb_tx_mode_t tx_mode;             /* Enhanced ShockBurst transmission mode */
+    uint8_t radio_irq_priority;            /* nRF radio interrupt priority */
+    uint8_t event_irq_priority;            /* ESB event interrupt priority */
+    uint8_t payload_length;                /* Length of the payload (maximum length depends on the platforms) */
+    bool selective_auto_ack;               /* Enable or disable selective auto acknowledgment */
+} nrf_esb_config_t;
+
+uint32_t nrf_esb_init(nrf_esb_config_t const *p_config);
+uint32_t nrf_esb_suspend(void);
+uint32_t nrf_esb_disable(void);
+bool nrf_esb_is_idle(void);
+uint32_t nrf_esb_write_payload(nrf_esb_payload_t const *p_payload);
+uint32_t nrf_esb_read_rx_payload(nrf_esb_payload_t *p_payload);
+uint32_t nrf_esb_start_tx(void);
+uint32_t nrf_esb_start_rx(void);
+uint32_t nrf_esb_stop_rx(void);
+uint32_t nrf_esb_flush_tx(void);
+uint32_t nrf_esb_pop_tx(void);
+uint32_t nrf_esb_flush_rx(void);
+uint32_t nrf_esb_set_address_length(uint8_t length);
+uint32_t nrf_esb_set_base_address_0(uint8_t const *p_addr);
+uint32_t nrf_esb_set_base_address_1(uint8_t const *p_addr);
+uint32_t nrf_esb_set_prefixes(uint8_t const *p_prefixes, uint8_t num_pipes);
+uint32_t nrf_esb_update_prefix(uint8_t pipe, uint8_t prefix);
+uint32_t nrf_esb_enable_pipes(uint8_t enable_mask);
+uint32_t nrf_esb_set_rf_channel(uint32_t channel);
+uint32_t nrf_esb_get_rf_channel(uint32_t *p_channel);
+uint32_t nrf_esb_set_tx_power(nrf_esb_tx_power_t tx_output_power);
+uint32_t nrf_esb_set_retransmit_delay(uint16_t delay);
+uint32_t nrf_esb_set_retransmit_count(uint16_t count);
+uint32_t nrf_esb_set_bitrate(nrf_esb_bitrate_t bitrate);
+
+#endif /* NRF_ESB_H_ */
@@ -0,0 +1,439 @@
+#include <stddef.h>
+#include <string.h>
+
+#include <common/commands/esb_cmd_def_common.h>
+#include <common/driver/esb.h>
+#include <common/driver/esb_time.h>
+#include <common/protocol/esb_channel.h>
+#include <common/sched/esb_sched.h>
+
+#define ESB_CHANNEL_IDX_ACTIVE 0
+#define ESB_CHANNEL_IDX_NUM 1
+#define ESB_CHANNEL_IDX_LIST 2
+
+#define ESB_CHANNEL_RF_MAX 100
+#define ESB_CHANNEL_EWMA_SHIFT 2  /* weight of a new frame in the score: 1/4 */
+#define ESB_CHANNEL_EWMA_FRAMES 8 /* frames per update taken into account, more don't move the score further */
+#define ESB_CHANNEL_AGE_SHIFT 2   /* scores of other hops move 1/4 towards unknown on every hop change */
+#define ESB_CHANNEL_HOP_NONE 0xFF
+
+#if (ESB_CHANNEL_MAX_HOPS > (ESB_PROTOCOL_MAX_PAYLOAD_LEN - ESB_CHANNEL_IDX_LIST))
+#error "ESB_CHANNEL_MAX_HOPS is too large, the hop sequence must fit into one message"
+#endif
+
+static const uint8_t g_default_sequence[] = ESB_CHANNEL_DEFAULT_SEQUENCE;
+#define ESB_CHANNEL_DEFAULT_NUM (sizeof(g_default_sequence) / sizeof(g_default_sequence[0]))
+
+static uint8_t g_initialized = 0;
+static uint8_t g_is_peripheral = 0;
+static uint8_t g_central_address[ESB_PIPE_ADDR_LENGTH] = {0};
+
+static uint8_t g_sequence[ESB_CHANNEL_MAX_HOPS];
+static uint8_t g_num_hops = 0;
+static uint8_t g_hop = 0;
+static uint8_t g_pending_hop = ESB_CHANNEL_HOP_NONE;
+static uint16_t g_scores[ESB_CHANNEL_MAX_HOPS];
+
+/* protocol counters at the last update, the differences are the frames sent on the active hop */
+static uint32_t g_last_tx_frames = 0;
+static uint32_t g_last_tx_failed = 0;
+static uint32_t g_last_tx_retransmits = 0;
+static uint8_t g_acked = 0;         /* a frame was acknowledged since the last esb_channel_process() */
+static uint8_t g_failed_in_row = 0; /* failed frames without an acknowledged one */
+
+static esb_channel_state_t g_state = ESB_CHANNEL_STATE_SYNCED;
+static uint8_t g_searched = 0;      /* hops probed in the current search cycle */
+static uint32_t g_search_cycles = 0; /* start of the search */
+static uint32_t g_backoff_cycles = 0;
+static esb_channel_stats_t g_stats = {0};
+
+static esb_cmd_table_item_t g_channel_cmd_table[] = {
+    /* COMMAND_ID               PAYLOAD_SIZE                FUNCTION_POINTER*/
+    {ESB_CMD_CHANNEL_MAP,       ESB_CMD_PAYLOAD_LEN_DYN,    esb_channel_cmd_fct_map},
+    {ESB_CMD_CHANNEL_QUALITY,   0,                          esb_channel_cmd_fct_quality},
+
+    /* last entry must be NULL-terminator */
+    {0,                         0,                          NULL}};
+
+static uint32_t esb_channel_elapsed_ms(uint32_t since_cycles)
+{
+    return (esb_time_cycles_to_us(esb_time_cycles() - since_cycles) / 1000);
+}
+
+/* difference of a protocol counter, the counters may have been reset in between */
+static uint32_t esb_channel_delta(uint32_t now, uint32_t *p_last)
+{
+    uint32_t delta = (now >= *p_last) ? (now - *p_last) : now;
+    *p_last = now;
+    return (delta);
+}
+
+/* account the frames completed since the last update to the active hop */
+static void esb_channel_update(void)
+{
+    esb_protocol_stats_t stats;
+    esb_protocol_get_stats(&stats);
+
+    uint32_t acked = esb_channel_delta(stats.counter[ESB_PROT_STAT_TX_FRAMES], &g_last_tx_frames);
+    uint32_t failed = esb_channel_delta(stats.counter[ESB_PROT_STAT_TX_FAILED], &g_last_tx_failed);
+    uint32_t retransmits = esb_channel_delta(stats.counter[ESB_PROT_STAT_TX_RETRANSMITS], &g_last_tx_retransmits);
+    uint32_t frames = acked + failed;
+
+    if (frames == 0) {
+        return;
+    }
+
+    uint32_t sample = ((frames + retransmits) * ESB_CHANNEL_SCORE_ONE) / frames;
+    uint16_t *p_score = &g_scores[g_hop];
+    for (uint32_t i = 0; (i < frames) && (i < ESB_CHANNEL_EWMA_FRAMES); i++) {
+        *p_score = (uint16_t)((int32_t)*p_score + (((int32_t)sample - (int32_t)*p_score) >> ESB_CHANNEL_EWMA_SHIFT));
+    }
+
+    if (acked > 0) {
+        g_acked = 1;
+        g_failed_in_row = 0;
+    } else {
+        uint32_t in_row = g_failed_in_row + failed;
+        g_failed_in_row = (in_row > 0xFF) ? 0xFF : (uint8_t)in_row;
+    }
+}
+
+/* move the radio to a hop, the frames sent so far are accounted to the old one */
+static esb_protocol_err_t esb_channel_set_hop(uint8_t hop)
+{
+    esb_channel_update();
+
+    if (hop == g_hop) {
+        return (ESB_PROT_ERR_OK);
+    }
+
+    int8_t result = esb_set_rf_channel(g_sequence[hop]);
+    if (result == ESB_ERR_BUSY) {
+        return (ESB_PROT_ERR_QUEUE_FULL);
+    } else if (result != ESB_ERR_OK) {
+        return (ESB_PROT_ERR_HAL);
+    }
+
+    g_hop = hop;
+    g_stats.hops++;
+
+    /* what was measured on the other hops gets outdated */
+    for (uint8_t i = 0; i < g_num_hops; i++) {
+        if (i != hop) {
+            int32_t score = g_scores[i];
+            g_scores[i] = (uint16_t)(score + ((ESB_CHANNEL_SCORE_UNKNOWN - score) >> ESB_CHANNEL_AGE_SHIFT));
+        }
+    }
+
+    return (ESB_PROT_ERR_OK);
+}
+
+static uint8_t esb_channel_sequence_valid(const uint8_t *p_channels, uint8_t num)
+{
+    if ((p_channels == NULL) || (num == 0) || (num > ESB_CHANNEL_MAX_HOPS)) {
+        return (0);
+    }
+    for (uint8_t i = 0; i < num; i++) {
+        if (p_channels[i] > ESB_CHANNEL_RF_MAX) {
+            return (0);
+        }
+    }
+    return (1);
+}
+
+/* take over a hop sequence, keeps the scores if it is unchanged */
+static void esb_channel_store_sequence(const uint8_t *p_channels, uint8_t num)
+{
+    if ((num == g_num_hops) && (memcmp(g_sequence, p_channels, num) == 0)) {
+        return;
+    }
+
+    memcpy(g_sequence, p_channels, num);
+    g_num_hops = num;
+    for (uint8_t i = 0; i < ESB_CHANNEL_MAX_HOPS; i++) {
+        g_scores[i] = ESB_CHANNEL_SCORE_UNKNOWN;
+    }
+}
+
+esb_protocol_err_t esb_channel_init(const uint8_t central_address[5])
+{
+    esb_protocol_stats_t stats;
+
+    g_initialized = 0;
+    g_is_peripheral = (central_address != NULL) ? 1 : 0;
+    if (central_address != NULL) {
+        memcpy(g_central_address, central_address, sizeof(g_central_address));
+    }
+
+    /* a longer default sequence is cut */
+    g_num_hops = 0;
+    esb_channel_store_sequence(g_default_sequence, (ESB_CHANNEL_DEFAULT_NUM > ESB_CHANNEL_MAX_HOPS)
+                                                       ? ESB_CHANNEL_MAX_HOPS
+                                                       : (uint8_t)ESB_CHANNEL_DEFAULT_NUM);
+    g_pending_hop = ESB_CHANNEL_HOP_NONE;
+    g_state = ESB_CHANNEL_STATE_SYNCED;
+    g_acked = 0;
+    g_failed_in_row = 0;
+    memset(&g_stats, 0, sizeof(g_stats));
+
+    esb_protocol_get_stats(&stats);
+    g_last_tx_frames = stats.counter[ESB_PROT_STAT_TX_FRAMES];
+    g_last_tx_failed = stats.counter[ESB_PROT_STAT_TX_FAILED];
+    g_last_tx_retransmits = stats.counter[ESB_PROT_STAT_TX_RETRANSMITS];
+
+    g_hop = 0;
+    if (esb_set_rf_channel(g_sequence[0]) != ESB_ERR_OK) {
+        return (ESB_PROT_ERR_HAL);
+    }
+
+    if (g_is_peripheral == 1) {
+        uint32_t num_entries = (sizeof(g_channel_cmd_table) / sizeof(g_channel_cmd_table[0])) - 1;
+        esb_protocol_err_t result = esb_commands_register_app_commands(g_channel_cmd_table, num_entries);
+        if (result != ESB_PROT_ERR_OK) {
+            return (ESB_PROT_ERR_MEM);
+        }
+    }
+    g_initialized = 1;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+esb_protocol_err_t esb_channel_set_sequence(const uint8_t *p_channels, uint8_t num)
+{
+    if (esb_channel_sequence_valid(p_channels, num) == 0) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    esb_channel_update();
+
+    int8_t result = esb_set_rf_channel(p_channels[0]);
+    if (result == ESB_ERR_BUSY) {
+        return (ESB_PROT_ERR_QUEUE_FULL);
+    } else if (result != ESB_ERR_OK) {
+        return (ESB_PROT_ERR_HAL);
+    }
+
+    g_num_hops = 0;
+    esb_channel_store_sequence(p_channels, num);
+    g_hop = 0;
+    g_pending_hop = ESB_CHANNEL_HOP_NONE;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+esb_protocol_err_t esb_channel_announce(const uint8_t address[5], uint8_t hop)
+{
+    if ((address == NULL) || (hop >= g_num_hops)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    esb_protocol_message_t message = {
+        .cmd = ESB_CMD_CHANNEL_MAP,
+        .error = ESB_PROT_REPLY_ERR_OK,
+        .payload_len = ESB_CHANNEL_MAP_LEN(g_num_hops),
+    };
+    memcpy(message.address, address, sizeof(message.address));
+    message.payload[ESB_CHANNEL_IDX_ACTIVE] = hop;
+    message.payload[ESB_CHANNEL_IDX_NUM] = g_num_hops;
+    memcpy(&(message.payload[ESB_CHANNEL_IDX_LIST]), g_sequence, g_num_hops);
+
+    esb_protocol_err_t result = esb_protocol_transmit(&message);
+    if (result == ESB_PROT_ERR_OK) {
+        g_pending_hop = hop;
+    }
+
+    return (result);
+}
+
+esb_protocol_err_t esb_channel_hop(uint8_t hop)
+{
+    if (hop >= g_num_hops) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    esb_protocol_err_t result = esb_channel_set_hop(hop);
+    if (result == ESB_PROT_ERR_OK) {
+        g_pending_hop = ESB_CHANNEL_HOP_NONE;
+    }
+
+    return (result);
+}
+
+uint8_t esb_channel_get_hop(void)
+{
+    return (g_hop);
+}
+
+uint8_t esb_channel_best_hop(void)
+{
+    uint8_t best = g_hop;
+
+    /* on equal scores the active hop wins, a hop change costs the announcements */
+    for (uint8_t i = 0; i < g_num_hops; i++) {
+        if (g_scores[i] < g_scores[best]) {
+            best = i;
+        }
+    }
+    return (best);
+}
+
+esb_channel_state_t esb_channel_get_state(void)
+{
+    return (g_state);
+}
+
+uint8_t esb_channel_get_quality(uint16_t *p_scores)
+{
+    if (p_scores != NULL) {
+        esb_channel_update();
+        memcpy(p_scores, g_scores, sizeof(g_scores));
+    }
+    return (g_num_hops);
+}
+
+void esb_channel_get_stats(esb_channel_stats_t *p_stats)
+{
+    if (p_stats != NULL) {
+        *p_stats = g_stats;
+    }
+}
+
+/* probe the next hop of the sequence with a poll to the central */
+static void esb_channel_search_step(void)
+{
+    if (g_searched >= g_num_hops) {
+        /* no answer on any hop, the central may be off or out of range */
+        g_state = ESB_CHANNEL_STATE_BACKOFF;
+        g_backoff_cycles = esb_time_cycles();
+        esb_sched_request_wakeup(ESB_CHANNEL_SEARCH_BACKOFF_MS * 1000);
+        return;
+    }
+
+    if (esb_channel_set_hop((uint8_t)((g_hop + 1) % g_num_hops)) != ESB_PROT_ERR_OK) {
+        return;
+    }
+
+    esb_protocol_message_t message = {
+        .cmd = ESB_CMD_POLL,
+        .error = ESB_PROT_REPLY_ERR_OK,
+        .payload_len = 0,
+    };
+    memcpy(message.address, g_central_address, sizeof(message.address));
+
+    if (esb_protocol_transmit(&message) == ESB_PROT_ERR_OK) {
+        g_searched++;
+        g_stats.probes++;
+        /* the poll is sent by the next esb_protocol_process() */
+        esb_sched_request_wakeup(0);
+    }
+}
+
+void esb_channel_process(void)
+{
+    if (g_initialized == 0) {
+        return;
+    }
+
+    esb_channel_update();
+    uint8_t acked = g_acked;
+    g_acked = 0;
+
+    if ((g_pending_hop != ESB_CHANNEL_HOP_NONE) && (esb_protocol_tx_idle() == 1)) {
+        /* the announcement is sent (central) or the frames on the old hop are completed (peripheral) */
+        if (esb_channel_set_hop(g_pending_hop) == ESB_PROT_ERR_OK) {
+            g_pending_hop = ESB_CHANNEL_HOP_NONE;
+        }
+        return;
+    }
+
+    if (g_is_peripheral == 0) {
+        return;
+    }
+
+    switch (g_state) {
+    case ESB_CHANNEL_STATE_SYNCED:
+        if (g_failed_in_row >= ESB_CHANNEL_LOST_FRAMES) {
+            g_state = ESB_CHANNEL_STATE_SEARCH;
+            g_searched = 0;
+            g_search_cycles = esb_time_cycles();
+            g_stats.searches++;
+            if (esb_protocol_tx_idle() == 1) {
+                esb_channel_search_step();
+            }
+        }
+        break;
+
+    case ESB_CHANNEL_STATE_SEARCH:
+        if (acked == 1) {
+            g_state = ESB_CHANNEL_STATE_SYNCED;
+            g_stats.last_search_ms = esb_channel_elapsed_ms(g_search_cycles);
+        } else if (esb_protocol_tx_idle() == 1) {
+            /* the poll on this hop failed */
+            esb_channel_search_step();
+        }
+        break;
+
+    case ESB_CHANNEL_STATE_BACKOFF:
+        if (acked == 1) {
+            g_state = ESB_CHANNEL_STATE_SYNCED;
+            g_stats.last_search_ms = esb_channel_elapsed_ms(g_search_cycles);
+        } else if (esb_channel_elapsed_ms(g_backoff_cycles) >= ESB_CHANNEL_SEARCH_BACKOFF_MS) {
+            g_state = ESB_CHANNEL_STATE_SEARCH;
+            g_searched = 0;
+            if (esb_protocol_tx_idle() == 1) {
+                esb_channel_search_step();
+            }
+        } else {
+            esb_sched_request_wakeup((ESB_CHANNEL_SEARCH_BACKOFF_MS - esb_channel_elapsed_ms(g_backoff_cycles)) * 1000);
+        }
+        break;
+    }
+}
+
+/* Channel map
+ * payload: 0: (uint8_t) active hop, 1: (uint8_t) number of hops, 2..: (uint8_t) RF channels of the hops
+ * answer: None, the peripheral moves to the active hop once its outgoing frames are completed
+ */
+void esb_channel_cmd_fct_map(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    answer->error = ESB_PROT_REPLY_NONE;
+
+    if (message->payload_len < ESB_CHANNEL_MAP_LEN(1)) {
+        return;
+    }
+
+    uint8_t hop = message->payload[ESB_CHANNEL_IDX_ACTIVE];
+    uint8_t num = message->payload[ESB_CHANNEL_IDX_NUM];
+
+    if ((message->payload_len != ESB_CHANNEL_MAP_LEN(num)) || (hop >= num) ||
+        (esb_channel_sequence_valid(&(message->payload[ESB_CHANNEL_IDX_LIST]), num) == 0)) {
+        return;
+    }
+
+    esb_channel_store_sequence(&(message->payload[ESB_CHANNEL_IDX_LIST]), num);
+    g_pending_hop = hop;
+    if (g_state != ESB_CHANNEL_STATE_SYNCED) {
+        /* the central is on the current hop */
+        g_state = ESB_CHANNEL_STATE_SYNCED;
+        g_stats.last_search_ms = esb_channel_elapsed_ms(g_search_cycles);
+    }
+    g_failed_in_row = 0;
+}
+
+/* Channel quality
+ * payload length must be 0
+ * answer payload: 0: (uint8_t) active hop, 1: (uint8_t) number of hops, 2..: (uint8_t) score per hop
+ * answer error: ESB_PROT_REPLY_ERR_OK
+ */
+void esb_channel_cmd_fct_quality(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    answer->error = ESB_PROT_REPLY_ERR_OK;
+
+    esb_channel_update();
+    answer->payload[ESB_CHANNEL_IDX_ACTIVE] = g_hop;
+    answer->payload[ESB_CHANNEL_IDX_NUM] = g_num_hops;
+    for (uint8_t i = 0; i < g_num_hops; i++) {
+        answer->payload[ESB_CHANNEL_IDX_LIST + i] = (g_scores[i] > 0xFF) ? 0xFF : (uint8_t)g_scores[i];
+    }
+    answer->payload_len = ESB_CHANNEL_MAP_LEN(g_num_hops);
+}
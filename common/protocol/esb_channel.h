@@ -0,0 +1,162 @@
+#ifndef ESB_CHANNEL_H_
+#define ESB_CHANNEL_H_
+
+/*!
+ * \file esb_channel.h
+ * \brief RF channel agility: channel quality, coordinated hopping and rediscovery of the central
+ * \details All nodes share a hop sequence of up to ESB_CHANNEL_MAX_HOPS RF channels, the active hop is the index
+ * of the channel in use. The module keeps a quality score per hop: the moving average of the attempts per sent
+ * frame (1.0 on a clean channel, retransmits and failed frames raise it), taken from the protocol statistics
+ * while the hop is active. Scores of hops not in use age towards ESB_CHANNEL_SCORE_UNKNOWN, so a channel that
+ * was bad a while ago is tried again.
+ *
+ * Central: selects a hop (e.g. esb_channel_best_hop()) and announces it with esb_channel_announce() to each
+ * peripheral. The central itself moves to the new hop once all announcements are sent.
+ *
+ * Peripheral (initialized with the central address): moves to the announced hop once its outgoing frames are
+ * completed. A peripheral that missed the announcement loses the central: after ESB_CHANNEL_LOST_FRAMES failed
+ * frames in a row without an acknowledged one it searches the hop sequence, on each hop it sends ESB_CMD_POLL to
+ * the central and stays on the first hop where the poll is acknowledged. After a full cycle without answer it
+ * waits ESB_CHANNEL_SEARCH_BACKOFF_MS before the next cycle.
+ *
+ * Payload of ESB_CMD_CHANNEL_MAP (sent by the central, no reply, the ESB ACK confirms it):
+ * Bytes:   |   0    |  1  |     2 : 2+NUM-1     |
+ * Value:   | ACTIVE | NUM | CHANNEL 0 ... NUM-1 |
+ *
+ * - ACTIVE:  Index of the hop to move to
+ * - NUM:     Number of hops of the sequence (1 to ESB_CHANNEL_MAX_HOPS)
+ * - CHANNEL: RF channels of the sequence (0 to 100)
+ *
+ * Reply of ESB_CMD_CHANNEL_QUALITY (no payload):
+ * Bytes:   |   0    |  1  |    2 : 2+NUM-1    |
+ * Value:   | ACTIVE | NUM | SCORE 0 ... NUM-1 |
+ *
+ * - SCORE:   Attempts per frame in 1/16 (16 = no retransmits), saturated at 255
+ *
+ * All functions must be called from the main loop (same context as esb_protocol_process()).
+ */
+
+#include <common/commands/esb_commands.h>
+#include <common/protocol/esb_protocol.h>
+#include <stdint.h>
+
+#ifndef ESB_CHANNEL_MAX_HOPS
+#define ESB_CHANNEL_MAX_HOPS 8 /* max length of the hop sequence */
+#endif
+
+#ifndef ESB_CHANNEL_DEFAULT_SEQUENCE
+/* default hop sequence, between the common Wi-Fi channels 1, 6 and 11, starting with ESB_DEFAULT_CHANNEL */
+#define ESB_CHANNEL_DEFAULT_SEQUENCE {40, 25, 50, 76, 88}
+#endif
+
+#ifndef ESB_CHANNEL_LOST_FRAMES
+#define ESB_CHANNEL_LOST_FRAMES 3 /* failed frames in a row after which a peripheral searches the central */
+#endif
+
+#ifndef ESB_CHANNEL_SEARCH_BACKOFF_MS
+#define ESB_CHANNEL_SEARCH_BACKOFF_MS 100 /* pause after a search cycle without answer of the central */
+#endif
+
+#define ESB_CHANNEL_SCORE_ONE 16                            /* score of a channel without retransmits */
+#define ESB_CHANNEL_SCORE_UNKNOWN (2 * ESB_CHANNEL_SCORE_ONE) /* score of a hop without history */
+
+#define ESB_CHANNEL_MAP_LEN(num) (2 + (num))
+
+/*! \brief Command IDs of the channel module */
+enum esb_cmd_id_channel {
+    ESB_CMD_CHANNEL_MAP = 0x15,     /* Announce the hop sequence and the active hop */
+    ESB_CMD_CHANNEL_QUALITY = 0x16, /* Get the quality scores of all hops */
+};
+
+/*! \brief State of the channel module */
+typedef enum {
+    ESB_CHANNEL_STATE_SYNCED = 0x00, /* On the hop of the central */
+    ESB_CHANNEL_STATE_SEARCH = 0x01, /* Peripheral lost the central and searches the hop sequence */
+    ESB_CHANNEL_STATE_BACKOFF = 0x02, /* Peripheral waits before the next search cycle */
+} esb_channel_state_t;
+
+/*! \brief Statistics of the channel module */
+typedef struct {
+    uint32_t hops;            /* Hop changes (announced, searched and local) */
+    uint32_t searches;        /* Times the central was lost */
+    uint32_t probes;          /* Polls sent while searching */
+    uint32_t last_search_ms;  /* Duration of the last completed search */
+} esb_channel_stats_t;
+
+/*! \brief Initialize the channel module with the default hop sequence and register its commands
+ *  \details Must be called after esb_protocol_init(), moves the radio to hop 0
+ *  \param central_address[in]      Pipeline address of the central on a peripheral, NULL on the central (no
+ *                                  commands are registered and the central is never searched)
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_HAL        - Setting the RF channel failed
+ *  \retval ESB_PROT_ERR_MEM        - Registration of the commands failed
+ */
+esb_protocol_err_t esb_channel_init(const uint8_t central_address[5]);
+
+/*! \brief Set the hop sequence, the scores are reset and the radio moves to hop 0
+ *  \param p_channels[in]           RF channels (0 to 100)
+ *  \param num[in]                  Number of hops (1 to ESB_CHANNEL_MAX_HOPS)
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_PARAM      - NULL Pointer, invalid number or channel
+ *  \retval ESB_PROT_ERR_QUEUE_FULL - Frames in flight, try again later
+ */
+esb_protocol_err_t esb_channel_set_sequence(const uint8_t *p_channels, uint8_t num);
+
+/*! \brief Announce a hop to a peripheral (central)
+ *  \details Queues ESB_CMD_CHANNEL_MAP with the hop sequence, the central moves to the hop in
+ *           esb_channel_process() once all outgoing messages are sent. Call once per peripheral.
+ *  \param address[in]              Pipeline address of the peripheral
+ *  \param hop[in]                  Index of the hop to move to
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_PARAM      - NULL Pointer or invalid hop
+ *  \retval ESB_PROT_ERR_QUEUE_FULL - Queue for outgoing messages is full
+ */
+esb_protocol_err_t esb_channel_announce(const uint8_t address[5], uint8_t hop);
+
+/*! \brief Move to a hop right away, without announcement
+ *  \param hop[in]                  Index of the hop
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_PARAM      - Invalid hop
+ *  \retval ESB_PROT_ERR_QUEUE_FULL - Frames in flight, try again later
+ */
+esb_protocol_err_t esb_channel_hop(uint8_t hop);
+
+/*! \brief Get the active hop
+ */
+uint8_t esb_channel_get_hop(void);
+
+/*! \brief Get the hop with the best (lowest) score
+ */
+uint8_t esb_channel_best_hop(void);
+
+/*! \brief Get the state of the channel module
+ */
+esb_channel_state_t esb_channel_get_state(void);
+
+/*! \brief Get the quality scores
+ *  \param p_scores[out]    Buffer for ESB_CHANNEL_MAX_HOPS scores in 1/16 attempts per frame
+ *  \returns number of hops
+ */
+uint8_t esb_channel_get_quality(uint16_t *p_scores);
+
+/*! \brief Get the statistics of the channel module
+ *  \param p_stats[out]     Buffer for the statistics
+ */
+void esb_channel_get_stats(esb_channel_stats_t *p_stats);
+
+/*! \brief Update the quality score, apply announced hops and search the central
+ *  \details Call from the main loop after esb_protocol_process(), requests a wakeup for the search backoff
+ *           (see esb_sched.h)
+ */
+void esb_channel_process(void);
+
+/* command functions of the channel module */
+void esb_channel_cmd_fct_map(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void esb_channel_cmd_fct_quality(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+
+/*! \brief Entries of the channel module for a static dispatch index (see ESB_COMMANDS_STATIC_INDEX) */
+#define ESB_CHANNEL_STATIC_ENTRIES                                                                                     \
+    ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_CHANNEL_MAP, ESB_CMD_PAYLOAD_LEN_DYN, esb_channel_cmd_fct_map),                   \
+        ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_CHANNEL_QUALITY, 0, esb_channel_cmd_fct_quality)
+
+#endif /* ESB_CHANNEL_H_ */
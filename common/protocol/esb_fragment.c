@@ -0,0 +1,427 @@
+#include <stddef.h>
+#include <string.h>
+
+#include <common/driver/esb_time.h>
+#include <common/protocol/esb_fragment.h>
+#include <common/sched/esb_sched.h>
+
+#define ESB_FRAGMENT_IDX_TRANSFER_ID 0
+#define ESB_FRAGMENT_IDX_SEQ 1
+#define ESB_FRAGMENT_IDX_COUNT 2
+#define ESB_FRAGMENT_IDX_MSG_CMD 3
+#define ESB_FRAGMENT_IDX_DATA ESB_FRAGMENT_HEADER_SIZE
+
+#define ESB_FRAGMENT_ACK_IDX_TRANSFER_ID 0
+#define ESB_FRAGMENT_ACK_IDX_SEQ 1
+#define ESB_FRAGMENT_ACK_IDX_BASE 2
+#define ESB_FRAGMENT_ACK_IDX_RECEIVED 3
+
+#define ESB_FRAGMENT_MAX_COUNT ((ESB_FRAGMENT_MAX_LEN + ESB_FRAGMENT_DATA_LEN - 1) / ESB_FRAGMENT_DATA_LEN)
+#define ESB_FRAGMENT_BITMAP_WORDS ((ESB_FRAGMENT_MAX_COUNT + 31) / 32)
+
+/* a reassembly buffer is reused when its sender must have given up */
+#define ESB_FRAGMENT_RX_IDLE_MS (ESB_FRAGMENT_TIMEOUT_MS * (ESB_FRAGMENT_RETRIES + 1))
+
+#if (ESB_FRAGMENT_MAX_COUNT > 255)
+#error "ESB_FRAGMENT_MAX_LEN is too large, at most 255 fragments are supported"
+#endif
+
+#if (ESB_FRAGMENT_WINDOW < 1) || (ESB_FRAGMENT_WINDOW > 32)
+#error "ESB_FRAGMENT_WINDOW must be between 1 and 32"
+#endif
+
+/* state of the active outgoing transfer */
+typedef struct {
+    uint8_t active;
+    uint8_t address[ESB_PIPE_ADDR_LENGTH];
+    uint8_t transfer_id;
+    uint8_t cmd;
+    const uint8_t *p_data;
+    uint16_t length;
+    uint8_t count;       /* number of fragments */
+    uint8_t base;        /* all fragments before base are acknowledged */
+    uint8_t next;        /* next fragment sent for the first time */
+    uint32_t acked;       /* bit i: fragment base + i is acknowledged */
+    uint32_t resend;      /* bit i: fragment base + i has to be sent again */
+    uint32_t last_cycles; /* time of the last progress, for the timeout */
+    uint8_t retries;
+    esb_fragment_tx_callback_t callback;
+} esb_fragment_tx_t;
+
+/* reassembly buffer */
+typedef struct {
+    uint8_t in_use;
+    uint8_t address[ESB_PIPE_ADDR_LENGTH]; /* sender of the message */
+    uint8_t transfer_id;
+    uint8_t cmd;
+    uint8_t count;
+    uint8_t base;    /* all fragments before base are received */
+    uint8_t acked_base; /* base of the last acknowledge, the window of the sender starts there */
+    uint8_t gap;        /* the last acknowledge reported a missing fragment */
+    uint16_t length; /* message length, known once the last fragment is received */
+    uint32_t received[ESB_FRAGMENT_BITMAP_WORDS];
+    uint32_t last_cycles; /* time of the last received fragment, idle buffers are reused */
+    uint8_t data[ESB_FRAGMENT_MAX_LEN];
+} esb_fragment_rx_t;
+
+/* last completed incoming transfer, acknowledged again if its fragments are repeated */
+typedef struct {
+    uint8_t valid;
+    uint8_t address[ESB_PIPE_ADDR_LENGTH];
+    uint8_t transfer_id;
+    uint8_t count;
+} esb_fragment_rx_done_t;
+
+static uint8_t g_initialized = 0;
+static esb_fragment_tx_t g_tx = {0};
+static uint8_t g_next_transfer_id = 0;
+static esb_fragment_rx_t g_rx_buffers[ESB_FRAGMENT_RX_BUFFERS];
+static esb_fragment_rx_done_t g_rx_done = {0};
+static esb_fragment_rx_callback_t g_rx_callback = NULL;
+
+static esb_cmd_table_item_t g_fragment_cmd_table[] = {
+    /* COMMAND_ID           PAYLOAD_SIZE                FUNCTION_POINTER*/
+    {ESB_CMD_FRAGMENT,      ESB_CMD_PAYLOAD_LEN_DYN,    esb_fragment_cmd_fct_fragment},
+    {ESB_CMD_FRAGMENT_ACK,  ESB_FRAGMENT_ACK_LEN,       esb_fragment_cmd_fct_ack},
+
+    /* last entry must be NULL-terminator */
+    {0,                     0,                          NULL}};
+
+static uint32_t esb_fragment_elapsed_ms(uint32_t since_cycles)
+{
+    return (esb_time_cycles_to_us(esb_time_cycles() - since_cycles) / 1000);
+}
+
+esb_protocol_err_t esb_fragment_init(esb_fragment_rx_callback_t rx_callback)
+{
+    memset(&g_tx, 0, sizeof(g_tx));
+    memset(g_rx_buffers, 0, sizeof(g_rx_buffers));
+    memset(&g_rx_done, 0, sizeof(g_rx_done));
+    g_rx_callback = rx_callback;
+
+    uint32_t num_entries = (sizeof(g_fragment_cmd_table) / sizeof(g_fragment_cmd_table[0])) - 1;
+    esb_protocol_err_t result = esb_commands_register_app_commands(g_fragment_cmd_table, num_entries);
+    if (result != ESB_PROT_ERR_OK) {
+        return (ESB_PROT_ERR_MEM);
+    }
+    g_initialized = 1;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+/*
+ * Sender
+ */
+
+esb_protocol_err_t esb_fragment_send(const uint8_t address[5], uint8_t cmd, const uint8_t *p_data, uint16_t length,
+                                     esb_fragment_tx_callback_t callback)
+{
+    if (g_initialized == 0) {
+        return (ESB_PROT_ERR_INIT);
+    }
+
+    if ((address == NULL) || (p_data == NULL) || (length == 0) || (length > ESB_FRAGMENT_MAX_LEN)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    if (g_tx.active == 1) {
+        return (ESB_PROT_ERR_QUEUE_FULL);
+    }
+
+    memcpy(g_tx.address, address, sizeof(g_tx.address));
+    g_tx.transfer_id = g_next_transfer_id++;
+    g_tx.cmd = cmd;
+    g_tx.p_data = p_data;
+    g_tx.length = length;
+    g_tx.count = (uint8_t)((length + ESB_FRAGMENT_DATA_LEN - 1) / ESB_FRAGMENT_DATA_LEN);
+    g_tx.base = 0;
+    g_tx.next = 0;
+    g_tx.acked = 0;
+    g_tx.resend = 0;
+    g_tx.retries = 0;
+    g_tx.last_cycles = esb_time_cycles();
+    g_tx.callback = callback;
+    g_tx.active = 1;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+uint8_t esb_fragment_tx_busy(void)
+{
+    return (g_tx.active);
+}
+
+static void esb_fragment_tx_finish(esb_protocol_err_t result)
+{
+    g_tx.active = 0;
+    if (g_tx.callback != NULL) {
+        g_tx.callback(result);
+    }
+}
+
+/* queue one fragment of the active transfer, returns ESB_PROT_ERR_QUEUE_FULL if it can't be queued right now */
+static esb_protocol_err_t esb_fragment_tx_queue(uint8_t seq)
+{
+    uint16_t offset = (uint16_t)seq * ESB_FRAGMENT_DATA_LEN;
+    uint16_t data_len = g_tx.length - offset;
+    if (data_len > ESB_FRAGMENT_DATA_LEN) {
+        data_len = ESB_FRAGMENT_DATA_LEN;
+    }
+
+    esb_protocol_message_t message = {
+        .cmd = ESB_CMD_FRAGMENT,
+        .error = ESB_PROT_REPLY_ERR_OK,
+        .payload_len = (uint8_t)(ESB_FRAGMENT_HEADER_SIZE + data_len),
+    };
+    memcpy(message.address, g_tx.address, sizeof(message.address));
+    message.payload[ESB_FRAGMENT_IDX_TRANSFER_ID] = g_tx.transfer_id;
+    message.payload[ESB_FRAGMENT_IDX_SEQ] = seq;
+    message.payload[ESB_FRAGMENT_IDX_COUNT] = g_tx.count;
+    message.payload[ESB_FRAGMENT_IDX_MSG_CMD] = g_tx.cmd;
+    memcpy(&(message.payload[ESB_FRAGMENT_IDX_DATA]), &(g_tx.p_data[offset]), data_len);
+
+    return (esb_protocol_transmit(&message));
+}
+
+void esb_fragment_process(void)
+{
+    if (g_tx.active == 0) {
+        return;
+    }
+
+    /* repeat the fragments reported missing, then continue with new fragments within the window */
+    while (g_tx.resend != 0) {
+        uint8_t bit = 0;
+        while ((g_tx.resend & (1u << bit)) == 0) {
+            bit++;
+        }
+        if (esb_fragment_tx_queue(g_tx.base + bit) != ESB_PROT_ERR_OK) {
+            return;
+        }
+        g_tx.resend &= ~(1u << bit);
+    }
+
+    while ((g_tx.next < g_tx.count) && ((g_tx.next - g_tx.base) < ESB_FRAGMENT_WINDOW)) {
+        if (esb_fragment_tx_queue(g_tx.next) != ESB_PROT_ERR_OK) {
+            return;
+        }
+        g_tx.next++;
+    }
+
+    if (esb_fragment_elapsed_ms(g_tx.last_cycles) >= ESB_FRAGMENT_TIMEOUT_MS) {
+        /* no acknowledge, repeat all unacknowledged fragments that were sent */
+        if (++g_tx.retries > ESB_FRAGMENT_RETRIES) {
+            esb_fragment_tx_finish(ESB_PROT_ERR_TIMEOUT);
+            return;
+        }
+        uint8_t sent = g_tx.next - g_tx.base;
+        uint32_t sent_mask = (sent >= 32) ? 0xFFFFFFFFu : ((1u << sent) - 1);
+        g_tx.resend = sent_mask & ~g_tx.acked;
+        g_tx.last_cycles = esb_time_cycles();
+    }
+
+    /* wake up for the timeout if no acknowledge arrives */
+    esb_sched_request_wakeup((ESB_FRAGMENT_TIMEOUT_MS - esb_fragment_elapsed_ms(g_tx.last_cycles)) * 1000);
+}
+
+void esb_fragment_cmd_fct_ack(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    answer->error = ESB_PROT_REPLY_NONE;
+
+    if ((g_tx.active == 0) || (message->payload[ESB_FRAGMENT_ACK_IDX_TRANSFER_ID] != g_tx.transfer_id) ||
+        (memcmp(message->address, g_tx.address, sizeof(g_tx.address)) != 0)) {
+        /* acknowledge of an old transfer */
+        return;
+    }
+
+    uint8_t seq = message->payload[ESB_FRAGMENT_ACK_IDX_SEQ];
+    uint8_t base = message->payload[ESB_FRAGMENT_ACK_IDX_BASE];
+    uint32_t received = (uint32_t)message->payload[ESB_FRAGMENT_ACK_IDX_RECEIVED] |
+                        ((uint32_t)message->payload[ESB_FRAGMENT_ACK_IDX_RECEIVED + 1] << 8) |
+                        ((uint32_t)message->payload[ESB_FRAGMENT_ACK_IDX_RECEIVED + 2] << 16) |
+                        ((uint32_t)message->payload[ESB_FRAGMENT_ACK_IDX_RECEIVED + 3] << 24);
+
+    if ((base > g_tx.next) || (seq >= g_tx.next) || (base < g_tx.base)) {
+        /* inconsistent or outdated acknowledge */
+        return;
+    }
+
+    g_tx.retries = 0;
+    g_tx.last_cycles = esb_time_cycles();
+
+    if (base >= g_tx.count) {
+        esb_fragment_tx_finish(ESB_PROT_ERR_OK);
+        return;
+    }
+
+    /* move the window, the receiver got the fragments in order, so the ones before seq which are still
+     * missing are lost */
+    uint8_t shift = base - g_tx.base;
+    g_tx.resend = (shift >= 32) ? 0 : (g_tx.resend >> shift);
+    g_tx.base = base;
+    g_tx.acked = received;
+
+    if (seq >= base) {
+        uint8_t upto = seq - base;
+        uint32_t lost_mask = (upto >= 31) ? 0xFFFFFFFFu : ((1u << (upto + 1)) - 1);
+        g_tx.resend |= lost_mask & ~received;
+    }
+}
+
+/*
+ * Receiver
+ */
+
+static uint8_t esb_fragment_rx_is_received(const esb_fragment_rx_t *p_rx, uint8_t seq)
+{
+    return ((p_rx->received[seq / 32] >> (seq % 32)) & 1u);
+}
+
+static void esb_fragment_rx_send_ack(const uint8_t address[5], uint8_t transfer_id, uint8_t seq, uint8_t base,
+                                     uint32_t received)
+{
+    esb_protocol_message_t message = {
+        .cmd = ESB_CMD_FRAGMENT_ACK,
+        .error = ESB_PROT_REPLY_ERR_OK,
+        .payload_len = ESB_FRAGMENT_ACK_LEN,
+    };
+    memcpy(message.address, address, sizeof(message.address));
+    message.payload[ESB_FRAGMENT_ACK_IDX_TRANSFER_ID] = transfer_id;
+    message.payload[ESB_FRAGMENT_ACK_IDX_SEQ] = seq;
+    message.payload[ESB_FRAGMENT_ACK_IDX_BASE] = base;
+    message.payload[ESB_FRAGMENT_ACK_IDX_RECEIVED] = (uint8_t)received;
+    message.payload[ESB_FRAGMENT_ACK_IDX_RECEIVED + 1] = (uint8_t)(received >> 8);
+    message.payload[ESB_FRAGMENT_ACK_IDX_RECEIVED + 2] = (uint8_t)(received >> 16);
+    message.payload[ESB_FRAGMENT_ACK_IDX_RECEIVED + 3] = (uint8_t)(received >> 24);
+
+    /* a lost acknowledge is repeated when the sender times out */
+    (void)esb_protocol_transmit(&message);
+}
+
+/* received bitmap relative to base */
+static uint32_t esb_fragment_rx_window(const esb_fragment_rx_t *p_rx)
+{
+    uint32_t window = 0;
+    for (uint8_t i = 0; (i < 32) && ((p_rx->base + i) < p_rx->count); i++) {
+        if (esb_fragment_rx_is_received(p_rx, p_rx->base + i)) {
+            window |= (1u << i);
+        }
+    }
+    return (window);
+}
+
+/* acknowledge the received fragments of a transfer in progress */
+static void esb_fragment_rx_ack(esb_fragment_rx_t *p_rx, uint8_t seq)
+{
+    esb_fragment_rx_send_ack(p_rx->address, p_rx->transfer_id, seq, p_rx->base, esb_fragment_rx_window(p_rx));
+    p_rx->acked_base = p_rx->base;
+    /* seq is received, a base at or before it is missing */
+    p_rx->gap = (p_rx->base <= seq) ? 1 : 0;
+}
+
+/* find the reassembly buffer of a transfer, or take a free (or the longest idle) one */
+static esb_fragment_rx_t *esb_fragment_rx_get(const uint8_t address[5], uint8_t transfer_id, uint8_t count)
+{
+    esb_fragment_rx_t *p_free = NULL;
+
+    for (uint8_t i = 0; i < ESB_FRAGMENT_RX_BUFFERS; i++) {
+        esb_fragment_rx_t *p_rx = &g_rx_buffers[i];
+        if (p_rx->in_use == 0) {
+            if (p_free == NULL) {
+                p_free = p_rx;
+            }
+        } else if ((p_rx->transfer_id == transfer_id) &&
+                   (memcmp(p_rx->address, address, ESB_PIPE_ADDR_LENGTH) == 0)) {
+            return ((p_rx->count == count) ? p_rx : NULL);
+        }
+    }
+
+    if (p_free == NULL) {
+        /* reuse a buffer whose sender gave up */
+        for (uint8_t i = 0; i < ESB_FRAGMENT_RX_BUFFERS; i++) {
+            if (esb_fragment_elapsed_ms(g_rx_buffers[i].last_cycles) >= ESB_FRAGMENT_RX_IDLE_MS) {
+                p_free = &g_rx_buffers[i];
+                break;
+            }
+        }
+    }
+
+    if (p_free != NULL) {
+        memset(p_free, 0, offsetof(esb_fragment_rx_t, data));
+        p_free->in_use = 1;
+        memcpy(p_free->address, address, ESB_PIPE_ADDR_LENGTH);
+        p_free->transfer_id = transfer_id;
+        p_free->count = count;
+    }
+
+    return (p_free);
+}
+
+void esb_fragment_cmd_fct_fragment(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    answer->error = ESB_PROT_REPLY_NONE;
+
+    if (message->payload_len <= ESB_FRAGMENT_HEADER_SIZE) {
+        return;
+    }
+
+    uint8_t transfer_id = message->payload[ESB_FRAGMENT_IDX_TRANSFER_ID];
+    uint8_t seq = message->payload[ESB_FRAGMENT_IDX_SEQ];
+    uint8_t count = message->payload[ESB_FRAGMENT_IDX_COUNT];
+    uint8_t data_len = message->payload_len - ESB_FRAGMENT_HEADER_SIZE;
+
+    if ((count == 0) || (count > ESB_FRAGMENT_MAX_COUNT) || (seq >= count) ||
+        ((seq < (count - 1)) && (data_len != ESB_FRAGMENT_DATA_LEN)) ||
+        ((((uint16_t)seq * ESB_FRAGMENT_DATA_LEN) + data_len) > ESB_FRAGMENT_MAX_LEN)) {
+        return;
+    }
+
+    if ((g_rx_done.valid == 1) && (g_rx_done.transfer_id == transfer_id) && (g_rx_done.count == count) &&
+        (memcmp(g_rx_done.address, message->address, ESB_PIPE_ADDR_LENGTH) == 0)) {
+        /* the final acknowledge got lost */
+        esb_fragment_rx_send_ack(message->address, transfer_id, seq, count, 0);
+        return;
+    }
+
+    esb_fragment_rx_t *p_rx = esb_fragment_rx_get(message->address, transfer_id, count);
+    if (p_rx == NULL) {
+        /* no buffer, the sender repeats the fragment after its timeout */
+        return;
+    }
+    p_rx->last_cycles = esb_time_cycles();
+
+    uint8_t duplicate = esb_fragment_rx_is_received(p_rx, seq);
+    if (duplicate == 0) {
+        memcpy(&(p_rx->data[(uint16_t)seq * ESB_FRAGMENT_DATA_LEN]), &(message->payload[ESB_FRAGMENT_IDX_DATA]),
+               data_len);
+        p_rx->received[seq / 32] |= (1u << (seq % 32));
+        if (seq == (count - 1)) {
+            p_rx->length = ((uint16_t)seq * ESB_FRAGMENT_DATA_LEN) + data_len;
+        }
+        p_rx->cmd = message->payload[ESB_FRAGMENT_IDX_MSG_CMD];
+        while ((p_rx->base < p_rx->count) && esb_fragment_rx_is_received(p_rx, p_rx->base)) {
+            p_rx->base++;
+        }
+    }
+
+    if (p_rx->base >= p_rx->count) {
+        esb_fragment_rx_send_ack(p_rx->address, transfer_id, seq, p_rx->count, 0);
+        if (g_rx_callback != NULL) {
+            g_rx_callback(p_rx->address, p_rx->cmd, p_rx->data, p_rx->length);
+        }
+        g_rx_done.valid = 1;
+        memcpy(g_rx_done.address, p_rx->address, ESB_PIPE_ADDR_LENGTH);
+        g_rx_done.transfer_id = transfer_id;
+        g_rx_done.count = count;
+        p_rx->in_use = 0;
+        return;
+    }
+
+    /* acknowledge at the end of the window the sender got with the last acknowledge, on the last fragment, on
+     * repeated fragments and once a reported gap is filled, the sender waits for it to move its window */
+    if ((duplicate == 1) || (seq == (count - 1)) ||
+        ((uint16_t)seq >= ((uint16_t)p_rx->acked_base + ESB_FRAGMENT_WINDOW - 1)) ||
+        ((p_rx->gap == 1) && (p_rx->base > p_rx->acked_base))) {
+        esb_fragment_rx_ack(p_rx, seq);
+    }
+}
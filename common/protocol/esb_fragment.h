@@ -0,0 +1,125 @@
+#ifndef ESB_FRAGMENT_H_
+#define ESB_FRAGMENT_H_
+
+/*!
+ * \file esb_fragment.h
+ * \brief Fragmentation and reassembly of messages larger than one frame
+ * \details A large message is sent as a train of ESB_CMD_FRAGMENT messages. Up to ESB_FRAGMENT_WINDOW
+ * fragments are in flight before the receiver has to acknowledge them. The window of the sender starts at the
+ * BASE of the last acknowledge. The receiver acknowledges at the end of that window, on the last fragment, on
+ * duplicates and once the first gap reported by the last acknowledge is filled with ESB_CMD_FRAGMENT_ACK, which
+ * lists the received fragments, and the sender repeats only the missing ones. Complete messages are passed to the receive
+ * callback, the reassembly buffers are taken from a fixed pool (ESB_FRAGMENT_RX_BUFFERS).
+ *
+ * Payload of a fragment (sent to the pipeline address of the receiver):
+ * Bytes:   |      0      |  1  |   2   |    3    |        4 : 24         |
+ * Value:   | TRANSFER_ID | SEQ | COUNT | MSG_CMD | DATA (up to 21 bytes) |
+ *
+ * - TRANSFER_ID: ID of the transfer, chosen by the sender
+ * - SEQ:         Index of the fragment (0 to COUNT - 1), all but the last fragment carry 21 data bytes
+ * - COUNT:       Number of fragments of the message
+ * - MSG_CMD:     Command ID of the large message, passed to the receive callback
+ *
+ * Payload of an acknowledge (sent to the PIPE address of the fragments):
+ * Bytes:   |      0      |  1  |   2  |        3 : 6         |
+ * Value:   | TRANSFER_ID | SEQ | BASE | RECEIVED (uint32 LE) |
+ *
+ * - SEQ:         Fragment that triggered the acknowledge
+ * - BASE:        All fragments before BASE are received, BASE = COUNT when the message is complete
+ * - RECEIVED:    Bit i is set if fragment BASE + i is received
+ *
+ * All functions must be called from the main loop (same context as esb_protocol_process()).
+ */
+
+#include <common/commands/esb_commands.h>
+#include <common/protocol/esb_protocol.h>
+#include <stdint.h>
+
+#ifndef ESB_FRAGMENT_MAX_LEN
+#define ESB_FRAGMENT_MAX_LEN 256 /* max size of a message in bytes */
+#endif
+
+#ifndef ESB_FRAGMENT_RX_BUFFERS
+#define ESB_FRAGMENT_RX_BUFFERS 2 /* number of messages that can be reassembled at the same time */
+#endif
+
+#ifndef ESB_FRAGMENT_WINDOW
+#define ESB_FRAGMENT_WINDOW 16 /* fragments sent before waiting for an acknowledge (1 to 32) */
+#endif
+
+#ifndef ESB_FRAGMENT_TIMEOUT_MS
+#define ESB_FRAGMENT_TIMEOUT_MS 50 /* time without acknowledge until the sender repeats the unacknowledged fragments */
+#endif
+
+#ifndef ESB_FRAGMENT_RETRIES
+#define ESB_FRAGMENT_RETRIES 5 /* timeouts in a row until a transfer fails */
+#endif
+
+#define ESB_FRAGMENT_HEADER_SIZE 4 /* TRANSFER_ID, SEQ, COUNT, MSG_CMD */
+#define ESB_FRAGMENT_DATA_LEN (ESB_PROTOCOL_MAX_PAYLOAD_LEN - ESB_FRAGMENT_HEADER_SIZE)
+#define ESB_FRAGMENT_ACK_LEN 7
+
+/*! \brief Command IDs of the fragmentation layer */
+enum esb_cmd_id_fragment {
+    ESB_CMD_FRAGMENT = 0x13,     /* Fragment of a large message */
+    ESB_CMD_FRAGMENT_ACK = 0x14, /* Acknowledge of received fragments */
+};
+
+/*! \brief Called when a message is completely received
+ *  \param address[in]      Pipeline address of the sender
+ *  \param cmd[in]          Command ID of the message (MSG_CMD)
+ *  \param p_data[in]       Message data, valid until the callback returns
+ *  \param length[in]       Message length
+ */
+typedef void (*esb_fragment_rx_callback_t)(const uint8_t address[5], uint8_t cmd, const uint8_t *p_data,
+                                           uint16_t length);
+
+/*! \brief Called when a transfer is completed
+ *  \param result[in]       ESB_PROT_ERR_OK if all fragments are acknowledged, ESB_PROT_ERR_TIMEOUT if the receiver
+ *                          didn't acknowledge after ESB_FRAGMENT_RETRIES timeouts
+ */
+typedef void (*esb_fragment_tx_callback_t)(esb_protocol_err_t result);
+
+/*! \brief Initialize the fragmentation layer and register its commands
+ *  \details Must be called after esb_protocol_init()
+ *  \param rx_callback[in]      Called for every completely received message, may be NULL
+ *  \retval ESB_PROT_ERR_OK     - OK
+ *  \retval ESB_PROT_ERR_MEM    - Registration of the commands failed
+ */
+esb_protocol_err_t esb_fragment_init(esb_fragment_rx_callback_t rx_callback);
+
+/*! \brief Start the transfer of a large message
+ *  \details The fragments are queued by esb_fragment_process(). Only one transfer can be active at a time.
+ *  \param address[in]          Pipeline address of the receiver
+ *  \param cmd[in]              Command ID of the message
+ *  \param p_data[in]           Message data, must stay valid until the transfer is completed
+ *  \param length[in]           Message length (1 to ESB_FRAGMENT_MAX_LEN)
+ *  \param callback[in]         Called when the transfer is completed, may be NULL
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_INIT       - Module not initialized
+ *  \retval ESB_PROT_ERR_PARAM      - NULL Pointer or invalid length
+ *  \retval ESB_PROT_ERR_QUEUE_FULL - A transfer is already active
+ */
+esb_protocol_err_t esb_fragment_send(const uint8_t address[5], uint8_t cmd, const uint8_t *p_data, uint16_t length,
+                                     esb_fragment_tx_callback_t callback);
+
+/*! \brief Check if a transfer is active
+ */
+uint8_t esb_fragment_tx_busy(void);
+
+/*! \brief Queue fragments of the active transfer and handle timeouts
+ *  \details Call from the main loop together with esb_protocol_process(), requests a wakeup for the timeout of
+ *           the active transfer (see esb_sched.h)
+ */
+void esb_fragment_process(void);
+
+/* command functions of the fragmentation layer */
+void esb_fragment_cmd_fct_fragment(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void esb_fragment_cmd_fct_ack(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+
+/*! \brief Entries of the fragmentation layer for a static dispatch index (see ESB_COMMANDS_STATIC_INDEX) */
+#define ESB_FRAGMENT_STATIC_ENTRIES                                                                                    \
+    ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_FRAGMENT, ESB_CMD_PAYLOAD_LEN_DYN, esb_fragment_cmd_fct_fragment),               \
+        ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_FRAGMENT_ACK, ESB_FRAGMENT_ACK_LEN, esb_fragment_cmd_fct_ack)
+
+#endif /* ESB_FRAGMENT_H_ */
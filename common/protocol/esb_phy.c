@@ -0,0 +1,632 @@
+#include <stddef.h>
+#include <string.h>
+
+#include <common/commands/esb_cmd_def_common.h>
+#include <common/driver/esb.h>
+#include <common/driver/esb_link.h>
+#include <common/driver/esb_time.h>
+#include <common/protocol/esb_phy.h>
+#include <common/sched/esb_sched.h>
+
+#define ESB_PHY_IDX_BITRATE 0
+#define ESB_PHY_IDX_TX_POWER 1
+#define ESB_PHY_IDX_LEVEL 1
+
+#define ESB_PHY_STATS_IDX_FRAMES 2
+#define ESB_PHY_STATS_IDX_FAILED 6
+#define ESB_PHY_STATS_IDX_SUCCESS 10
+#define ESB_PHY_STATS_IDX_FPS 12
+#define ESB_PHY_STATS_IDX_ENERGY 14
+
+#define ESB_PHY_RAMP_UP_US 130 /* radio ramp up, before the frame and before the ACK */
+#define ESB_PHY_ADDR_LEN 5
+#define ESB_PHY_CRC_LEN 2
+#define ESB_PHY_PCF_BITS 9
+
+/* radio current in uA, nRF52832 with DC/DC converter */
+#define ESB_PHY_RX_UA_1MBPS 5400
+#define ESB_PHY_RX_UA_2MBPS 5800
+
+/* trial steps of a peripheral: the new setting, the previous one, the default one */
+#define ESB_PHY_TRIAL_NEW 0
+#define ESB_PHY_TRIAL_PREVIOUS 1
+#define ESB_PHY_TRIAL_DEFAULT 2
+
+typedef struct {
+    uint32_t frames;
+    uint32_t failed;
+    uint32_t attempts;
+} esb_phy_counts_t;
+
+static const int8_t g_levels[] = ESB_PHY_POWER_LEVELS;
+#define ESB_PHY_NUM_LEVELS ((uint8_t)(sizeof(g_levels) / sizeof(g_levels[0])))
+
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+_Static_assert(ESB_PHY_NUM_LEVELS <= ESB_PHY_MAX_LEVELS, "too many ESB_PHY_POWER_LEVELS");
+#endif
+
+static uint8_t g_initialized = 0;
+static uint8_t g_is_peripheral = 0;
+static uint8_t g_central_address[ESB_PIPE_ADDR_LENGTH] = {0};
+
+static esb_bitrate_t g_bitrate = ESB_BITRATE_1MBPS;
+static uint8_t g_level = 0;
+static esb_bitrate_t g_prev_bitrate = ESB_BITRATE_1MBPS;
+static uint8_t g_prev_level = 0;
+
+/* setting to apply once the outgoing frames are sent */
+static uint8_t g_pending = 0;
+static esb_bitrate_t g_pending_bitrate = ESB_BITRATE_1MBPS;
+static uint8_t g_pending_level = 0;
+
+static esb_phy_state_t g_state = ESB_PHY_STATE_STABLE;
+static uint8_t g_trial_step = ESB_PHY_TRIAL_NEW;
+static uint32_t g_trial_cycles = 0;
+static uint32_t g_probe_cycles = 0;
+static uint8_t g_probe_sent = 0;
+
+/* protocol counters at the last update, the differences are accounted to the current setting */
+static uint32_t g_last_tx_frames = 0;
+static uint32_t g_last_tx_failed = 0;
+static uint32_t g_last_tx_retransmits = 0;
+static uint32_t g_last_rx_frames = 0;
+static uint8_t g_acked = 0;    /* a frame was acknowledged since the last esb_phy_process() */
+static uint8_t g_received = 0; /* a frame was received since the last esb_phy_process() */
+static uint8_t g_failed_in_row = 0;
+
+/* TX power policy */
+static esb_phy_counts_t g_window = {0};
+static uint16_t g_last_success = 0; /* share of acknowledged attempts of the last window */
+static uint8_t g_last_valid = 0;
+static uint8_t g_stepped_down = 0;  /* the last window lowered the TX power */
+static uint8_t g_hold_len = 1;      /* windows a failed level is not retried, doubles with every failure */
+static uint8_t g_hold_count = 0;
+static uint8_t g_bitrate_hold_len[ESB_BITRATE_NUM];
+static uint8_t g_bitrate_hold[ESB_BITRATE_NUM]; /* windows a bitrate which failed its trial is not proposed */
+
+static esb_phy_counts_t g_counts[ESB_BITRATE_NUM][ESB_PHY_MAX_LEVELS];
+static esb_phy_counters_t g_counters = {0};
+
+static esb_cmd_table_item_t g_phy_cmd_table[] = {
+    /* COMMAND_ID               PAYLOAD_SIZE                FUNCTION_POINTER*/
+    {ESB_CMD_PHY_SET,           ESB_PHY_SET_LEN,            esb_phy_cmd_fct_set},
+    {ESB_CMD_PHY_GET_STATS,     ESB_PHY_GET_STATS_LEN,      esb_phy_cmd_fct_get_stats},
+
+    /* last entry must be NULL-terminator */
+    {0,                         0,                          NULL}};
+
+static uint32_t esb_phy_elapsed_ms(uint32_t since_cycles)
+{
+    return (esb_time_cycles_to_us(esb_time_cycles() - since_cycles) / 1000);
+}
+
+/* difference of a protocol counter, the counters may have been reset in between */
+static uint32_t esb_phy_delta(uint32_t now, uint32_t *p_last)
+{
+    uint32_t delta = (now >= *p_last) ? (now - *p_last) : now;
+    *p_last = now;
+    return (delta);
+}
+
+static uint32_t esb_phy_tx_current_ua(int8_t tx_power)
+{
+    switch (tx_power) {
+    case 4:
+        return (7500);
+    case 0:
+        return (5300);
+    case -4:
+        return (4200);
+    case -8:
+        return (3800);
+    case -12:
+        return (3300);
+    case -16:
+        return (3000);
+    case -20:
+        return (2700);
+    default:
+        return (2300);
+    }
+}
+
+/* on-air duration of a frame in microseconds */
+static uint32_t esb_phy_airtime_us(uint8_t length, esb_bitrate_t bitrate)
+{
+    uint32_t preamble = (bitrate == ESB_BITRATE_2MBPS) ? 2 : 1;
+    uint32_t bits = (8 * (preamble + ESB_PHY_ADDR_LEN + length + ESB_PHY_CRC_LEN)) + ESB_PHY_PCF_BITS;
+
+    return ((bitrate == ESB_BITRATE_2MBPS) ? ((bits + 1) / 2) : bits);
+}
+
+/* account the frames completed since the last update to the current setting */
+static void esb_phy_update(void)
+{
+    esb_protocol_stats_t stats;
+    esb_protocol_get_stats(&stats);
+
+    uint32_t acked = esb_phy_delta(stats.counter[ESB_PROT_STAT_TX_FRAMES], &g_last_tx_frames);
+    uint32_t failed = esb_phy_delta(stats.counter[ESB_PROT_STAT_TX_FAILED], &g_last_tx_failed);
+    uint32_t retransmits = esb_phy_delta(stats.counter[ESB_PROT_STAT_TX_RETRANSMITS], &g_last_tx_retransmits);
+
+    if (esb_phy_delta(stats.counter[ESB_PROT_STAT_RX_FRAMES], &g_last_rx_frames) > 0) {
+        g_received = 1;
+    }
+
+    uint32_t frames = acked + failed;
+    if (frames == 0) {
+        return;
+    }
+
+    esb_phy_counts_t *p_counts = &g_counts[g_bitrate][g_level];
+    p_counts->frames += frames;
+    p_counts->failed += failed;
+    p_counts->attempts += frames + retransmits;
+
+    if (g_state == ESB_PHY_STATE_STABLE) {
+        g_window.frames += frames;
+        g_window.failed += failed;
+        g_window.attempts += frames + retransmits;
+    }
+
+    if (acked > 0) {
+        g_acked = 1;
+        g_failed_in_row = 0;
+    } else {
+        uint32_t in_row = g_failed_in_row + failed;
+        g_failed_in_row = (in_row > 0xFF) ? 0xFF : (uint8_t)in_row;
+    }
+}
+
+/* apply a setting, the frames sent so far are accounted to the old one */
+static esb_protocol_err_t esb_phy_apply(esb_bitrate_t bitrate, uint8_t level)
+{
+    esb_phy_update();
+
+    if ((bitrate == g_bitrate) && (level == g_level)) {
+        return (ESB_PROT_ERR_OK);
+    }
+
+    int8_t result = esb_set_phy(bitrate, g_levels[level]);
+    if (result == ESB_ERR_BUSY) {
+        return (ESB_PROT_ERR_QUEUE_FULL);
+    } else if (result != ESB_ERR_OK) {
+        return (ESB_PROT_ERR_HAL);
+    }
+
+    g_bitrate = bitrate;
+    g_level = level;
+    g_counters.switches++;
+    memset(&g_window, 0, sizeof(g_window));
+    g_failed_in_row = 0;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+/* start a trial of a setting, the current one is kept as previous setting */
+static void esb_phy_start_trial(esb_bitrate_t bitrate, uint8_t level, uint8_t step)
+{
+    esb_bitrate_t prev_bitrate = g_bitrate;
+    uint8_t prev_level = g_level;
+
+    if (esb_phy_apply(bitrate, level) != ESB_PROT_ERR_OK) {
+        return;
+    }
+    if (step == ESB_PHY_TRIAL_NEW) {
+        g_prev_bitrate = prev_bitrate;
+        g_prev_level = prev_level;
+    }
+
+    g_state = ESB_PHY_STATE_TRIAL;
+    g_trial_step = step;
+    g_trial_cycles = esb_time_cycles();
+    g_probe_sent = 0;
+    g_acked = 0;
+    g_received = 0;
+}
+
+static int8_t esb_phy_find_level(int8_t tx_power)
+{
+    for (uint8_t i = 0; i < ESB_PHY_NUM_LEVELS; i++) {
+        if (g_levels[i] == tx_power) {
+            return ((int8_t)i);
+        }
+    }
+    return (-1);
+}
+
+esb_protocol_err_t esb_phy_init(const uint8_t central_address[5])
+{
+    esb_protocol_stats_t stats;
+
+    g_initialized = 0;
+    g_is_peripheral = (central_address != NULL) ? 1 : 0;
+    if (central_address != NULL) {
+        memcpy(g_central_address, central_address, sizeof(g_central_address));
+    }
+
+    memset(g_counts, 0, sizeof(g_counts));
+    memset(&g_counters, 0, sizeof(g_counters));
+    memset(&g_window, 0, sizeof(g_window));
+    memset(g_bitrate_hold, 0, sizeof(g_bitrate_hold));
+    for (uint8_t i = 0; i < ESB_BITRATE_NUM; i++) {
+        g_bitrate_hold_len[i] = 1;
+    }
+    g_pending = 0;
+    g_state = ESB_PHY_STATE_STABLE;
+    g_last_valid = 0;
+    g_stepped_down = 0;
+    g_hold_len = 1;
+    g_hold_count = 0;
+    g_acked = 0;
+    g_received = 0;
+    g_failed_in_row = 0;
+
+    esb_protocol_get_stats(&stats);
+    g_last_tx_frames = stats.counter[ESB_PROT_STAT_TX_FRAMES];
+    g_last_tx_failed = stats.counter[ESB_PROT_STAT_TX_FAILED];
+    g_last_tx_retransmits = stats.counter[ESB_PROT_STAT_TX_RETRANSMITS];
+    g_last_rx_frames = stats.counter[ESB_PROT_STAT_RX_FRAMES];
+
+    if (esb_set_phy(ESB_BITRATE_1MBPS, g_levels[0]) != ESB_ERR_OK) {
+        return (ESB_PROT_ERR_HAL);
+    }
+    g_bitrate = ESB_BITRATE_1MBPS;
+    g_level = 0;
+
+    if (g_is_peripheral == 1) {
+        uint32_t num_entries = (sizeof(g_phy_cmd_table) / sizeof(g_phy_cmd_table[0])) - 1;
+        esb_protocol_err_t result = esb_commands_register_app_commands(g_phy_cmd_table, num_entries);
+        if (result != ESB_PROT_ERR_OK) {
+            return (ESB_PROT_ERR_MEM);
+        }
+    }
+    g_initialized = 1;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+esb_protocol_err_t esb_phy_set(esb_bitrate_t bitrate, uint8_t level)
+{
+    if ((bitrate >= ESB_BITRATE_NUM) || (level >= ESB_PHY_NUM_LEVELS)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    esb_protocol_err_t result = esb_phy_apply(bitrate, level);
+    if (result == ESB_PROT_ERR_OK) {
+        g_pending = 0;
+        g_state = ESB_PHY_STATE_STABLE;
+    }
+
+    return (result);
+}
+
+esb_protocol_err_t esb_phy_announce(const uint8_t address[5], esb_bitrate_t bitrate)
+{
+    if ((address == NULL) || (bitrate >= ESB_BITRATE_NUM)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    esb_protocol_message_t message = {
+        .cmd = ESB_CMD_PHY_SET,
+        .error = ESB_PROT_REPLY_ERR_OK,
+        .payload_len = ESB_PHY_SET_LEN,
+    };
+    memcpy(message.address, address, sizeof(message.address));
+    message.payload[ESB_PHY_IDX_BITRATE] = (uint8_t)bitrate;
+    message.payload[ESB_PHY_IDX_TX_POWER] = (uint8_t)g_levels[0];
+
+    esb_protocol_err_t result = esb_protocol_transmit(&message);
+    if (result == ESB_PROT_ERR_OK) {
+        g_pending = 1;
+        g_pending_bitrate = bitrate;
+        g_pending_level = 0;
+    }
+
+    return (result);
+}
+
+esb_bitrate_t esb_phy_best_bitrate(void)
+{
+    if (g_last_valid == 0) {
+        return (g_bitrate);
+    }
+
+    if (g_bitrate == ESB_BITRATE_1MBPS) {
+        /* 2 Mbit/s needs about 4 dB more signal, only try it with enough TX power in reserve */
+        if ((g_bitrate_hold[ESB_BITRATE_2MBPS] == 0) && (g_last_success >= ESB_PHY_SUCCESS_PERMILLE) &&
+            ((g_levels[0] - g_levels[g_level]) >= ESB_PHY_2MBPS_MARGIN_DB)) {
+            return (ESB_BITRATE_2MBPS);
+        }
+    } else if ((g_level == 0) && (g_last_success < ESB_PHY_SUCCESS_PERMILLE)) {
+        return (ESB_BITRATE_1MBPS);
+    }
+
+    return (g_bitrate);
+}
+
+uint8_t esb_phy_get_level(void)
+{
+    return (g_level);
+}
+
+esb_phy_state_t esb_phy_get_state(void)
+{
+    return (g_state);
+}
+
+esb_protocol_err_t esb_phy_get_stats(esb_bitrate_t bitrate, uint8_t level, esb_phy_stats_t *p_stats)
+{
+    if ((p_stats == NULL) || (bitrate >= ESB_BITRATE_NUM) || (level >= ESB_PHY_NUM_LEVELS)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    esb_phy_update();
+
+    const esb_phy_counts_t *p_counts = &g_counts[bitrate][level];
+    memset(p_stats, 0, sizeof(esb_phy_stats_t));
+    p_stats->frames = p_counts->frames;
+    p_stats->failed = p_counts->failed;
+    p_stats->attempts = p_counts->attempts;
+
+    uint32_t delivered = p_counts->frames - p_counts->failed;
+    if ((p_counts->attempts == 0) || (delivered == 0)) {
+        return (ESB_PROT_ERR_OK);
+    }
+
+    /* an attempt is the frame and the ACK (or the wait for it), a retransmit starts after the retransmit delay */
+    uint32_t frame_us = ESB_PHY_RAMP_UP_US + esb_phy_airtime_us(ESB_PHY_REF_FRAME_LEN, bitrate);
+    uint32_t ack_us = ESB_PHY_RAMP_UP_US + esb_phy_airtime_us(0, bitrate);
+    uint32_t attempt_us = frame_us + ack_us;
+    uint32_t retransmit_us = (attempt_us > ESB_LINK_DELAY_MIN_US) ? attempt_us : ESB_LINK_DELAY_MIN_US;
+    uint64_t time_us = ((uint64_t)p_counts->frames * attempt_us) +
+                       ((uint64_t)(p_counts->attempts - p_counts->frames) * retransmit_us);
+
+    uint32_t rx_ua = (bitrate == ESB_BITRATE_2MBPS) ? ESB_PHY_RX_UA_2MBPS : ESB_PHY_RX_UA_1MBPS;
+    uint64_t attempt_nj = ((((uint64_t)esb_phy_tx_current_ua(g_levels[level]) * frame_us) + ((uint64_t)rx_ua * ack_us)) *
+                           ESB_PHY_SUPPLY_MV) / 1000000u;
+
+    p_stats->success_permille = (uint16_t)(((uint64_t)delivered * 1000) / p_counts->attempts);
+    p_stats->frames_per_s = (uint16_t)(((uint64_t)delivered * 1000000u) / time_us);
+    p_stats->energy_nj = (uint32_t)((attempt_nj * p_counts->attempts) / delivered);
+
+    return (ESB_PROT_ERR_OK);
+}
+
+void esb_phy_get_counters(esb_phy_counters_t *p_counters)
+{
+    if (p_counters != NULL) {
+        *p_counters = g_counters;
+    }
+}
+
+#if (ESB_PHY_POLICY == 1)
+/* the level after a step down doesn't work, wait longer before the next try */
+static void esb_phy_power_failed(void)
+{
+    if (g_stepped_down == 1) {
+        g_hold_len = (g_hold_len >= (ESB_PHY_HOLD_MAX_WINDOWS / 2)) ? ESB_PHY_HOLD_MAX_WINDOWS : (g_hold_len * 2);
+        g_hold_count = g_hold_len;
+    }
+    g_stepped_down = 0;
+}
+
+/* TX power policy, one decision per window of attempts */
+static void esb_phy_power_policy(void)
+{
+    if (g_window.attempts < ESB_PHY_WINDOW_ATTEMPTS) {
+        return;
+    }
+
+    uint16_t success = (uint16_t)(((g_window.frames - g_window.failed) * 1000) / g_window.attempts);
+    uint8_t level = g_level;
+
+    for (uint8_t i = 0; i < ESB_BITRATE_NUM; i++) {
+        if (g_bitrate_hold[i] > 0) {
+            g_bitrate_hold[i]--;
+        }
+    }
+
+    if (success < ESB_PHY_SUCCESS_PERMILLE) {
+        esb_phy_power_failed();
+        if (level > 0) {
+            level--;
+        }
+    } else if (g_hold_count > 0) {
+        g_hold_count--;
+        g_stepped_down = 0;
+    } else if (level < (ESB_PHY_NUM_LEVELS - 1)) {
+        if ((g_stepped_down == 1) && (g_hold_len > 1)) {
+            /* the last step worked */
+            g_hold_len /= 2;
+        }
+        level++;
+        g_stepped_down = 1;
+    } else {
+        g_stepped_down = 0;
+    }
+
+    g_last_success = success;
+    g_last_valid = 1;
+
+    if (esb_phy_apply(g_bitrate, level) == ESB_PROT_ERR_OK) {
+        memset(&g_window, 0, sizeof(g_window));
+    }
+}
+#endif
+
+/* poll the central during a trial, the ACK confirms that it uses the same setting */
+static void esb_phy_probe(void)
+{
+    if ((g_probe_sent == 1) && (esb_phy_elapsed_ms(g_probe_cycles) < ESB_PHY_PROBE_MS)) {
+        esb_sched_request_wakeup((ESB_PHY_PROBE_MS - esb_phy_elapsed_ms(g_probe_cycles)) * 1000);
+        return;
+    }
+    if (esb_protocol_tx_idle() == 0) {
+        return;
+    }
+
+    esb_protocol_message_t message = {
+        .cmd = ESB_CMD_POLL,
+        .error = ESB_PROT_REPLY_ERR_OK,
+        .payload_len = 0,
+    };
+    memcpy(message.address, g_central_address, sizeof(message.address));
+
+    if (esb_protocol_transmit(&message) == ESB_PROT_ERR_OK) {
+        g_probe_sent = 1;
+        g_probe_cycles = esb_time_cycles();
+        /* the poll is sent by the next esb_protocol_process() */
+        esb_sched_request_wakeup(0);
+    }
+}
+
+static void esb_phy_trial(uint8_t confirmed)
+{
+    if (confirmed == 1) {
+        g_state = ESB_PHY_STATE_STABLE;
+        return;
+    }
+
+    if (esb_phy_elapsed_ms(g_trial_cycles) < ESB_PHY_TRIAL_MS) {
+        if (g_is_peripheral == 1) {
+            esb_phy_probe();
+        } else {
+            esb_sched_request_wakeup((ESB_PHY_TRIAL_MS - esb_phy_elapsed_ms(g_trial_cycles)) * 1000);
+        }
+        return;
+    }
+
+    if (g_is_peripheral == 0) {
+        /* no peripheral followed, hold the bitrate for a while */
+        esb_bitrate_t failed = g_bitrate;
+        if (esb_phy_apply(g_prev_bitrate, g_prev_level) == ESB_PROT_ERR_OK) {
+            g_bitrate_hold[failed] = g_bitrate_hold_len[failed];
+            if (g_bitrate_hold_len[failed] < ESB_PHY_HOLD_MAX_WINDOWS) {
+                g_bitrate_hold_len[failed] *= 2;
+            }
+            g_counters.reverts++;
+            g_state = ESB_PHY_STATE_STABLE;
+        }
+    } else if ((g_trial_step == ESB_PHY_TRIAL_NEW) &&
+               ((g_prev_bitrate != g_bitrate) || (g_prev_level != g_level))) {
+        g_counters.reverts++;
+        esb_phy_start_trial(g_prev_bitrate, g_prev_level, ESB_PHY_TRIAL_PREVIOUS);
+    } else if ((g_bitrate != ESB_BITRATE_1MBPS) || (g_level != 0)) {
+        g_counters.fallbacks++;
+        esb_phy_start_trial(ESB_BITRATE_1MBPS, 0, ESB_PHY_TRIAL_DEFAULT);
+    } else {
+        /* the default setting, nothing else to try */
+        g_state = ESB_PHY_STATE_STABLE;
+    }
+}
+
+void esb_phy_process(void)
+{
+    if (g_initialized == 0) {
+        return;
+    }
+
+    esb_phy_update();
+    uint8_t acked = g_acked;
+    uint8_t received = g_received;
+    g_acked = 0;
+    g_received = 0;
+
+    if ((g_pending == 1) && (esb_protocol_tx_idle() == 1)) {
+        /* the announcements are sent (central) or the frames with the old setting are completed (peripheral) */
+        g_pending = 0;
+        esb_phy_start_trial(g_pending_bitrate, g_pending_level, ESB_PHY_TRIAL_NEW);
+        if (g_is_peripheral == 1) {
+            esb_phy_probe();
+        }
+        return;
+    }
+
+    if (g_state == ESB_PHY_STATE_TRIAL) {
+        /* the central also accepts frames received from a peripheral as confirmation */
+        esb_phy_trial(((acked == 1) || ((g_is_peripheral == 0) && (received == 1))) ? 1 : 0);
+        return;
+    }
+
+#if (ESB_PHY_POLICY == 1)
+    if ((g_failed_in_row >= ESB_PHY_LOST_FRAMES) && (g_level > 0)) {
+        /* frames lost after all retransmits, don't wait for the end of the window */
+        esb_phy_power_failed();
+        if (esb_phy_apply(g_bitrate, 0) == ESB_PROT_ERR_OK) {
+            g_failed_in_row = 0;
+        }
+        return;
+    }
+#endif
+
+    if ((g_is_peripheral == 1) && (g_failed_in_row >= ESB_PHY_LOST_FRAMES) &&
+        ((g_bitrate != ESB_BITRATE_1MBPS) || (g_level != 0))) {
+        /* the central may have returned to another setting, meet it at the default one */
+        g_counters.fallbacks++;
+        esb_phy_start_trial(ESB_BITRATE_1MBPS, 0, ESB_PHY_TRIAL_DEFAULT);
+        esb_phy_probe();
+        return;
+    }
+
+#if (ESB_PHY_POLICY == 1)
+    esb_phy_power_policy();
+#endif
+}
+
+/* Set bitrate and TX power
+ * payload: 0: (uint8_t) bitrate (esb_bitrate_t), 1: (int8_t) TX power in dBm
+ * answer: None, the peripheral switches once its outgoing frames are completed
+ */
+void esb_phy_cmd_fct_set(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    answer->error = ESB_PROT_REPLY_NONE;
+
+    uint8_t bitrate = message->payload[ESB_PHY_IDX_BITRATE];
+    int8_t level = esb_phy_find_level((int8_t)message->payload[ESB_PHY_IDX_TX_POWER]);
+
+    if ((bitrate >= ESB_BITRATE_NUM) || (level < 0)) {
+        return;
+    }
+
+    g_pending = 1;
+    g_pending_bitrate = (esb_bitrate_t)bitrate;
+    g_pending_level = (uint8_t)level;
+}
+
+static void esb_phy_put_u32(uint8_t *p_buf, uint32_t value)
+{
+    p_buf[0] = (uint8_t)value;
+    p_buf[1] = (uint8_t)(value >> 8);
+    p_buf[2] = (uint8_t)(value >> 16);
+    p_buf[3] = (uint8_t)(value >> 24);
+}
+
+/* Get the statistics of a setting
+ * payload: 0: (uint8_t) bitrate (esb_bitrate_t), 1: (uint8_t) TX power level
+ * answer payload: see esb_phy.h
+ * answer error: ESB_PROT_REPLY_ERR_OK if OK, ESB_PROT_REPLY_ERR_PARAM for an invalid bitrate or level
+ */
+void esb_phy_cmd_fct_get_stats(const esb_protocol_message_t *message, esb_protocol_message_t *answer)
+{
+    uint8_t bitrate = message->payload[ESB_PHY_IDX_BITRATE];
+    uint8_t level = message->payload[ESB_PHY_IDX_LEVEL];
+    esb_phy_stats_t stats;
+
+    if (esb_phy_get_stats((esb_bitrate_t)bitrate, level, &stats) != ESB_PROT_ERR_OK) {
+        answer->error = ESB_PROT_REPLY_ERR_PARAM;
+        return;
+    }
+
+    answer->error = ESB_PROT_REPLY_ERR_OK;
+    answer->payload[ESB_PHY_IDX_BITRATE] = bitrate;
+    answer->payload[ESB_PHY_IDX_TX_POWER] = (uint8_t)g_levels[level];
+    esb_phy_put_u32(&(answer->payload[ESB_PHY_STATS_IDX_FRAMES]), stats.frames);
+    esb_phy_put_u32(&(answer->payload[ESB_PHY_STATS_IDX_FAILED]), stats.failed);
+    answer->payload[ESB_PHY_STATS_IDX_SUCCESS] = (uint8_t)stats.success_permille;
+    answer->payload[ESB_PHY_STATS_IDX_SUCCESS + 1] = (uint8_t)(stats.success_permille >> 8);
+    answer->payload[ESB_PHY_STATS_IDX_FPS] = (uint8_t)stats.frames_per_s;
+    answer->payload[ESB_PHY_STATS_IDX_FPS + 1] = (uint8_t)(stats.frames_per_s >> 8);
+    esb_phy_put_u32(&(answer->payload[ESB_PHY_STATS_IDX_ENERGY]), stats.energy_nj);
+    answer->payload_len = ESB_PHY_STATS_REPLY_LEN;
+}
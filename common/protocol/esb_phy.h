@@ -0,0 +1,199 @@
+#ifndef ESB_PHY_H_
+#define ESB_PHY_H_
+
+/*!
+ * \file esb_phy.h
+ * \brief Runtime selection of bitrate and TX power
+ * \details A setting is a bitrate and a TX power level (ESB_PHY_POWER_LEVELS). The module accounts the frames
+ * sent with each setting (from the protocol TX counters) and estimates per setting the frames per second and
+ * the energy per delivered frame for a frame of ESB_PHY_REF_FRAME_LEN bytes, see esb_phy_get_stats().
+ *
+ * TX power is local to a node: with ESB_PHY_POLICY each node lowers its TX power one level per window of
+ * ESB_PHY_WINDOW_ATTEMPTS attempts while the share of acknowledged attempts stays above ESB_PHY_SUCCESS_PERMILLE
+ * and raises it when it drops below. A level that failed is retried after a hold time that doubles with every
+ * failure (up to ESB_PHY_HOLD_MAX_WINDOWS windows).
+ *
+ * The bitrate must be the same on both ends of a link, it is negotiated:
+ * - The central picks a bitrate, e.g. esb_phy_best_bitrate(): 2 Mbit/s when 1 Mbit/s works with at least
+ *   ESB_PHY_2MBPS_MARGIN_DB less than the highest TX power, back to 1 Mbit/s when 2 Mbit/s fails at the highest
+ *   TX power. It announces the bitrate with esb_phy_announce() to each peripheral and switches once all
+ *   announcements are sent.
+ * - A peripheral switches once its outgoing frames are completed and polls the central (ESB_CMD_POLL) every
+ *   ESB_PHY_PROBE_MS. Without an acknowledge within ESB_PHY_TRIAL_MS it returns to the previous setting and
+ *   polls again, then falls back to the default setting (1 Mbit/s, highest TX power), where all nodes meet.
+ * - The central returns to the previous setting if nothing is acknowledged or received during its trial, the
+ *   bitrate it left is held for a while (esb_phy_best_bitrate() doesn't propose it).
+ * A peripheral which loses the central (ESB_PHY_LOST_FRAMES failed frames in a row) on a setting other than the
+ * default one also falls back to the default setting.
+ *
+ * Payload of ESB_CMD_PHY_SET (sent by the central, no reply, the ESB ACK confirms it):
+ * Bytes:   |    0    |    1     |
+ * Value:   | BITRATE | TX_POWER |
+ *
+ * - BITRATE:  esb_bitrate_t
+ * - TX_POWER: TX power in dBm (int8_t) the peripheral starts with
+ *
+ * ESB_CMD_PHY_GET_STATS, payload: BITRATE, LEVEL (index into ESB_PHY_POWER_LEVELS)
+ * Bytes:   |    0    |    1     |     2:5     |     6:9     |      10:11       |   12:13   |    14:17    |
+ * Value:   | BITRATE | TX_POWER |   FRAMES    |   FAILED    | SUCCESS_PERMILLE |    FPS    |  ENERGY_NJ  |
+ * (multi-byte values little endian, see esb_phy_stats_t)
+ *
+ * All functions must be called from the main loop (same context as esb_protocol_process()).
+ */
+
+#include <common/commands/esb_commands.h>
+#include <common/driver/esb.h>
+#include <common/protocol/esb_protocol.h>
+#include <stdint.h>
+
+#ifndef ESB_PHY_POWER_LEVELS
+#define ESB_PHY_POWER_LEVELS {4, 0, -4, -8, -12, -16, -20} /* TX power levels in dBm, highest first */
+#endif
+
+#ifndef ESB_PHY_POLICY
+#define ESB_PHY_POLICY 1 /* 0: TX power only changes with esb_phy_set() and ESB_CMD_PHY_SET */
+#endif
+
+#ifndef ESB_PHY_WINDOW_ATTEMPTS
+#define ESB_PHY_WINDOW_ATTEMPTS 32 /* attempts (frames and retransmits) per decision of the TX power policy */
+#endif
+
+#ifndef ESB_PHY_SUCCESS_PERMILLE
+#define ESB_PHY_SUCCESS_PERMILLE 900 /* min share of acknowledged attempts of a usable setting */
+#endif
+
+#ifndef ESB_PHY_HOLD_MAX_WINDOWS
+#define ESB_PHY_HOLD_MAX_WINDOWS 64 /* max windows until a failed TX power level is retried */
+#endif
+
+#ifndef ESB_PHY_2MBPS_MARGIN_DB
+#define ESB_PHY_2MBPS_MARGIN_DB 8 /* TX power reserve at 1 Mbit/s before 2 Mbit/s is proposed */
+#endif
+
+#ifndef ESB_PHY_TRIAL_MS
+#define ESB_PHY_TRIAL_MS 100 /* time a new setting has to prove itself before it is abandoned */
+#endif
+
+#ifndef ESB_PHY_PROBE_MS
+#define ESB_PHY_PROBE_MS 10 /* interval of the polls of a peripheral during a trial */
+#endif
+
+#ifndef ESB_PHY_LOST_FRAMES
+#define ESB_PHY_LOST_FRAMES 3 /* failed frames in a row after which a peripheral falls back to the default */
+#endif
+
+#ifndef ESB_PHY_REF_FRAME_LEN
+#define ESB_PHY_REF_FRAME_LEN 32 /* frame length of the throughput and energy estimates */
+#endif
+
+#ifndef ESB_PHY_SUPPLY_MV
+#define ESB_PHY_SUPPLY_MV 3000 /* supply voltage of the energy estimate */
+#endif
+
+#define ESB_PHY_MAX_LEVELS 8
+#define ESB_PHY_SET_LEN 2
+#define ESB_PHY_GET_STATS_LEN 2
+#define ESB_PHY_STATS_REPLY_LEN 18
+
+/*! \brief Command IDs of the PHY module */
+enum esb_cmd_id_phy {
+    ESB_CMD_PHY_SET = 0x17,       /* Switch bitrate and TX power */
+    ESB_CMD_PHY_GET_STATS = 0x18, /* Get the statistics of a setting */
+};
+
+/*! \brief State of the PHY module */
+typedef enum {
+    ESB_PHY_STATE_STABLE = 0x00, /* Setting confirmed */
+    ESB_PHY_STATE_TRIAL = 0x01,  /* New setting not yet confirmed by the other end */
+} esb_phy_state_t;
+
+/*! \brief Statistics of a setting */
+typedef struct {
+    uint32_t frames;           /* Frames completed */
+    uint32_t failed;           /* Frames not acknowledged after all retransmits */
+    uint32_t attempts;         /* Attempts of all frames */
+    uint16_t success_permille; /* Share of acknowledged attempts */
+    uint16_t frames_per_s;     /* Estimated delivered frames per second of back-to-back frames */
+    uint32_t energy_nj;        /* Estimated radio energy per delivered frame in nJ */
+} esb_phy_stats_t;
+
+/*! \brief Counters of the negotiation */
+typedef struct {
+    uint32_t switches;  /* Settings applied (negotiated and TX power policy) */
+    uint32_t reverts;   /* Trials which returned to the previous setting */
+    uint32_t fallbacks; /* Returns to the default setting */
+} esb_phy_counters_t;
+
+/*! \brief Initialize the PHY module and register its commands
+ *  \details Must be called after esb_protocol_init(), applies the default setting (1 Mbit/s, highest TX power)
+ *  \param central_address[in]      Pipeline address of the central on a peripheral, NULL on the central (no
+ *                                  commands are registered)
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_HAL        - Setting bitrate or TX power failed
+ *  \retval ESB_PROT_ERR_MEM        - Registration of the commands failed
+ */
+esb_protocol_err_t esb_phy_init(const uint8_t central_address[5]);
+
+/*! \brief Apply a setting right away, without negotiation
+ *  \param bitrate[in]              Bitrate
+ *  \param level[in]                TX power level (index into ESB_PHY_POWER_LEVELS)
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_PARAM      - Invalid bitrate or level
+ *  \retval ESB_PROT_ERR_QUEUE_FULL - Frames in flight, try again later
+ *  \retval ESB_PROT_ERR_HAL        - Setting bitrate or TX power failed
+ */
+esb_protocol_err_t esb_phy_set(esb_bitrate_t bitrate, uint8_t level);
+
+/*! \brief Announce a bitrate to a peripheral (central)
+ *  \details Queues ESB_CMD_PHY_SET, the central switches in esb_phy_process() once all outgoing messages are
+ *           sent. Call once per peripheral.
+ *  \param address[in]              Pipeline address of the peripheral
+ *  \param bitrate[in]              Bitrate, the peripheral starts with the highest TX power
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_PARAM      - NULL Pointer or invalid bitrate
+ *  \retval ESB_PROT_ERR_QUEUE_FULL - Queue for outgoing messages is full
+ */
+esb_protocol_err_t esb_phy_announce(const uint8_t address[5], esb_bitrate_t bitrate);
+
+/*! \brief Get the bitrate proposed by the policy (see above)
+ */
+esb_bitrate_t esb_phy_best_bitrate(void);
+
+/*! \brief Get the current TX power level
+ */
+uint8_t esb_phy_get_level(void);
+
+/*! \brief Get the state of the PHY module
+ */
+esb_phy_state_t esb_phy_get_state(void);
+
+/*! \brief Get the statistics of a setting
+ *  \param bitrate[in]              Bitrate
+ *  \param level[in]                TX power level
+ *  \param p_stats[out]             Buffer for the statistics
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_PARAM      - NULL Pointer, invalid bitrate or level
+ */
+esb_protocol_err_t esb_phy_get_stats(esb_bitrate_t bitrate, uint8_t level, esb_phy_stats_t *p_stats);
+
+/*! \brief Get the counters of the negotiation
+ *  \param p_counters[out]  Buffer for the counters
+ */
+void esb_phy_get_counters(esb_phy_counters_t *p_counters);
+
+/*! \brief Account the sent frames, run the TX power policy and the negotiation
+ *  \details Call from the main loop after esb_protocol_process(), requests wakeups for the polls of a trial
+ *           (see esb_sched.h)
+ */
+void esb_phy_process(void);
+
+/* command functions of the PHY module */
+void esb_phy_cmd_fct_set(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+void esb_phy_cmd_fct_get_stats(const esb_protocol_message_t *message, esb_protocol_message_t *answer);
+
+/*! \brief Entries of the PHY module for a static dispatch index (see ESB_COMMANDS_STATIC_INDEX) */
+#define ESB_PHY_STATIC_ENTRIES                                                                                         \
+    ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_PHY_SET, ESB_PHY_SET_LEN, esb_phy_cmd_fct_set),                                  \
+        ESB_COMMANDS_STATIC_ENTRY(ESB_CMD_PHY_GET_STATS, ESB_PHY_GET_STATS_LEN, esb_phy_cmd_fct_get_stats)
+
+#endif /* ESB_PHY_H_ */
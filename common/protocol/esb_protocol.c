@@ -1,10 +1,14 @@
 
 #include <common/commands/esb_commands.h>
+#include <common/driver/esb_time.h>
 #include <common/protocol/esb_protocol.h>
+#include <common/protocol/esb_ring.h>
+#include <common/sched/esb_sched.h>
+#include <common/trace/esb_trace.h>
 #include <stdint.h>
 #include <string.h>
 
-#include "nrf_queue.h"
+#include "app_util_platform.h"
 
 #define ESB_PIPE_SEND ESB_PIPE_0
 #define ESB_PIPE_LISTENING ESB_PIPE_1
@@ -12,49 +16,410 @@
 #define ESB_FRAME_IDX_CMD 0
 #define ESB_FRAME_IDX_ERR 1
 #define ESB_FRAME_IDX_PIPE 2
-#define ESB_FRAME_IDX_PAYLOAD ESB_PROTOCOL_HEADER_SIZE
-
-#define ESB_MESSAGE_QUEUE_SIZE 5 /* up to 5 messages can be stored before processing */
-
-/* define message queues in NO_OVERFLOW mode, throws error when full (don't overwrite old items)*/
-NRF_QUEUE_DEF(esb_protocol_message_t, g_queue_tx, ESB_MESSAGE_QUEUE_SIZE, NRF_QUEUE_MODE_NO_OVERFLOW);
-NRF_QUEUE_DEF(esb_protocol_message_t, g_queue_rx, ESB_MESSAGE_QUEUE_SIZE, NRF_QUEUE_MODE_NO_OVERFLOW);
+#define ESB_FRAME_IDX_NODE_ID 2 /* compact header */
+
+/* Outgoing messages, queued and sent from the main loop */
+ESB_RING_DEF(esb_protocol_message_t, g_ring_tx, ESB_PROTOCOL_TX_QUEUE_SIZE);
+
+/* Received message */
+typedef struct {
+    esb_protocol_message_t message;
+    uint8_t ack_payload; /* received as ACK payload of a sent frame, never answered */
+    uint8_t sender;      /* entry of the sender in g_rx_senders */
+} esb_protocol_rx_slot_t;
+
+/* Received messages, produced by the radio interrupt and consumed by the main loop. The interrupt parses each
+ * frame once into the free element at the head, the command handler gets a reference to the element, which is
+ * popped after the handler returned. */
+ESB_RING_DEF(esb_protocol_rx_slot_t, g_ring_rx, ESB_PROTOCOL_RX_QUEUE_SIZE);
+
+/* Frames the radio interrupt couldn't queue, answered with ESB_PROT_REPLY_ERR_BUSY by the main loop */
+typedef struct {
+    uint8_t cmd;        /* command of the frame */
+    uint8_t request_id; /* request ID of the frame, ESB_PROT_REQ_ID_NONE if it has none */
+} esb_protocol_busy_t;
+
+ESB_RING_DEF(esb_protocol_busy_t, g_ring_busy, ESB_PROTOCOL_BUSY_QUEUE_SIZE);
+
+#if ESB_PROTOCOL_RX_FAIR
+/* senders of the queued incoming messages for the fair admission, an entry is used while its count isn't 0. The
+ * radio interrupt counts a message when it is queued, the main loop uncounts it before it is popped. */
+typedef struct {
+    uint8_t address[ESB_PIPE_ADDR_LENGTH];
+    uint8_t count; /* queued messages of the sender */
+} esb_protocol_rx_sender_t;
+
+static esb_protocol_rx_sender_t g_rx_senders[ESB_PROTOCOL_RX_QUEUE_SIZE];
+static uint8_t g_rx_sender_num = 0;  /* entries in use */
+static uint8_t g_rx_sender_last = 0; /* entry of the last queued message, a flooding sender is found first try */
+#endif
 
 static uint8_t g_initialized = 0;
 static uint8_t g_pipeline_address[ESB_PIPE_ADDR_LENGTH] = {0};
 
-static void esb_listener_callback(uint8_t *payload, uint8_t payload_length)
+static esb_protocol_rx_cycles_t g_rx_cycles = {0};
+static esb_protocol_stats_t g_stats = {0};
+static esb_protocol_reply_mode_t g_reply_mode = ESB_PROTOCOL_REPLY_MODE_DEFAULT;
+
+/* replies of the last requests with ID, replaced in round robin order */
+typedef struct {
+    uint8_t address[ESB_PIPE_ADDR_LENGTH]; /* sender of the request */
+    uint8_t cmd;                           /* command of the request */
+    uint8_t request_id;                    /* ESB_PROT_REQ_ID_NONE if the entry is unused */
+    esb_protocol_message_t answer;         /* reply, error ESB_PROT_REPLY_NONE if there was none */
+} esb_protocol_req_entry_t;
+
+static esb_protocol_req_entry_t g_req_cache[ESB_PROTOCOL_REQ_CACHE_SIZE];
+static uint8_t g_req_cache_next = 0;
+static uint8_t g_next_request_id = ESB_PROT_REQ_ID_NONE;
+
+/* node ID of this node, pipeline addresses of the node IDs assigned by the central */
+typedef struct {
+    uint8_t used;
+    uint8_t address[ESB_PIPE_ADDR_LENGTH];
+} esb_protocol_node_t;
+
+static uint8_t g_node_id = ESB_PROT_NODE_ID_NONE;
+static esb_protocol_node_t g_nodes[ESB_PROTOCOL_NODE_ID_NUM];
+
+/* back-off after a hint of a busy receiver, set by the radio interrupt */
+static uint8_t g_backoff_address[ESB_PIPE_ADDR_LENGTH];
+static uint32_t g_backoff_cycles;
+static volatile uint8_t g_backoff = 0;
+
+/* reply the radio couldn't take during a slice of esb_protocol_process_budget(), sent first by the next one */
+static esb_protocol_message_t g_reply_held_msg;
+static uint8_t g_reply_held = 0;
+
+static uint8_t esb_protocol_build_frame(const esb_protocol_message_t *message, uint8_t *p_frame);
+
+#if ESB_PROTOCOL_RX_FAIR
+/* entry of a sender in g_rx_senders, an unused one if it has no queued messages, called from the radio interrupt
+ * while the queue isn't full, so there is an unused entry */
+static uint8_t esb_protocol_rx_sender_find(const uint8_t *p_address)
+{
+    const esb_protocol_rx_sender_t *p_last = &g_rx_senders[g_rx_sender_last];
+    if ((p_last->count > 0) && (memcmp(p_last->address, p_address, ESB_PIPE_ADDR_LENGTH) == 0)) {
+        return (g_rx_sender_last);
+    }
+
+    uint8_t unused = ESB_PROTOCOL_RX_QUEUE_SIZE;
+    for (uint8_t i = 0; i < ESB_PROTOCOL_RX_QUEUE_SIZE; i++) {
+        if (g_rx_senders[i].count == 0) {
+            unused = (unused == ESB_PROTOCOL_RX_QUEUE_SIZE) ? i : unused;
+        } else if (memcmp(g_rx_senders[i].address, p_address, ESB_PIPE_ADDR_LENGTH) == 0) {
+            return (i);
+        }
+    }
+
+    return (unused);
+}
+
+/* the main loop is done with a queued message of a sender */
+static void esb_protocol_rx_sender_done(uint8_t sender)
+{
+    CRITICAL_REGION_ENTER();
+    g_rx_senders[sender].count--;
+    if (g_rx_senders[sender].count == 0) {
+        g_rx_sender_num--;
+    }
+    CRITICAL_REGION_EXIT();
+}
+#endif
+
+/* fair admission, called from the radio interrupt: once the queue for incoming messages is half full, a sender
+ * may only hold its share of the queue (depth / senders with queued messages) and the last quarter of the queue is
+ * kept for senders without queued messages. p_sender is set to the entry of the sender in g_rx_senders. */
+static uint8_t esb_protocol_rx_admit(const uint8_t *p_address, uint8_t *p_sender)
 {
-    if (payload == NULL) {
+    uint32_t used = esb_ring_count(&g_ring_rx);
+
+    if (used >= ESB_PROTOCOL_RX_QUEUE_SIZE) {
+        return (0);
+    }
+
+#if ESB_PROTOCOL_RX_FAIR
+    *p_sender = esb_protocol_rx_sender_find(p_address);
+    if (used >= (ESB_PROTOCOL_RX_QUEUE_SIZE / 2)) {
+        uint32_t own = g_rx_senders[*p_sender].count;
+        uint32_t senders = g_rx_sender_num + ((own == 0) ? 1 : 0);
+
+        if ((own > 0) && (((own * senders) >= ESB_PROTOCOL_RX_QUEUE_SIZE) ||
+                          (used >= (ESB_PROTOCOL_RX_QUEUE_SIZE - (ESB_PROTOCOL_RX_QUEUE_SIZE / 4))))) {
+            return (0);
+        }
+    }
+#else
+    *p_sender = 0;
+#endif
+
+    return (1);
+}
+
+/* a frame wasn't queued, called from the radio interrupt */
+static void esb_protocol_rx_reject(uint8_t cmd, uint8_t request_id)
+{
+    g_stats.counter[ESB_PROT_STAT_RX_DROPPED]++;
+
+#if ESB_PROTOCOL_BUSY_REPLY
+    esb_protocol_busy_t *p_busy = esb_ring_alloc(&g_ring_busy);
+    if (p_busy != NULL) {
+        p_busy->cmd = cmd;
+        p_busy->request_id = request_id;
+        esb_ring_commit(&g_ring_busy);
+        g_stats.counter[ESB_PROT_STAT_RX_BUSY]++;
+    }
+#endif
+}
+
+/* the queue for incoming messages just became full, called from the radio interrupt: attach a back-off hint to the
+ * ACK of the next frame, which won't be queued (frame reply mode, ACK payloads are discarded when the radio
+ * switches to transmit mode) */
+static void esb_protocol_busy_hint(void)
+{
+#if ESB_PROTOCOL_BUSY_HINT
+    if (g_reply_mode != ESB_PROT_REPLY_MODE_FRAME) {
+        /* the ACK payloads carry the queued replies, a hint would wait behind them */
         return;
     }
-    esb_protocol_message_t rx_msg;
-    rx_msg.cmd = payload[ESB_FRAME_IDX_CMD];
-    rx_msg.error = payload[ESB_FRAME_IDX_ERR];
-    rx_msg.payload_len = payload_length - ESB_PROTOCOL_HEADER_SIZE;
 
-    if (rx_msg.payload_len > 0) {
-        memcpy(rx_msg.payload, &(payload[ESB_FRAME_IDX_PAYLOAD]), rx_msg.payload_len);
+    esb_protocol_message_t hint = {.cmd = ESB_PROTOCOL_CMD_BUSY_HINT, .error = ESB_PROT_REPLY_ERR_BUSY};
+    uint8_t frame[ESB_FRAME_SIZE];
+    uint8_t frame_size = esb_protocol_build_frame(&hint, frame);
+
+    if (esb_write_ack_payload(ESB_PIPE_LISTENING, frame, frame_size) == ESB_ERR_OK) {
+        g_stats.counter[ESB_PROT_STAT_TX_BUSY_HINTS]++;
     }
-    nrf_queue_push(&g_queue_rx, &rx_msg);
+#endif
 }
 
-static void esb_protocol_send(const esb_pipeline_t pipeline, esb_protocol_message_t *message)
+/* parse a received frame into the queue for incoming messages, called from the radio interrupt
+ * ack_payload is set for the ACK payloads of sent frames, they are replies or notifications and aren't answered */
+static void esb_protocol_rx_frame(uint8_t *payload, uint8_t payload_length, uint8_t ack_payload)
+{
+    uint32_t start = esb_time_cycles();
+    uint8_t header_size = ESB_PROTOCOL_HEADER_SIZE;
+    uint8_t request_id = ESB_PROT_REQ_ID_NONE;
+    const uint8_t *p_address;
+
+    if ((payload == NULL) || (payload_length < ESB_PROTOCOL_COMPACT_HEADER_SIZE)) {
+        g_stats.counter[ESB_PROT_STAT_RX_INVALID]++;
+        return;
+    }
+
+    if ((payload[ESB_FRAME_IDX_ERR] & ESB_PROTOCOL_FLAG_COMPACT) != 0) {
+        /* the sender is identified by its node ID */
+        uint8_t node_id = payload[ESB_FRAME_IDX_NODE_ID];
+        if ((node_id >= ESB_PROTOCOL_NODE_ID_NUM) || (g_nodes[node_id].used == 0)) {
+            g_stats.counter[ESB_PROT_STAT_RX_INVALID]++;
+            return;
+        }
+        p_address = g_nodes[node_id].address;
+        header_size = ESB_PROTOCOL_COMPACT_HEADER_SIZE;
+    } else if (payload_length < ESB_PROTOCOL_HEADER_SIZE) {
+        g_stats.counter[ESB_PROT_STAT_RX_INVALID]++;
+        return;
+    } else {
+        p_address = &(payload[ESB_FRAME_IDX_PIPE]);
+    }
+
+    if ((payload[ESB_FRAME_IDX_ERR] & ESB_PROTOCOL_FLAG_REQ_ID) != 0) {
+        if ((payload_length <= header_size) || (payload[header_size] == ESB_PROT_REQ_ID_NONE)) {
+            g_stats.counter[ESB_PROT_STAT_RX_INVALID]++;
+            return;
+        }
+        request_id = payload[header_size];
+        header_size++;
+    }
+
+    if ((ack_payload != 0) && (payload[ESB_FRAME_IDX_CMD] == ESB_PROTOCOL_CMD_BUSY_HINT)) {
+        /* the receiver won't queue the next frames, hold the messages to it for a while */
+        memcpy(g_backoff_address, p_address, ESB_PIPE_ADDR_LENGTH);
+        g_backoff_cycles = esb_time_cycles();
+        g_backoff = 1;
+        g_stats.counter[ESB_PROT_STAT_RX_BUSY_HINTS]++;
+        return;
+    }
+
+    esb_protocol_rx_slot_t *p_slot = NULL;
+    uint8_t sender = 0;
+    if (esb_protocol_rx_admit(p_address, &sender) != 0) {
+        p_slot = esb_ring_alloc(&g_ring_rx);
+    }
+    if (p_slot == NULL) {
+        if (ack_payload != 0) {
+            /* nothing to answer, the message is lost */
+            g_stats.counter[ESB_PROT_STAT_RX_DROPPED]++;
+        } else {
+            /* queue full or sender over its share, the sender gets a BUSY reply instead */
+            esb_protocol_rx_reject(payload[ESB_FRAME_IDX_CMD], request_id);
+        }
+        return;
+    }
+
+    esb_protocol_message_t *p_message = &(p_slot->message);
+    p_message->cmd = payload[ESB_FRAME_IDX_CMD];
+    p_message->error = (esb_protocol_msg_err_t)(payload[ESB_FRAME_IDX_ERR] &
+                                                (uint8_t)~(ESB_PROTOCOL_FLAG_REQ_ID | ESB_PROTOCOL_FLAG_COMPACT));
+    p_message->request_id = request_id;
+    memcpy(p_message->address, p_address, ESB_PIPE_ADDR_LENGTH);
+    p_message->payload_len = payload_length - header_size;
+    memcpy(p_message->payload, &(payload[header_size]), p_message->payload_len);
+    p_slot->ack_payload = ack_payload;
+    p_slot->sender = sender;
+#if ESB_PROTOCOL_RX_FAIR
+    if (g_rx_senders[sender].count == 0) {
+        memcpy(g_rx_senders[sender].address, p_address, ESB_PIPE_ADDR_LENGTH);
+        g_rx_sender_num++;
+    }
+    g_rx_senders[sender].count++;
+    g_rx_sender_last = sender;
+#endif
+
+    ESB_TRACE(ESB_TRACE_EVT_RX_QUEUED, esb_ring_head(&g_ring_rx));
+    esb_ring_commit(&g_ring_rx);
+    g_stats.counter[ESB_PROT_STAT_RX_FRAMES]++;
+
+    uint32_t used = esb_ring_count(&g_ring_rx);
+    if (used > g_stats.counter[ESB_PROT_STAT_RX_QUEUE_MAX]) {
+        g_stats.counter[ESB_PROT_STAT_RX_QUEUE_MAX] = used;
+    }
+    if ((used == ESB_PROTOCOL_RX_QUEUE_SIZE) && (ack_payload == 0)) {
+        esb_protocol_busy_hint();
+    }
+
+    g_rx_cycles.isr_last = esb_time_cycles() - start;
+    if (g_rx_cycles.isr_last > g_rx_cycles.isr_max) {
+        g_rx_cycles.isr_max = g_rx_cycles.isr_last;
+    }
+}
+
+static void esb_listener_callback(uint8_t *payload, uint8_t payload_length)
+{
+    esb_protocol_rx_frame(payload, payload_length, 0);
+}
+
+/* ACK payload of a sent frame, called from the radio interrupt */
+static void esb_ack_payload_callback(uint8_t *payload, uint8_t payload_length)
+{
+    esb_protocol_rx_frame(payload, payload_length, 1);
+}
+
+/* completion of a sent frame, called from the radio interrupt */
+static void esb_protocol_tx_complete(const esb_tx_result_t *p_result, void *p_context)
+{
+    if (p_result->status == ESB_TX_SUCCESS) {
+        g_stats.counter[ESB_PROT_STAT_TX_FRAMES]++;
+    } else {
+        g_stats.counter[ESB_PROT_STAT_TX_FAILED]++;
+    }
+    if (p_result->attempts > 1) {
+        g_stats.counter[ESB_PROT_STAT_TX_RETRANSMITS] += p_result->attempts - 1;
+    }
+}
+
+/* write a message into a frame buffer of ESB_FRAME_SIZE bytes
+ * returns the frame size, 0 if the payload doesn't fit (node ID cleared after the message was queued) */
+static uint8_t esb_protocol_build_frame(const esb_protocol_message_t *message, uint8_t *p_frame)
+{
+    uint8_t header_size = ESB_PROTOCOL_HEADER_SIZE;
+    uint8_t max_payload_len = esb_protocol_max_payload_len();
+
+    if (message->payload_len > max_payload_len) {
+        return (0);
+    }
+
+    p_frame[ESB_FRAME_IDX_CMD] = message->cmd;
+    p_frame[ESB_FRAME_IDX_ERR] = message->error;
+    if (g_node_id != ESB_PROT_NODE_ID_NONE) {
+        p_frame[ESB_FRAME_IDX_ERR] |= ESB_PROTOCOL_FLAG_COMPACT;
+        p_frame[ESB_FRAME_IDX_NODE_ID] = g_node_id;
+        header_size = ESB_PROTOCOL_COMPACT_HEADER_SIZE;
+    } else {
+        memcpy(&(p_frame[ESB_FRAME_IDX_PIPE]), g_pipeline_address, sizeof(g_pipeline_address));
+    }
+
+    /* replies too long for the request ID are sent without it */
+    if ((message->request_id != ESB_PROT_REQ_ID_NONE) && (message->payload_len < max_payload_len)) {
+        p_frame[ESB_FRAME_IDX_ERR] |= ESB_PROTOCOL_FLAG_REQ_ID;
+        p_frame[header_size] = message->request_id;
+        header_size++;
+    }
+    memcpy(&(p_frame[header_size]), message->payload, message->payload_len);
+
+    return (message->payload_len + header_size);
+}
+
+/* reply of an already processed request with ID, NULL if there is none */
+static const esb_protocol_req_entry_t *esb_protocol_req_cache_find(const esb_protocol_message_t *message)
+{
+    if (message->request_id == ESB_PROT_REQ_ID_NONE) {
+        return (NULL);
+    }
+
+    for (uint8_t i = 0; i < ESB_PROTOCOL_REQ_CACHE_SIZE; i++) {
+        const esb_protocol_req_entry_t *p_entry = &g_req_cache[i];
+        if ((p_entry->request_id == message->request_id) && (p_entry->cmd == message->cmd) &&
+            (memcmp(p_entry->address, message->address, ESB_PIPE_ADDR_LENGTH) == 0)) {
+            return (p_entry);
+        }
+    }
+
+    return (NULL);
+}
+
+/* keep the reply of a request with ID, the oldest entry is replaced */
+static void esb_protocol_req_cache_add(const esb_protocol_message_t *message, const esb_protocol_message_t *answer)
+{
+    if (message->request_id == ESB_PROT_REQ_ID_NONE) {
+        return;
+    }
+
+    esb_protocol_req_entry_t *p_entry = &g_req_cache[g_req_cache_next];
+    memcpy(p_entry->address, message->address, ESB_PIPE_ADDR_LENGTH);
+    p_entry->cmd = message->cmd;
+    p_entry->request_id = message->request_id;
+    p_entry->answer = *answer;
+
+    g_req_cache_next = (g_req_cache_next + 1) % ESB_PROTOCOL_REQ_CACHE_SIZE;
+}
+
+/* queue a message for transmission without waiting for its completion
+ * returns the result of esb_send_packet_async(), ESB_ERR_BUSY if the radio can't take the frame right now */
+static int8_t esb_protocol_send(const esb_pipeline_t pipeline, const esb_protocol_message_t *message)
 {
     uint8_t tx_buffer[ESB_FRAME_SIZE];
-    uint8_t tx_size = message->payload_len + ESB_PROTOCOL_HEADER_SIZE;
+    uint8_t tx_size = esb_protocol_build_frame(message, tx_buffer);
 
-    tx_buffer[ESB_FRAME_IDX_CMD] = message->cmd;
-    tx_buffer[ESB_FRAME_IDX_ERR] = message->error;
-    memcpy(&(tx_buffer[ESB_FRAME_IDX_PIPE]), g_pipeline_address, sizeof(g_pipeline_address));
-    memcpy(&(tx_buffer[ESB_FRAME_IDX_PAYLOAD]), message->payload, message->payload_len);
+    if (tx_size == 0) {
+        return (ESB_ERR_SIZE);
+    }
 
     /* set TX adress if not an answer */
     if (pipeline == ESB_PIPE_SEND) {
         esb_set_pipeline_address(pipeline, message->address);
     }
 
-    esb_send_packet(pipeline, tx_buffer, tx_size);
+    return (esb_send_packet_async(pipeline, tx_buffer, tx_size, esb_protocol_tx_complete, NULL));
+}
+
+/* queue a message as ACK payload of the next frame received on the listening pipeline
+ * returns the result of esb_write_ack_payload(), ESB_ERR_BUSY if the radio can't take the payload right now */
+static int8_t esb_protocol_send_ack(const esb_protocol_message_t *message)
+{
+    uint8_t tx_buffer[ESB_FRAME_SIZE];
+    uint8_t tx_size = esb_protocol_build_frame(message, tx_buffer);
+
+    if (tx_size == 0) {
+        return (ESB_ERR_SIZE);
+    }
+
+    int8_t result = esb_write_ack_payload(ESB_PIPE_LISTENING, tx_buffer, tx_size);
+    if (result == ESB_ERR_OK) {
+        g_stats.counter[ESB_PROT_STAT_TX_ACK_PAYLOADS]++;
+    }
+
+    return (result);
 }
 
 esb_protocol_err_t esb_protocol_init(const uint8_t pipeline_address[5])
@@ -73,13 +438,28 @@ esb_protocol_err_t esb_protocol_init(const uint8_t pipeline_address[5])
         return (ESB_PROT_ERR_HAL);
     }
 
+    esb_ring_reset(&g_ring_tx);
+    esb_ring_reset(&g_ring_rx);
+    esb_ring_reset(&g_ring_busy);
+#if ESB_PROTOCOL_RX_FAIR
+    memset(g_rx_senders, 0, sizeof(g_rx_senders));
+    g_rx_sender_num = 0;
+    g_rx_sender_last = 0;
+#endif
+    g_reply_held = 0;
+    g_backoff = 0;
+    esb_protocol_reset_stats();
+    memset(g_req_cache, 0, sizeof(g_req_cache));
+    g_req_cache_next = 0;
+    memset(g_nodes, 0, sizeof(g_nodes));
+    g_node_id = ESB_PROT_NODE_ID_NONE;
+
     result = esb_start_listening(ESB_PIPE_LISTENING, esb_listener_callback);
     if (result != ESB_ERR_OK) {
         return (ESB_PROT_ERR_HAL);
     }
-
-    nrf_queue_reset(&g_queue_tx);
-    nrf_queue_reset(&g_queue_rx);
+    /* replies and notifications of receivers in ACK payload reply mode */
+    esb_set_ack_payload_callback(esb_ack_payload_callback);
 
     esb_commands_init();
 
@@ -89,6 +469,14 @@ esb_protocol_err_t esb_protocol_init(const uint8_t pipeline_address[5])
     return (ESB_PROT_ERR_OK);
 }
 
+static void esb_protocol_update_tx_queue_max(void)
+{
+    uint32_t used = esb_ring_count(&g_ring_tx);
+    if (used > g_stats.counter[ESB_PROT_STAT_TX_QUEUE_MAX]) {
+        g_stats.counter[ESB_PROT_STAT_TX_QUEUE_MAX] = used;
+    }
+}
+
 esb_protocol_err_t esb_protocol_transmit(const esb_protocol_message_t *message)
 {
     if (g_initialized == 0) {
@@ -99,48 +487,364 @@ esb_protocol_err_t esb_protocol_transmit(const esb_protocol_message_t *message)
         return (ESB_PROT_ERR_PARAM);
     }
 
-    if (message->payload_len > ESB_PROTOCOL_MAX_PAYLOAD_LEN) {
+    if ((message->payload_len + ((message->request_id != ESB_PROT_REQ_ID_NONE) ? 1 : 0)) >
+        esb_protocol_max_payload_len()) {
         return (ESB_PROT_ERR_PARAM);
     }
 
-    nrf_queue_push(&g_queue_tx, message);
+    if (esb_ring_push(&g_ring_tx, message) == 0) {
+        g_stats.counter[ESB_PROT_STAT_TX_DROPPED]++;
+        return (ESB_PROT_ERR_QUEUE_FULL);
+    }
+    esb_protocol_update_tx_queue_max();
 
     return (ESB_PROT_ERR_OK);
 }
 
+/* result of esb_protocol_rx_next() */
+typedef enum {
+    ESB_RX_ITEM_NONE = 0x00,  /* Nothing to do, or the radio can't take the reply */
+    ESB_RX_ITEM_CMD = 0x01,   /* Command processed */
+    ESB_RX_ITEM_REPLY = 0x02, /* Held reply or BUSY reply sent, not counted as an item of the slice */
+} esb_rx_item_t;
+
+/* send a reply on the listening pipeline, the radio keeps frames in flight while the next ones are queued
+ * returns 1 if the reply is handed to the radio (or dropped), 0 if the radio can't take it and waiting isn't allowed */
+static uint8_t esb_protocol_send_reply(const esb_protocol_message_t *answer, uint8_t may_block)
+{
+    if (g_reply_mode == ESB_PROT_REPLY_MODE_ACK_PAYLOAD) {
+        /* delivered with the outgoing messages, there is room (checked before the handler ran) */
+        (void)esb_ring_push(&g_ring_tx, answer);
+        esb_protocol_update_tx_queue_max();
+        return (1);
+    }
+
+    while (esb_protocol_send(ESB_PIPE_LISTENING, answer) == ESB_ERR_BUSY) {
+        if (may_block == 0) {
+            return (0);
+        }
+        /* radio TX FIFO full, sleep until a frame is completed */
+        esb_sched_port_wait(ESB_SCHED_WAIT_FOREVER);
+    }
+
+    return (1);
+}
+
+/* handle one item of the incoming side: the held reply, a BUSY reply or a queued command
+ * returns ESB_RX_ITEM_CMD if a command was processed, ESB_RX_ITEM_REPLY if only a reply was sent, ESB_RX_ITEM_NONE
+ * if there is nothing to do or the radio can't take the reply */
+static esb_rx_item_t esb_protocol_rx_next(uint8_t may_block)
+{
+    /* with ACK payload replies the reply must fit into the queue for outgoing messages */
+    if ((g_reply_mode == ESB_PROT_REPLY_MODE_ACK_PAYLOAD) && (esb_ring_alloc(&g_ring_tx) == NULL)) {
+        return (ESB_RX_ITEM_NONE);
+    }
+
+    /* reply the radio couldn't take during the last slice */
+    if (g_reply_held != 0) {
+        if (esb_protocol_send_reply(&g_reply_held_msg, may_block) == 0) {
+            return (ESB_RX_ITEM_NONE);
+        }
+        g_reply_held = 0;
+        return (ESB_RX_ITEM_REPLY);
+    }
+
+    /* BUSY replies to the frames which weren't queued go first, their senders retry right away */
+    const esb_protocol_busy_t *p_busy = esb_ring_peek(&g_ring_busy);
+    if (p_busy != NULL) {
+        esb_protocol_message_t answer = {
+            .cmd = p_busy->cmd, .error = ESB_PROT_REPLY_ERR_BUSY, .request_id = p_busy->request_id};
+
+        if (esb_protocol_send_reply(&answer, may_block) == 0) {
+            return (ESB_RX_ITEM_NONE);
+        }
+        esb_ring_pop(&g_ring_busy);
+        return (ESB_RX_ITEM_REPLY);
+    }
+
+    const esb_protocol_rx_slot_t *p_slot = esb_ring_peek(&g_ring_rx);
+    if (p_slot == NULL) {
+        return (ESB_RX_ITEM_NONE);
+    }
+    const esb_protocol_message_t *p_message = &(p_slot->message);
+    uint8_t ack_payload = p_slot->ack_payload;
+
+    uint32_t start = esb_time_cycles();
+    ESB_TRACE(ESB_TRACE_EVT_CMD_LOOKUP, esb_ring_tail(&g_ring_rx));
+    esb_protocol_message_t answer = {0};
+    const esb_protocol_req_entry_t *p_cached = (ack_payload == 0) ? esb_protocol_req_cache_find(p_message) : NULL;
+
+    /* lookup command */
+    const esb_cmd_table_item_t *cmd = esb_commands_lookup(p_message->cmd, p_message->payload_len);
+
+    if (p_cached != NULL) {
+        /* repeated request, the handler already ran, send the same reply again */
+        answer = p_cached->answer;
+        g_stats.counter[ESB_PROT_STAT_RX_REPEATED]++;
+    } else if (cmd != NULL) {
+        ESB_TRACE(ESB_TRACE_EVT_HANDLER_ENTER, p_message->cmd);
+        cmd->cmd_fct_pnt(p_message, &answer);
+        ESB_TRACE(ESB_TRACE_EVT_HANDLER_EXIT, p_message->cmd);
+    } else if (esb_commands_find(p_message->cmd) != NULL) {
+        answer.error = ESB_PROT_REPLY_ERR_SIZE;
+        g_stats.counter[ESB_PROT_STAT_CMD_SIZE_MISMATCH]++;
+    } else {
+        answer.error = ESB_PROT_REPLY_ERR_CMD;
+        g_stats.counter[ESB_PROT_STAT_CMD_UNKNOWN]++;
+    }
+    if (ack_payload != 0) {
+        /* a reply or notification, answering it would only put another frame on the air */
+        answer.error = ESB_PROT_REPLY_NONE;
+    } else if (p_cached == NULL) {
+        answer.cmd = p_message->cmd;
+        answer.request_id = p_message->request_id;
+        esb_protocol_req_cache_add(p_message, &answer);
+    }
+
+    /* the handler is done with the message, hand the element back to the radio interrupt */
+#if ESB_PROTOCOL_RX_FAIR
+    esb_protocol_rx_sender_done(p_slot->sender);
+#endif
+    esb_ring_pop(&g_ring_rx);
+
+    /* send reply here if applicable, held for the next slice if the radio can't take it */
+    if ((answer.error != ESB_PROT_REPLY_NONE) && (esb_protocol_send_reply(&answer, may_block) == 0)) {
+        g_reply_held_msg = answer;
+        g_reply_held = 1;
+    }
+
+    g_rx_cycles.process_last = esb_time_cycles() - start;
+    if (g_rx_cycles.process_last > g_rx_cycles.process_max) {
+        g_rx_cycles.process_max = g_rx_cycles.process_last;
+    }
+
+    return (ESB_RX_ITEM_CMD);
+}
+
+/* remaining back-off for a destination after its back-off hint, requests a wakeup for its end */
+static uint32_t esb_protocol_backoff_us(const uint8_t *p_address)
+{
+    uint32_t remaining_us = 0;
+
+    CRITICAL_REGION_ENTER();
+    if ((g_backoff != 0) && (memcmp(g_backoff_address, p_address, ESB_PIPE_ADDR_LENGTH) == 0)) {
+        uint32_t elapsed_us = esb_time_cycles_to_us(esb_time_cycles() - g_backoff_cycles);
+        if (elapsed_us < ESB_PROTOCOL_BUSY_BACKOFF_US) {
+            remaining_us = ESB_PROTOCOL_BUSY_BACKOFF_US - elapsed_us;
+        } else {
+            g_backoff = 0;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (remaining_us > 0) {
+        esb_sched_request_wakeup(remaining_us);
+    }
+
+    return (remaining_us);
+}
+
+/* hand one queued message to the radio
+ * returns 1 if a message was sent (or dropped), 0 if there is none or the radio can't take it */
+static uint8_t esb_protocol_tx_next(void)
+{
+    const esb_protocol_message_t *p_queued = esb_ring_peek(&g_ring_tx);
+    if (p_queued == NULL) {
+        return (0);
+    }
+
+    int8_t result;
+    if (g_reply_mode == ESB_PROT_REPLY_MODE_ACK_PAYLOAD) {
+        result = esb_protocol_send_ack(p_queued);
+    } else if (esb_protocol_backoff_us(p_queued->address) > 0) {
+        /* destination busy, the message waits (and the ones behind it, to keep the order) */
+        return (0);
+    } else {
+        result = esb_protocol_send(ESB_PIPE_SEND, p_queued);
+    }
+
+    if (result == ESB_ERR_BUSY) {
+        /* radio busy, keep the message queued for the next call */
+        return (0);
+    } else if (result == ESB_ERR_SIZE) {
+        g_stats.counter[ESB_PROT_STAT_TX_DROPPED]++;
+    }
+    esb_ring_pop(&g_ring_tx);
+
+    return (1);
+}
+
 esb_protocol_err_t esb_protocol_process(void)
+{
+    return (esb_protocol_process_budget(0, 0, NULL));
+}
+
+esb_protocol_err_t esb_protocol_process_budget(uint32_t max_items, uint32_t max_us, esb_protocol_pending_t *p_pending)
 {
     if (g_initialized == 0) {
         return (ESB_PROT_ERR_INIT);
     }
 
-    /* process incoming messages */
-    while (!nrf_queue_is_empty(&g_queue_rx)) {
-        esb_protocol_message_t message;
-        esb_protocol_message_t answer = {0};
-        nrf_queue_pop(&g_queue_rx, &message);
+    uint32_t process_start = esb_time_cycles();
+    uint8_t may_block = ((max_items == 0) && (max_us == 0)) ? 1 : 0;
 
-        /* lookup command */
-        esb_cmd_table_item_t *cmd = esb_commands_lookup(message.cmd, message.payload_len);
+    /* replies and queued messages are sent as one burst, the radio switches to PTX and back once */
+    if (g_reply_mode == ESB_PROT_REPLY_MODE_FRAME) {
+        esb_tx_burst_begin();
+    }
 
-        if (cmd != NULL) {
-            cmd->cmd_fct_pnt(&message, &answer);
-        } else {
-            answer.error = ESB_PROT_REPLY_ERR_CMD;
+    /* alternate between incoming commands (with their replies) and outgoing messages, the frames stay in flight
+     * while the next ones are queued */
+    uint32_t items = 0;
+    uint8_t rx_turn = 1;
+    uint8_t rx_done = 0;
+    uint8_t tx_done = 0;
+    while ((rx_done == 0) || (tx_done == 0)) {
+        if (((max_items != 0) && (items >= max_items)) ||
+            ((max_us != 0) && (esb_time_cycles_to_us(esb_time_cycles() - process_start) >= max_us))) {
+            break;
         }
-        /* send reply here if applicable */
-        if (answer.error != ESB_PROT_REPLY_NONE) {
-            answer.cmd = message.cmd;
-            esb_protocol_send(ESB_PIPE_LISTENING, &answer);
+
+        if ((rx_turn != 0) && (rx_done == 0)) {
+            esb_rx_item_t item = esb_protocol_rx_next(may_block);
+            if (item == ESB_RX_ITEM_CMD) {
+                items++;
+                /* the handler may have queued outgoing messages */
+                tx_done = 0;
+            } else if (item == ESB_RX_ITEM_NONE) {
+                rx_done = 1;
+            }
+        } else if (tx_done == 0) {
+            if (esb_protocol_tx_next() != 0) {
+                items++;
+            } else {
+                tx_done = 1;
+            }
         }
+        rx_turn ^= 1;
+    }
+
+    /* not kept open across calls, the node would stay deaf until the next call */
+    if (g_reply_mode == ESB_PROT_REPLY_MODE_FRAME) {
+        (void)esb_tx_burst_end();
+    }
+
+    uint32_t process_us = esb_time_cycles_to_us(esb_time_cycles() - process_start);
+    if (process_us > g_stats.counter[ESB_PROT_STAT_PROCESS_MAX_US]) {
+        g_stats.counter[ESB_PROT_STAT_PROCESS_MAX_US] = process_us;
+    }
+
+    if (p_pending != NULL) {
+        p_pending->rx = esb_ring_count(&g_ring_rx) + esb_ring_count(&g_ring_busy) + g_reply_held;
+        p_pending->tx = esb_ring_count(&g_ring_tx);
     }
 
-    /* process outgoing messages */
-    while (!nrf_queue_is_empty(&g_queue_tx)) {
-        esb_protocol_message_t message;
-        nrf_queue_pop(&g_queue_tx, &message);
+    return (ESB_PROT_ERR_OK);
+}
+
+uint8_t esb_protocol_next_request_id(void)
+{
+    g_next_request_id++;
+    if (g_next_request_id == ESB_PROT_REQ_ID_NONE) {
+        g_next_request_id++;
+    }
+
+    return (g_next_request_id);
+}
+
+esb_protocol_err_t esb_protocol_set_node_id(uint8_t node_id)
+{
+    if (g_initialized == 0) {
+        return (ESB_PROT_ERR_INIT);
+    }
+    g_node_id = node_id;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+uint8_t esb_protocol_get_node_id(void)
+{
+    return (g_node_id);
+}
+
+uint8_t esb_protocol_max_payload_len(void)
+{
+    return ((g_node_id != ESB_PROT_NODE_ID_NONE) ? ESB_PROTOCOL_COMPACT_MAX_PAYLOAD_LEN : ESB_PROTOCOL_MAX_PAYLOAD_LEN);
+}
+
+esb_protocol_err_t esb_protocol_register_node(uint8_t node_id, const uint8_t address[5])
+{
+    if (g_initialized == 0) {
+        return (ESB_PROT_ERR_INIT);
+    }
+
+    if ((node_id == ESB_PROT_NODE_ID_NONE) || (node_id >= ESB_PROTOCOL_NODE_ID_NUM)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
 
-        esb_protocol_send(ESB_PIPE_SEND, &message);
+    /* the table is read by the radio interrupt */
+    CRITICAL_REGION_ENTER();
+    if (address != NULL) {
+        memcpy(g_nodes[node_id].address, address, ESB_PIPE_ADDR_LENGTH);
+        g_nodes[node_id].used = 1;
+    } else {
+        g_nodes[node_id].used = 0;
     }
+    CRITICAL_REGION_EXIT();
+
     return (ESB_PROT_ERR_OK);
 }
+
+uint8_t esb_protocol_tx_idle(void)
+{
+    return (((esb_ring_count(&g_ring_tx) == 0) && (g_reply_held == 0) && (esb_tx_pending() == 0)) ? 1 : 0);
+}
+
+void esb_protocol_get_stats(esb_protocol_stats_t *p_stats)
+{
+    if (p_stats == NULL) {
+        return;
+    }
+
+    /* the counters are updated from the radio interrupt, take a consistent snapshot */
+    CRITICAL_REGION_ENTER();
+    *p_stats = g_stats;
+    CRITICAL_REGION_EXIT();
+}
+
+void esb_protocol_reset_stats(void)
+{
+    CRITICAL_REGION_ENTER();
+    memset(&g_stats, 0, sizeof(g_stats));
+    CRITICAL_REGION_EXIT();
+}
+
+esb_protocol_err_t esb_protocol_set_reply_mode(esb_protocol_reply_mode_t mode)
+{
+    if ((mode != ESB_PROT_REPLY_MODE_FRAME) && (mode != ESB_PROT_REPLY_MODE_ACK_PAYLOAD)) {
+        return (ESB_PROT_ERR_PARAM);
+    }
+
+    if ((g_initialized != 0) && (g_reply_mode == ESB_PROT_REPLY_MODE_ACK_PAYLOAD) &&
+        (mode == ESB_PROT_REPLY_MODE_FRAME)) {
+        /* the central polls for the messages of this mode, they would now be sent as frames it doesn't wait for */
+        if (esb_flush_ack_payloads() != ESB_ERR_OK) {
+            return (ESB_PROT_ERR_HAL);
+        }
+        while (esb_ring_peek(&g_ring_tx) != NULL) {
+            esb_ring_pop(&g_ring_tx);
+            g_stats.counter[ESB_PROT_STAT_TX_DROPPED]++;
+        }
+    }
+    g_reply_mode = mode;
+
+    return (ESB_PROT_ERR_OK);
+}
+
+void esb_protocol_get_rx_cycles(esb_protocol_rx_cycles_t *p_cycles)
+{
+    if (p_cycles == NULL) {
+        return;
+    }
+    *p_cycles = g_rx_cycles;
+}
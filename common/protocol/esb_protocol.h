@@ -10,12 +10,94 @@
  * Bytes:   |  0   |   1   | 2 3 4 5 6 | 7          ...               31|
  * Value:   | CMD  | ERROR |   PIPE    |          DATA                  |
  *
+ * Optional request ID, flagged by bit 7 of the ERROR byte (ESB_PROTOCOL_FLAG_REQ_ID)
+ *          |------------HEADER------------|---------PAYLOAD------------|
+ * Bytes:   |  0   |   1   | 2 3 4 5 6 |  7   | 8          ...         31|
+ * Value:   | CMD  | ERROR |   PIPE    | REQ  |          DATA            |
+ *
+ * A request with ID gets its reply with the same ID, so a central can keep several requests to the same
+ * node in flight and match the replies. The receiver keeps the replies of the last ESB_PROTOCOL_REQ_CACHE_SIZE
+ * requests with ID: a request repeated with the same ID (e.g. after the reply was lost) is not executed
+ * again, the cached reply is sent instead. Replies without room for the ID (longer than
+ * ESB_PROTOCOL_REQ_MAX_PAYLOAD_LEN with the full header) are sent without it. Receivers without support reply
+ * ESB_PROT_REPLY_ERR_SIZE (or ERR_CMD) without ID.
+ *
+ * Compact header, flagged by bit 6 of the ERROR byte (ESB_PROTOCOL_FLAG_COMPACT)
+ *          |-----HEADER----------|---------PAYLOAD-----------------------|
+ * Bytes:   |  0   |   1   |  2   | 3                 ...               31|
+ * Value:   | CMD  | ERROR | NODE |              DATA                     |
+ *
+ * NODE is a short node ID assigned by the central (ESB_CMD_SET_NODE_ID), it replaces the 5 byte PIPE address
+ * and leaves up to ESB_PROTOCOL_COMPACT_MAX_PAYLOAD_LEN bytes for the payload. A node with an ID sends all its
+ * frames with the compact header, the request ID flag works the same way (REQ follows NODE). The central maps
+ * the node ID back to the pipeline address (esb_protocol_register_node()), handlers see the address in
+ * esb_protocol_message_t::address as with the full header. The central registers the node ID before it sends
+ * ESB_CMD_SET_NODE_ID, a node without support replies ESB_PROT_REPLY_ERR_CMD and keeps the full header.
+ * Frames to the nodes always use the full header.
+ *
+ * Overload: a received frame is ACKed by the radio before the protocol sees it. A frame which can't be queued for
+ * processing (queue full, or the sender is over its share of a half-full queue, see ESB_PROTOCOL_RX_FAIR) is answered
+ * with ESB_PROT_REPLY_ERR_BUSY (same CMD and request ID, no payload) at the start of the next
+ * esb_protocol_process(), the command was not executed and can be sent again right away. When the queue becomes
+ * full, a back-off hint (CMD ESB_PROTOCOL_CMD_BUSY_HINT, ERROR ESB_PROT_REPLY_ERR_BUSY, no payload) is attached to
+ * the ACK of the next frame: the sender learns that the frame won't be queued without waiting for the main loop.
+ * The hint is dropped when the radio switches to transmit mode, it may also arrive once with the ACK of a frame
+ * which was queued after all. A sender which gets the hint holds its queued messages to that node for
+ * ESB_PROTOCOL_BUSY_BACKOFF_US, the hint itself is not handed to the command handlers.
  */
 
 #define ESB_FRAME_SIZE 32
 #define ESB_PIPE_ADDR_LENGTH 5
 #define ESB_PROTOCOL_HEADER_SIZE (2 + ESB_PIPE_ADDR_LENGTH) /* command and error byte */
 #define ESB_PROTOCOL_MAX_PAYLOAD_LEN (ESB_FRAME_SIZE - ESB_PROTOCOL_HEADER_SIZE)
+#define ESB_PROTOCOL_REQ_MAX_PAYLOAD_LEN (ESB_PROTOCOL_MAX_PAYLOAD_LEN - 1) /* payload of a message with request ID */
+#define ESB_PROTOCOL_COMPACT_HEADER_SIZE 3 /* command, error and node ID byte */
+#define ESB_PROTOCOL_COMPACT_MAX_PAYLOAD_LEN (ESB_FRAME_SIZE - ESB_PROTOCOL_COMPACT_HEADER_SIZE)
+
+#define ESB_PROTOCOL_FLAG_REQ_ID 0x80 /* ERROR byte flag, the header is followed by the request ID */
+#define ESB_PROT_REQ_ID_NONE 0        /* message without request ID, valid IDs are 1 to 255 */
+#define ESB_PROTOCOL_FLAG_COMPACT 0x40 /* ERROR byte flag, compact header with node ID instead of PIPE */
+#define ESB_PROT_NODE_ID_NONE 0        /* no node ID, frames are sent with the full header */
+
+#ifndef ESB_PROTOCOL_REQ_CACHE_SIZE
+#define ESB_PROTOCOL_REQ_CACHE_SIZE 4 /* requests with ID whose replies are kept to answer repeated requests */
+#endif
+
+#ifndef ESB_PROTOCOL_NODE_ID_NUM
+#define ESB_PROTOCOL_NODE_ID_NUM 32 /* node IDs 1 to ESB_PROTOCOL_NODE_ID_NUM - 1 known to the central */
+#endif
+
+#ifndef ESB_PROTOCOL_RX_QUEUE_SIZE
+#define ESB_PROTOCOL_RX_QUEUE_SIZE 8 /* received messages waiting for esb_protocol_process(), power of 2 */
+#endif
+
+#ifndef ESB_PROTOCOL_TX_QUEUE_SIZE
+#define ESB_PROTOCOL_TX_QUEUE_SIZE 8 /* messages queued for transmission, power of 2 */
+#endif
+
+#ifndef ESB_PROTOCOL_RX_FAIR
+#define ESB_PROTOCOL_RX_FAIR 1 /* 0: frames are queued until the queue is full, regardless of the sender. 1: once the
+                                  queue is half full, a sender may hold depth / senders messages, the last quarter
+                                  is kept for senders without queued messages */
+#endif
+
+#ifndef ESB_PROTOCOL_BUSY_REPLY
+#define ESB_PROTOCOL_BUSY_REPLY 1 /* 0: frames which can't be queued are dropped without reply (e.g. on a central) */
+#endif
+
+#ifndef ESB_PROTOCOL_BUSY_QUEUE_SIZE
+#define ESB_PROTOCOL_BUSY_QUEUE_SIZE 8 /* frames waiting for their BUSY reply, power of 2 */
+#endif
+
+#ifndef ESB_PROTOCOL_BUSY_HINT
+#define ESB_PROTOCOL_BUSY_HINT 1 /* 0: no back-off hint in the ACK payload when the queue becomes full */
+#endif
+
+#ifndef ESB_PROTOCOL_BUSY_BACKOFF_US
+#define ESB_PROTOCOL_BUSY_BACKOFF_US 2000 /* frames to a node which sent a back-off hint are held this long */
+#endif
+
+#define ESB_PROTOCOL_CMD_BUSY_HINT 0x1A /* CMD of the back-off hint, not a command */
 
 /*! \brief Module error codes */
 typedef enum {
@@ -27,30 +109,85 @@ typedef enum {
     ESB_PROT_ERR_PARAM = 0x05,       /* Parameter error */
     ESB_PROT_ERR_INIT = 0x06,        /* Module not initialized */
     ESB_PROT_ERR_MEM = 0x07,         /* Not enough memory for operation */
-    ESB_PROT_ERR_VALUE = 0x08        /* Value error, unexpected value */
+    ESB_PROT_ERR_VALUE = 0x08,       /* Value error, unexpected value */
+    ESB_PROT_ERR_DUPLICATE = 0x09,   /* Duplicate entry, e.g. command ID already registered */
+    ESB_PROT_ERR_TIMEOUT = 0x0A      /* No answer from the remote device */
 } esb_protocol_err_t;
 
 /*! \brief Error code sent in ESB replies */
 typedef enum {
     ESB_PROT_REPLY_ERR_OK = 0x00,    /* No Error */
-    ESB_PROT_REPLY_ERR_SIZE = 0x01,  /* Invalid payload length */
+    ESB_PROT_REPLY_ERR_SIZE = 0x01,  /* Invalid payload length, the command ID is known */
     ESB_PROT_REPLY_ERR_CMD = 0x02,   /* Unknown command */
     ESB_PROT_REPLY_ERR_API = 0x03,   /* Call of an API function returned an Error */
     ESB_PROT_REPLY_ERR_PARAM = 0x04, /* Invalid Parameter */
+    ESB_PROT_REPLY_ERR_BUSY = 0x05,  /* Receiver overloaded, the command was not executed, send it again */
     ESB_PROT_REPLY_NONE = 0xFF       /* Special reply code. When set on a reply, the protocol layer will not send a
                                         reply for the current command */
 } esb_protocol_msg_err_t;
 
+/*! \brief How replies and queued messages are delivered */
+typedef enum {
+    ESB_PROT_REPLY_MODE_FRAME = 0x00,      /* Every message is sent as a separate frame (radio switches to PTX mode) */
+    ESB_PROT_REPLY_MODE_ACK_PAYLOAD = 0x01 /* Messages ride on the ACK of the next frame received from the central */
+} esb_protocol_reply_mode_t;
+
+#ifndef ESB_PROTOCOL_REPLY_MODE_DEFAULT
+#define ESB_PROTOCOL_REPLY_MODE_DEFAULT ESB_PROT_REPLY_MODE_FRAME
+#endif
+
 /*! \brief Structure representing ESB messages */
 typedef struct {
     uint8_t address[ESB_PIPE_ADDR_LENGTH]; /* Pipeline address to which the message shall be sent (tx) or from which the
-                                              message was received (rx)*/
+                                              message was received (rx, PIPE field of the frame header)*/
     uint8_t cmd;                           /* Command byte */
     esb_protocol_msg_err_t error;          /* Message error code, (tx-only)*/
-    uint8_t payload[ESB_PROTOCOL_MAX_PAYLOAD_LEN]; /* Payload buffer */
+    uint8_t payload[ESB_PROTOCOL_COMPACT_MAX_PAYLOAD_LEN]; /* Payload buffer, see esb_protocol_max_payload_len() */
     uint8_t payload_len;                           /* Payload length */
+    uint8_t request_id; /* Request ID, ESB_PROT_REQ_ID_NONE if the frame has none. Replies get the ID of the request */
 } esb_protocol_message_t;
 
+/*! \brief Cycle counts of the receive path (see esb_time.h for the cycle unit) */
+typedef struct {
+    uint32_t isr_last;     /* Cycles spent in the radio interrupt for the last received frame */
+    uint32_t isr_max;      /* Maximum cycles spent in the radio interrupt per received frame */
+    uint32_t process_last; /* Cycles from dequeuing the last command until its reply was queued */
+    uint32_t process_max;  /* Maximum cycles from dequeuing a command until its reply was queued */
+} esb_protocol_rx_cycles_t;
+
+/*! \brief Counters of the protocol statistics, the order is part of the ESB_CMD_GET_STATS reply format */
+typedef enum {
+    ESB_PROT_STAT_RX_FRAMES = 0,       /* Frames received and queued for processing */
+    ESB_PROT_STAT_RX_DROPPED,          /* Frames not queued, queue for incoming messages full or sender over its share */
+    ESB_PROT_STAT_RX_INVALID,          /* Frames dropped, shorter than the header or from an unknown node ID */
+    ESB_PROT_STAT_RX_QUEUE_MAX,        /* High-water mark of the queue for incoming messages */
+    ESB_PROT_STAT_TX_FRAMES,           /* Frames acknowledged by the receiver */
+    ESB_PROT_STAT_TX_FAILED,           /* Frames not acknowledged after all retransmits */
+    ESB_PROT_STAT_TX_RETRANSMITS,      /* Retransmits of all sent frames */
+    ESB_PROT_STAT_TX_ACK_PAYLOADS,     /* Messages queued as ACK payload (see esb_protocol_set_reply_mode) */
+    ESB_PROT_STAT_TX_DROPPED,          /* Messages rejected, queue for outgoing messages full or payload too long */
+    ESB_PROT_STAT_TX_QUEUE_MAX,        /* High-water mark of the queue for outgoing messages */
+    ESB_PROT_STAT_CMD_UNKNOWN,         /* Commands with an unknown command ID */
+    ESB_PROT_STAT_CMD_SIZE_MISMATCH,   /* Commands with a payload size not matching the command table */
+    ESB_PROT_STAT_PROCESS_MAX_US,      /* Maximum duration of a esb_protocol_process(_budget)() call in microseconds */
+    ESB_PROT_STAT_RX_REPEATED,         /* Repeated requests with ID answered from the reply cache */
+    ESB_PROT_STAT_RX_BUSY,             /* Frames not queued and answered with ESB_PROT_REPLY_ERR_BUSY */
+    ESB_PROT_STAT_TX_BUSY_HINTS,       /* Back-off hints attached to the ACK payload */
+    ESB_PROT_STAT_RX_BUSY_HINTS,       /* Back-off hints received with the ACK of a sent frame */
+    ESB_PROT_STAT_NUM
+} esb_protocol_stat_id_t;
+
+/*! \brief Protocol statistics, counters since esb_protocol_init() or esb_protocol_reset_stats() */
+typedef struct {
+    uint32_t counter[ESB_PROT_STAT_NUM]; /* Counters, indexed by esb_protocol_stat_id_t */
+} esb_protocol_stats_t;
+
+/*! \brief Work left after esb_protocol_process_budget() */
+typedef struct {
+    uint32_t rx; /* Received messages and replies waiting (incl. BUSY replies and a reply the radio couldn't take) */
+    uint32_t tx; /* Messages queued for transmission */
+} esb_protocol_pending_t;
+
 /*! \brief Initialize Enhanced Shockburst (ESB) communication protocol
  *  \param pipeline_address        ESP Pipeline address for listening (only 5-byte address supported)
  *  \retval ESB_PROT_ERR_OK         - OK
@@ -66,17 +203,107 @@ esb_protocol_err_t esb_protocol_init(const uint8_t pipeline_address[5]);
  *  \retval ESB_PROT_ERR_OK         - OK
  *  \retval ESB_PROT_ERR_INIT       - Module not initialized
  *  \retval ESB_PROT_ERR_HAL        - ESB HAL Error
- *  \retval ESB_PROT_ERR_PARAM      - Parameter Error (NULL Pointer)
+ *  \retval ESB_PROT_ERR_PARAM      - Parameter Error (NULL Pointer, payload too long)
+ *  \retval ESB_PROT_ERR_QUEUE_FULL - Queue for outgoing messages is full
  */
 esb_protocol_err_t esb_protocol_transmit(const esb_protocol_message_t *message);
 
 /*! \brief Process incoming and outgoing message queue
  *  \details Check for pending incoming messages, execute associated function and
- *           send reply if applicable
+ *           send reply if applicable. Outgoing messages are handed to the radio without waiting
+ *           for their completion, messages the radio can't take right now stay queued for the next call.
+ *           In frame reply mode the replies and outgoing messages of one call are sent as a TX burst
+ *           (see esb_tx_burst_begin()), the radio switches to transmit mode and back once per call
  *  \retval ESB_PROT_ERR_OK          - OK
  *  \retval ESB_PROT_ERR_INIT        - Module not initialized
  *  \retval ESB_PROT_ERR_HAL         - ESB HAL Error
  */
 esb_protocol_err_t esb_protocol_process(void);
 
+/*! \brief Process incoming and outgoing messages in a bounded slice
+ *  \details Like esb_protocol_process(), but returns once max_items messages are handled or max_us passed, the
+ *           rest stays queued for the next call. Incoming commands (with their replies) and outgoing messages
+ *           are handled alternately, so neither side starves the other. The call doesn't wait for the radio:
+ *           a reply the radio TX FIFO can't take is held and sent first by the next call, until then no further
+ *           commands are processed. The time limit is checked before each message, a slice overruns it by at
+ *           most one command handler. With both limits 0 it is the same as esb_protocol_process().
+ *  \param max_items[in]            Max commands and outgoing messages handled (BUSY replies and a held reply
+ *                                  don't count), 0 for no limit
+ *  \param max_us[in]               Max duration of the slice in microseconds, 0 for no limit
+ *  \param p_pending[out]           Work left after the slice, may be NULL
+ *  \retval ESB_PROT_ERR_OK          - OK
+ *  \retval ESB_PROT_ERR_INIT        - Module not initialized
+ */
+esb_protocol_err_t esb_protocol_process_budget(uint32_t max_items, uint32_t max_us, esb_protocol_pending_t *p_pending);
+
+/*! \brief Get a new request ID, e.g. for several requests in flight to the same node
+ *  \details IDs count from 1 to 255 and wrap around, ESB_PROT_REQ_ID_NONE is skipped
+ *  \returns request ID for esb_protocol_message_t::request_id
+ */
+uint8_t esb_protocol_next_request_id(void);
+
+/*! \brief Set the node ID of this node, frames are sent with the compact header while it is set
+ *  \details Usually set by ESB_CMD_SET_NODE_ID from the central. Queued messages longer than the payload
+ *           of the full header are dropped when the ID is cleared.
+ *  \param node_id[in]              Node ID (1 to 255), ESB_PROT_NODE_ID_NONE for the full header
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_INIT       - Module not initialized
+ */
+esb_protocol_err_t esb_protocol_set_node_id(uint8_t node_id);
+
+/*! \brief Get the node ID of this node
+ *  \returns node ID, ESB_PROT_NODE_ID_NONE if frames are sent with the full header
+ */
+uint8_t esb_protocol_get_node_id(void);
+
+/*! \brief Get the max payload length of a message without request ID
+ *  \returns ESB_PROTOCOL_COMPACT_MAX_PAYLOAD_LEN with a node ID, ESB_PROTOCOL_MAX_PAYLOAD_LEN otherwise
+ */
+uint8_t esb_protocol_max_payload_len(void);
+
+/*! \brief Register the pipeline address of a node ID (central)
+ *  \details Frames with the compact header are accepted from registered node IDs only
+ *  \param node_id[in]              Node ID (1 to ESB_PROTOCOL_NODE_ID_NUM - 1)
+ *  \param address[in]              Pipeline address of the node, NULL to remove the node ID
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_INIT       - Module not initialized
+ *  \retval ESB_PROT_ERR_PARAM      - Invalid node ID
+ */
+esb_protocol_err_t esb_protocol_register_node(uint8_t node_id, const uint8_t address[5]);
+
+/*! \brief Check if all outgoing messages are sent
+ *  \returns 1 if the queue for outgoing messages is empty and no frame is in flight, 0 otherwise
+ */
+uint8_t esb_protocol_tx_idle(void);
+
+/*! \brief Select how replies and queued messages are delivered
+ *  \details In ESB_PROT_REPLY_MODE_ACK_PAYLOAD mode the radio stays in receive mode. Replies and messages
+ *           queued with esb_protocol_transmit() are attached in order to the ACKs of the next frames received on
+ *           the listening pipeline, the address of the messages is ignored. A request/response exchange takes a
+ *           single air transaction: the central gets the reply with the ACK of its next frame, e.g. the next
+ *           command or ESB_CMD_POLL. Commands are only processed while the queue for outgoing messages has room.
+ *           The central handles received ACK payloads like frames, except that they are never answered.
+ *           ACK payloads not yet picked up are discarded when switching back to ESB_PROT_REPLY_MODE_FRAME, as are
+ *           the messages still queued for them (counted as ESB_PROT_STAT_TX_DROPPED).
+ *  \param mode                     Reply mode, default is ESB_PROTOCOL_REPLY_MODE_DEFAULT
+ *  \retval ESB_PROT_ERR_OK         - OK
+ *  \retval ESB_PROT_ERR_PARAM      - Invalid mode
+ *  \retval ESB_PROT_ERR_HAL        - Error discarding the ACK payloads
+ */
+esb_protocol_err_t esb_protocol_set_reply_mode(esb_protocol_reply_mode_t mode);
+
+/*! \brief Get the protocol statistics
+ *  \param p_stats[out]     Buffer for the statistics
+ */
+void esb_protocol_get_stats(esb_protocol_stats_t *p_stats);
+
+/*! \brief Reset all counters of the protocol statistics to 0
+ */
+void esb_protocol_reset_stats(void);
+
+/*! \brief Get the cycle counts of the receive path
+ *  \param p_cycles[out]    Buffer for the cycle counts
+ */
+void esb_protocol_get_rx_cycles(esb_protocol_rx_cycles_t *p_cycles);
+
 #endif // ESB_PROTOCOL_H_
@@ -0,0 +1,132 @@
+#ifndef ESB_RING_H_
+#define ESB_RING_H_
+
+/*!
+ * \file esb_ring.h
+ * \brief Lock-free single-producer/single-consumer ring of fixed-size elements
+ * \details One context (e.g. the radio interrupt) produces, one other context (e.g. the main loop) consumes,
+ * no interrupts are masked. Head and tail are free-running counters, each written by one side only, the depth
+ * must be a power of 2. Elements are written and read in place: the producer fills the element returned by
+ * ::esb_ring_alloc and publishes it with ::esb_ring_commit, the consumer reads the element returned by
+ * ::esb_ring_peek and hands it back with ::esb_ring_pop once it is done with it.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*! \brief Ring control block */
+typedef struct {
+    uint32_t head; /* Elements committed, written by the producer only */
+    uint32_t tail; /* Elements popped, written by the consumer only */
+} esb_ring_cb_t;
+
+/*! \brief Ring instance */
+typedef struct {
+    esb_ring_cb_t *p_cb;   /* Control block */
+    uint8_t *p_buffer;     /* Storage of the elements */
+    uint32_t mask;         /* Depth - 1 */
+    uint32_t element_size; /* Size of one element */
+} esb_ring_t;
+
+/*! \brief Define a ring instance with a depth of _size elements of _type (power of 2) */
+#define ESB_RING_DEF(_type, _name, _size)                                                                              \
+    _Static_assert(((_size) > 0) && (((_size) & ((_size)-1)) == 0), #_name " depth must be a power of 2");           \
+    static _type _name##_buffer[(_size)];                                                                              \
+    static esb_ring_cb_t _name##_cb;                                                                                   \
+    static const esb_ring_t _name = {&_name##_cb, (uint8_t *)_name##_buffer, (_size)-1, sizeof(_type)}
+
+/*! \brief Discard all elements, neither side may use the ring at the same time */
+static inline void esb_ring_reset(const esb_ring_t *p_ring)
+{
+    __atomic_store_n(&p_ring->p_cb->head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&p_ring->p_cb->tail, 0, __ATOMIC_RELEASE);
+}
+
+/*! \brief Get the free element at the head (producer)
+ *  \returns element to fill, NULL if the ring is full
+ */
+static inline void *esb_ring_alloc(const esb_ring_t *p_ring)
+{
+    uint32_t head = __atomic_load_n(&p_ring->p_cb->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&p_ring->p_cb->tail, __ATOMIC_ACQUIRE);
+
+    if ((head - tail) > p_ring->mask) {
+        return (NULL);
+    }
+    return (&p_ring->p_buffer[(head & p_ring->mask) * p_ring->element_size]);
+}
+
+/*! \brief Publish the element returned by esb_ring_alloc() (producer) */
+static inline void esb_ring_commit(const esb_ring_t *p_ring)
+{
+    uint32_t head = __atomic_load_n(&p_ring->p_cb->head, __ATOMIC_RELAXED);
+    __atomic_store_n(&p_ring->p_cb->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/*! \brief Copy an element into the ring (producer)
+ *  \returns 1 if the element was added, 0 if the ring is full
+ */
+static inline uint8_t esb_ring_push(const esb_ring_t *p_ring, const void *p_element)
+{
+    void *p_slot = esb_ring_alloc(p_ring);
+    if (p_slot == NULL) {
+        return (0);
+    }
+    memcpy(p_slot, p_element, p_ring->element_size);
+    esb_ring_commit(p_ring);
+
+    return (1);
+}
+
+/*! \brief Get the oldest element without removing it (consumer)
+ *  \returns element, NULL if the ring is empty
+ */
+static inline void *esb_ring_peek(const esb_ring_t *p_ring)
+{
+    uint32_t tail = __atomic_load_n(&p_ring->p_cb->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&p_ring->p_cb->head, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return (NULL);
+    }
+    return (&p_ring->p_buffer[(tail & p_ring->mask) * p_ring->element_size]);
+}
+
+/*! \brief Remove the element returned by esb_ring_peek(), the producer may reuse it afterwards (consumer) */
+static inline void esb_ring_pop(const esb_ring_t *p_ring)
+{
+    uint32_t tail = __atomic_load_n(&p_ring->p_cb->tail, __ATOMIC_RELAXED);
+    __atomic_store_n(&p_ring->p_cb->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/*! \brief Get the number of elements in the ring (exact on either side, a snapshot elsewhere) */
+static inline uint32_t esb_ring_count(const esb_ring_t *p_ring)
+{
+    uint32_t tail = __atomic_load_n(&p_ring->p_cb->tail, __ATOMIC_ACQUIRE);
+    uint32_t head = __atomic_load_n(&p_ring->p_cb->head, __ATOMIC_ACQUIRE);
+
+    return (head - tail);
+}
+
+/*! \brief Get the element at a free-running position, e.g. to scan the elements from the tail to the head
+ *  \details Only the producer may look at elements between tail and head, they stay valid until it reuses them
+ */
+static inline void *esb_ring_at(const esb_ring_t *p_ring, uint32_t position)
+{
+    return (&p_ring->p_buffer[(position & p_ring->mask) * p_ring->element_size]);
+}
+
+/*! \brief Get the free-running position of the head, e.g. to tag an element in a trace */
+static inline uint32_t esb_ring_head(const esb_ring_t *p_ring)
+{
+    return (__atomic_load_n(&p_ring->p_cb->head, __ATOMIC_RELAXED));
+}
+
+/*! \brief Get the free-running position of the tail */
+static inline uint32_t esb_ring_tail(const esb_ring_t *p_ring)
+{
+    return (__atomic_load_n(&p_ring->p_cb->tail, __ATOMIC_RELAXED));
+}
+
+#endif /* ESB_RING_H_ */
@@ -0,0 +1,106 @@
+#include <stddef.h>
+
+#include <common/driver/esb_time.h>
+#include <common/sched/esb_sched.h>
+
+#include "app_util_platform.h"
+
+static volatile uint32_t g_events = 0;
+
+/* earliest requested wakeup, relative to the cycle counter value when it was requested */
+static uint8_t g_wakeup_requested = 0;
+static uint32_t g_wakeup_cycles = 0;
+static uint32_t g_wakeup_delay_us = 0;
+
+static esb_sched_stats_t g_stats = {0};
+static uint32_t g_active_start = 0; /* cycle counter value when the last wait returned */
+
+void esb_sched_init(void)
+{
+    esb_time_init();
+
+    CRITICAL_REGION_ENTER();
+    g_events = 0;
+    CRITICAL_REGION_EXIT();
+
+    g_wakeup_requested = 0;
+    esb_sched_reset_stats();
+}
+
+void esb_sched_signal(uint32_t events)
+{
+    __atomic_fetch_or(&g_events, events, __ATOMIC_RELEASE);
+    esb_sched_port_wake();
+}
+
+uint32_t esb_sched_pending(void)
+{
+    return (__atomic_load_n(&g_events, __ATOMIC_ACQUIRE));
+}
+
+uint32_t esb_sched_take(void)
+{
+    return (__atomic_exchange_n(&g_events, 0, __ATOMIC_ACQ_REL));
+}
+
+uint8_t esb_sched_next_deadline(uint32_t *p_delay_us)
+{
+    if (g_wakeup_requested == 0) {
+        return (0);
+    }
+
+    uint32_t elapsed_us = esb_time_cycles_to_us(esb_time_cycles() - g_wakeup_cycles);
+    if (p_delay_us != NULL) {
+        *p_delay_us = (elapsed_us < g_wakeup_delay_us) ? (g_wakeup_delay_us - elapsed_us) : 0;
+    }
+    return (1);
+}
+
+void esb_sched_request_wakeup(uint32_t delay_us)
+{
+    uint32_t remaining_us;
+
+    if ((esb_sched_next_deadline(&remaining_us) == 1) && (remaining_us <= delay_us)) {
+        return;
+    }
+
+    g_wakeup_cycles = esb_time_cycles();
+    g_wakeup_delay_us = delay_us;
+    g_wakeup_requested = 1;
+}
+
+void esb_sched_wait(void)
+{
+    uint32_t remaining_us = ESB_SCHED_WAIT_FOREVER;
+
+    g_stats.active_us += esb_time_cycles_to_us(esb_time_cycles() - g_active_start);
+
+    while (esb_sched_pending() == 0) {
+        if (esb_sched_next_deadline(&remaining_us) == 1) {
+            if (remaining_us == 0) {
+                esb_sched_signal(ESB_SCHED_EVT_TIMER);
+                break;
+            }
+        }
+
+        esb_sched_port_wait(remaining_us);
+        g_stats.wakeups++;
+    }
+    g_wakeup_requested = 0;
+
+    g_active_start = esb_time_cycles();
+}
+
+void esb_sched_get_stats(esb_sched_stats_t *p_stats)
+{
+    if (p_stats != NULL) {
+        *p_stats = g_stats;
+    }
+}
+
+void esb_sched_reset_stats(void)
+{
+    g_stats.wakeups = 0;
+    g_stats.active_us = 0;
+    g_active_start = esb_time_cycles();
+}
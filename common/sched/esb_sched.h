@@ -0,0 +1,100 @@
+#ifndef ESB_SCHED_H_
+#define ESB_SCHED_H_
+
+/*!
+ * \file esb_sched.h
+ * \brief Event-driven main loop for the ESB stack
+ * \details The radio interrupt signals received frames and completed transmissions, application interrupts can
+ * signal their own events. Modules with timeouts (e.g. esb_fragment, esb_config) request a wakeup from their
+ * process function. esb_sched_wait() sleeps until an event is signalled or the earliest requested wakeup is due,
+ * instead of polling empty queues:
+ *
+ *   while (1) {
+ *       uint32_t events = esb_sched_take();
+ *       if (events & ESB_SCHED_EVT_APP) {
+ *           binary_sensor_publish();
+ *       }
+ *       esb_protocol_process();
+ *       esb_sched_wait();
+ *   }
+ *
+ * Events signalled while the loop is busy stay pending, so the following esb_sched_wait() returns right away.
+ *
+ * On target the CPU sleeps with WFE and wakes up on any interrupt. The cycle counter doesn't run during sleep, so a
+ * wakeup at a deadline needs a timer of the application, e.g. an RTC compare set from esb_sched_next_deadline().
+ * On the host backend the loop blocks on a condition variable with a timeout.
+ */
+
+#include <stdint.h>
+
+#define ESB_SCHED_EVT_RX (1u << 0)      /* frame received (radio interrupt) */
+#define ESB_SCHED_EVT_TX_DONE (1u << 1) /* frame or ACK payload completed (radio interrupt) */
+#define ESB_SCHED_EVT_TIMER (1u << 2)   /* requested wakeup is due */
+#define ESB_SCHED_EVT_APP (1u << 3)     /* first event bit free for the application */
+
+#define ESB_SCHED_WAIT_FOREVER UINT32_MAX
+
+/*! \brief Sleep statistics since esb_sched_init() or esb_sched_reset_stats() */
+typedef struct {
+    uint32_t wakeups;   /* Returns from sleep, including spurious ones */
+    uint32_t active_us; /* Time spent outside of esb_sched_wait(), on target only while the CPU runs */
+} esb_sched_stats_t;
+
+/*! \brief Initialize the scheduler, clears pending events and requested wakeups
+ */
+void esb_sched_init(void);
+
+/*! \brief Signal events and wake up the main loop, can be called from interrupts
+ *  \param events           Event bits (ESB_SCHED_EVT_*)
+ */
+void esb_sched_signal(uint32_t events);
+
+/*! \brief Get the pending events without clearing them ("anything to do?")
+ */
+uint32_t esb_sched_pending(void);
+
+/*! \brief Get and clear the pending events, call before processing them
+ */
+uint32_t esb_sched_take(void);
+
+/*! \brief Request a wakeup, the earliest request is kept until the next esb_sched_wait() returns
+ *  \details Call from the process function of a module each time it waits for a timeout
+ *  \param delay_us         Time from now until the wakeup
+ */
+void esb_sched_request_wakeup(uint32_t delay_us);
+
+/*! \brief Get the time until the earliest requested wakeup
+ *  \param p_delay_us[out]  Time from now, 0 if the wakeup is already due
+ *  \returns 1 if a wakeup is requested, 0 otherwise
+ */
+uint8_t esb_sched_next_deadline(uint32_t *p_delay_us);
+
+/*! \brief Sleep until an event is pending or the requested wakeup is due
+ *  \details Returns right away if events are pending, signals ESB_SCHED_EVT_TIMER when the wakeup is due and
+ *           clears the requested wakeup
+ */
+void esb_sched_wait(void);
+
+/*! \brief Get the sleep statistics
+ *  \param p_stats[out]     Buffer for the statistics
+ */
+void esb_sched_get_stats(esb_sched_stats_t *p_stats);
+
+/*! \brief Reset the sleep statistics
+ */
+void esb_sched_reset_stats(void);
+
+/*
+ * Platform layer, implemented in driver/esb_sched_port.c (target) and host/esb_sched_host.c (host backend)
+ */
+
+/* \brief Sleep until esb_sched_port_wake() is called or timeout_us passed (ESB_SCHED_WAIT_FOREVER for no timeout)
+ * \details May return early, a wakeup since the last return is not lost
+ */
+void esb_sched_port_wait(uint32_t timeout_us);
+
+/* \brief Wake up esb_sched_port_wait(), can be called from interrupts
+ */
+void esb_sched_port_wake(void);
+
+#endif /* ESB_SCHED_H_ */
@@ -0,0 +1,52 @@
+#include <common/trace/esb_trace.h>
+
+#if ESB_TRACE_ENABLED
+
+#include <common/driver/esb_time.h>
+#include <stddef.h>
+
+#if (ESB_TRACE_BUFFER_SIZE & (ESB_TRACE_BUFFER_SIZE - 1)) != 0
+#error "ESB_TRACE_BUFFER_SIZE must be a power of 2"
+#endif
+
+esb_trace_record_t g_esb_trace_buffer[ESB_TRACE_BUFFER_SIZE];
+volatile uint32_t g_esb_trace_index = 0; /* number of events recorded so far, next write position */
+
+void esb_trace_emit(esb_trace_evt_t event, uint8_t arg)
+{
+    /* reserve a record, an interrupting writer gets the next one (LDREX/STREX on Cortex-M4) */
+    uint32_t index = __atomic_fetch_add(&g_esb_trace_index, 1, __ATOMIC_RELAXED);
+    esb_trace_record_t *p_record = &g_esb_trace_buffer[index & (ESB_TRACE_BUFFER_SIZE - 1)];
+
+    p_record->cycles = esb_time_cycles();
+    p_record->event = (uint8_t)event;
+    p_record->arg = arg;
+    p_record->seq = (uint16_t)index;
+}
+
+uint32_t esb_trace_read(esb_trace_record_t *p_records, uint32_t max_records)
+{
+    if (p_records == NULL) {
+        return (0);
+    }
+
+    uint32_t end = g_esb_trace_index;
+    uint32_t count = (end < ESB_TRACE_BUFFER_SIZE) ? end : ESB_TRACE_BUFFER_SIZE;
+    if (count > max_records) {
+        count = max_records;
+    }
+
+    /* records written while copying are detected by the decoder with the sequence number */
+    for (uint32_t i = 0; i < count; i++) {
+        p_records[i] = g_esb_trace_buffer[(end - count + i) & (ESB_TRACE_BUFFER_SIZE - 1)];
+    }
+
+    return (count);
+}
+
+void esb_trace_reset(void)
+{
+    g_esb_trace_index = 0;
+}
+
+#endif /* ESB_TRACE_ENABLED */
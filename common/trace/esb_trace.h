@@ -0,0 +1,76 @@
+#ifndef ESB_TRACE_H_
+#define ESB_TRACE_H_
+
+/*!
+ * \file esb_trace.h
+ * \brief Cycle-stamped event trace of the ESB stack
+ * \details With ESB_TRACE_ENABLED set to 1 the driver and the protocol layer record compact binary events
+ * (see ::esb_trace_evt_t) into a fixed-size ring buffer. Every event carries a timestamp of the cycle counter
+ * (see esb_time.h), so the time spent in the radio interrupt, the queues, the command handlers and on air
+ * can be told apart. The ring is written lock-free from the radio interrupt and the main loop, the oldest
+ * events are overwritten.
+ *
+ * The ring can be read with ::esb_trace_read, or dumped with the debugger (g_esb_trace_buffer and
+ * g_esb_trace_index). On the host, esb_trace_decode.h turns a dump into per-stage latency histograms.
+ *
+ * With ESB_TRACE_ENABLED 0 (default) ::ESB_TRACE expands to nothing and no buffer is allocated.
+ */
+
+#include <stdint.h>
+
+#ifndef ESB_TRACE_ENABLED
+#define ESB_TRACE_ENABLED 0
+#endif
+
+#ifndef ESB_TRACE_BUFFER_SIZE
+#define ESB_TRACE_BUFFER_SIZE 256 /* number of events in the ring buffer, must be a power of 2 */
+#endif
+
+/*! \brief Trace events */
+typedef enum {
+    ESB_TRACE_EVT_RADIO_IRQ = 0x01,     /* Radio event handler entered, arg: nrf_esb event ID */
+    ESB_TRACE_EVT_RX_QUEUED = 0x02,     /* Received frame queued for processing, arg: RX slot */
+    ESB_TRACE_EVT_CMD_LOOKUP = 0x03,    /* Received frame dequeued, command lookup starts, arg: RX slot */
+    ESB_TRACE_EVT_HANDLER_ENTER = 0x04, /* Command handler called, arg: command ID */
+    ESB_TRACE_EVT_HANDLER_EXIT = 0x05,  /* Command handler returned, arg: command ID */
+    ESB_TRACE_EVT_TX_START = 0x06,      /* Frame written to the radio TX FIFO, arg: pipeline */
+    ESB_TRACE_EVT_TX_DONE = 0x07,       /* Frame completed, arg: esb_tx_status_t */
+} esb_trace_evt_t;
+
+/*! \brief Trace event record (8 bytes, little endian in dumps) */
+typedef struct {
+    uint32_t cycles; /* Cycle counter at the time of the event */
+    uint16_t seq;    /* Lower 16 bits of the event number, used to detect overwritten records */
+    uint8_t event;   /* Event, see esb_trace_evt_t */
+    uint8_t arg;     /* Event specific argument */
+} esb_trace_record_t;
+
+#if ESB_TRACE_ENABLED
+
+#define ESB_TRACE(event, arg) esb_trace_emit((event), (uint8_t)(arg))
+
+/*! \brief Record an event, use ::ESB_TRACE instead
+ *  \details Safe to call from interrupts and the main loop at the same time
+ */
+void esb_trace_emit(esb_trace_evt_t event, uint8_t arg);
+
+/*! \brief Copy the recorded events, oldest first
+ *  \param p_records[out]   Buffer for the events
+ *  \param max_records[in]  Size of the buffer, the newest events are copied if it is too small
+ *  \returns number of copied events
+ */
+uint32_t esb_trace_read(esb_trace_record_t *p_records, uint32_t max_records);
+
+/*! \brief Discard all recorded events
+ */
+void esb_trace_reset(void);
+
+#else
+
+#define ESB_TRACE(event, arg)                                                                                          \
+    do {                                                                                                               \
+    } while (0)
+
+#endif /* ESB_TRACE_ENABLED */
+
+#endif /* ESB_TRACE_H_ */
@@ -0,0 +1,161 @@
+#include <string.h>
+
+#include <common/trace/esb_trace_decode.h>
+
+#define ESB_TRACE_DECODE_SLOTS 256    /* RX slots are identified by the 8 bit event argument */
+#define ESB_TRACE_DECODE_TX_DEPTH 8   /* frames in the radio TX FIFO tracked at the same time */
+
+static const char *g_stage_names[ESB_TRACE_STAGE_NUM] = {"isr", "queue", "lookup", "handler", "reply", "radio"};
+
+typedef struct {
+    uint32_t cycles;
+    uint8_t valid;
+} esb_trace_stamp_t;
+
+static void esb_trace_histogram_add(esb_trace_histogram_t *p_hist, uint32_t duration_us)
+{
+    uint8_t bucket = 0;
+    while ((bucket < (ESB_TRACE_HIST_BUCKETS - 1)) && (duration_us >= (1u << bucket))) {
+        bucket++;
+    }
+
+    if ((p_hist->count == 0) || (duration_us < p_hist->min_us)) {
+        p_hist->min_us = duration_us;
+    }
+    if (duration_us > p_hist->max_us) {
+        p_hist->max_us = duration_us;
+    }
+    p_hist->count++;
+    p_hist->total_us += duration_us;
+    p_hist->bucket[bucket]++;
+}
+
+/* add the time since a stamp to a stage and invalidate the stamp */
+static void esb_trace_stage_end(esb_trace_report_t *p_report, esb_trace_stage_t stage, esb_trace_stamp_t *p_stamp,
+                                uint32_t cycles, uint32_t cycles_per_us)
+{
+    if (p_stamp->valid == 1) {
+        esb_trace_histogram_add(&p_report->stage[stage], (cycles - p_stamp->cycles) / cycles_per_us);
+        p_stamp->valid = 0;
+    }
+}
+
+int8_t esb_trace_decode(const esb_trace_record_t *p_records, uint32_t num_records, uint32_t cycles_per_us,
+                        esb_trace_report_t *p_report)
+{
+    if ((p_records == NULL) || (p_report == NULL) || (cycles_per_us == 0)) {
+        return (-1);
+    }
+
+    memset(p_report, 0, sizeof(*p_report));
+
+    esb_trace_stamp_t irq = {0};
+    esb_trace_stamp_t rx_slots[ESB_TRACE_DECODE_SLOTS] = {0};
+    esb_trace_stamp_t lookup = {0};
+    esb_trace_stamp_t handler = {0};
+    esb_trace_stamp_t reply = {0};
+    uint32_t tx_cycles[ESB_TRACE_DECODE_TX_DEPTH];
+    uint8_t tx_head = 0;
+    uint8_t tx_count = 0;
+    uint16_t expected_seq = (num_records > 0) ? p_records[0].seq : 0;
+
+    for (uint32_t i = 0; i < num_records; i++) {
+        const esb_trace_record_t *p_record = &p_records[i];
+
+        if (p_record->seq != expected_seq) {
+            /* overwritten while the dump was taken, or written out of order: restart the pairing */
+            p_report->skipped++;
+            expected_seq = p_record->seq + 1;
+            irq.valid = lookup.valid = handler.valid = reply.valid = 0;
+            memset(rx_slots, 0, sizeof(rx_slots));
+            tx_count = 0;
+            continue;
+        }
+        expected_seq++;
+        p_report->records++;
+
+        uint32_t cycles = p_record->cycles;
+
+        switch (p_record->event) {
+            case ESB_TRACE_EVT_RADIO_IRQ:
+                irq = (esb_trace_stamp_t){.cycles = cycles, .valid = 1};
+                break;
+            case ESB_TRACE_EVT_RX_QUEUED:
+                esb_trace_stage_end(p_report, ESB_TRACE_STAGE_ISR, &irq, cycles, cycles_per_us);
+                rx_slots[p_record->arg] = (esb_trace_stamp_t){.cycles = cycles, .valid = 1};
+                break;
+            case ESB_TRACE_EVT_CMD_LOOKUP:
+                esb_trace_stage_end(p_report, ESB_TRACE_STAGE_QUEUE, &rx_slots[p_record->arg], cycles,
+                                    cycles_per_us);
+                lookup = (esb_trace_stamp_t){.cycles = cycles, .valid = 1};
+                reply.valid = 0;
+                break;
+            case ESB_TRACE_EVT_HANDLER_ENTER:
+                esb_trace_stage_end(p_report, ESB_TRACE_STAGE_LOOKUP, &lookup, cycles, cycles_per_us);
+                handler = (esb_trace_stamp_t){.cycles = cycles, .valid = 1};
+                break;
+            case ESB_TRACE_EVT_HANDLER_EXIT:
+                esb_trace_stage_end(p_report, ESB_TRACE_STAGE_HANDLER, &handler, cycles, cycles_per_us);
+                reply = (esb_trace_stamp_t){.cycles = cycles, .valid = 1};
+                break;
+            case ESB_TRACE_EVT_TX_START:
+                esb_trace_stage_end(p_report, ESB_TRACE_STAGE_REPLY, &reply, cycles, cycles_per_us);
+                if (tx_count < ESB_TRACE_DECODE_TX_DEPTH) {
+                    tx_cycles[(tx_head + tx_count) % ESB_TRACE_DECODE_TX_DEPTH] = cycles;
+                    tx_count++;
+                }
+                break;
+            case ESB_TRACE_EVT_TX_DONE:
+                /* frames complete in the order they were written */
+                if (tx_count > 0) {
+                    esb_trace_stamp_t tx = {.cycles = tx_cycles[tx_head], .valid = 1};
+                    esb_trace_stage_end(p_report, ESB_TRACE_STAGE_RADIO, &tx, cycles, cycles_per_us);
+                    tx_head = (tx_head + 1) % ESB_TRACE_DECODE_TX_DEPTH;
+                    tx_count--;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    return (0);
+}
+
+const char *esb_trace_stage_name(esb_trace_stage_t stage)
+{
+    if (stage >= ESB_TRACE_STAGE_NUM) {
+        return ("?");
+    }
+    return (g_stage_names[stage]);
+}
+
+void esb_trace_print_report(const esb_trace_report_t *p_report, FILE *p_file)
+{
+    if ((p_report == NULL) || (p_file == NULL)) {
+        return;
+    }
+
+    fprintf(p_file, "records: %u, skipped: %u\n", p_report->records, p_report->skipped);
+    for (uint8_t stage = 0; stage < ESB_TRACE_STAGE_NUM; stage++) {
+        const esb_trace_histogram_t *p_hist = &p_report->stage[stage];
+
+        if (p_hist->count == 0) {
+            fprintf(p_file, "%-8s no samples\n", esb_trace_stage_name(stage));
+            continue;
+        }
+        fprintf(p_file, "%-8s n=%u min=%uus avg=%uus max=%uus\n", esb_trace_stage_name(stage), p_hist->count,
+                p_hist->min_us, (uint32_t)(p_hist->total_us / p_hist->count), p_hist->max_us);
+        for (uint8_t bucket = 0; bucket < ESB_TRACE_HIST_BUCKETS; bucket++) {
+            if (p_hist->bucket[bucket] == 0) {
+                continue;
+            }
+            uint32_t low = (bucket == 0) ? 0 : (1u << (bucket - 1));
+            if (bucket == (ESB_TRACE_HIST_BUCKETS - 1)) {
+                fprintf(p_file, "    >= %6uus: %u\n", low, p_hist->bucket[bucket]);
+            } else {
+                fprintf(p_file, "    %6u..%6uus: %u\n", low, (1u << bucket) - 1, p_hist->bucket[bucket]);
+            }
+        }
+    }
+}
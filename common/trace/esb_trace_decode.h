@@ -0,0 +1,71 @@
+#ifndef ESB_TRACE_DECODE_H_
+#define ESB_TRACE_DECODE_H_
+
+/*!
+ * \file esb_trace_decode.h
+ * \brief Host-side decoder for dumps of the ESB trace ring (see esb_trace.h)
+ * \details The decoder pairs the events of a dump and sorts the durations of the following stages into
+ * latency histograms:
+ * - ISR:     radio event handler entered until the received frame is queued
+ * - QUEUE:   received frame queued until it is dequeued by esb_protocol_process()
+ * - LOOKUP:  dequeued until the command handler is called
+ * - HANDLER: command handler execution
+ * - REPLY:   command handler returned until the reply frame is written to the radio
+ * - RADIO:   frame written to the radio until it is completed (including waiting for frames ahead of it)
+ *
+ * A dump is the array of ::esb_trace_record_t as returned by esb_trace_read(), or the ring buffer read with
+ * the debugger rotated by g_esb_trace_index. Overwritten or torn records are skipped.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <common/trace/esb_trace.h>
+
+#define ESB_TRACE_HIST_BUCKETS 16 /* bucket 0: < 1us, bucket i: [2^(i-1), 2^i) us, last bucket: all above */
+
+/*! \brief Stages measured by the decoder */
+typedef enum {
+    ESB_TRACE_STAGE_ISR = 0,
+    ESB_TRACE_STAGE_QUEUE,
+    ESB_TRACE_STAGE_LOOKUP,
+    ESB_TRACE_STAGE_HANDLER,
+    ESB_TRACE_STAGE_REPLY,
+    ESB_TRACE_STAGE_RADIO,
+    ESB_TRACE_STAGE_NUM
+} esb_trace_stage_t;
+
+/*! \brief Latency histogram of a stage */
+typedef struct {
+    uint32_t count;                          /* Number of measured durations */
+    uint32_t min_us;                         /* Shortest duration */
+    uint32_t max_us;                         /* Longest duration */
+    uint64_t total_us;                       /* Sum of all durations */
+    uint32_t bucket[ESB_TRACE_HIST_BUCKETS]; /* Number of durations per bucket */
+} esb_trace_histogram_t;
+
+/*! \brief Result of decoding a dump */
+typedef struct {
+    uint32_t records;                                 /* Number of decoded records */
+    uint32_t skipped;                                 /* Number of overwritten or torn records */
+    esb_trace_histogram_t stage[ESB_TRACE_STAGE_NUM]; /* Histogram per stage */
+} esb_trace_report_t;
+
+/*! \brief Decode a dump into per-stage latency histograms
+ *  \param p_records[in]        Records of the dump, oldest first
+ *  \param num_records[in]      Number of records
+ *  \param cycles_per_us[in]    Frequency of the cycle counter (64 for a 64MHz target, 1 on the host backend)
+ *  \param p_report[out]        Histograms, overwritten
+ *  \retval 0                   - OK
+ *  \retval -1                  - NULL Pointer or cycles_per_us is 0
+ */
+int8_t esb_trace_decode(const esb_trace_record_t *p_records, uint32_t num_records, uint32_t cycles_per_us,
+                        esb_trace_report_t *p_report);
+
+/*! \brief Get the name of a stage */
+const char *esb_trace_stage_name(esb_trace_stage_t stage);
+
+/*! \brief Print the histograms of a report as text */
+void esb_trace_print_report(const esb_trace_report_t *p_report, FILE *p_file);
+
+#endif /* ESB_TRACE_DECODE_H_ */